@@ -0,0 +1,90 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Battery level from sparse voltage samples and coulomb counting
+ */
+
+#include "battery.h"
+
+/* nC in 0.5 % of one mAh: 3.6 C / 200 */
+#define NC_PER_MAH_X2           18000000ULL
+
+/* Estimate and sample may differ by this much (0.5 %) before the sample wins */
+#define REANCHOR_BAND_X2        4
+
+const battery_curve_point_t battery_curve_liion[BATTERY_CURVE_LIION_LEN] = {
+    { 4200, 200 },
+    { 4100, 180 },
+    { 3980, 150 },
+    { 3870, 120 },
+    { 3840, 100 },
+    { 3800, 80 },
+    { 3770, 60 },
+    { 3730, 40 },
+    { 3690, 20 },
+    { 3610, 10 },
+    { 3270, 0 },
+};
+
+uint8_t battery_curve_percent_x2(const battery_curve_point_t *curve, uint8_t len, uint16_t mv)
+{
+    if (len == 0) {
+        return 0;
+    }
+    if (mv >= curve[0].mv) {
+        return curve[0].percent_x2;
+    }
+    for (uint8_t i = 1; i < len; i++) {
+        const battery_curve_point_t *hi = &curve[i - 1];
+        const battery_curve_point_t *lo = &curve[i];
+        if (mv >= lo->mv) {
+            uint32_t span = hi->mv - lo->mv;
+            uint32_t rise = hi->percent_x2 - lo->percent_x2;
+            return lo->percent_x2 + ((mv - lo->mv) * rise + span / 2) / span;
+        }
+    }
+    return curve[len - 1].percent_x2;
+}
+
+bool battery_sample_due(const battery_config_t *config, const battery_state_t *state)
+{
+    return !state->valid || state->wakes >= config->sample_every;
+}
+
+void battery_update_voltage(const battery_config_t *config, battery_state_t *state, uint16_t mv)
+{
+    uint8_t measured = battery_curve_percent_x2(config->curve, config->curve_len, mv);
+
+    if (state->valid) {
+        uint8_t estimate = battery_percent_x2(config, state);
+        int diff = (int)measured - estimate;
+        if (diff >= -REANCHOR_BAND_X2 && diff <= REANCHOR_BAND_X2) {
+            measured = estimate;
+        }
+    }
+
+    state->valid = true;
+    state->anchor_x2 = measured;
+    state->voltage_mv = mv;
+    state->wakes = 0;
+    state->used_nc = 0;
+}
+
+uint64_t battery_charge_nc(const battery_load_t *load, uint32_t active_ms, uint32_t rx_ms,
+                           uint32_t idle_ua, uint32_t idle_ms)
+{
+    return (uint64_t)load->active_ua * active_ms + (uint64_t)load->rx_ua * rx_ms +
+           (uint64_t)idle_ua * idle_ms;
+}
+
+uint8_t battery_percent_x2(const battery_config_t *config, const battery_state_t *state)
+{
+    if (!state->valid) {
+        return 0xFF;
+    }
+    if (config->capacity_mah == 0) {
+        return state->anchor_x2;
+    }
+    uint64_t used_x2 = state->used_nc / ((uint64_t)config->capacity_mah * NC_PER_MAH_X2);
+    return used_x2 >= state->anchor_x2 ? 0 : state->anchor_x2 - used_x2;
+}
@@ -0,0 +1,117 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Oversampled battery voltage reading
+ */
+
+#include "battery.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+
+static const char *TAG = "battery";
+
+#define BATTERY_ADC_ATTEN           ADC_ATTEN_DB_12
+#define BATTERY_ADC_BITS            12
+#define BATTERY_ADC_FULL_SCALE_MV   3300    /* Nominal, without eFuse calibration */
+
+/* Calibration handle for the channel, NULL when the chip has no calibration data */
+static adc_cali_handle_t battery_cali_create(int channel)
+{
+    adc_cali_handle_t cali = NULL;
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t cali_config = {
+        .unit_id = ADC_UNIT_1,
+        .chan = channel,
+        .atten = BATTERY_ADC_ATTEN,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    if (adc_cali_create_scheme_curve_fitting(&cali_config, &cali) != ESP_OK) {
+        cali = NULL;
+    }
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    adc_cali_line_fitting_config_t cali_config = {
+        .unit_id = ADC_UNIT_1,
+        .atten = BATTERY_ADC_ATTEN,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    if (adc_cali_create_scheme_line_fitting(&cali_config, &cali) != ESP_OK) {
+        cali = NULL;
+    }
+#endif
+    return cali;
+}
+
+static void battery_cali_delete(adc_cali_handle_t cali)
+{
+    if (cali == NULL) {
+        return;
+    }
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_delete_scheme_curve_fitting(cali);
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    adc_cali_delete_scheme_line_fitting(cali);
+#endif
+}
+
+/**
+ * @brief Pin voltage in 1/4 mV from an average raw value in 1/4 LSB
+ *
+ * The calibration maps whole codes only; the two fraction bits are
+ * interpolated between the neighbouring codes.
+ */
+static uint32_t battery_pin_mv_x4(adc_cali_handle_t cali, uint32_t raw_x4)
+{
+    int raw = raw_x4 >> 2;
+    uint32_t frac = raw_x4 & 3;
+    int mv0, mv1;
+
+    if (cali == NULL || adc_cali_raw_to_voltage(cali, raw, &mv0) != ESP_OK ||
+        adc_cali_raw_to_voltage(cali, raw + 1, &mv1) != ESP_OK) {
+        return raw_x4 * BATTERY_ADC_FULL_SCALE_MV >> BATTERY_ADC_BITS;
+    }
+    return mv0 * 4 + (mv1 - mv0) * (int)frac;
+}
+
+esp_err_t battery_read_mv(const battery_config_t *config, uint16_t *mv)
+{
+    uint8_t shift = config->oversample_log2 < 2 ? 2 : (config->oversample_log2 > 8 ? 8 : config->oversample_log2);
+    adc_oneshot_unit_handle_t unit;
+    adc_oneshot_unit_init_cfg_t unit_config = {
+        .unit_id = ADC_UNIT_1,
+    };
+    ESP_RETURN_ON_ERROR(adc_oneshot_new_unit(&unit_config, &unit), TAG, "Failed to create ADC unit");
+
+    adc_oneshot_chan_cfg_t channel_config = {
+        .atten = BATTERY_ADC_ATTEN,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    esp_err_t ret = adc_oneshot_config_channel(unit, config->adc_channel, &channel_config);
+
+    // One burst; the sum of up to 256 12-bit codes fits easily
+    uint32_t sum = 0;
+    for (uint32_t i = 0; ret == ESP_OK && i < (1U << shift); i++) {
+        int raw;
+        ret = adc_oneshot_read(unit, config->adc_channel, &raw);
+        sum += raw;
+    }
+
+    if (ret == ESP_OK) {
+        // Average with two fraction bits, rounded
+        uint8_t drop = shift - 2;
+        uint32_t raw_x4 = drop ? (sum + (1U << (drop - 1))) >> drop : sum;
+        adc_cali_handle_t cali = battery_cali_create(config->adc_channel);
+        uint32_t pin_mv_x4 = battery_pin_mv_x4(cali, raw_x4);
+        battery_cali_delete(cali);
+        *mv = (pin_mv_x4 * config->divider + 2) / 4;
+        ESP_LOGI(TAG, "Battery %u mV (%u conversions, raw %lu.%02lu)", *mv, 1U << shift,
+                 (unsigned long)(raw_x4 >> 2), (unsigned long)(raw_x4 & 3) * 25);
+    } else {
+        ESP_LOGW(TAG, "ADC read failed: %s", esp_err_to_name(ret));
+    }
+
+    adc_oneshot_del_unit(unit);
+    return ret;
+}
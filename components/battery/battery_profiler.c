@@ -0,0 +1,33 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Battery charge of a wake from the wake profiler phases
+ */
+
+#include "battery.h"
+#include "esp_timer.h"
+#include "wake_profiler.h"
+
+static uint32_t phase_ms(wake_phase_t phase)
+{
+    int64_t us = wake_profiler_duration_us(phase);
+    return us > 0 ? us / 1000 : 0;
+}
+
+void battery_account_wake(const battery_config_t *config, battery_state_t *state,
+                          uint32_t sleep_s, uint32_t sleep_ua)
+{
+    int64_t awake_us = esp_timer_get_time() - wake_profiler_start_us(WAKE_PHASE_AWAKE);
+    uint32_t awake_ms = awake_us > 0 ? awake_us / 1000 : 0;
+    uint32_t rx_ms = phase_ms(WAKE_PHASE_REJOIN) + phase_ms(WAKE_PHASE_REPORT);
+    if (rx_ms > awake_ms) {
+        rx_ms = awake_ms;
+    }
+
+    uint64_t nc = battery_charge_nc(&config->load, awake_ms - rx_ms, rx_ms, sleep_ua, sleep_s * 1000);
+    state->used_nc += nc;
+    state->total_nc += nc;
+    if (state->wakes < UINT16_MAX) {
+        state->wakes++;
+    }
+}
@@ -0,0 +1,41 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Battery level as the ZCL Power Configuration cluster
+ */
+
+#include "battery_zcl.h"
+
+/* Attribute storage */
+static uint8_t s_voltage;
+static uint8_t s_percentage;
+
+static void battery_zcl_values(const battery_config_t *config, const battery_state_t *state)
+{
+    s_voltage = state->valid ? (state->voltage_mv + 50) / 100 : 0xFF;
+    s_percentage = battery_percent_x2(config, state);
+}
+
+esp_zb_attribute_list_t *battery_zcl_cluster_create(const battery_config_t *config, const battery_state_t *state)
+{
+    battery_zcl_values(config, state);
+
+    esp_zb_power_config_cluster_cfg_t power_cfg = {0};
+    esp_zb_attribute_list_t *cluster = esp_zb_power_config_cluster_create(&power_cfg);
+    esp_zb_power_config_cluster_add_attr(cluster, ESP_ZB_ZCL_ATTR_POWER_CONFIG_BATTERY_VOLTAGE_ID, &s_voltage);
+    esp_zb_power_config_cluster_add_attr(cluster, ESP_ZB_ZCL_ATTR_POWER_CONFIG_BATTERY_PERCENTAGE_REMAINING_ID,
+                                         &s_percentage);
+    return cluster;
+}
+
+void battery_zcl_update(uint8_t endpoint, const battery_config_t *config, const battery_state_t *state)
+{
+    battery_zcl_values(config, state);
+
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_zb_zcl_set_attribute_val(endpoint, ESP_ZB_ZCL_CLUSTER_ID_POWER_CONFIG, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 ESP_ZB_ZCL_ATTR_POWER_CONFIG_BATTERY_VOLTAGE_ID, &s_voltage, false);
+    esp_zb_zcl_set_attribute_val(endpoint, ESP_ZB_ZCL_CLUSTER_ID_POWER_CONFIG, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 ESP_ZB_ZCL_ATTR_POWER_CONFIG_BATTERY_PERCENTAGE_REMAINING_ID, &s_percentage, false);
+    esp_zb_lock_release();
+}
@@ -0,0 +1,158 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Battery level from sparse voltage samples and coulomb counting
+ *
+ * Reading the ADC costs a burst of conversions and, on a cell with a flat
+ * discharge curve, says little between two samples. The battery voltage is
+ * therefore sampled only once every few wakes; in between, the charge each
+ * wake and the sleep after it draw is estimated from the time the wake
+ * profiler measured per phase and the currents of the power states, and
+ * subtracted from the level of the last sample. A voltage sample that
+ * differs from the estimate by more than 2 points, in either direction,
+ * re-anchors it, so the counting error stays within 2 points.
+ *
+ * The state is meant to live in RTC memory.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief One point of a discharge curve
+ */
+typedef struct {
+    uint16_t mv;                /**< Cell voltage */
+    uint8_t percent_x2;         /**< Remaining capacity in 0.5 % (ZCL units) */
+} battery_curve_point_t;
+
+/**
+ * @brief Currents of the power states, for coulomb counting
+ */
+typedef struct {
+    uint32_t active_ua;         /**< CPU running, radio off */
+    uint32_t rx_ua;             /**< Radio on (rejoin, reports), CPU included */
+} battery_load_t;
+
+/**
+ * @brief Battery and ADC settings
+ */
+typedef struct {
+    int adc_channel;                    /**< ADC1 channel of the divided battery voltage */
+    uint8_t divider;                    /**< Battery voltage / ADC pin voltage */
+    uint8_t oversample_log2;            /**< 2^n conversions per sample, 2..8 */
+    uint16_t sample_every;              /**< Wakes per voltage sample */
+    uint16_t capacity_mah;              /**< Usable capacity */
+    const battery_curve_point_t *curve; /**< Discharge curve, voltage descending */
+    uint8_t curve_len;                  /**< Points in curve */
+    battery_load_t load;                /**< Currents while awake */
+} battery_config_t;
+
+/**
+ * @brief Li-ion / LiPo cell at a low discharge rate
+ */
+#define BATTERY_CURVE_LIION_LEN     11
+extern const battery_curve_point_t battery_curve_liion[BATTERY_CURVE_LIION_LEN];
+
+/**
+ * @brief Rounded typical currents of the chip
+ */
+#if CONFIG_IDF_TARGET_ESP32H2
+#define BATTERY_LOAD_DEFAULT()      { .active_ua = 20000, .rx_ua = 24000 }
+#else
+#define BATTERY_LOAD_DEFAULT()      { .active_ua = 38000, .rx_ua = 74000 }
+#endif
+
+/**
+ * @brief Retained estimator state
+ */
+typedef struct {
+    bool valid;                 /**< A voltage sample has been taken */
+    uint8_t anchor_x2;          /**< Level at the last voltage sample, 0.5 % */
+    uint16_t voltage_mv;        /**< Last voltage sample */
+    uint16_t wakes;             /**< Wakes since the last voltage sample */
+    uint64_t used_nc;           /**< Charge drawn since the last voltage sample, nC */
+    uint64_t total_nc;          /**< Charge drawn since power-on, nC */
+} battery_state_t;
+
+/**
+ * @brief Level of a voltage on a discharge curve, interpolated linearly
+ *
+ * @return Remaining capacity in 0.5 %, clamped to the ends of the curve
+ */
+uint8_t battery_curve_percent_x2(const battery_curve_point_t *curve, uint8_t len, uint16_t mv);
+
+/**
+ * @brief Whether this wake should sample the voltage
+ */
+bool battery_sample_due(const battery_config_t *config, const battery_state_t *state);
+
+/**
+ * @brief Take one oversampled reading of the battery voltage
+ *
+ * Creates the ADC unit, runs one burst of 2^oversample_log2 conversions and
+ * releases the unit again. The sum keeps two bits beyond the converter's
+ * resolution, which the calibrated conversion interpolates in fixed point.
+ *
+ * @param config Settings
+ * @param[out] mv Battery voltage
+ * @return ESP_OK on success, ADC driver error otherwise
+ */
+esp_err_t battery_read_mv(const battery_config_t *config, uint16_t *mv);
+
+/**
+ * @brief Re-anchor the estimate on a voltage sample
+ *
+ * The sample replaces the estimate when the two are more than 2 points
+ * apart, whether the count ran ahead or behind or the battery was replaced
+ * or charged. Within 2 points the estimate is kept, so ADC noise and the
+ * voltage recovering at rest do not make the level jump back and forth.
+ */
+void battery_update_voltage(const battery_config_t *config, battery_state_t *state, uint16_t mv);
+
+/**
+ * @brief Charge of an interval with the radio on for part of it
+ *
+ * @param load Currents
+ * @param active_ms Time with the CPU running and the radio off
+ * @param rx_ms Time with the radio on
+ * @param idle_ua Current for idle_ms
+ * @param idle_ms Time asleep
+ * @return Charge in nC (µA·ms)
+ */
+uint64_t battery_charge_nc(const battery_load_t *load, uint32_t active_ms, uint32_t rx_ms,
+                           uint32_t idle_ua, uint32_t idle_ms);
+
+/**
+ * @brief Count the charge of the current wake and the sleep after it
+ *
+ * Takes the time awake so far and the rejoin and report phases (radio on)
+ * from the wake profiler. Call right before sleeping, ahead of
+ * wake_profiler_sleep().
+ *
+ * @param config Settings
+ * @param state Estimator state, updated
+ * @param sleep_s Time until the next wake
+ * @param sleep_ua Average current until then
+ */
+void battery_account_wake(const battery_config_t *config, battery_state_t *state,
+                          uint32_t sleep_s, uint32_t sleep_ua);
+
+/**
+ * @brief Current level estimate
+ *
+ * @return Remaining capacity in 0.5 % (ZCL BatteryPercentageRemaining), 0xFF before the first sample
+ */
+uint8_t battery_percent_x2(const battery_config_t *config, const battery_state_t *state);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,39 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Battery level as the ZCL Power Configuration cluster
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_zigbee_core.h"
+#include "battery.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Create the Power Configuration cluster with the battery attributes
+ *
+ * BatteryVoltage (100 mV) and BatteryPercentageRemaining (0.5 %) start
+ * from state. Add the result to the endpoint's cluster list as a server
+ * cluster.
+ *
+ * @return Attribute list of the cluster
+ */
+esp_zb_attribute_list_t *battery_zcl_cluster_create(const battery_config_t *config, const battery_state_t *state);
+
+/**
+ * @brief Write the current estimate into the cluster's attributes
+ *
+ * Takes the Zigbee lock; do not call with the lock held.
+ *
+ * @param endpoint Endpoint the cluster was registered on
+ */
+void battery_zcl_update(uint8_t endpoint, const battery_config_t *config, const battery_state_t *state);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,423 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Persistent log in a flash partition
+ */
+
+#include "flash_log.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include "esp_attr.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+static const char *TAG = "flash_log";
+
+#define FLASH_LOG_STATE_MAGIC           0x464C5354
+#define FLASH_LOG_BUFFER_SIZE           CONFIG_FLASH_LOG_BUFFER_SIZE
+#define FLASH_LOG_BODY_SIZE             (FLASH_LOG_SECTOR_SIZE - sizeof(flash_log_sector_t))
+
+_Static_assert(FLASH_LOG_BUFFER_SIZE >= FLASH_LOG_HEADER_SIZE + FLASH_LOG_TEXT_MAX,
+               "CONFIG_FLASH_LOG_BUFFER_SIZE must hold the longest record");
+
+/**
+ * Write position and buffer fill. Kept in RTC memory next to the buffer and
+ * sealed with a CRC, so both are trusted after a reset only if intact.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t address;                   /* Partition offset, detects a changed partition table */
+    uint32_t sector;                    /* Sector being filled */
+    uint32_t used;                      /* Bytes programmed in it, header included */
+    uint32_t seq;                       /* Its sequence number */
+    uint16_t boot;
+    uint16_t buffered;                  /* Bytes in s_buffer */
+    uint32_t crc;
+} flash_log_state_t;
+
+static RTC_NOINIT_ATTR flash_log_state_t s_state;
+static RTC_NOINIT_ATTR uint8_t s_buffer[FLASH_LOG_BUFFER_SIZE];
+
+static const esp_partition_t *s_partition;
+static uint32_t s_sectors;
+static SemaphoreHandle_t s_mutex;
+static vprintf_like_t s_vprintf;
+
+static uint32_t flash_log_state_crc(void)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)&s_state, offsetof(flash_log_state_t, crc));
+}
+
+static void flash_log_seal(void)
+{
+    s_state.crc = flash_log_state_crc();
+}
+
+static bool flash_log_state_valid(void)
+{
+    return s_state.magic == FLASH_LOG_STATE_MAGIC &&
+           s_state.address == s_partition->address &&
+           s_state.sector < s_sectors &&
+           s_state.used <= FLASH_LOG_SECTOR_SIZE &&
+           s_state.buffered <= FLASH_LOG_BUFFER_SIZE &&
+           s_state.crc == flash_log_state_crc();
+}
+
+static bool flash_log_lock(void)
+{
+    // A log line from inside the flash log (e.g. a flash driver error) is dropped
+    if (!s_mutex || xSemaphoreGetMutexHolder(s_mutex) == xTaskGetCurrentTaskHandle()) {
+        return false;
+    }
+    return xSemaphoreTake(s_mutex, portMAX_DELAY) == pdTRUE;
+}
+
+static void flash_log_unlock(void)
+{
+    xSemaphoreGive(s_mutex);
+}
+
+// Erase a sector and give it a header
+static esp_err_t flash_log_next_sector(uint32_t sector)
+{
+    flash_log_sector_t header;
+    uint32_t offset = sector * FLASH_LOG_SECTOR_SIZE;
+
+    flash_log_sector_init(&header, s_state.seq + 1, s_state.boot);
+    esp_err_t ret = esp_partition_erase_range(s_partition, offset, FLASH_LOG_SECTOR_SIZE);
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(s_partition, offset, &header, sizeof(header));
+    }
+    // Move on even after an error, so a bad sector is skipped next time
+    s_state.sector = sector;
+    s_state.seq = header.seq;
+    s_state.used = ret == ESP_OK ? sizeof(header) : FLASH_LOG_SECTOR_SIZE;
+    flash_log_seal();
+    return ret;
+}
+
+static esp_err_t flash_log_flush_locked(void)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (!s_state.buffered) {
+        return ESP_OK;
+    }
+    // Only after a rescan found less room than the buffer was filled for
+    if (s_state.used + s_state.buffered > FLASH_LOG_SECTOR_SIZE) {
+        flash_log_next_sector((s_state.sector + 1) % s_sectors);
+    }
+    if (s_state.used + s_state.buffered <= FLASH_LOG_SECTOR_SIZE) {
+        ret = esp_partition_write(s_partition, s_state.sector * FLASH_LOG_SECTOR_SIZE + s_state.used,
+                                  s_buffer, s_state.buffered);
+        s_state.used += s_state.buffered;
+    }
+    s_state.buffered = 0;
+    flash_log_seal();
+    return ret;
+}
+
+static void flash_log_append(esp_log_level_t level, const char *tag, const char *text)
+{
+    char line[FLASH_LOG_TEXT_MAX + 1];
+    int len = tag ? snprintf(line, sizeof(line), "%s: %s", tag, text) : snprintf(line, sizeof(line), "%s", text);
+    if (len < 0) {
+        return;
+    }
+    if (len > FLASH_LOG_TEXT_MAX) {
+        len = FLASH_LOG_TEXT_MAX;
+    }
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+        len--;
+    }
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    flash_log_record_t record = {
+        .level = level,
+        .boot = s_state.boot,
+        .time_s = now.tv_sec,
+        .time_ms = now.tv_usec / 1000,
+        .len = len,
+        .text = line,
+    };
+    size_t size = FLASH_LOG_HEADER_SIZE + len;
+
+    // Records never cross a sector, and the buffer is programmed as one write
+    if (s_state.used + s_state.buffered + size > FLASH_LOG_SECTOR_SIZE) {
+        flash_log_flush_locked();
+        if (s_state.used + size > FLASH_LOG_SECTOR_SIZE) {
+            flash_log_next_sector((s_state.sector + 1) % s_sectors);
+        }
+    } else if (s_state.buffered + size > FLASH_LOG_BUFFER_SIZE) {
+        flash_log_flush_locked();
+    }
+    if (s_state.used + size > FLASH_LOG_SECTOR_SIZE) {
+        return;
+    }
+    s_state.buffered += flash_log_encode(&s_buffer[s_state.buffered], FLASH_LOG_BUFFER_SIZE - s_state.buffered, &record);
+    flash_log_seal();
+}
+
+typedef struct {
+    uint16_t boot;
+    uint32_t records;
+} flash_log_scan_t;
+
+static bool flash_log_scan_visit(const flash_log_record_t *record, void *arg)
+{
+    flash_log_scan_t *scan = arg;
+
+    if ((int16_t)(record->boot - scan->boot) > 0) {
+        scan->boot = record->boot;
+    }
+    scan->records++;
+    return true;
+}
+
+// Find the newest sector and the end of its data; used is 0 if there is none
+static esp_err_t flash_log_scan(void)
+{
+    const void *image;
+    esp_partition_mmap_handle_t handle;
+
+    esp_err_t ret = esp_partition_mmap(s_partition, 0, s_partition->size, ESP_PARTITION_MMAP_DATA, &image, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    int newest = flash_log_newest_sector(image, s_partition->size);
+    s_state.used = 0;
+    if (newest >= 0) {
+        const uint8_t *sector = (const uint8_t *)image + newest * FLASH_LOG_SECTOR_SIZE;
+        flash_log_sector_t header;
+        flash_log_scan_t scan = { 0 };
+        size_t end;
+
+        memcpy(&header, sector, sizeof(header));
+        scan.boot = header.boot;
+        flash_log_walk_records(sector + sizeof(header), FLASH_LOG_BODY_SIZE, flash_log_scan_visit, &scan, &end);
+
+        s_state.sector = newest;
+        s_state.seq = header.seq;
+        s_state.used = sizeof(header) + end;
+        if ((int16_t)(scan.boot - s_state.boot) > 0) {
+            s_state.boot = scan.boot;
+        }
+
+        // Anything but erased flash after the last record is a cut-short write: leave the sector
+        for (size_t i = s_state.used; i < FLASH_LOG_SECTOR_SIZE; i++) {
+            if (sector[i] != 0xFF) {
+                s_state.used = FLASH_LOG_SECTOR_SIZE;
+                break;
+            }
+        }
+        ESP_LOGD(TAG, "Sector %d (seq %lu) holds %lu records, %lu bytes used", newest,
+                 (unsigned long)header.seq, (unsigned long)scan.records, (unsigned long)s_state.used);
+    }
+    esp_partition_munmap(handle);
+    flash_log_seal();
+    return ESP_OK;
+}
+
+esp_err_t flash_log_init(void)
+{
+    s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                           CONFIG_FLASH_LOG_PARTITION_LABEL);
+    if (!s_partition) {
+        ESP_LOGW(TAG, "No \"%s\" partition", CONFIG_FLASH_LOG_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_sectors = s_partition->size / FLASH_LOG_SECTOR_SIZE;
+    if (s_sectors < 2) {
+        ESP_LOGW(TAG, "Partition \"%s\" needs at least two sectors", CONFIG_FLASH_LOG_PARTITION_LABEL);
+        s_partition = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (!flash_log_state_valid()) {
+        memset(&s_state, 0, sizeof(s_state));
+        s_state.magic = FLASH_LOG_STATE_MAGIC;
+        s_state.address = s_partition->address;
+    }
+
+    // A deep-sleep wake trusts the RTC state; anything else, e.g. flashing over serial, may have changed the partition
+    esp_err_t ret = ESP_OK;
+    if (reason != ESP_RST_DEEPSLEEP || s_state.used == 0) {
+        ret = flash_log_scan();
+        s_state.boot++;
+        flash_log_seal();
+        if (ret == ESP_OK && s_state.used == 0) {
+            s_state.seq = 0;
+            ret = flash_log_next_sector(0);
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open log: %s", esp_err_to_name(ret));
+        s_partition = NULL;
+        return ret;
+    }
+
+    s_mutex = xSemaphoreCreateMutex();
+    if (!s_mutex) {
+        s_partition = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (reason != ESP_RST_DEEPSLEEP) {
+        bool fault = reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT ||
+                     reason == ESP_RST_WDT || reason == ESP_RST_BROWNOUT;
+        char text[32];
+        snprintf(text, sizeof(text), "boot %u, reset reason %d", s_state.boot, reason);
+        flash_log_lock();
+        flash_log_append(fault ? ESP_LOG_WARN : ESP_LOG_INFO, TAG, text);
+        flash_log_unlock();
+    }
+    return ESP_OK;
+}
+
+void flash_log_write(esp_log_level_t level, const char *tag, const char *text)
+{
+    if (!flash_log_enabled(level) || !s_partition || !flash_log_lock()) {
+        return;
+    }
+    flash_log_append(level, tag, text);
+    flash_log_unlock();
+}
+
+static int flash_log_vprintf(const char *format, va_list args)
+{
+    va_list copy;
+    va_copy(copy, args);
+    int ret = s_vprintf(format, args);
+
+    // ESP_LOGx formats start with an optional color sequence and the level letter
+    const char *f = format;
+    if (*f == '\033') {
+        f = strchr(f, 'm');
+        f = f ? f + 1 : "";
+    }
+    esp_log_level_t level = *f == 'E' ? ESP_LOG_ERROR : *f == 'W' ? ESP_LOG_WARN :
+                            *f == 'I' ? ESP_LOG_INFO : *f == 'D' ? ESP_LOG_DEBUG :
+                            *f == 'V' ? ESP_LOG_VERBOSE : ESP_LOG_NONE;
+    if (flash_log_enabled(level) && f[1] == ' ' && f[2] == '(') {
+        char line[FLASH_LOG_TEXT_MAX + 32];
+        vsnprintf(line, sizeof(line), format, copy);
+
+        // Keep "TAG: message": drop everything up to the timestamp and the color reset
+        char *text = strstr(line, ") ");
+        if (text) {
+            text += 2;
+            char *reset = strchr(text, '\033');
+            if (reset) {
+                *reset = '\0';
+            }
+            flash_log_write(level, NULL, text);
+        }
+    }
+    va_end(copy);
+    return ret;
+}
+
+void flash_log_capture_esp_log(void)
+{
+    if (!s_vprintf) {
+        s_vprintf = esp_log_set_vprintf(flash_log_vprintf);
+    }
+}
+
+uint16_t flash_log_boot(void)
+{
+    return s_partition ? s_state.boot : 0;
+}
+
+esp_err_t flash_log_flush(void)
+{
+    if (!s_partition) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!flash_log_lock()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = flash_log_flush_locked();
+    flash_log_unlock();
+    return ret;
+}
+
+typedef struct {
+    size_t skip;
+    size_t visited;
+    bool stopped;
+    flash_log_visit_t visit;
+    void *arg;
+} flash_log_recent_t;
+
+static bool flash_log_recent_visit(const flash_log_record_t *record, void *arg)
+{
+    flash_log_recent_t *recent = arg;
+
+    if (recent->skip) {
+        recent->skip--;
+        return true;
+    }
+    recent->visited++;
+    recent->stopped = !recent->visit(record, recent->arg);
+    return !recent->stopped;
+}
+
+size_t flash_log_recent(size_t count, flash_log_visit_t visit, void *arg)
+{
+    const void *image;
+    esp_partition_mmap_handle_t handle;
+
+    if (!s_partition || !flash_log_lock()) {
+        return 0;
+    }
+    if (esp_partition_mmap(s_partition, 0, s_partition->size, ESP_PARTITION_MMAP_DATA, &image, &handle) != ESP_OK) {
+        flash_log_unlock();
+        return 0;
+    }
+
+    // Count first, then skip all but the newest
+    size_t total = flash_log_walk_image(image, s_partition->size, NULL, NULL) +
+                   flash_log_walk_records(s_buffer, s_state.buffered, NULL, NULL, NULL);
+    flash_log_recent_t recent = {
+        .skip = total > count ? total - count : 0,
+        .visit = visit,
+        .arg = arg,
+    };
+    flash_log_walk_image(image, s_partition->size, flash_log_recent_visit, &recent);
+    if (!recent.stopped) {
+        flash_log_walk_records(s_buffer, s_state.buffered, flash_log_recent_visit, &recent, NULL);
+    }
+    esp_partition_munmap(handle);
+    flash_log_unlock();
+    return recent.visited;
+}
+
+static bool flash_log_print_visit(const flash_log_record_t *record, void *arg)
+{
+    char line[FLASH_LOG_TEXT_MAX + 32];
+
+    flash_log_format_line(line, sizeof(line), record);
+    printf("%s\n", line);
+    return true;
+}
+
+void flash_log_dump(size_t count)
+{
+    if (!s_partition) {
+        printf("flash log not available\n");
+        return;
+    }
+    printf("--- flash log, boot %u, newest %u records ---\n", s_state.boot, (unsigned)count);
+    flash_log_recent(count, flash_log_print_visit, NULL);
+    printf("--- end of flash log ---\n");
+}
@@ -0,0 +1,170 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * On-flash layout of the persistent log
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "flash_log_format.h"
+
+uint8_t flash_log_crc8(uint8_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    /* CRC-8, polynomial 0x07 */
+    while (len--) {
+        crc ^= *p++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 0x80 ? (uint8_t)(crc << 1) ^ 0x07 : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+void flash_log_sector_init(flash_log_sector_t *sector, uint32_t seq, uint16_t boot)
+{
+    sector->magic = FLASH_LOG_SECTOR_MAGIC;
+    sector->seq = seq;
+    sector->boot = boot;
+    sector->reserved = 0xFF;
+    sector->crc = flash_log_crc8(0, sector, offsetof(flash_log_sector_t, crc));
+}
+
+bool flash_log_sector_valid(const uint8_t *buf)
+{
+    flash_log_sector_t sector;
+
+    memcpy(&sector, buf, sizeof(sector));
+    return sector.magic == FLASH_LOG_SECTOR_MAGIC &&
+           sector.crc == flash_log_crc8(0, &sector, offsetof(flash_log_sector_t, crc));
+}
+
+static uint8_t flash_log_record_crc(const flash_log_header_t *header, const void *text)
+{
+    flash_log_header_t h = *header;
+
+    h.crc = 0;
+    return flash_log_crc8(flash_log_crc8(0, &h, sizeof(h)), text, h.len);
+}
+
+size_t flash_log_encode(uint8_t *buf, size_t len, const flash_log_record_t *record)
+{
+    flash_log_header_t header = {
+        .magic = FLASH_LOG_RECORD_MAGIC,
+        .level = record->level,
+        .len = record->len,
+        .boot = record->boot,
+        .time_ms = record->time_ms,
+        .time_s = record->time_s,
+    };
+
+    if (len < sizeof(header) + record->len) {
+        return 0;
+    }
+    header.crc = flash_log_record_crc(&header, record->text);
+    memcpy(buf, &header, sizeof(header));
+    memcpy(buf + sizeof(header), record->text, record->len);
+    return sizeof(header) + record->len;
+}
+
+size_t flash_log_decode(const uint8_t *buf, size_t len, flash_log_record_t *record)
+{
+    flash_log_header_t header;
+
+    if (len < sizeof(header) || buf[0] != FLASH_LOG_RECORD_MAGIC) {
+        return 0;
+    }
+    memcpy(&header, buf, sizeof(header));
+    if (len < sizeof(header) + header.len || header.crc != flash_log_record_crc(&header, buf + sizeof(header))) {
+        return 0;
+    }
+    record->level = header.level;
+    record->boot = header.boot;
+    record->time_s = header.time_s;
+    record->time_ms = header.time_ms;
+    record->len = header.len;
+    record->text = (const char *)buf + sizeof(header);
+    return sizeof(header) + header.len;
+}
+
+/* Visit records until the data ends or visit asks to stop; returns false on a stop */
+static bool flash_log_walk(const uint8_t *buf, size_t len, flash_log_visit_t visit, void *arg,
+                           size_t *count, size_t *end)
+{
+    flash_log_record_t record;
+    size_t pos = 0, n;
+    bool more = true;
+
+    while (more && (n = flash_log_decode(buf + pos, len - pos, &record)) != 0) {
+        pos += n;
+        (*count)++;
+        more = !visit || visit(&record, arg);
+    }
+    if (end) {
+        *end = pos;
+    }
+    return more;
+}
+
+size_t flash_log_walk_records(const uint8_t *buf, size_t len, flash_log_visit_t visit, void *arg, size_t *end)
+{
+    size_t count = 0;
+
+    flash_log_walk(buf, len, visit, arg, &count, end);
+    return count;
+}
+
+int flash_log_newest_sector(const uint8_t *image, size_t size)
+{
+    int newest = -1;
+    uint32_t newest_seq = 0;
+
+    for (size_t i = 0; i < size / FLASH_LOG_SECTOR_SIZE; i++) {
+        const uint8_t *p = image + i * FLASH_LOG_SECTOR_SIZE;
+        flash_log_sector_t sector;
+        if (!flash_log_sector_valid(p)) {
+            continue;
+        }
+        memcpy(&sector, p, sizeof(sector));
+        /* Serial-number order, so the sequence may wrap */
+        if (newest < 0 || (int32_t)(sector.seq - newest_seq) > 0) {
+            newest = i;
+            newest_seq = sector.seq;
+        }
+    }
+    return newest;
+}
+
+size_t flash_log_walk_image(const uint8_t *image, size_t size, flash_log_visit_t visit, void *arg)
+{
+    size_t sectors = size / FLASH_LOG_SECTOR_SIZE;
+    int newest = flash_log_newest_sector(image, size);
+    size_t count = 0;
+
+    if (newest < 0) {
+        return 0;
+    }
+    for (size_t i = 1; i <= sectors; i++) {
+        const uint8_t *p = image + ((newest + i) % sectors) * FLASH_LOG_SECTOR_SIZE;
+        if (flash_log_sector_valid(p) &&
+            !flash_log_walk(p + sizeof(flash_log_sector_t), FLASH_LOG_SECTOR_SIZE - sizeof(flash_log_sector_t),
+                            visit, arg, &count, NULL)) {
+            break;
+        }
+    }
+    return count;
+}
+
+size_t flash_log_format_line(char *buf, size_t len, const flash_log_record_t *record)
+{
+    static const char letters[] = "NEWIDV";
+    char letter = record->level < sizeof(letters) - 1 ? letters[record->level] : '?';
+
+    int n = snprintf(buf, len, "%c %u %lu.%03u %.*s", letter, record->boot, (unsigned long)record->time_s,
+                     record->time_ms, record->len, record->text);
+    if (n < 0) {
+        return 0;
+    }
+    return (size_t)n < len ? (size_t)n : len - 1;
+}
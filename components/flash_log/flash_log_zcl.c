@@ -0,0 +1,80 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Newest flash log lines as a manufacturer-specific Zigbee cluster
+ */
+
+#include <string.h>
+#include "flash_log_zcl.h"
+
+#define FLASH_LOG_ZCL_LINES             16
+#define FLASH_LOG_ZCL_TEXT_MAX          254     /* ZCL octet string limit */
+
+/* Attribute storage: boot number and ZCL octet string (length byte + data) */
+static uint16_t s_boot;
+static uint8_t s_recent[1 + FLASH_LOG_ZCL_TEXT_MAX];
+
+/* Append a line to s_recent, dropping the oldest lines to make room */
+static bool flash_log_zcl_visit(const flash_log_record_t *record, void *arg)
+{
+    char line[FLASH_LOG_ZCL_TEXT_MAX + 1];
+    char *text = (char *)&s_recent[1];
+    size_t len = s_recent[0];
+
+    size_t n = flash_log_format_line(line, sizeof(line) - 1, record);
+    line[n++] = '\n';
+    while (len + n > FLASH_LOG_ZCL_TEXT_MAX) {
+        const char *next = memchr(text, '\n', len);
+        size_t skip = next ? (size_t)(next - text) + 1 : len;
+        memmove(text, text + skip, len - skip);
+        len -= skip;
+    }
+    memcpy(text + len, line, n);
+    s_recent[0] = len + n;
+    return true;
+}
+
+esp_zb_attribute_list_t *flash_log_zcl_cluster_create(void)
+{
+    /* Full-length initial value so the stack reserves room for the whole string */
+    memset(&s_recent[1], ' ', FLASH_LOG_ZCL_TEXT_MAX);
+    s_recent[0] = FLASH_LOG_ZCL_TEXT_MAX;
+
+    esp_zb_attribute_list_t *cluster = esp_zb_zcl_attr_list_create(FLASH_LOG_CLUSTER_ID);
+    esp_zb_custom_cluster_add_custom_attr(cluster, FLASH_LOG_ATTR_BOOT, ESP_ZB_ZCL_ATTR_TYPE_U16,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_boot);
+    esp_zb_custom_cluster_add_custom_attr(cluster, FLASH_LOG_ATTR_RECENT, ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, s_recent);
+    return cluster;
+}
+
+/* Zigbee lock held or running in the Zigbee task */
+static void flash_log_zcl_set(uint8_t endpoint)
+{
+    s_boot = flash_log_boot();
+    s_recent[0] = 0;
+    flash_log_recent(FLASH_LOG_ZCL_LINES, flash_log_zcl_visit, NULL);
+
+    esp_zb_zcl_set_attribute_val(endpoint, FLASH_LOG_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 FLASH_LOG_ATTR_BOOT, &s_boot, false);
+    esp_zb_zcl_set_attribute_val(endpoint, FLASH_LOG_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 FLASH_LOG_ATTR_RECENT, s_recent, false);
+}
+
+void flash_log_zcl_update(uint8_t endpoint)
+{
+    esp_zb_lock_acquire(portMAX_DELAY);
+    flash_log_zcl_set(endpoint);
+    esp_zb_lock_release();
+}
+
+static void flash_log_zcl_refresh(uint8_t endpoint)
+{
+    flash_log_zcl_set(endpoint);
+    esp_zb_scheduler_alarm(flash_log_zcl_refresh, endpoint, FLASH_LOG_ZCL_REFRESH_MS);
+}
+
+void flash_log_zcl_start(uint8_t endpoint)
+{
+    flash_log_zcl_refresh(endpoint);
+}
@@ -0,0 +1,60 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Print the persistent log from a raw partition dump
+ *
+ * Not part of any IDF build. Compile from the component directory, dump the
+ * partition and decode it:
+ *
+ *   cc -O2 -Iinclude host/flash_log_decode.c flash_log_format.c -o flash_log_decode
+ *   parttool.py read_partition --partition-name storage --output log.bin
+ *   ./flash_log_decode log.bin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "flash_log_format.h"
+
+static bool print_visit(const flash_log_record_t *record, void *arg)
+{
+    char line[FLASH_LOG_TEXT_MAX + 32];
+
+    flash_log_format_line(line, sizeof(line), record);
+    printf("%s\n", line);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s partition.bin\n", argv[0]);
+        return 2;
+    }
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *image = malloc(size > 0 ? size : 1);
+    if (!image || fread(image, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "%s: read failed\n", argv[1]);
+        return 1;
+    }
+    fclose(f);
+
+    if (size % FLASH_LOG_SECTOR_SIZE) {
+        fprintf(stderr, "%s: size is not a multiple of %d, ignoring the tail\n", argv[1], FLASH_LOG_SECTOR_SIZE);
+    }
+    if (flash_log_newest_sector(image, size) < 0) {
+        fprintf(stderr, "%s: no log sectors\n", argv[1]);
+        return 1;
+    }
+    size_t records = flash_log_walk_image(image, size, print_visit, NULL);
+    fprintf(stderr, "%zu records\n", records);
+    free(image);
+    return 0;
+}
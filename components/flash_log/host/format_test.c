@@ -0,0 +1,186 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host tests for the persistent log layout
+ *
+ * Builds partition images the way the device fills them - sectors in ring
+ * order, a wrapped sequence number, a write cut short by a power loss - and
+ * checks that they decode oldest first and stop at damage.
+ *
+ * Compile and run from the component directory:
+ *
+ *   cc -O2 -Iinclude -I../host_test host/format_test.c flash_log_format.c -o format_test && ./format_test
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "flash_log_format.h"
+#include "host_test.h"
+
+#define SECTORS     4
+
+static uint8_t s_image[SECTORS * FLASH_LOG_SECTOR_SIZE];
+
+/* Minimal writer: append records, moving to the next sector when one is full */
+typedef struct {
+    int sector;
+    size_t used;
+    uint32_t seq;
+} writer_t;
+
+static void writer_next(writer_t *w, uint16_t boot)
+{
+    flash_log_sector_t header;
+
+    w->sector = (w->sector + 1) % SECTORS;
+    w->seq++;
+    memset(&s_image[w->sector * FLASH_LOG_SECTOR_SIZE], 0xFF, FLASH_LOG_SECTOR_SIZE);
+    flash_log_sector_init(&header, w->seq, boot);
+    memcpy(&s_image[w->sector * FLASH_LOG_SECTOR_SIZE], &header, sizeof(header));
+    w->used = sizeof(header);
+}
+
+static void writer_append(writer_t *w, uint32_t n, uint16_t boot)
+{
+    char text[64];
+    flash_log_record_t record = {
+        .level = 2,
+        .boot = boot,
+        .time_s = n,
+        .time_ms = n % 1000,
+        .text = text,
+    };
+    /* Vary the length so sectors end at different offsets */
+    record.len = snprintf(text, sizeof(text), "TEST: record %u %.*s", n, (int)(n % 23), "xxxxxxxxxxxxxxxxxxxxxxx");
+
+    if (w->used + FLASH_LOG_HEADER_SIZE + record.len > FLASH_LOG_SECTOR_SIZE) {
+        writer_next(w, boot);
+    }
+    w->used += flash_log_encode(&s_image[w->sector * FLASH_LOG_SECTOR_SIZE + w->used],
+                                FLASH_LOG_SECTOR_SIZE - w->used, &record);
+}
+
+typedef struct {
+    uint32_t first;
+    uint32_t next;
+    size_t count;
+    bool in_order;
+} order_t;
+
+static bool order_visit(const flash_log_record_t *record, void *arg)
+{
+    order_t *order = arg;
+
+    if (order->count == 0) {
+        order->first = record->time_s;
+    } else if (record->time_s != order->next) {
+        order->in_order = false;
+    }
+    order->next = record->time_s + 1;
+    order->count++;
+    return true;
+}
+
+static void test_record_roundtrip(void)
+{
+    uint8_t buf[FLASH_LOG_HEADER_SIZE + 16];
+    flash_log_record_t in = { .level = 1, .boot = 7, .time_s = 123, .time_ms = 456, .len = 5, .text = "hello" };
+    flash_log_record_t out;
+
+    CHECK_EQ(flash_log_encode(buf, FLASH_LOG_HEADER_SIZE + 4, &in), 0);
+    CHECK_EQ(flash_log_encode(buf, sizeof(buf), &in), FLASH_LOG_HEADER_SIZE + 5);
+    CHECK_EQ(flash_log_decode(buf, sizeof(buf), &out), FLASH_LOG_HEADER_SIZE + 5);
+    CHECK_EQ(out.level, 1);
+    CHECK_EQ(out.boot, 7);
+    CHECK_EQ(out.time_s, 123);
+    CHECK_EQ(out.time_ms, 456);
+    CHECK_EQ(memcmp(out.text, "hello", 5), 0);
+
+    char line[64];
+    flash_log_format_line(line, sizeof(line), &out);
+    CHECK_EQ(strcmp(line, "E 7 123.456 hello"), 0);
+
+    /* Truncated, flipped or erased data does not decode */
+    CHECK_EQ(flash_log_decode(buf, FLASH_LOG_HEADER_SIZE + 4, &out), 0);
+    buf[FLASH_LOG_HEADER_SIZE + 2] ^= 0x20;
+    CHECK_EQ(flash_log_decode(buf, sizeof(buf), &out), 0);
+    memset(buf, 0xFF, sizeof(buf));
+    CHECK_EQ(flash_log_decode(buf, sizeof(buf), &out), 0);
+}
+
+static void test_ring_order(void)
+{
+    writer_t w = { .sector = SECTORS - 1, .seq = 0xFFFFFFF0u };
+    order_t order = { .in_order = true };
+
+    /* Starts near the sequence wrap and goes around the ring several times */
+    memset(s_image, 0xFF, sizeof(s_image));
+    CHECK_EQ(flash_log_newest_sector(s_image, sizeof(s_image)), -1);
+    writer_next(&w, 1);
+    for (uint32_t n = 0; n < 2000; n++) {
+        writer_append(&w, n, 1);
+    }
+    CHECK_EQ(flash_log_newest_sector(s_image, sizeof(s_image)), w.sector);
+
+    size_t count = flash_log_walk_image(s_image, sizeof(s_image), order_visit, &order);
+    CHECK_EQ(count, order.count);
+    CHECK_EQ(order.in_order, true);
+    CHECK_EQ(order.next, 2000);
+    CHECK_EQ(count > 2 * (FLASH_LOG_SECTOR_SIZE / 64), true);
+}
+
+static void test_cut_short(void)
+{
+    writer_t w = { .sector = SECTORS - 1 };
+    order_t order = { .in_order = true };
+    size_t end;
+
+    memset(s_image, 0xFF, sizeof(s_image));
+    writer_next(&w, 3);
+    for (uint32_t n = 0; n < 10; n++) {
+        writer_append(&w, n, 3);
+    }
+    size_t good = w.used;
+
+    /* A record whose programming stopped halfway */
+    writer_append(&w, 10, 3);
+    memset(&s_image[w.sector * FLASH_LOG_SECTOR_SIZE + w.used - 4], 0xFF, 4);
+
+    CHECK_EQ(flash_log_walk_records(&s_image[sizeof(flash_log_sector_t)], FLASH_LOG_SECTOR_SIZE - sizeof(flash_log_sector_t),
+                                    NULL, NULL, &end), 10);
+    CHECK_EQ(end + sizeof(flash_log_sector_t), good);
+    CHECK_EQ(flash_log_walk_image(s_image, sizeof(s_image), order_visit, &order), 10);
+
+    /* A damaged sector header hides that sector only */
+    s_image[1] ^= 1;
+    CHECK_EQ(flash_log_newest_sector(s_image, sizeof(s_image)), -1);
+}
+
+static bool stop_visit(const flash_log_record_t *record, void *arg)
+{
+    return ++*(int *)arg < 3;
+}
+
+static void test_stop(void)
+{
+    writer_t w = { .sector = SECTORS - 1 };
+    int visited = 0;
+
+    memset(s_image, 0xFF, sizeof(s_image));
+    writer_next(&w, 1);
+    for (uint32_t n = 0; n < 500; n++) {
+        writer_append(&w, n, 1);
+    }
+    CHECK_EQ(flash_log_walk_image(s_image, sizeof(s_image), stop_visit, &visited), 3);
+    CHECK_EQ(visited, 3);
+}
+
+int main(void)
+{
+    test_record_roundtrip();
+    test_ring_order();
+    test_cut_short();
+    test_stop();
+
+    return host_test_summary("flash_log format");
+}
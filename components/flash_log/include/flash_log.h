@@ -0,0 +1,101 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Persistent log in a flash partition
+ *
+ * Log lines at or above CONFIG_FLASH_LOG_LEVEL are appended to a ring of
+ * sectors in the CONFIG_FLASH_LOG_PARTITION_LABEL partition, so the lines
+ * leading up to a fault can still be read after the device was reset or
+ * power-cycled. Sectors are used round-robin, so every sector wears equally
+ * and each is erased once per trip around the partition.
+ *
+ * Records are collected in a RAM buffer and programmed in one write when it
+ * fills, instead of one write per line. The buffer is RTC memory that is not
+ * cleared on reset: it survives deep sleep, panics and watchdog resets and
+ * is written out later, so only a power loss costs its contents.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "flash_log_format.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Open the log partition and recover the write position
+ *
+ * After a reset other than a deep-sleep wake, starts a new boot number and
+ * logs the reset reason.
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_NOT_FOUND if there is no partition with the configured label
+ *     - ESP_ERR_INVALID_SIZE if it is smaller than two sectors
+ */
+esp_err_t flash_log_init(void);
+
+/**
+ * @brief Whether lines at level are stored; check before formatting
+ */
+static inline bool flash_log_enabled(esp_log_level_t level)
+{
+    return level != ESP_LOG_NONE && level <= CONFIG_FLASH_LOG_LEVEL;
+}
+
+/**
+ * @brief Append a line
+ *
+ * Task context. Programs flash only when the buffer is full. Lines below
+ * the configured level, and calls before flash_log_init(), are ignored.
+ *
+ * @param level Level of the line
+ * @param tag Tag, stored in front of the text; may be NULL
+ * @param text Text, truncated to FLASH_LOG_TEXT_MAX bytes with the tag
+ */
+void flash_log_write(esp_log_level_t level, const char *tag, const char *text);
+
+/**
+ * @brief Also store lines printed with ESP_LOGx
+ *
+ * Installs a vprintf hook that passes output on to the previous one and
+ * stores each line at or above the configured level. For firmware without
+ * a central logger that could call flash_log_write() itself.
+ */
+void flash_log_capture_esp_log(void);
+
+/**
+ * @brief Boot number, increased on every reset but deep-sleep wakes
+ */
+uint16_t flash_log_boot(void);
+
+/**
+ * @brief Program buffered records now
+ */
+esp_err_t flash_log_flush(void);
+
+/**
+ * @brief Visit the newest records, oldest of them first
+ *
+ * Includes records still in the RAM buffer.
+ *
+ * @param count Number of newest records to visit
+ * @return Records visited
+ */
+size_t flash_log_recent(size_t count, flash_log_visit_t visit, void *arg);
+
+/**
+ * @brief Print the newest records
+ */
+void flash_log_dump(size_t count);
+
+#ifdef __cplusplus
+}
+#endif
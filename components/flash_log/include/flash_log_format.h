@@ -0,0 +1,129 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * On-flash layout of the persistent log
+ *
+ * The partition is a ring of 4 KiB sectors written strictly in order. Each
+ * sector starts with a header carrying an increasing sequence number, so the
+ * newest sector is the one with the highest sequence and the oldest data sits
+ * right after it. Records follow the header back to back and never cross a
+ * sector; erased bytes (0xFF) end the sector's data. A record whose CRC does
+ * not match (power lost while programming) also ends it.
+ *
+ * No IDF dependencies, so the host decoder builds it unchanged.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLASH_LOG_SECTOR_SIZE           4096
+#define FLASH_LOG_SECTOR_MAGIC          0x31474C46  /* "FLG1" */
+#define FLASH_LOG_RECORD_MAGIC          0x5A
+
+/**
+ * @brief Sector header, little endian
+ */
+typedef struct {
+    uint32_t magic;                     /**< FLASH_LOG_SECTOR_MAGIC */
+    uint32_t seq;                       /**< Increments with every sector written */
+    uint16_t boot;                      /**< Boot number when the sector was started */
+    uint8_t reserved;                   /**< 0xFF */
+    uint8_t crc;                        /**< CRC-8 of the fields above */
+} flash_log_sector_t;
+
+/**
+ * @brief Record header, little endian, followed by len bytes of text
+ */
+typedef struct {
+    uint8_t magic;                      /**< FLASH_LOG_RECORD_MAGIC */
+    uint8_t level;                      /**< esp_log_level_t */
+    uint8_t len;                        /**< Text length, no terminator */
+    uint8_t crc;                        /**< CRC-8 of the header (crc as 0) and the text */
+    uint16_t boot;                      /**< Boot number */
+    uint16_t time_ms;                   /**< Milliseconds part of the time */
+    uint32_t time_s;                    /**< gettimeofday() seconds: since power-on unless the clock was set */
+} flash_log_header_t;
+
+#define FLASH_LOG_HEADER_SIZE           sizeof(flash_log_header_t)
+#define FLASH_LOG_TEXT_MAX              255
+
+_Static_assert(sizeof(flash_log_sector_t) == 12, "flash_log_sector_t must not contain padding");
+_Static_assert(sizeof(flash_log_header_t) == 12, "flash_log_header_t must not contain padding");
+
+/**
+ * @brief A decoded record; text points into the parsed image and is not terminated
+ */
+typedef struct {
+    uint8_t level;
+    uint16_t boot;
+    uint32_t time_s;
+    uint16_t time_ms;
+    uint8_t len;
+    const char *text;
+} flash_log_record_t;
+
+/**
+ * @brief Called for each record, oldest first; return false to stop
+ */
+typedef bool (*flash_log_visit_t)(const flash_log_record_t *record, void *arg);
+
+uint8_t flash_log_crc8(uint8_t crc, const void *data, size_t len);
+
+/**
+ * @brief Seal a sector header
+ */
+void flash_log_sector_init(flash_log_sector_t *sector, uint32_t seq, uint16_t boot);
+
+/**
+ * @brief Whether buf starts with a valid sector header
+ */
+bool flash_log_sector_valid(const uint8_t *buf);
+
+/**
+ * @brief Encode a record into buf
+ * @return Bytes written (header and text), 0 if it does not fit
+ */
+size_t flash_log_encode(uint8_t *buf, size_t len, const flash_log_record_t *record);
+
+/**
+ * @brief Decode the record at buf
+ * @return Bytes it takes, 0 at erased space, a bad CRC or a truncated record
+ */
+size_t flash_log_decode(const uint8_t *buf, size_t len, flash_log_record_t *record);
+
+/**
+ * @brief Walk records packed back to back, as in a sector body
+ *
+ * @param[out] end Bytes of valid records; may be NULL
+ * @return Records visited
+ */
+size_t flash_log_walk_records(const uint8_t *buf, size_t len, flash_log_visit_t visit, void *arg, size_t *end);
+
+/**
+ * @brief Index of the newest valid sector in a partition image
+ * @return Sector index, -1 if no sector is valid
+ */
+int flash_log_newest_sector(const uint8_t *image, size_t size);
+
+/**
+ * @brief Walk every record of a partition image, oldest sector first
+ * @return Records visited
+ */
+size_t flash_log_walk_image(const uint8_t *image, size_t size, flash_log_visit_t visit, void *arg);
+
+/**
+ * @brief Format a record as one line: level letter, boot, time and text
+ * @return Length of the line (truncated to len - 1), without a newline
+ */
+size_t flash_log_format_line(char *buf, size_t len, const flash_log_record_t *record);
+
+#ifdef __cplusplus
+}
+#endif
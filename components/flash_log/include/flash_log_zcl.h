@@ -0,0 +1,53 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Newest flash log lines as a manufacturer-specific Zigbee cluster
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_zigbee_core.h"
+#include "flash_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLASH_LOG_CLUSTER_ID            0xFC04  /**< Manufacturer-specific flash log cluster */
+#define FLASH_LOG_ATTR_BOOT             0x0000  /**< uint16, flash_log_boot() */
+#define FLASH_LOG_ATTR_RECENT           0x0001  /**< Octet string, newest lines as flash_log_format_line() text, '\n' separated */
+
+#define FLASH_LOG_ZCL_REFRESH_MS        60000   /**< Attribute refresh period of flash_log_zcl_start() */
+
+/**
+ * @brief Create the flash log cluster
+ *
+ * Add the result to the endpoint's cluster list as a server cluster.
+ *
+ * @return Attribute list of the cluster
+ */
+esp_zb_attribute_list_t *flash_log_zcl_cluster_create(void);
+
+/**
+ * @brief Write the newest lines that fit into the cluster's attributes
+ *
+ * Takes the Zigbee lock; do not call with the lock held.
+ *
+ * @param endpoint Endpoint the cluster was registered on
+ */
+void flash_log_zcl_update(uint8_t endpoint);
+
+/**
+ * @brief Update the attributes now and every FLASH_LOG_ZCL_REFRESH_MS
+ *
+ * For devices that stay awake. Call once, from the Zigbee task (e.g. the
+ * signal handler).
+ *
+ * @param endpoint Endpoint the cluster was registered on
+ */
+void flash_log_zcl_start(uint8_t endpoint);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,69 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Checks shared by the host tests
+ *
+ * The host/ directories of the components and firmware modules hold plain C
+ * programs that run the IDF-independent parts of the code on the build
+ * machine. They are not part of any IDF build and have no build target of
+ * their own: each file starts with the cc line that builds it, which adds
+ * this directory to the include path. Anything IDF-specific they pull in
+ * comes from <stubs>, the stand-in headers of an IDF linux target build.
+ *
+ * A failed check prints where it failed and the test carries on, so one run
+ * lists every failure; main() ends with return host_test_summary("name").
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+
+static int host_test_failures;
+
+/**
+ * @brief Report a failure with a printf-style message
+ */
+#define CHECK_FAIL(format, ...)                                                             \
+    do {                                                                                    \
+        printf("%s:%d: " format "\n", __func__, __LINE__, ##__VA_ARGS__);                   \
+        host_test_failures++;                                                               \
+    } while (0)
+
+/**
+ * @brief Compare two integers (pointers and booleans included)
+ */
+#define CHECK_EQ(actual, expected)                                                          \
+    do {                                                                                    \
+        long a_ = (long)(actual), e_ = (long)(expected);                                    \
+        if (a_ != e_) {                                                                     \
+            CHECK_FAIL("%s = %ld, expected %ld", #actual, a_, e_);                          \
+        }                                                                                   \
+    } while (0)
+
+/**
+ * @brief Compare two strings
+ */
+#define CHECK_STR(actual, expected)                                                         \
+    do {                                                                                    \
+        const char *a_ = (actual), *e_ = (expected);                                        \
+        if (strcmp(a_, e_) != 0) {                                                          \
+            CHECK_FAIL("\"%s\", expected \"%s\"", a_, e_);                                  \
+        }                                                                                   \
+    } while (0)
+
+/**
+ * @brief Print the outcome of the run
+ *
+ * @param name What was tested, for the success line
+ * @return Exit status for main()
+ */
+static inline int host_test_summary(const char *name)
+{
+    if (host_test_failures) {
+        printf("%d failure(s)\n", host_test_failures);
+        return 1;
+    }
+    printf("all %s tests passed\n", name);
+    return 0;
+}
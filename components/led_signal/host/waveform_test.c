@@ -0,0 +1,147 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host tests for the LED state pattern tables
+ *
+ * Plays each state the way the esp_timer chain in status_led does - apply a
+ * step, arm for its duration, advance - and checks the emitted edges.
+ *
+ * Compile and run from the component directory, with the error blink of
+ * either application:
+ *
+ *   cc -O2 -Iinclude -I../status_led/include -I../host_test -I<stubs> \
+ *      -DCONFIG_LED_SIGNAL_GPIO=15 -DCONFIG_LED_SIGNAL_ERROR_OFF_MS=200 \
+ *      host/waveform_test.c led_signal_patterns.c ../status_led/status_led_player.c \
+ *      -o waveform_test && ./waveform_test
+ *
+ * <stubs> only needs an empty sdkconfig.h and a driver/gpio.h that declares
+ * gpio_num_t.
+ */
+
+#include <stdio.h>
+#include "led_signal.h"
+#include "host_test.h"
+
+typedef struct {
+    uint32_t t_ms;
+    uint8_t level;
+} edge_t;
+
+#define MAX_EDGES 32
+
+typedef struct {
+    edge_t edges[MAX_EDGES];
+    size_t count;
+    unsigned arms;                      // Timer starts, i.e. wakeups
+} waveform_t;
+
+// Play pattern from t = 0 and record level changes before until_ms
+static void render(const status_led_pattern_t *pattern, uint32_t until_ms, waveform_t *wave)
+{
+    status_led_player_t player;
+    const status_led_step_t *step = status_led_player_start(&player, pattern, 0);
+    uint32_t t = 0;
+
+    wave->count = 0;
+    wave->arms = 0;
+    while (t < until_ms) {
+        uint8_t level = (step->red | step->green | step->blue) != 0;
+
+        if ((wave->count == 0 || wave->edges[wave->count - 1].level != level) && wave->count < MAX_EDGES) {
+            wave->edges[wave->count++] = (edge_t) { t, level };
+        }
+        if (step->ms == 0) {
+            break;
+        }
+        wave->arms++;
+        t += step->ms;
+        step = status_led_player_next(&player);
+    }
+}
+
+static void check_waveform(led_signal_state_t state, const edge_t *expected, size_t count, uint32_t until_ms)
+{
+    waveform_t wave;
+
+    render(led_signal_pattern(state), until_ms, &wave);
+    CHECK_EQ(wave.count, count);
+    for (size_t i = 0; i < count && i < wave.count; i++) {
+        CHECK_EQ(wave.edges[i].t_ms, expected[i].t_ms);
+        CHECK_EQ(wave.edges[i].level, expected[i].level);
+    }
+}
+
+#define CHECK_WAVEFORM(state, until_ms, ...)                                                        \
+    do {                                                                                            \
+        static const edge_t expected_[] = { __VA_ARGS__ };                                          \
+        check_waveform(state, expected_, sizeof(expected_) / sizeof(expected_[0]), until_ms);       \
+    } while (0)
+
+static void test_tables(void)
+{
+    for (int state = 0; state <= LED_STATE_OFF; state++) {
+        const status_led_pattern_t *pattern = led_signal_pattern(state);
+
+        CHECK_EQ(pattern != NULL, 1);
+        if (pattern == NULL) {
+            continue;
+        }
+        CHECK_EQ(pattern->len > 0, 1);
+        for (size_t i = 0; i < pattern->len; i++) {
+            // Only the last step may hold
+            if (i + 1 < pattern->len) {
+                CHECK_EQ(pattern->steps[i].ms > 0, 1);
+            }
+            // Adjacent steps differ, or a step would be wasted as a wakeup
+            if (pattern->len > 1) {
+                const status_led_step_t *a = &pattern->steps[i], *b = &pattern->steps[(i + 1) % pattern->len];
+
+                CHECK_EQ((a->red | a->green | a->blue) != (b->red | b->green | b->blue), 1);
+            }
+        }
+    }
+    CHECK_EQ(led_signal_pattern(LED_STATE_OFF + 1) == NULL, 1);
+    CHECK_EQ(led_signal_pattern(-1) == NULL, 1);
+}
+
+// One full period and the start of the next
+static void test_waveforms(void)
+{
+    CHECK_WAVEFORM(LED_STATE_INITIALIZING, 401, { 0, 1 }, { 200, 0 }, { 400, 1 });
+    CHECK_WAVEFORM(LED_STATE_JOINING, 1001, { 0, 1 }, { 500, 0 }, { 1000, 1 });
+    CHECK_WAVEFORM(LED_STATE_CONNECTED, 4001, { 0, 1 }, { 2000, 0 }, { 4000, 1 });
+    CHECK_WAVEFORM(LED_STATE_ERROR, 101 + CONFIG_LED_SIGNAL_ERROR_OFF_MS,
+                   { 0, 1 }, { 100, 0 }, { 100 + CONFIG_LED_SIGNAL_ERROR_OFF_MS, 1 });
+    CHECK_WAVEFORM(LED_STATE_SENSOR_READING, 1101,
+                   { 0, 1 }, { 100, 0 }, { 200, 1 }, { 300, 0 }, { 400, 1 }, { 500, 0 }, { 1100, 1 });
+    CHECK_WAVEFORM(LED_STATE_COMMAND_RECEIVED, 801,
+                   { 0, 1 }, { 100, 0 }, { 200, 1 }, { 300, 0 }, { 800, 1 });
+    CHECK_WAVEFORM(LED_STATE_DEEP_SLEEP_PREPARE, 1901,
+                   { 0, 1 }, { 150, 0 }, { 300, 1 }, { 450, 0 }, { 600, 1 }, { 750, 0 }, { 1900, 1 });
+    CHECK_WAVEFORM(LED_STATE_OTA_UPDATE, 401, { 0, 1 }, { 300, 0 }, { 400, 1 });
+}
+
+// A blinking state wakes once per step, a steady one never
+static void test_wakeups(void)
+{
+    waveform_t wave;
+
+    render(led_signal_pattern(LED_STATE_OFF), 3600 * 1000, &wave);
+    CHECK_EQ(wave.count, 1);
+    CHECK_EQ(wave.edges[0].level, 0);
+    CHECK_EQ(wave.arms, 0);
+
+    render(led_signal_pattern(LED_STATE_CONNECTED), 60 * 1000, &wave);
+    CHECK_EQ(wave.arms, 30);
+    render(led_signal_pattern(LED_STATE_SENSOR_READING), 11 * 1100, &wave);
+    CHECK_EQ(wave.arms, 11 * 6);
+}
+
+int main(void)
+{
+    test_tables();
+    test_waveforms();
+    test_wakeups();
+
+    return host_test_summary("led_signal waveform");
+}
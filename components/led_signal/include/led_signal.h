@@ -2,31 +2,40 @@
 #ifndef LED_SIGNAL_H
 #define LED_SIGNAL_H
 
+#include "sdkconfig.h"
 #include "driver/gpio.h"
+#include "status_led_pattern.h"
 
 // LED GPIO pin definition
-#define LED_SIGNAL_GPIO   GPIO_NUM_15  // Status LED pin
+#define LED_SIGNAL_GPIO   ((gpio_num_t)CONFIG_LED_SIGNAL_GPIO)  // Status LED pin
 
 // LED signal states for different Zigbee events
 typedef enum {
     LED_STATE_INITIALIZING,      // Fast blink (200ms on/off) - Stack initializing
     LED_STATE_JOINING,           // Medium blink (500ms on/off) - Joining network
     LED_STATE_CONNECTED,         // Slow blink (2000ms on/off) - Connected to network
-    LED_STATE_ERROR,             // Very fast blink (100ms on/off) - Error occurred
+    LED_STATE_ERROR,             // Very fast blink (100ms on/CONFIG_LED_SIGNAL_ERROR_OFF_MS off) - Error occurred
     LED_STATE_SENSOR_READING,    // Quick triple blink - Reading sensor data
     LED_STATE_COMMAND_RECEIVED,  // Quick double blink - Command received
-    LED_STATE_DEEP_SLEEP_PREPARE,// Fade pattern (3 quick blinks) - Preparing for deep sleep
+    LED_STATE_DEEP_SLEEP_PREPARE,// 3 quick blinks, 1s pause - Preparing for deep sleep
     LED_STATE_OTA_UPDATE,        // Alternating pattern (300ms/100ms) - OTA update in progress
     LED_STATE_OFF                // LED off - Idle state
 } led_signal_state_t;
 
 /**
- * @brief Initialize LED signal GPIO
+ * @brief Initialize LED signal GPIO and the status_led engine
+ *
+ * Patterns are played from a one-shot esp_timer that is re-armed for each
+ * step, so there is no LED task and a steady state (OFF) costs no wakeups.
  */
 void led_signal_init(void);
 
 /**
  * @brief Set LED signal state
+ *
+ * The new pattern starts right away, or at the end of the current step if
+ * the timer callback is running at that moment.
+ *
  * @param state The desired LED state
  */
 void led_signal_set_state(led_signal_state_t state);
@@ -38,8 +47,14 @@ void led_signal_set_state(led_signal_state_t state);
 void led_signal_blink_once(uint32_t duration_ms);
 
 /**
- * @brief Stop LED task (before deep sleep)
+ * @brief Stop playback and turn the LED off (before deep sleep)
  */
 void led_signal_stop(void);
 
+/**
+ * @brief Step table played for a state
+ * @return Pattern, or NULL for an invalid state
+ */
+const status_led_pattern_t *led_signal_pattern(led_signal_state_t state);
+
 #endif // LED_SIGNAL_H
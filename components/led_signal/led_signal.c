@@ -0,0 +1,71 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "led_signal.h"
+#include "status_led.h"
+#include "esp_log.h"
+
+static const char *TAG = "LED_SIGNAL";
+
+// Current LED state
+static led_signal_state_t current_state = LED_STATE_OFF;
+
+void led_signal_init(void)
+{
+    status_led_backend_t backend;
+
+    // Configure LED GPIO, the engine starts with the LED off
+    ESP_ERROR_CHECK(status_led_backend_gpio(LED_SIGNAL_GPIO, false, &backend));
+    ESP_ERROR_CHECK(status_led_init(&backend));
+
+    ESP_LOGI(TAG, "LED signal initialized on GPIO %d", LED_SIGNAL_GPIO);
+}
+
+void led_signal_set_state(led_signal_state_t state)
+{
+    const char *state_names[] = {
+        "INITIALIZING",
+        "JOINING",
+        "CONNECTED",
+        "ERROR",
+        "SENSOR_READING",
+        "COMMAND_RECEIVED",
+        "DEEP_SLEEP_PREPARE",
+        "OTA_UPDATE",
+        "OFF"
+    };
+
+    if (state < 0 || state > LED_STATE_OFF) {
+        ESP_LOGW(TAG, "Invalid LED state: %d", state);
+        return;
+    }
+    if (state == current_state) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "LED state changed: %s -> %s",
+            state_names[current_state], state_names[state]);
+    current_state = state;
+    status_led_set(led_signal_pattern(state));
+}
+
+void led_signal_blink_once(uint32_t duration_ms)
+{
+    led_signal_state_t previous_state = current_state;
+
+    // Set to sensor reading state
+    led_signal_set_state(LED_STATE_SENSOR_READING);
+
+    // Wait for specified duration
+    vTaskDelay(pdMS_TO_TICKS(duration_ms));
+
+    // Restore previous state
+    led_signal_set_state(previous_state);
+}
+
+void led_signal_stop(void)
+{
+    ESP_LOGI(TAG, "Stopping LED signal");
+    current_state = LED_STATE_OFF;
+    status_led_stop();
+    ESP_LOGI(TAG, "LED signal stopped");
+}
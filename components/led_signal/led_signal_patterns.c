@@ -0,0 +1,39 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Step tables of the LED states, shared by the applications
+ *
+ * Applications tell their errors apart by the dark half of the error blink
+ * (CONFIG_LED_SIGNAL_ERROR_OFF_MS).
+ */
+
+#include "led_signal.h"
+
+STATUS_LED_PATTERN_DEFINE(s_initializing, STATUS_LED_BLINK(STATUS_LED_WHITE, 200, 200));
+STATUS_LED_PATTERN_DEFINE(s_joining, STATUS_LED_BLINK(STATUS_LED_WHITE, 500, 500));
+STATUS_LED_PATTERN_DEFINE(s_connected, STATUS_LED_BLINK(STATUS_LED_WHITE, 2000, 2000));
+STATUS_LED_PATTERN_DEFINE(s_error, STATUS_LED_BLINK(STATUS_LED_WHITE, 100, CONFIG_LED_SIGNAL_ERROR_OFF_MS));
+STATUS_LED_PATTERN_DEFINE(s_sensor_reading, STATUS_LED_BURST(3, STATUS_LED_WHITE, 100, 100, 500));
+STATUS_LED_PATTERN_DEFINE(s_command_received, STATUS_LED_BURST(2, STATUS_LED_WHITE, 100, 100, 400));
+STATUS_LED_PATTERN_DEFINE(s_deep_sleep_prepare, STATUS_LED_BURST(3, STATUS_LED_WHITE, 150, 150, 1000));
+STATUS_LED_PATTERN_DEFINE(s_ota_update, STATUS_LED_BLINK(STATUS_LED_WHITE, 300, 100));
+STATUS_LED_PATTERN_DEFINE(s_off, STATUS_LED_HOLD(STATUS_LED_DARK));
+
+static const status_led_pattern_t *const s_patterns[] = {
+    [LED_STATE_INITIALIZING] = &s_initializing,
+    [LED_STATE_JOINING] = &s_joining,
+    [LED_STATE_CONNECTED] = &s_connected,
+    [LED_STATE_ERROR] = &s_error,
+    [LED_STATE_SENSOR_READING] = &s_sensor_reading,
+    [LED_STATE_COMMAND_RECEIVED] = &s_command_received,
+    [LED_STATE_DEEP_SLEEP_PREPARE] = &s_deep_sleep_prepare,
+    [LED_STATE_OTA_UPDATE] = &s_ota_update,
+    [LED_STATE_OFF] = &s_off,
+};
+
+_Static_assert(sizeof(s_patterns) / sizeof(s_patterns[0]) == LED_STATE_OFF + 1, "every LED state needs a pattern");
+
+const status_led_pattern_t *led_signal_pattern(led_signal_state_t state)
+{
+    return state >= 0 && state <= LED_STATE_OFF ? s_patterns[state] : NULL;
+}
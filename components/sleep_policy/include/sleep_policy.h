@@ -0,0 +1,138 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Deep sleep or light sleep between samples
+ *
+ * A deep-sleep device cold-boots on every wake and, whenever it has
+ * something to send, initializes the Zigbee stack and rejoins. A sleepy end
+ * device (SED) in automatic light sleep stays joined: it pays a higher
+ * floor current and a short receive window per data poll, but a wake costs
+ * neither a boot nor a rejoin. Which is cheaper depends on how often the
+ * device wakes and reports; this module compares the average current of
+ * both.
+ *
+ * Work done in either mode (measuring, sending the reports) is left out.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief How the device spends the time between wakes
+ */
+typedef enum {
+    SLEEP_MODE_DEEP = 0,        /**< esp_deep_sleep_start(), cold boot and rejoin */
+    SLEEP_MODE_LIGHT,           /**< Joined SED, automatic light sleep with tickless idle */
+} sleep_mode_t;
+
+/**
+ * @brief Costs of the two modes
+ */
+typedef struct {
+    uint32_t deep_sleep_ua;     /**< Chip in deep sleep */
+    uint32_t light_sleep_ua;    /**< Chip in light sleep, radio off */
+    uint32_t active_ua;         /**< CPU running, radio off */
+    uint32_t rx_ua;             /**< Radio receiving, CPU included */
+    uint32_t boot_ms;           /**< Reset until app_main */
+    uint32_t stack_init_ms;     /**< esp_zb_init() until esp_zb_start() */
+    uint32_t rejoin_ms;         /**< esp_zb_start() until on the network, radio on */
+    uint32_t poll_interval_ms;  /**< SED data poll period (keep_alive) */
+    uint32_t poll_ms;           /**< Radio on per data poll */
+} sleep_policy_model_t;
+
+/**
+ * @brief Rounded typical figures of the chip
+ *
+ * Boot, stack init and rejoin are starting points; replace them with
+ * measured values, see sleep_policy_model_from_profiler().
+ */
+#if CONFIG_IDF_TARGET_ESP32H2
+#define SLEEP_POLICY_MODEL_DEFAULT()        \
+    {                                       \
+        .deep_sleep_ua = 7,                 \
+        .light_sleep_ua = 85,               \
+        .active_ua = 20000,                 \
+        .rx_ua = 24000,                     \
+        .boot_ms = 140,                     \
+        .stack_init_ms = 60,                \
+        .rejoin_ms = 1650,                  \
+        .poll_interval_ms = 3000,           \
+        .poll_ms = 5,                       \
+    }
+#else
+#define SLEEP_POLICY_MODEL_DEFAULT()        \
+    {                                       \
+        .deep_sleep_ua = 7,                 \
+        .light_sleep_ua = 180,              \
+        .active_ua = 38000,                 \
+        .rx_ua = 74000,                     \
+        .boot_ms = 140,                     \
+        .stack_init_ms = 60,                \
+        .rejoin_ms = 1650,                  \
+        .poll_interval_ms = 3000,           \
+        .poll_ms = 5,                       \
+    }
+#endif
+
+/**
+ * @brief Average current of a mode
+ *
+ * @param model Costs
+ * @param mode Mode
+ * @param wake_s Time between wakes
+ * @param uplink_s Time between wakes that use the radio (>= wake_s)
+ * @return Average in nA, UINT32_MAX for an invalid mode or zero intervals
+ */
+uint32_t sleep_policy_average_na(const sleep_policy_model_t *model, sleep_mode_t mode,
+                                 uint32_t wake_s, uint32_t uplink_s);
+
+/**
+ * @brief Pick the cheaper mode
+ *
+ * Switches away from current only when the other mode saves more than an
+ * eighth, so intervals near the break-even point do not flip the mode on
+ * every wake.
+ *
+ * @param model Costs
+ * @param current Mode in use
+ * @param wake_s Time between wakes
+ * @param uplink_s Time between wakes that use the radio
+ * @return Mode to use
+ */
+sleep_mode_t sleep_policy_select(const sleep_policy_model_t *model, sleep_mode_t current,
+                                 uint32_t wake_s, uint32_t uplink_s);
+
+/**
+ * @brief Take boot, stack init and rejoin times from the wake profiler
+ *
+ * Uses the averages retained by wake_profiler where it has any; the other
+ * fields are left as they are.
+ */
+void sleep_policy_model_from_profiler(sleep_policy_model_t *model);
+
+/**
+ * @brief Time between uplinks, from the profiled share of wakes that used the radio
+ *
+ * A deep-sleep wake that uses the radio rejoins; a light-sleep wake only
+ * reports. The larger of the two counts is taken as the number of uplinks.
+ *
+ * @param wake_s Time between wakes
+ * @return wake_s scaled by wakes per uplink, wake_s without statistics
+ */
+uint32_t sleep_policy_uplink_interval_s(uint32_t wake_s);
+
+/**
+ * @brief Name of a mode for logs
+ */
+const char *sleep_policy_mode_name(sleep_mode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,67 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Deep sleep or light sleep between samples
+ */
+
+#include "sleep_policy.h"
+
+/* µA·ms spread over s seconds, in nA */
+static uint64_t spread_na(uint64_t ua_ms, uint32_t s)
+{
+    return ua_ms / s;
+}
+
+uint32_t sleep_policy_average_na(const sleep_policy_model_t *model, sleep_mode_t mode,
+                                 uint32_t wake_s, uint32_t uplink_s)
+{
+    uint64_t na;
+
+    switch (mode) {
+    case SLEEP_MODE_DEEP:
+        if (wake_s == 0 || uplink_s == 0) {
+            return UINT32_MAX;
+        }
+        na = (uint64_t)model->deep_sleep_ua * 1000 +
+             spread_na((uint64_t)model->active_ua * model->boot_ms, wake_s) +
+             spread_na((uint64_t)model->active_ua * model->stack_init_ms +
+                       (uint64_t)model->rx_ua * model->rejoin_ms, uplink_s);
+        break;
+    case SLEEP_MODE_LIGHT:
+        if (model->poll_interval_ms == 0) {
+            return UINT32_MAX;
+        }
+        na = (uint64_t)model->light_sleep_ua * 1000 +
+             (uint64_t)model->rx_ua * model->poll_ms * 1000 / model->poll_interval_ms;
+        break;
+    default:
+        return UINT32_MAX;
+    }
+
+    return na > UINT32_MAX ? UINT32_MAX : (uint32_t)na;
+}
+
+sleep_mode_t sleep_policy_select(const sleep_policy_model_t *model, sleep_mode_t current,
+                                 uint32_t wake_s, uint32_t uplink_s)
+{
+    if (current != SLEEP_MODE_LIGHT) {
+        current = SLEEP_MODE_DEEP;
+    }
+    sleep_mode_t other = current == SLEEP_MODE_DEEP ? SLEEP_MODE_LIGHT : SLEEP_MODE_DEEP;
+    uint64_t current_na = sleep_policy_average_na(model, current, wake_s, uplink_s);
+    uint64_t other_na = sleep_policy_average_na(model, other, wake_s, uplink_s);
+
+    return other_na + other_na / 8 < current_na ? other : current;
+}
+
+const char *sleep_policy_mode_name(sleep_mode_t mode)
+{
+    switch (mode) {
+    case SLEEP_MODE_DEEP:
+        return "deep sleep";
+    case SLEEP_MODE_LIGHT:
+        return "light sleep";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,37 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Sleep policy costs from the wake profiler statistics
+ */
+
+#include "sleep_policy.h"
+#include "wake_profiler.h"
+
+static void take_average(uint32_t *field, wake_phase_t phase)
+{
+    const wake_profiler_stats_t *stats = wake_profiler_stats(phase);
+    if (stats != NULL && stats->count > 0) {
+        *field = stats->sum_ms / stats->count;
+    }
+}
+
+void sleep_policy_model_from_profiler(sleep_policy_model_t *model)
+{
+    take_average(&model->boot_ms, WAKE_PHASE_BOOT);
+    take_average(&model->stack_init_ms, WAKE_PHASE_STACK_INIT);
+    take_average(&model->rejoin_ms, WAKE_PHASE_REJOIN);
+}
+
+uint32_t sleep_policy_uplink_interval_s(uint32_t wake_s)
+{
+    const wake_profiler_stats_t *rejoin = wake_profiler_stats(WAKE_PHASE_REJOIN);
+    const wake_profiler_stats_t *report = wake_profiler_stats(WAKE_PHASE_REPORT);
+    uint32_t uplinks = rejoin->count > report->count ? rejoin->count : report->count;
+    uint32_t wakes = wake_profiler_wakes();
+
+    if (uplinks == 0 || wakes < uplinks) {
+        return wake_s;
+    }
+    uint64_t uplink_s = (uint64_t)wake_s * wakes / uplinks;
+    return uplink_s > UINT32_MAX ? UINT32_MAX : (uint32_t)uplink_s;
+}
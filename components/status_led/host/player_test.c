@@ -0,0 +1,113 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host tests for the status LED pattern macros and player
+ *
+ * Compile and run from the component directory:
+ *
+ *   cc -O2 -Iinclude -I../host_test host/player_test.c status_led_player.c -o player_test && ./player_test
+ */
+
+#include <stdio.h>
+#include "status_led_pattern.h"
+#include "host_test.h"
+
+STATUS_LED_PATTERN_DEFINE(s_steady_green, STATUS_LED_HOLD(0x00FF00));
+STATUS_LED_PATTERN_DEFINE(s_blink, STATUS_LED_BLINK(STATUS_LED_WHITE, 100, 300));
+STATUS_LED_PATTERN_DEFINE(s_burst, STATUS_LED_BURST(3, 0x8000FF, 150, 150, 1000));
+STATUS_LED_PATTERN_DEFINE(s_burst_one, STATUS_LED_BURST(1, 0xFF0000, 50, 50, 450));
+
+// Sum of step durations over runs of the player, -1 if it never ends
+static long play_ms(const status_led_pattern_t *pattern, uint8_t times, unsigned *steps)
+{
+    status_led_player_t player;
+    const status_led_step_t *step = status_led_player_start(&player, pattern, times);
+    long total = 0;
+
+    *steps = 0;
+    while (step != NULL) {
+        if (step->ms == 0 || *steps > 1000) {
+            return -1;
+        }
+        total += step->ms;
+        (*steps)++;
+        step = status_led_player_next(&player);
+    }
+    return total;
+}
+
+static void test_macros(void)
+{
+    CHECK_EQ(s_steady_green.len, 1);
+    CHECK_EQ(s_steady_green.steps[0].green, 0xFF);
+    CHECK_EQ(s_steady_green.steps[0].red, 0);
+    CHECK_EQ(s_steady_green.steps[0].ms, 0);
+
+    CHECK_EQ(s_blink.len, 2);
+    CHECK_EQ(s_blink.steps[0].blue, 0xFF);
+    CHECK_EQ(s_blink.steps[1].blue, 0);
+    CHECK_EQ(s_blink.steps[1].ms, 300);
+
+    // Blinks with the pause folded into the last dark step
+    CHECK_EQ(s_burst.len, 6);
+    for (size_t i = 0; i < s_burst.len; i++) {
+        CHECK_EQ(s_burst.steps[i].red, i % 2 ? 0 : 0x80);
+        CHECK_EQ(s_burst.steps[i].blue, i % 2 ? 0 : 0xFF);
+        CHECK_EQ(s_burst.steps[i].ms, i == 5 ? 1150 : 150);
+    }
+    CHECK_EQ(s_burst_one.len, 2);
+    CHECK_EQ(s_burst_one.steps[1].ms, 500);
+}
+
+static void test_counted(void)
+{
+    unsigned steps;
+
+    CHECK_EQ(play_ms(&s_blink, 1, &steps), 400);
+    CHECK_EQ(steps, 2);
+    CHECK_EQ(play_ms(&s_blink, 5, &steps), 2000);
+    CHECK_EQ(steps, 10);
+    CHECK_EQ(play_ms(&s_burst, 2, &steps), 2 * 1900);
+    CHECK_EQ(steps, 12);
+    // A holding step never ends
+    CHECK_EQ(play_ms(&s_steady_green, 1, &steps), -1);
+}
+
+static void test_loop(void)
+{
+    status_led_player_t player;
+    const status_led_step_t *step = status_led_player_start(&player, &s_blink, 0);
+
+    for (int i = 0; i < 1000; i++) {
+        CHECK_EQ(step == &s_blink_steps[i % 2], 1);
+        step = status_led_player_next(&player);
+    }
+    CHECK_EQ(status_led_player_step(&player) == step, 1);
+
+    // Holding stays put
+    step = status_led_player_start(&player, &s_steady_green, 0);
+    CHECK_EQ(status_led_player_next(&player) == step, 1);
+    CHECK_EQ(status_led_player_next(&player) == step, 1);
+}
+
+static void test_idle(void)
+{
+    status_led_player_t player;
+
+    status_led_player_start(&player, &s_burst_one, 1);
+    status_led_player_next(&player);
+    CHECK_EQ(status_led_player_next(&player) == NULL, 1);
+    CHECK_EQ(player.pattern == NULL, 1);
+    CHECK_EQ(status_led_player_step(&player) == NULL, 1);
+    CHECK_EQ(status_led_player_next(&player) == NULL, 1);
+}
+
+int main(void)
+{
+    test_macros();
+    test_counted();
+    test_loop();
+    test_idle();
+
+    return host_test_summary("status_led player");
+}
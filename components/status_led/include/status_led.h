@@ -0,0 +1,119 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Status indication LED
+ *
+ * Plays status_led_pattern_t tables on one LED. Each step is applied from a
+ * one-shot esp_timer that is then re-armed for the step's duration, so there
+ * is no task and a steady color costs no wakeups at all.
+ *
+ * Two layers are shown: a base pattern that loops (or holds) until replaced,
+ * and a flash that plays a pattern a given number of times over it and then
+ * hands back to the base from its first step.
+ *
+ * The LED itself sits behind a back end: a GPIO, an LEDC PWM channel, or
+ * any callback - e.g. into the driver that owns an addressable strip, so the
+ * status pixel can share the strip with other pixels.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "status_led_pattern.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Show a color; called from the esp_timer task
+ */
+typedef void (*status_led_set_fn_t)(void *ctx, uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * @brief LED back end
+ */
+typedef struct {
+    status_led_set_fn_t set;            /**< Show a color */
+    void *ctx;                          /**< Passed to set */
+} status_led_backend_t;
+
+/**
+ * @brief Back end for an LED on a plain GPIO: on for any non-dark color
+ *
+ * @param gpio LED pin, configured as output here
+ * @param active_low Whether the LED lights with the pin low
+ * @param[out] backend Filled in; holds no allocation
+ */
+esp_err_t status_led_backend_gpio(gpio_num_t gpio, bool active_low, status_led_backend_t *backend);
+
+/**
+ * @brief LEDC channel for status_led_backend_ledc()
+ */
+typedef struct {
+    gpio_num_t gpio;                    /**< LED pin */
+    ledc_timer_t timer;                 /**< Timer, configured here */
+    ledc_channel_t channel;             /**< Channel, configured here */
+    uint32_t freq_hz;                   /**< PWM frequency */
+} status_led_ledc_config_t;
+
+/**
+ * @brief Back end for a dimmable LED on an LEDC channel
+ *
+ * The brightest channel of a color sets the duty (low speed mode, 8-bit).
+ *
+ * @param config Channel to use
+ * @param[out] backend Filled in; holds no allocation
+ */
+esp_err_t status_led_backend_ledc(const status_led_ledc_config_t *config, status_led_backend_t *backend);
+
+/**
+ * @brief Start the engine on a back end and show dark
+ *
+ * @return ESP_OK, or an error creating the timer or event group
+ */
+esp_err_t status_led_init(const status_led_backend_t *backend);
+
+/**
+ * @brief Replace the base pattern; NULL is dark
+ *
+ * Shown from its first step right away, or after the flash in progress. If
+ * the timer callback is running at that moment the change lands at the end
+ * of the current step.
+ */
+void status_led_set(const status_led_pattern_t *pattern);
+
+/**
+ * @brief Play pattern times times over the base, then return to the base
+ *
+ * Replaces a flash in progress. The pattern must not end in a holding step.
+ *
+ * @param times Number of runs, at least one
+ */
+void status_led_flash(const status_led_pattern_t *pattern, uint8_t times);
+
+/**
+ * @brief status_led_wait() timeout that never expires
+ */
+#define STATUS_LED_WAIT_FOREVER         UINT32_MAX
+
+/**
+ * @brief Wait until no flash is playing
+ *
+ * @param timeout_ms Longest wait, 0 to only check, or STATUS_LED_WAIT_FOREVER
+ * @return true if no flash is playing
+ */
+bool status_led_wait(uint32_t timeout_ms);
+
+/**
+ * @brief Drop base and flash, disarm the timer and show dark (before deep sleep)
+ */
+void status_led_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,129 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Status LED patterns
+ *
+ * A pattern is a const table of (color, duration) steps built at compile
+ * time with the macros below, so a firmware carries exactly the patterns it
+ * defines and they live in flash. A step with a duration of zero holds its
+ * color until the pattern is replaced; a steady color is a single such
+ * step. The player only walks a table - no IDF dependencies, so it also
+ * builds on the host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief One step: color and how long to show it
+ *
+ * Single-color back ends use the brightest channel as the level.
+ */
+typedef struct {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint16_t ms;                        /**< Duration, 0 holds the color */
+} status_led_step_t;
+
+/**
+ * @brief Sequence of steps
+ */
+typedef struct {
+    const status_led_step_t *steps;     /**< Steps, in flash */
+    uint8_t len;                        /**< Number of steps, at least one */
+} status_led_pattern_t;
+
+/**
+ * @brief Colors as 0xRRGGBB
+ */
+#define STATUS_LED_DARK                 0x000000
+#define STATUS_LED_WHITE                0xFFFFFF
+
+/**
+ * @brief Step showing rgb (0xRRGGBB) for ms milliseconds
+ */
+#define STATUS_LED_STEP(rgb, ms)        { ((rgb) >> 16) & 0xFF, ((rgb) >> 8) & 0xFF, (rgb) & 0xFF, (ms) }
+
+/**
+ * @brief Steady color
+ */
+#define STATUS_LED_HOLD(rgb)            STATUS_LED_STEP(rgb, 0)
+
+/**
+ * @brief One blink: on_ms lit, off_ms dark
+ */
+#define STATUS_LED_BLINK(rgb, on_ms, off_ms) \
+    STATUS_LED_STEP(rgb, on_ms), STATUS_LED_STEP(STATUS_LED_DARK, off_ms)
+
+/**
+ * @brief count blinks (1 to 8, a literal) followed by pause_ms extra dark
+ *
+ * The pause is folded into the last dark step, so a burst costs exactly one
+ * timer wakeup per edge.
+ */
+#define STATUS_LED_BURST(count, rgb, on_ms, off_ms, pause_ms)               \
+    STATUS_LED_BLINKS_##count(rgb, on_ms, off_ms)                           \
+    STATUS_LED_STEP(rgb, on_ms), STATUS_LED_STEP(STATUS_LED_DARK, (off_ms) + (pause_ms))
+
+#define STATUS_LED_BLINKS_1(rgb, on, off)
+#define STATUS_LED_BLINKS_2(rgb, on, off) STATUS_LED_BLINK(rgb, on, off),
+#define STATUS_LED_BLINKS_3(rgb, on, off) STATUS_LED_BLINKS_2(rgb, on, off) STATUS_LED_BLINK(rgb, on, off),
+#define STATUS_LED_BLINKS_4(rgb, on, off) STATUS_LED_BLINKS_3(rgb, on, off) STATUS_LED_BLINK(rgb, on, off),
+#define STATUS_LED_BLINKS_5(rgb, on, off) STATUS_LED_BLINKS_4(rgb, on, off) STATUS_LED_BLINK(rgb, on, off),
+#define STATUS_LED_BLINKS_6(rgb, on, off) STATUS_LED_BLINKS_5(rgb, on, off) STATUS_LED_BLINK(rgb, on, off),
+#define STATUS_LED_BLINKS_7(rgb, on, off) STATUS_LED_BLINKS_6(rgb, on, off) STATUS_LED_BLINK(rgb, on, off),
+#define STATUS_LED_BLINKS_8(rgb, on, off) STATUS_LED_BLINKS_7(rgb, on, off) STATUS_LED_BLINK(rgb, on, off),
+
+/**
+ * @brief Define a static const pattern name from the given steps
+ */
+#define STATUS_LED_PATTERN_DEFINE(name, ...)                                \
+    static const status_led_step_t name##_steps[] = { __VA_ARGS__ };      \
+    static const status_led_pattern_t name = {                              \
+        .steps = name##_steps,                                              \
+        .len = sizeof(name##_steps) / sizeof(name##_steps[0]),              \
+    }
+
+/**
+ * @brief Playback position
+ */
+typedef struct {
+    const status_led_pattern_t *pattern; /**< Pattern being played, NULL when idle */
+    uint8_t index;                      /**< Current step */
+    uint8_t remaining;                  /**< Runs left including this one, 0 loops forever */
+} status_led_player_t;
+
+/**
+ * @brief Play pattern from its first step
+ *
+ * @param times Number of runs, 0 to loop until replaced
+ * @return First step
+ */
+const status_led_step_t *status_led_player_start(status_led_player_t *player,
+                                                 const status_led_pattern_t *pattern, uint8_t times);
+
+/**
+ * @brief Move to the next step
+ *
+ * Wraps at the end of the pattern while runs are left. A holding step is
+ * never left.
+ *
+ * @return New current step, NULL once the last run ended (the player is then idle)
+ */
+const status_led_step_t *status_led_player_next(status_led_player_t *player);
+
+/**
+ * @brief Current step, NULL when idle
+ */
+const status_led_step_t *status_led_player_step(const status_led_player_t *player);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,176 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Status indication LED
+ */
+
+#include "status_led.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+static const char *TAG = "status_led";
+
+#define STATUS_LED_IDLE_BIT             (1 << 0)    /* No flash playing */
+
+static const status_led_step_t s_dark = STATUS_LED_HOLD(STATUS_LED_DARK);
+
+static status_led_backend_t s_backend;
+static esp_timer_handle_t s_timer;
+static EventGroupHandle_t s_events;
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Guarded by s_mux
+static status_led_player_t s_base;
+static status_led_player_t s_flash;
+static bool s_restart;                  // Show the current step again instead of advancing
+
+// Show step and arm the timer for the next one
+static void status_led_apply(const status_led_step_t *step)
+{
+    s_backend.set(s_backend.ctx, step->red, step->green, step->blue);
+    if (step->ms != 0) {
+        // Fails if a request re-armed the timer meanwhile; that run applies the request
+        esp_timer_start_once(s_timer, (uint64_t)step->ms * 1000);
+    }
+}
+
+// Runs in the esp_timer task at every step boundary and after every request
+static void status_led_timer_cb(void *arg)
+{
+    const status_led_step_t *step;
+    bool flash_done = false;
+
+    portENTER_CRITICAL(&s_mux);
+    if (s_restart) {
+        s_restart = false;
+        step = status_led_player_step(&s_flash);
+        if (step == NULL) {
+            step = status_led_player_step(&s_base);
+        }
+    } else if (s_flash.pattern != NULL) {
+        step = status_led_player_next(&s_flash);
+        if (step == NULL) {
+            // Hand back to the base from its start
+            flash_done = true;
+            step = s_base.pattern != NULL ? status_led_player_start(&s_base, s_base.pattern, 0) : NULL;
+        }
+    } else {
+        step = status_led_player_next(&s_base);
+    }
+    portEXIT_CRITICAL(&s_mux);
+
+    status_led_apply(step != NULL ? step : &s_dark);
+    if (flash_done) {
+        // Unless a new flash came in meanwhile
+        portENTER_CRITICAL(&s_mux);
+        flash_done = s_flash.pattern == NULL;
+        portEXIT_CRITICAL(&s_mux);
+        if (flash_done) {
+            xEventGroupSetBits(s_events, STATUS_LED_IDLE_BIT);
+        }
+    }
+}
+
+// Show the current step now rather than at the end of the one showing
+static void status_led_kick(void)
+{
+    if (s_timer == NULL) {
+        return;
+    }
+    esp_timer_stop(s_timer);
+    esp_timer_start_once(s_timer, 0);
+}
+
+esp_err_t status_led_init(const status_led_backend_t *backend)
+{
+    if (backend == NULL || backend->set == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_backend = *backend;
+
+    s_events = xEventGroupCreate();
+    if (s_events == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    xEventGroupSetBits(s_events, STATUS_LED_IDLE_BIT);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = status_led_timer_cb,
+        .name = "status_led",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &s_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create timer: %s", esp_err_to_name(ret));
+        vEventGroupDelete(s_events);
+        s_events = NULL;
+        return ret;
+    }
+
+    status_led_apply(&s_dark);
+    return ESP_OK;
+}
+
+void status_led_set(const status_led_pattern_t *pattern)
+{
+    bool visible;
+
+    portENTER_CRITICAL(&s_mux);
+    if (pattern != NULL) {
+        status_led_player_start(&s_base, pattern, 0);
+    } else {
+        s_base.pattern = NULL;
+    }
+    // Under a flash the new base only starts once the flash ends
+    visible = s_flash.pattern == NULL;
+    s_restart |= visible;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (visible) {
+        status_led_kick();
+    }
+}
+
+void status_led_flash(const status_led_pattern_t *pattern, uint8_t times)
+{
+    if (pattern == NULL || times == 0) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    status_led_player_start(&s_flash, pattern, times);
+    s_restart = true;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (s_events != NULL) {
+        xEventGroupClearBits(s_events, STATUS_LED_IDLE_BIT);
+    }
+    status_led_kick();
+}
+
+bool status_led_wait(uint32_t timeout_ms)
+{
+    if (s_events == NULL) {
+        return true;
+    }
+    TickType_t ticks = timeout_ms == STATUS_LED_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    EventBits_t bits = xEventGroupWaitBits(s_events, STATUS_LED_IDLE_BIT, pdFALSE, pdTRUE, ticks);
+    return (bits & STATUS_LED_IDLE_BIT) != 0;
+}
+
+void status_led_stop(void)
+{
+    portENTER_CRITICAL(&s_mux);
+    s_base.pattern = NULL;
+    s_flash.pattern = NULL;
+    s_restart = false;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (s_timer == NULL) {
+        return;
+    }
+    esp_timer_stop(s_timer);
+    s_backend.set(s_backend.ctx, 0, 0, 0);
+    xEventGroupSetBits(s_events, STATUS_LED_IDLE_BIT);
+}
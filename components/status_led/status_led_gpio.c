@@ -0,0 +1,40 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Status LED back end: plain GPIO
+ */
+
+#include "status_led.h"
+
+// ctx holds the pin, bit 8 is set for an active-low LED
+#define STATUS_LED_GPIO_ACTIVE_LOW      0x100
+
+static void status_led_gpio_set(void *ctx, uint8_t red, uint8_t green, uint8_t blue)
+{
+    uintptr_t pin = (uintptr_t)ctx;
+    uint32_t on = (red | green | blue) != 0;
+
+    if (pin & STATUS_LED_GPIO_ACTIVE_LOW) {
+        on = !on;
+    }
+    gpio_set_level((gpio_num_t)(pin & 0xFF), on);
+}
+
+esp_err_t status_led_backend_gpio(gpio_num_t gpio, bool active_low, status_led_backend_t *backend)
+{
+    const gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << gpio,
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    backend->set = status_led_gpio_set;
+    backend->ctx = (void *)(uintptr_t)(gpio | (active_low ? STATUS_LED_GPIO_ACTIVE_LOW : 0));
+    return ESP_OK;
+}
@@ -0,0 +1,48 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Status LED back end: LEDC PWM channel
+ */
+
+#include "status_led.h"
+
+static void status_led_ledc_set(void *ctx, uint8_t red, uint8_t green, uint8_t blue)
+{
+    ledc_channel_t channel = (ledc_channel_t)(uintptr_t)ctx;
+    uint8_t level = red > green ? red : green;
+
+    level = level > blue ? level : blue;
+    ledc_set_duty(LEDC_LOW_SPEED_MODE, channel, level);
+    ledc_update_duty(LEDC_LOW_SPEED_MODE, channel);
+}
+
+esp_err_t status_led_backend_ledc(const status_led_ledc_config_t *config, status_led_backend_t *backend)
+{
+    const ledc_timer_config_t timer_conf = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .duty_resolution = LEDC_TIMER_8_BIT,
+        .timer_num = config->timer,
+        .freq_hz = config->freq_hz,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    esp_err_t ret = ledc_timer_config(&timer_conf);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    const ledc_channel_config_t channel_conf = {
+        .gpio_num = config->gpio,
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .channel = config->channel,
+        .timer_sel = config->timer,
+        .duty = 0,
+    };
+    ret = ledc_channel_config(&channel_conf);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    backend->set = status_led_ledc_set;
+    backend->ctx = (void *)(uintptr_t)config->channel;
+    return ESP_OK;
+}
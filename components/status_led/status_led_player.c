@@ -0,0 +1,43 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Status LED patterns
+ */
+
+#include "status_led_pattern.h"
+
+const status_led_step_t *status_led_player_start(status_led_player_t *player,
+                                                 const status_led_pattern_t *pattern, uint8_t times)
+{
+    player->pattern = pattern;
+    player->index = 0;
+    player->remaining = times;
+    return &pattern->steps[0];
+}
+
+const status_led_step_t *status_led_player_next(status_led_player_t *player)
+{
+    const status_led_pattern_t *pattern = player->pattern;
+
+    if (pattern == NULL) {
+        return NULL;
+    }
+    if (pattern->steps[player->index].ms == 0) {
+        return &pattern->steps[player->index];
+    }
+    if (++player->index < pattern->len) {
+        return &pattern->steps[player->index];
+    }
+
+    player->index = 0;
+    if (player->remaining != 0 && --player->remaining == 0) {
+        player->pattern = NULL;
+        return NULL;
+    }
+    return &pattern->steps[0];
+}
+
+const status_led_step_t *status_led_player_step(const status_led_player_t *player)
+{
+    return player->pattern != NULL ? &player->pattern->steps[player->index] : NULL;
+}
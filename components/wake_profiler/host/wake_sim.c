@@ -0,0 +1,136 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host wake-cycle simulator: virtual clock and energy model
+ */
+
+#include "wake_sim.h"
+#include <stdio.h>
+#include <string.h>
+
+#define US_PER_DAY          86400000000.0
+
+static const char *const s_state_names[WAKE_SIM_STATE_MAX] = {
+    [WAKE_SIM_DEEP_SLEEP] = "deep sleep",
+    [WAKE_SIM_LIGHT_SLEEP] = "light sleep",
+    [WAKE_SIM_CPU] = "cpu",
+    [WAKE_SIM_RADIO_RX] = "radio rx",
+    [WAKE_SIM_RADIO_TX] = "radio tx",
+};
+
+static const char *const s_phase_names[WAKE_PHASE_MAX + 1] = {
+    [WAKE_PHASE_BOOT] = "boot",
+    [WAKE_PHASE_SENSOR_INIT] = "sensor_init",
+    [WAKE_PHASE_MEASURE] = "measure",
+    [WAKE_PHASE_STACK_INIT] = "stack_init",
+    [WAKE_PHASE_REJOIN] = "rejoin",
+    [WAKE_PHASE_REPORT] = "report",
+    [WAKE_PHASE_AWAKE] = "other awake",
+    [WAKE_PHASE_MAX] = "asleep",
+};
+
+/* Charge in µC of current_ua flowing for us */
+static double charge_uc(uint32_t current_ua, uint64_t us)
+{
+    return (double)current_ua * (double)us / 1e6;
+}
+
+static void account(wake_sim_t *sim, wake_sim_state_t state, wake_phase_t phase, uint64_t us)
+{
+    double uc = charge_uc(sim->power.current_ua[state], us);
+    sim->state_us[state] += us;
+    sim->state_uc[state] += uc;
+    sim->phase_uc[phase] += uc;
+    if (phase == WAKE_PHASE_MAX) {
+        sim->asleep_us += us;
+    }
+    sim->now_us += us;
+}
+
+void wake_sim_init(wake_sim_t *sim, const wake_sim_power_t *power)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->power = *power;
+}
+
+void wake_sim_wake(wake_sim_t *sim)
+{
+    sim->awake = true;
+    sim->wakes++;
+    account(sim, WAKE_SIM_CPU, WAKE_PHASE_BOOT, (uint64_t)sim->power.boot_ms * 1000);
+}
+
+void wake_sim_resume(wake_sim_t *sim)
+{
+    sim->awake = true;
+    sim->wakes++;
+}
+
+void wake_sim_spend(wake_sim_t *sim, wake_sim_state_t state, wake_phase_t phase, uint32_t ms)
+{
+    if (!sim->awake || state == WAKE_SIM_DEEP_SLEEP || phase > WAKE_PHASE_MAX) {
+        return;
+    }
+    account(sim, state, phase, (uint64_t)ms * 1000);
+}
+
+void wake_sim_load(wake_sim_t *sim, wake_phase_t phase, uint32_t current_ua, uint64_t ms)
+{
+    double uc = charge_uc(current_ua, ms * 1000);
+    sim->load_uc += uc;
+    sim->phase_uc[phase > WAKE_PHASE_MAX ? WAKE_PHASE_MAX : phase] += uc;
+}
+
+void wake_sim_uplink(wake_sim_t *sim)
+{
+    sim->uplinks++;
+}
+
+void wake_sim_sleep(wake_sim_t *sim, int64_t us)
+{
+    sim->awake = false;
+    if (us > 0) {
+        account(sim, WAKE_SIM_DEEP_SLEEP, WAKE_PHASE_MAX, us);
+    }
+}
+
+void wake_sim_report(const wake_sim_t *sim, uint32_t battery_mah)
+{
+    double total_uc = sim->load_uc;
+    for (int i = 0; i < WAKE_SIM_STATE_MAX; i++) {
+        total_uc += sim->state_uc[i];
+    }
+    if (sim->now_us == 0 || total_uc == 0) {
+        printf("nothing simulated\n");
+        return;
+    }
+
+    double days = sim->now_us / US_PER_DAY;
+    double mah_per_day = total_uc / 3.6e6 / days;
+    double awake_us = sim->now_us - sim->asleep_us;
+
+    printf("%s, %.2f days: %lu wakes (%.0f/day), %lu with radio (%.0f/day), %.0f ms awake per wake\n",
+           sim->power.name, days, (unsigned long)sim->wakes, sim->wakes / days,
+           (unsigned long)sim->uplinks, sim->uplinks / days, sim->wakes ? awake_us / 1000 / sim->wakes : 0);
+    printf("  average %.1f uA, %.3f mAh/day", total_uc * 1e6 / sim->now_us, mah_per_day);
+    if (battery_mah > 0) {
+        printf(", %.0f days on %lu mAh", battery_mah / mah_per_day, (unsigned long)battery_mah);
+    }
+    printf("\n");
+
+    printf("  %-12s %9s %9s %8s\n", "state", "time %", "mAh/day", "charge %");
+    for (int i = 0; i < WAKE_SIM_STATE_MAX; i++) {
+        printf("  %-12s %9.4f %9.4f %8.1f\n", s_state_names[i], 100.0 * sim->state_us[i] / sim->now_us,
+               sim->state_uc[i] / 3.6e6 / days, 100.0 * sim->state_uc[i] / total_uc);
+    }
+    printf("  %-12s %9s %9.4f %8.1f\n", "peripherals", "", sim->load_uc / 3.6e6 / days,
+           100.0 * sim->load_uc / total_uc);
+
+    printf("  %-12s %9s %9s %8s\n", "phase", "", "mAh/day", "charge %");
+    for (int i = 0; i <= WAKE_PHASE_MAX; i++) {
+        if (sim->phase_uc[i] > 0) {
+            printf("  %-12s %9s %9.4f %8.1f\n", s_phase_names[i], "", sim->phase_uc[i] / 3.6e6 / days,
+                   100.0 * sim->phase_uc[i] / total_uc);
+        }
+    }
+}
@@ -0,0 +1,150 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host wake-cycle simulator: virtual clock and energy model
+ *
+ * A device model spends virtual time in power states (deep sleep, light
+ * sleep, CPU active, radio receive, radio transmit) and attributes it to the
+ * wake_profiler phases. The simulator integrates the chip current of each
+ * state, plus any peripheral load, into charge per state and per phase, so a
+ * change to a wake sequence or timer can be compared in mAh/day before it is
+ * tried on hardware.
+ *
+ * Host only, not part of any IDF build; see wake_sim_devices.c.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "wake_profiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Power states of the chip
+ */
+typedef enum {
+    WAKE_SIM_DEEP_SLEEP,        /**< RTC timer and RTC memory only */
+    WAKE_SIM_LIGHT_SLEEP,       /**< Tickless idle with PM enabled */
+    WAKE_SIM_CPU,               /**< CPU running, radio off */
+    WAKE_SIM_RADIO_RX,          /**< Receiving or listening */
+    WAKE_SIM_RADIO_TX,          /**< Transmitting */
+    WAKE_SIM_STATE_MAX,
+} wake_sim_state_t;
+
+/**
+ * @brief Chip currents in µA at 3.3 V, and the boot time
+ */
+typedef struct {
+    const char *name;                           /**< Chip, for the report */
+    uint32_t current_ua[WAKE_SIM_STATE_MAX];    /**< Per state */
+    uint32_t boot_ms;                           /**< Reset to app_main, spent in WAKE_SIM_CPU */
+} wake_sim_power_t;
+
+/**
+ * @brief Rounded typical datasheet figures
+ *
+ * Radio currents include the CPU. Boot is ROM plus second-stage bootloader
+ * from flash with the default log level.
+ */
+#define WAKE_SIM_POWER_ESP32C6()                        \
+    {                                                   \
+        .name = "ESP32-C6",                             \
+        .current_ua = {                                 \
+            [WAKE_SIM_DEEP_SLEEP] = 7,                  \
+            [WAKE_SIM_LIGHT_SLEEP] = 180,               \
+            [WAKE_SIM_CPU] = 38000,                     \
+            [WAKE_SIM_RADIO_RX] = 74000,                \
+            [WAKE_SIM_RADIO_TX] = 80000,                \
+        },                                              \
+        .boot_ms = 140,                                 \
+    }
+
+#define WAKE_SIM_POWER_ESP32H2()                        \
+    {                                                   \
+        .name = "ESP32-H2",                             \
+        .current_ua = {                                 \
+            [WAKE_SIM_DEEP_SLEEP] = 7,                  \
+            [WAKE_SIM_LIGHT_SLEEP] = 85,                \
+            [WAKE_SIM_CPU] = 20000,                     \
+            [WAKE_SIM_RADIO_RX] = 24000,                \
+            [WAKE_SIM_RADIO_TX] = 27000,                \
+        },                                              \
+        .boot_ms = 140,                                 \
+    }
+
+/**
+ * @brief Simulation state
+ *
+ * Charge is kept in µC as double; a day at 80 mA is 6.9e9 µC, well inside
+ * its exact integer range.
+ */
+typedef struct {
+    wake_sim_power_t power;                     /**< Chip model */
+    int64_t now_us;                             /**< Virtual time since the start */
+    bool awake;                                 /**< Between wake_sim_wake() and wake_sim_sleep() */
+    uint32_t wakes;                             /**< Wakes so far */
+    uint32_t uplinks;                           /**< Wakes that started the radio */
+    uint64_t asleep_us;                         /**< Time between wakes: deep sleep, or light sleep and data polls */
+    uint64_t state_us[WAKE_SIM_STATE_MAX];      /**< Time per state */
+    double state_uc[WAKE_SIM_STATE_MAX];        /**< Chip charge per state */
+    double phase_uc[WAKE_PHASE_MAX + 1];        /**< Chip and load charge per wake phase, the last entry asleep */
+    double load_uc;                             /**< Peripheral charge (sensors, LEDs) */
+} wake_sim_t;
+
+/**
+ * @brief Start a simulation at time 0, asleep
+ */
+void wake_sim_init(wake_sim_t *sim, const wake_sim_power_t *power);
+
+/**
+ * @brief Wake from deep sleep: boot, attributed to WAKE_PHASE_BOOT
+ */
+void wake_sim_wake(wake_sim_t *sim);
+
+/**
+ * @brief Start a wake of a device that stays up between wakes (SED in light sleep)
+ */
+void wake_sim_resume(wake_sim_t *sim);
+
+/**
+ * @brief Spend time awake in a state
+ *
+ * @param phase Wake phase the time counts towards, WAKE_PHASE_AWAKE for none,
+ *              WAKE_PHASE_MAX for the time between wakes of a device that
+ *              stays up; that time counts as asleep, not as part of a wake
+ */
+void wake_sim_spend(wake_sim_t *sim, wake_sim_state_t state, wake_phase_t phase, uint32_t ms);
+
+/**
+ * @brief Charge of a peripheral, without advancing the clock
+ *
+ * @param phase Wake phase it counts towards, WAKE_PHASE_MAX for asleep
+ */
+void wake_sim_load(wake_sim_t *sim, wake_phase_t phase, uint32_t current_ua, uint64_t ms);
+
+/**
+ * @brief Mark the current wake as one that used the radio
+ */
+void wake_sim_uplink(wake_sim_t *sim);
+
+/**
+ * @brief Enter deep sleep until the next wake
+ *
+ * @param us Sleep time; the RTC timer wake-up is measured from here
+ */
+void wake_sim_sleep(wake_sim_t *sim, int64_t us);
+
+/**
+ * @brief Print consumption, duty cycle and battery life
+ *
+ * @param battery_mah Usable battery capacity, 0 to skip the life estimate
+ */
+void wake_sim_report(const wake_sim_t *sim, uint32_t battery_mah);
+
+#ifdef __cplusplus
+}
+#endif
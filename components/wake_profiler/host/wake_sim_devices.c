@@ -0,0 +1,841 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host wake-cycle simulator: the battery devices of this repository
+ *
+ * Each model replays one device's wake sequence on the virtual clock of
+ * wake_sim.c and prints its consumption:
+ *
+ *   co2     zigbee-co2: adaptive interval, buffered reports. Runs the real
+ *           wake_interval, report_policy and scd40_strategy code against a
+ *           synthetic bedroom CO2 trace.
+ *   remote  zigbee-remote: 20 s timer, LED blinks, 5 s one-shot before sleep
+ *   motion  zigbee-motion-light: 3 min heartbeat plus PIR wakes
+ *   ot      deep_sleep: OpenThread sleepy device, 20 s timer, 5 s before sleep
+ *
+ * With light=1 the co2 and remote models run as a joined sleepy end device
+ * in automatic light sleep instead (CO2_SENSOR_SLEEP_LIGHT,
+ * REMOTE_SLEEP_LIGHT); the light sleep between wakes counts as asleep. Each
+ * run ends with the sleep_policy estimate for the intervals the firmware
+ * passes to it, to check the policy against the simulation.
+ *
+ * Timers, intervals and thresholds are read at start-up from the firmware
+ * sources under the repository root: the default of a Kconfig option unless
+ * the application's sdkconfig sets it, or a #define or const int. The rejoin
+ * time is the average of the profiler log in zigbee-co2/README.md, the other
+ * radio and stack times are rough defaults; replace them with the averages
+ * the wake profile cluster (0xFC01) reports from a real device.
+ *
+ * The models script the applications' wake sequences rather than run them,
+ * so host/wake_sim_test.c pins the figures read from the tree and the sleep
+ * policy verdicts; a firmware change that moves them fails there first.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wake_sim_devices.h"
+#include "wake_interval.h"
+#include "report_policy.h"
+#include "scd40_strategy.h"
+
+#define SIM_MAX_PARAMS      32
+#define SIM_DAY_S           86400
+#define SIM_LINE_MAX        256
+
+/*
+ * Where the firmware keeps a figure: a Kconfig option, a #define or a
+ * const int in file, relative to the repository root. The value found is
+ * multiplied by scale (0 counts as 1), e.g. to turn seconds into ms.
+ */
+typedef struct {
+    const char *file;
+    const char *symbol;
+    int32_t scale;
+} sim_origin_t;
+
+typedef struct {
+    const char *name;
+    int32_t value;                              /* Filled in from origin if it has a file */
+    const char *help;
+    sim_origin_t origin;                        /* No file: a model assumption */
+    bool set;                                   /* Given on the command line */
+} sim_param_t;
+
+typedef struct sim_device {
+    const char *name;
+    const char *app;
+    const char *sdkconfig;                      /* Overrides the Kconfig defaults, may be missing */
+    bool h2;                                    /* Default chip is an ESP32-H2 */
+    void (*run)(wake_sim_t *sim, const sim_param_t *params);
+    /* Wake interval the firmware gives the sleep policy; NULL for the simulated average */
+    uint32_t (*policy_wake_s)(const sim_param_t *params);
+    sim_param_t params[SIM_MAX_PARAMS];         /* Terminated by a NULL name */
+} sim_device_t;
+
+/* Parameters every model has, prepended to its own */
+#define SIM_COMMON_PARAMS(keep_alive_file, keep_alive_symbol)                       \
+    { "days", 7, "simulated time" },                                                \
+    { "battery_mah", 2600, "usable capacity for the life estimate" },               \
+    { "stack_ms", 60, "stack and device setup until esp_zb_start(), CPU" },         \
+    { "rejoin_ms", 1650, "rejoin from NVRAM, radio listening" },                    \
+    { "frame_ms", 4, "one frame on air including CSMA" },                           \
+    { "ack_ms", 40, "listening for the ack and response per frame" },               \
+    { "light", 0, "stay joined as a light-sleeping SED (co2 and remote)" },         \
+    { "poll_interval_ms", 0, "SED data poll period",                                \
+      { keep_alive_file, keep_alive_symbol } },                                     \
+    { "poll_ms", 5, "radio on per data poll" }
+
+static uint32_t s_rng = 0x2545F491;
+
+static uint32_t rng_next(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+/* Uniform in [-range, range] */
+static int32_t rng_spread(int32_t range)
+{
+    return range ? (int32_t)(rng_next() % (2 * range + 1)) - range : 0;
+}
+
+static const sim_param_t *param_find(const sim_param_t *params, const char *name)
+{
+    for (; params->name != NULL; params++) {
+        if (strcmp(params->name, name) == 0) {
+            return params;
+        }
+    }
+    return NULL;
+}
+
+static int32_t param(const sim_param_t *params, const char *name)
+{
+    const sim_param_t *p = param_find(params, name);
+    if (p == NULL) {
+        fprintf(stderr, "model reads unknown parameter %s\n", name);
+        exit(2);
+    }
+    return p->value;
+}
+
+/********************* Figures from the firmware sources *********************/
+
+static FILE *source_open(const char *repo, const char *file)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", repo, file);
+    return fopen(path, "r");
+}
+
+/* Integer expression: numbers, + - * / and parentheses */
+static bool expr_parse(const char **s, int64_t *value);
+
+static bool expr_term(const char **s, int64_t *value)
+{
+    while (**s == ' ' || **s == '\t') {
+        (*s)++;
+    }
+    if (**s == '(') {
+        (*s)++;
+        if (!expr_parse(s, value)) {
+            return false;
+        }
+        while (**s == ' ' || **s == '\t') {
+            (*s)++;
+        }
+        if (**s != ')') {
+            return false;
+        }
+        (*s)++;
+        return true;
+    }
+    char *end;
+    *value = strtoll(*s, &end, 0);
+    if (end == *s) {
+        return false;
+    }
+    // Integer suffixes
+    while (*end == 'u' || *end == 'U' || *end == 'l' || *end == 'L') {
+        end++;
+    }
+    *s = end;
+    return true;
+}
+
+static bool expr_product(const char **s, int64_t *value)
+{
+    if (!expr_term(s, value)) {
+        return false;
+    }
+    while (true) {
+        while (**s == ' ' || **s == '\t') {
+            (*s)++;
+        }
+        char op = **s;
+        int64_t rhs;
+        if ((op != '*' && op != '/') || ((*s)++, !expr_term(s, &rhs)) || (op == '/' && rhs == 0)) {
+            return op != '*' && op != '/';
+        }
+        *value = op == '*' ? *value * rhs : *value / rhs;
+    }
+}
+
+static bool expr_parse(const char **s, int64_t *value)
+{
+    if (!expr_product(s, value)) {
+        return false;
+    }
+    while (true) {
+        while (**s == ' ' || **s == '\t') {
+            (*s)++;
+        }
+        char op = **s;
+        int64_t rhs;
+        if ((op != '+' && op != '-') || ((*s)++, !expr_product(s, &rhs))) {
+            return op != '+' && op != '-';
+        }
+        *value = op == '+' ? *value + rhs : *value - rhs;
+    }
+}
+
+/* Value of an expression up to a comment, ';' or the end of the line */
+static bool expr_eval(const char *text, int64_t *value)
+{
+    char buf[SIM_LINE_MAX];
+    snprintf(buf, sizeof(buf), "%s", text);
+    buf[strcspn(buf, ";\r\n")] = '\0';
+    char *comment = strstr(buf, "/*");
+    if (comment == NULL) {
+        comment = strstr(buf, "//");
+    }
+    if (comment) {
+        *comment = '\0';
+    }
+
+    const char *s = buf;
+    if (!expr_parse(&s, value)) {
+        return false;
+    }
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    return *s == '\0';
+}
+
+/* Text after word at s, if s starts with word followed by a blank */
+static const char *after_word(const char *s, const char *word)
+{
+    size_t len = strlen(word);
+    if (strncmp(s, word, len) != 0 || (s[len] != ' ' && s[len] != '\t')) {
+        return NULL;
+    }
+    s += len;
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    return s;
+}
+
+/* CONFIG_<symbol>=value in an sdkconfig */
+static bool sdkconfig_value(const char *repo, const char *file, const char *symbol, int64_t *value)
+{
+    char line[SIM_LINE_MAX];
+    char key[128];
+    bool found = false;
+    FILE *f = file ? source_open(repo, file) : NULL;
+
+    if (f == NULL) {
+        return false;
+    }
+    snprintf(key, sizeof(key), "CONFIG_%s=", symbol);
+    while (!found && fgets(line, sizeof(line), f)) {
+        found = strncmp(line, key, strlen(key)) == 0 && expr_eval(line + strlen(key), value);
+    }
+    fclose(f);
+    return found;
+}
+
+/* First unconditional default of a Kconfig option */
+static bool kconfig_default(FILE *f, const char *symbol, int64_t *value)
+{
+    char line[SIM_LINE_MAX];
+    bool in_option = false;
+
+    while (fgets(line, sizeof(line), f)) {
+        const char *s = line;
+        while (*s == ' ' || *s == '\t') {
+            s++;
+        }
+        const char *rest;
+        if ((rest = after_word(s, "config")) != NULL || (rest = after_word(s, "menuconfig")) != NULL) {
+            in_option = strncmp(rest, symbol, strlen(symbol)) == 0 && strchr(" \t\r\n", rest[strlen(symbol)]);
+        } else if (in_option && (rest = after_word(s, "default")) != NULL && strstr(rest, " if ") == NULL) {
+            return expr_eval(rest, value);
+        }
+    }
+    return false;
+}
+
+/* #define <symbol> value or const int <symbol> = value in C source */
+static bool c_value(FILE *f, const char *symbol, int64_t *value)
+{
+    char line[SIM_LINE_MAX];
+    size_t len = strlen(symbol);
+
+    while (fgets(line, sizeof(line), f)) {
+        const char *s = line;
+        while (*s == ' ' || *s == '\t') {
+            s++;
+        }
+        const char *rest = NULL;
+        if (*s == '#') {
+            // "# define" counts too
+            s++;
+            while (*s == ' ' || *s == '\t') {
+                s++;
+            }
+            rest = after_word(s, "define");
+        } else if ((s = after_word(s, "const")) != NULL) {
+            rest = after_word(s, "int");
+        }
+        if (rest == NULL || strncmp(rest, symbol, len) != 0 || !strchr(" \t=", rest[len])) {
+            continue;
+        }
+        rest += len;
+        while (*rest == ' ' || *rest == '\t' || *rest == '=') {
+            rest++;
+        }
+        return expr_eval(rest, value);
+    }
+    return false;
+}
+
+/**
+ * Fill in the parameters not given on the command line from the firmware
+ * sources. Returns false, after printing which, if one cannot be found.
+ */
+static bool params_resolve(sim_device_t *device, const char *repo, bool quiet)
+{
+    bool ok = true;
+
+    for (sim_param_t *p = device->params; p->name != NULL; p++) {
+        const sim_origin_t *origin = &p->origin;
+        if (p->set || origin->file == NULL) {
+            continue;
+        }
+
+        int64_t value;
+        bool found = false;
+        const char *name = strrchr(origin->file, '/') ? strrchr(origin->file, '/') + 1 : origin->file;
+        bool kconfig = strncmp(name, "Kconfig", 7) == 0;
+        if (kconfig) {
+            // The application's configuration wins over the option's default, as in the build
+            found = sdkconfig_value(repo, device->sdkconfig, origin->symbol, &value);
+        }
+        FILE *f = found ? NULL : source_open(repo, origin->file);
+        if (f != NULL) {
+            found = kconfig ? kconfig_default(f, origin->symbol, &value) : c_value(f, origin->symbol, &value);
+            fclose(f);
+        }
+        if (!found) {
+            if (!quiet) {
+                fprintf(stderr, "%s: %s not found in %s/%s; pass repo= or %s=\n",
+                        p->name, origin->symbol, repo, origin->file, p->name);
+            }
+            ok = false;
+            continue;
+        }
+        p->value = (int32_t)(value * (origin->scale ? origin->scale : 1));
+    }
+    return ok;
+}
+
+/* Waiting with nothing to do: light sleep with PM and tickless idle, else the idle task spins */
+static void sim_idle(wake_sim_t *sim, const sim_param_t *p, wake_phase_t phase, uint32_t ms)
+{
+    wake_sim_spend(sim, param(p, "pm") ? WAKE_SIM_LIGHT_SLEEP : WAKE_SIM_CPU, phase, ms);
+}
+
+/* Frames each answered by the parent */
+static void sim_zigbee_send(wake_sim_t *sim, const sim_param_t *p, uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; i++) {
+        wake_sim_spend(sim, WAKE_SIM_RADIO_TX, WAKE_PHASE_REPORT, param(p, "frame_ms"));
+        wake_sim_spend(sim, WAKE_SIM_RADIO_RX, WAKE_PHASE_REPORT, param(p, "ack_ms"));
+    }
+}
+
+/* Zigbee stack start and rejoin, then the frames */
+static void sim_zigbee_uplink(wake_sim_t *sim, const sim_param_t *p, uint32_t frames)
+{
+    wake_sim_uplink(sim);
+    wake_sim_spend(sim, WAKE_SIM_CPU, WAKE_PHASE_STACK_INIT, param(p, "stack_ms"));
+    wake_sim_spend(sim, WAKE_SIM_RADIO_RX, WAKE_PHASE_REJOIN, param(p, "rejoin_ms"));
+    sim_zigbee_send(sim, p, frames);
+}
+
+/* Joined SED between wakes: light sleep, up for a data poll every keep_alive */
+static void sim_sed_idle(wake_sim_t *sim, const sim_param_t *p, int64_t ms)
+{
+    uint32_t rx_ms = ms / param(p, "poll_interval_ms") * param(p, "poll_ms");
+    wake_sim_spend(sim, WAKE_SIM_RADIO_RX, WAKE_PHASE_MAX, rx_ms);
+    wake_sim_spend(sim, WAKE_SIM_LIGHT_SLEEP, WAKE_PHASE_MAX, ms - rx_ms);
+}
+
+/* Poisson arrivals: time of the event after after_us, rate per hour */
+static int64_t sim_next_event(int64_t after_us, int32_t per_hour)
+{
+    if (per_hour <= 0) {
+        return INT64_MAX;
+    }
+    double u = (rng_next() >> 8) / 16777216.0;
+    return after_us + (int64_t)(-log(1.0 - u) * 3600e6 / per_hour);
+}
+
+/**
+ * Deep sleep until the RTC timer or a GPIO event, whichever comes first.
+ * Events while awake do not wake the device and are dropped. Returns true
+ * for a GPIO wake; *event_us then moves on to the next event.
+ */
+static bool sim_sleep(wake_sim_t *sim, int64_t timer_us, int64_t *event_us, int32_t per_hour)
+{
+    while (*event_us <= sim->now_us) {
+        *event_us = sim_next_event(*event_us, per_hour);
+    }
+    int64_t wake_us = sim->now_us + timer_us;
+    bool event = *event_us < wake_us;
+    wake_sim_sleep(sim, (event ? *event_us : wake_us) - sim->now_us);
+    return event;
+}
+
+/********************* zigbee-co2 *********************/
+
+/* CO2 of a bedroom: occupied 22:00-07:00, first order towards the occupied or empty level */
+typedef struct {
+    double co2_ppm;
+    int64_t time_us;
+} sim_room_t;
+
+static uint16_t sim_room_co2(sim_room_t *room, const sim_param_t *p, int64_t now_us)
+{
+    double dt_min = (now_us - room->time_us) / 60e6;
+    uint32_t hour = (uint32_t)(now_us / 3600000000LL) % 24;
+    bool occupied = hour >= 22 || hour < 7;
+    double target = 420 + (occupied ? 450.0 * param(p, "occupants") : 0);
+    double tau_min = occupied ? 90 : 180;
+
+    room->co2_ppm = target + (room->co2_ppm - target) * exp(-dt_min / tau_min);
+    room->time_us = now_us;
+    return (uint16_t)(room->co2_ppm + rng_spread(8));
+}
+
+static void sim_run_co2(wake_sim_t *sim, const sim_param_t *p)
+{
+    const wake_interval_config_t wake_config = {
+        .min_interval_s = param(p, "wake_min"),
+        .max_interval_s = param(p, "wake_max"),
+        .stable_slope = param(p, "stable_slope"),
+        .fast_slope = param(p, "fast_slope"),
+        .high_level_ppm = param(p, "fast_level"),
+    };
+    const report_policy_config_t policy_config = {
+        .num_channels = 3,
+        .channels = {
+            { .deadband = param(p, "deadband_co2"), .alert_enabled = param(p, "alert") > 0,
+              .alert_level = param(p, "alert"), .alert_hysteresis = param(p, "alert_hyst") },
+            { .deadband = param(p, "deadband_t") },
+            { .deadband = param(p, "deadband_rh") },
+        },
+        .max_silence_s = param(p, "silence"),
+    };
+    const scd40_energy_model_t model = SCD40_ENERGY_MODEL_DEFAULT();
+    scd40_variant_t variant = param(p, "variant") == 41 ? SCD4X_VARIANT_SCD41 : SCD4X_VARIANT_SCD40;
+
+    wake_interval_state_t wake_state = { 0 };
+    report_policy_state_t policy_state = { 0 };
+    sim_room_t room = { .co2_ppm = 450 };
+    scd40_strategy_t strategy = SCD40_STRATEGY_PERIODIC;
+    uint32_t buffered = 0;
+    uint16_t co2_ppm = 0;
+    uint32_t co2_time_s = 0;
+    int64_t end_us = (int64_t)param(p, "days") * SIM_DAY_S * 1000000;
+    int64_t no_event_us = INT64_MAX;
+
+    bool light = param(p, "light");
+
+    // Samples are stamped at the wake; the first one is taken one interval in.
+    // A light-sleeping SED boots and joins once.
+    if (light) {
+        wake_sim_wake(sim);
+        sim_zigbee_uplink(sim, p, 0);
+        sim_sed_idle(sim, p, param(p, "wake_min") * 1000);
+    } else {
+        sim_sleep(sim, (int64_t)param(p, "wake_min") * 1000000, &no_event_us, 0);
+    }
+
+    while (sim->now_us < end_us) {
+        int64_t wake_us = sim->now_us;
+        uint32_t now_s = wake_us / 1000000;
+        if (light) {
+            wake_sim_resume(sim);
+        } else {
+            wake_sim_wake(sim);
+        }
+        wake_sim_spend(sim, WAKE_SIM_CPU, WAKE_PHASE_SENSOR_INIT, 2);
+
+        // Host waits out the conversion, then reads the sample over I2C
+        uint32_t wait_ms = scd40_strategy_wait_ms(strategy);
+        sim_idle(sim, p, WAKE_PHASE_MEASURE, wait_ms);
+        wake_sim_spend(sim, WAKE_SIM_CPU, WAKE_PHASE_MEASURE, param(p, "sensor_ms"));
+        if (scd40_strategy_measures_co2(strategy) || co2_ppm == 0) {
+            co2_ppm = sim_room_co2(&room, p, wake_us);
+            co2_time_s = now_s;
+        }
+        int32_t day_phase = (int32_t)(now_s % SIM_DAY_S);
+        int32_t values[3] = {
+            co2_ppm,
+            2100 + (int32_t)(150 * sin(2 * M_PI * day_phase / SIM_DAY_S)) + rng_spread(5),
+            4500 + (int32_t)(500 * cos(2 * M_PI * day_phase / SIM_DAY_S)) + rng_spread(30),
+        };
+
+        uint32_t sleep_s = wake_interval_update(&wake_config, &wake_state, co2_ppm, now_s);
+
+        // As sensor_next_strategy() in CO2_SENSOR_STRATEGY_AUTO
+        int32_t slope = wake_interval_slope(&wake_state);
+        bool co2_needed = param(p, "refresh") == 0 ||
+                          slope > wake_config.stable_slope || slope < -wake_config.stable_slope ||
+                          now_s + sleep_s - co2_time_s > (uint32_t)param(p, "refresh");
+        scd40_strategy_t next = scd40_strategy_select(&model, variant, sleep_s, co2_needed);
+
+        // Sensor current over the coming interval, less the host wait counted above
+        uint64_t sensor_uc = scd40_strategy_charge_uc(&model, next, sleep_s);
+        uint64_t host_uc = (uint64_t)model.host_wait_na * scd40_strategy_wait_ms(next) / 1000000;
+        wake_sim_load(sim, WAKE_PHASE_MEASURE, (sensor_uc - host_uc) / sleep_s, (uint64_t)sleep_s * 1000);
+        strategy = next;
+
+        buffered++;
+        uint32_t reasons = report_policy_evaluate(&policy_config, &policy_state, values, now_s);
+        if (reasons != REPORT_POLICY_NONE || buffered >= (uint32_t)param(p, "ring")) {
+            // Temperature, humidity and CO2 reports, then the history frame
+            if (light) {
+                wake_sim_uplink(sim);
+                sim_zigbee_send(sim, p, 4);
+            } else {
+                sim_zigbee_uplink(sim, p, 4);
+            }
+            report_policy_commit(&policy_config, &policy_state, values, now_s);
+            buffered = 0;
+        }
+
+        wake_sim_spend(sim, WAKE_SIM_CPU, WAKE_PHASE_AWAKE, 1);
+        if (light) {
+            sim_sed_idle(sim, p, (int64_t)sleep_s * 1000);
+        } else {
+            sim_sleep(sim, (int64_t)sleep_s * 1000000, &no_event_us, 0);
+        }
+    }
+}
+
+/********************* zigbee-remote *********************/
+
+/* light_driver_blink(): LED on for on_ms, off for off_ms in between, blocking */
+static void sim_blink(wake_sim_t *sim, const sim_param_t *p, wake_phase_t phase,
+                      uint32_t times, uint32_t on_ms, uint32_t off_ms)
+{
+    for (uint32_t i = 0; i < times; i++) {
+        wake_sim_load(sim, phase, param(p, "led_ua"), on_ms);
+        sim_idle(sim, p, phase, on_ms + (i + 1 < times ? off_ms : 0));
+    }
+}
+
+static void sim_run_remote(wake_sim_t *sim, const sim_param_t *p)
+{
+    int64_t end_us = (int64_t)param(p, "days") * SIM_DAY_S * 1000000;
+    int64_t timer_us = (int64_t)param(p, "wake_s") * 1000000;
+    int64_t press_us = 0;
+
+    if (param(p, "light")) {
+        // Joined once, then only button presses wake it from light sleep
+        wake_sim_wake(sim);
+        sim_blink(sim, p, WAKE_PHASE_AWAKE, 1, 3000, 100);
+        sim_zigbee_uplink(sim, p, 0);
+        sim_blink(sim, p, WAKE_PHASE_AWAKE, 2, 200, 200);
+        while (sim->now_us < end_us) {
+            while (press_us <= sim->now_us) {
+                press_us = sim_next_event(press_us, param(p, "presses"));
+            }
+            int64_t idle_us = (press_us < end_us ? press_us : end_us) - sim->now_us;
+            sim_sed_idle(sim, p, idle_us / 1000);
+            if (press_us < end_us) {
+                wake_sim_resume(sim);
+                sim_blink(sim, p, WAKE_PHASE_AWAKE, param(p, "wake_pin") + 1, 1000, 100);
+            }
+        }
+        return;
+    }
+
+    bool pressed = sim_sleep(sim, timer_us, &press_us, param(p, "presses"));
+    while (sim->now_us < end_us) {
+        wake_sim_wake(sim);
+        if (pressed) {
+            // One blink per GPIO number plus one (GPIO7 on the C6, GPIO9 on the H2)
+            sim_blink(sim, p, WAKE_PHASE_AWAKE, param(p, "wake_pin") + 1, 1000, 100);
+        } else {
+            sim_blink(sim, p, WAKE_PHASE_AWAKE, 2, 1000, 100);
+        }
+
+        sim_zigbee_uplink(sim, p, 0);
+        sim_blink(sim, p, WAKE_PHASE_AWAKE, 2, 200, 200);
+
+        // One-shot timer; the stack keeps running, polling the parent
+        sim_idle(sim, p, WAKE_PHASE_AWAKE, param(p, "presleep_ms"));
+        pressed = sim_sleep(sim, timer_us, &press_us, param(p, "presses"));
+    }
+}
+
+/********************* zigbee-motion-light *********************/
+
+static void sim_run_motion(wake_sim_t *sim, const sim_param_t *p)
+{
+    int64_t end_us = (int64_t)param(p, "days") * SIM_DAY_S * 1000000;
+    int64_t timer_us = (int64_t)param(p, "heartbeat_s") * 1000000;
+    int64_t motion_us = 0;
+    bool motion = sim_sleep(sim, timer_us, &motion_us, param(p, "motions"));
+
+    while (sim->now_us < end_us) {
+        int64_t wake_us = sim->now_us;
+        wake_sim_wake(sim);
+        sim_zigbee_uplink(sim, p, 1);
+
+        if (motion) {
+            // Occupied went out with the join; cleared follows once the PIR
+            // output drops. The strip sweeps meanwhile.
+            wake_sim_load(sim, WAKE_PHASE_AWAKE, param(p, "led_ua"), param(p, "strip_leds") * 2 * 50);
+            int64_t hold_ms = param(p, "pir_hold_ms") - (sim->now_us - wake_us) / 1000;
+            sim_idle(sim, p, WAKE_PHASE_AWAKE, hold_ms > 0 ? hold_ms : 0);
+            wake_sim_spend(sim, WAKE_SIM_RADIO_TX, WAKE_PHASE_REPORT, param(p, "frame_ms"));
+            wake_sim_spend(sim, WAKE_SIM_RADIO_RX, WAKE_PHASE_REPORT, param(p, "ack_ms"));
+        }
+
+        // light_animation_deinit() settle before sleep
+        sim_idle(sim, p, WAKE_PHASE_AWAKE, 20);
+        motion = sim_sleep(sim, timer_us, &motion_us, param(p, "motions"));
+    }
+
+    // The PIR module is powered all the time
+    wake_sim_load(sim, WAKE_PHASE_MAX, param(p, "pir_ua"), sim->now_us / 1000);
+}
+
+/********************* deep_sleep (OpenThread) *********************/
+
+static void sim_run_ot(wake_sim_t *sim, const sim_param_t *p)
+{
+    int64_t end_us = (int64_t)param(p, "days") * SIM_DAY_S * 1000000;
+    int64_t timer_us = (int64_t)param(p, "wake_s") * 1000000;
+    wake_sim_sleep(sim, timer_us);
+
+    while (sim->now_us < end_us) {
+        wake_sim_wake(sim);
+        // Reattach as a child: same shape as a Zigbee rejoin
+        sim_zigbee_uplink(sim, p, 1);
+        sim_idle(sim, p, WAKE_PHASE_AWAKE, param(p, "presleep_ms"));
+        wake_sim_sleep(sim, timer_us);
+    }
+}
+
+/*
+ * The remote's sleep_mode_select() and the one-shot devices: a timer wake,
+ * then the one-shot before deep sleep
+ */
+static uint32_t sim_timer_presleep_s(const sim_param_t *p)
+{
+    return param(p, "wake_s") + param(p, "presleep_ms") / 1000;
+}
+
+static uint32_t sim_heartbeat_s(const sim_param_t *p)
+{
+    return param(p, "heartbeat_s");
+}
+
+#define CO2_KCONFIG         "zigbee-co2/main/Kconfig.projbuild"
+#define REMOTE_SOURCE       "zigbee-remote/main/esp_zb_remote.c"
+#define OT_SOURCE           "deep_sleep/main/esp_ot_sleepy_device.c"
+
+static sim_device_t s_devices[] = {
+    {
+        .name = "co2", .app = "zigbee-co2", .sdkconfig = "zigbee-co2/sdkconfig", .run = sim_run_co2,
+        .params = {
+            SIM_COMMON_PARAMS("zigbee-co2/main/esp_zb_co2_sensor.c", "ED_KEEP_ALIVE_MS"),
+            { "pm", 1, "CONFIG_PM_ENABLE with tickless idle" },
+            { "variant", 41, "40 or 41 (single shot)" },
+            { "wake_min", 0, "shortest wake interval (s)", { CO2_KCONFIG, "CO2_SENSOR_WAKE_MIN_SEC" } },
+            { "wake_max", 0, "longest wake interval (s)", { CO2_KCONFIG, "CO2_SENSOR_WAKE_MAX_SEC" } },
+            { "stable_slope", 0, "stable CO2 slope (ppm/min)", { CO2_KCONFIG, "CO2_SENSOR_WAKE_STABLE_SLOPE" } },
+            { "fast_slope", 0, "fast CO2 rise (ppm/min)", { CO2_KCONFIG, "CO2_SENSOR_WAKE_FAST_SLOPE" } },
+            { "fast_level", 0, "CO2 level for fastest sampling", { CO2_KCONFIG, "CO2_SENSOR_WAKE_FAST_LEVEL_PPM" } },
+            { "refresh", 0, "longest CO2 reuse (s)", { CO2_KCONFIG, "CO2_SENSOR_CO2_REFRESH_SEC" } },
+            { "deadband_co2", 0, "CO2 deadband (ppm)", { CO2_KCONFIG, "CO2_SENSOR_DEADBAND_CO2_PPM" } },
+            { "deadband_t", 0, "temperature deadband (0.01 C)", { CO2_KCONFIG, "CO2_SENSOR_DEADBAND_TEMPERATURE" } },
+            { "deadband_rh", 0, "humidity deadband (0.01 %RH)", { CO2_KCONFIG, "CO2_SENSOR_DEADBAND_HUMIDITY" } },
+            { "silence", 0, "longest time without a report (s)", { CO2_KCONFIG, "CO2_SENSOR_MAX_SILENCE_SEC" } },
+            { "alert", 0, "alert CO2 level (ppm)", { CO2_KCONFIG, "CO2_SENSOR_ALERT_PPM" } },
+            { "alert_hyst", 0, "alert hysteresis (ppm)", { CO2_KCONFIG, "CO2_SENSOR_ALERT_HYSTERESIS_PPM" } },
+            { "ring", 0, "buffered samples",
+              { "zigbee-co2/components/sample_ring/Kconfig", "SAMPLE_RING_CAPACITY" } },
+            { "sensor_ms", 10, "I2C transfers per wake, CPU" },
+            { "occupants", 2, "people in the room at night" },
+        },
+    },
+    {
+        .name = "remote", .app = "zigbee-remote", .sdkconfig = "zigbee-remote/sdkconfig", .run = sim_run_remote,
+        .policy_wake_s = sim_timer_presleep_s,
+        .params = {
+            SIM_COMMON_PARAMS("zigbee-remote/main/esp_zb_remote.h", "ED_KEEP_ALIVE"),
+            { "pm", 1, "CONFIG_PM_ENABLE with tickless idle" },
+            { "wake_s", 0, "timer wake-up", { REMOTE_SOURCE, "REMOTE_WAKE_SEC" } },
+            { "presleep_ms", 0, "one-shot timer before deep sleep",
+              { REMOTE_SOURCE, "before_deep_sleep_time_sec", 1000 } },
+            { "led_ua", 5000, "LED while lit" },
+            { "presses", 0, "button wakes per hour" },
+            { "wake_pin", 0, "GPIO of the button (ESP32-C6)", { REMOTE_SOURCE, "REMOTE_WAKE_PIN" } },
+        },
+    },
+    {
+        .name = "motion", .app = "zigbee-motion-light", .sdkconfig = "zigbee-motion-light/sdkconfig",
+        .run = sim_run_motion, .policy_wake_s = sim_heartbeat_s,
+        .params = {
+            SIM_COMMON_PARAMS("zigbee-motion-light/main/esp_zb_motion_light.h", "ED_KEEP_ALIVE"),
+            { "pm", 0, "CONFIG_PM_ENABLE with tickless idle" },
+            { "heartbeat_s", 0, "timer wake-up",
+              { "zigbee-motion-light/main/main.c", "DEEP_SLEEP_TIMER_INTERVAL_SEC" } },
+            { "motions", 4, "PIR wakes per hour" },
+            { "pir_hold_ms", 2300, "PIR output high after motion" },
+            { "pir_ua", 15, "PIR module quiescent" },
+            { "strip_leds", 0, "pixels the wake animation sweeps",
+              { "zigbee-motion-light/components/light_driver/light_driver.h", "CONFIG_EXAMPLE_STRIP_LED_NUMBER" } },
+            { "led_ua", 20000, "strip while one pixel sweeps" },
+        },
+    },
+    {
+        .name = "ot", .app = "deep_sleep", .sdkconfig = "deep_sleep/sdkconfig", .h2 = true, .run = sim_run_ot,
+        .policy_wake_s = sim_timer_presleep_s,
+        .params = {
+            SIM_COMMON_PARAMS("deep_sleep/main/esp_ot_sleepy_device_config.h",
+                              "CONFIG_OPENTHREAD_NETWORK_POLLPERIOD_TIME"),
+            { "pm", 0, "CONFIG_PM_ENABLE with tickless idle" },
+            { "wake_s", 0, "timer wake-up", { OT_SOURCE, "wakeup_time_sec" } },
+            { "presleep_ms", 0, "one-shot timer before deep sleep", { OT_SOURCE, "before_deep_sleep_time_sec", 1000 } },
+        },
+    },
+};
+
+/********************* Device API *********************/
+
+#define SIM_DEVICE_COUNT    (sizeof(s_devices) / sizeof(s_devices[0]))
+
+wake_sim_device_t *wake_sim_device_find(const char *name)
+{
+    for (size_t d = 0; d < SIM_DEVICE_COUNT; d++) {
+        if (strcmp(name, s_devices[d].name) == 0) {
+            return &s_devices[d];
+        }
+    }
+    return NULL;
+}
+
+wake_sim_device_t *wake_sim_device_at(size_t index)
+{
+    return index < SIM_DEVICE_COUNT ? &s_devices[index] : NULL;
+}
+
+const char *wake_sim_device_name(const wake_sim_device_t *device)
+{
+    return device->name;
+}
+
+const char *wake_sim_device_app(const wake_sim_device_t *device)
+{
+    return device->app;
+}
+
+bool wake_sim_device_set(wake_sim_device_t *device, const char *name, int32_t value)
+{
+    sim_param_t *p = (sim_param_t *)param_find(device->params, name);
+    if (p == NULL) {
+        return false;
+    }
+    p->value = value;
+    p->set = true;
+    return true;
+}
+
+int32_t wake_sim_device_param(const wake_sim_device_t *device, const char *name)
+{
+    return param(device->params, name);
+}
+
+bool wake_sim_device_resolve(wake_sim_device_t *device, const char *repo, bool quiet)
+{
+    return params_resolve(device, repo, quiet);
+}
+
+void wake_sim_device_print(const wake_sim_device_t *device)
+{
+    for (const sim_param_t *p = device->params; p->name != NULL; p++) {
+        printf("  %-16s %6ld  %s", p->name, (long)p->value, p->help);
+        if (p->origin.file) {
+            printf(" [%s in %s]", p->origin.symbol, p->origin.file);
+        }
+        printf("\n");
+    }
+}
+
+bool wake_sim_device_h2(const wake_sim_device_t *device)
+{
+    return device->h2;
+}
+
+void wake_sim_device_run(wake_sim_device_t *device, wake_sim_t *sim, bool h2)
+{
+    const wake_sim_power_t c6 = WAKE_SIM_POWER_ESP32C6();
+    const wake_sim_power_t h2_power = WAKE_SIM_POWER_ESP32H2();
+
+    s_rng = 0x2545F491;
+    wake_sim_init(sim, h2 ? &h2_power : &c6);
+    device->run(sim, device->params);
+}
+
+wake_sim_verdict_t wake_sim_device_verdict(const wake_sim_device_t *device, const wake_sim_t *sim)
+{
+    const sim_param_t *p = device->params;
+    sleep_policy_model_t model = {
+        .deep_sleep_ua = sim->power.current_ua[WAKE_SIM_DEEP_SLEEP],
+        .light_sleep_ua = sim->power.current_ua[WAKE_SIM_LIGHT_SLEEP],
+        .active_ua = sim->power.current_ua[WAKE_SIM_CPU],
+        .rx_ua = sim->power.current_ua[WAKE_SIM_RADIO_RX],
+        .boot_ms = sim->power.boot_ms,
+        .stack_init_ms = param(p, "stack_ms"),
+        .rejoin_ms = param(p, "rejoin_ms"),
+        .poll_interval_ms = param(p, "poll_interval_ms"),
+        .poll_ms = param(p, "poll_ms"),
+    };
+    wake_sim_verdict_t verdict;
+
+    if (device->policy_wake_s != NULL) {
+        // Every timer wake rejoins
+        verdict.wake_s = device->policy_wake_s(p);
+        verdict.uplink_s = verdict.wake_s;
+    } else {
+        verdict.wake_s = sim->wakes ? sim->now_us / 1000000 / sim->wakes : 0;
+        verdict.uplink_s = sim->uplinks ? sim->now_us / 1000000 / sim->uplinks : UINT32_MAX;
+    }
+    verdict.deep_na = sleep_policy_average_na(&model, SLEEP_MODE_DEEP, verdict.wake_s, verdict.uplink_s);
+    verdict.light_na = sleep_policy_average_na(&model, SLEEP_MODE_LIGHT, verdict.wake_s, verdict.uplink_s);
+    verdict.mode = sleep_policy_select(&model, SLEEP_MODE_DEEP, verdict.wake_s, verdict.uplink_s);
+    return verdict;
+}
@@ -0,0 +1,100 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host wake-cycle simulator: the battery devices of this repository
+ *
+ * Host only, not part of any IDF build; see wake_sim_devices.c for the
+ * models and wake_sim_main.c for the command line.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "wake_sim.h"
+#include "sleep_policy.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sim_device wake_sim_device_t;
+
+/**
+ * @brief What the firmware's sleep policy makes of a simulated device
+ */
+typedef struct {
+    uint32_t wake_s;            /**< Wake interval the firmware passes to the policy */
+    uint32_t uplink_s;          /**< Uplink interval the firmware passes to the policy */
+    uint32_t deep_na;           /**< Average current in deep sleep */
+    uint32_t light_na;          /**< Average current as a light-sleeping SED */
+    sleep_mode_t mode;          /**< Mode the policy picks coming from deep sleep */
+} wake_sim_verdict_t;
+
+/**
+ * @brief Device model by name (co2, remote, motion, ot), NULL if there is none
+ */
+wake_sim_device_t *wake_sim_device_find(const char *name);
+
+/**
+ * @brief Device model by index, NULL past the last one
+ */
+wake_sim_device_t *wake_sim_device_at(size_t index);
+
+/**
+ * @brief Name and application directory of a model
+ */
+const char *wake_sim_device_name(const wake_sim_device_t *device);
+const char *wake_sim_device_app(const wake_sim_device_t *device);
+
+/**
+ * @brief Set a parameter; it is no longer read from the firmware sources
+ *
+ * @return false if the model has no such parameter
+ */
+bool wake_sim_device_set(wake_sim_device_t *device, const char *name, int32_t value);
+
+/**
+ * @brief Value of a parameter; exits if the model has no such parameter
+ */
+int32_t wake_sim_device_param(const wake_sim_device_t *device, const char *name);
+
+/**
+ * @brief Read the parameters not set from the firmware sources
+ *
+ * @param repo Repository root
+ * @param quiet Do not print the figures that cannot be found
+ * @return false if one of them cannot be found
+ */
+bool wake_sim_device_resolve(wake_sim_device_t *device, const char *repo, bool quiet);
+
+/**
+ * @brief Print the parameters, their values and where they come from
+ */
+void wake_sim_device_print(const wake_sim_device_t *device);
+
+/**
+ * @brief Default chip of a model is an ESP32-H2
+ */
+bool wake_sim_device_h2(const wake_sim_device_t *device);
+
+/**
+ * @brief Run a resolved model from time 0
+ *
+ * @param h2 Simulate an ESP32-H2 rather than an ESP32-C6
+ */
+void wake_sim_device_run(wake_sim_device_t *device, wake_sim_t *sim, bool h2);
+
+/**
+ * @brief The sleep policy's view of a run
+ *
+ * Timer-driven models pass their configured timer interval, as their
+ * firmware does; the co2 model, whose interval adapts, passes the simulated
+ * averages.
+ */
+wake_sim_verdict_t wake_sim_device_verdict(const wake_sim_device_t *device, const wake_sim_t *sim);
+
+#ifdef __cplusplus
+}
+#endif
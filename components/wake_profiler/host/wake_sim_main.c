@@ -0,0 +1,95 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host wake-cycle simulator: command line
+ *
+ * Runs one device model of wake_sim_devices.c and prints its consumption and
+ * the sleep policy's verdict. The figures taken from the firmware are read
+ * under repo= (the repository root, ../.. by default); usage lists where
+ * each one comes from. Every figure is a name=value argument, so a tuning
+ * change can be compared before and after:
+ *
+ *   ./wake_sim co2 days=7 wake_max=900
+ *   ./wake_sim remote presleep_ms=500 pm=1
+ *   ./wake_sim remote chip=h2
+ *
+ * Not part of any IDF build. Compile and run it from the component directory,
+ * with a host stand-in for esp_err.h (e.g. that of an IDF linux target build):
+ *
+ *   C=../../zigbee-co2/components
+ *   cc -O2 -Iinclude -I$C/wake_interval/include -I$C/report_policy/include \
+ *      -I$C/scd40/include -I$C/sensirion_i2c/include -I../sleep_policy/include -I<stubs> \
+ *      -DCONFIG_SENSIRION_I2C_MAX_WORDS=16 host/wake_sim.c host/wake_sim_devices.c \
+ *      host/wake_sim_main.c $C/wake_interval/wake_interval.c \
+ *      $C/report_policy/report_policy.c $C/scd40/scd40_strategy.c $C/scd40/scd40_common.c \
+ *      $C/sensirion_i2c/sensirion_i2c.c ../sleep_policy/sleep_policy.c -lm -o wake_sim
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wake_sim_devices.h"
+
+static void usage(const char *repo)
+{
+    wake_sim_device_t *device;
+
+    printf("usage: wake_sim <device> [chip=c6|h2] [repo=path] [name=value ...]\n");
+    for (size_t d = 0; (device = wake_sim_device_at(d)) != NULL; d++) {
+        bool found = wake_sim_device_resolve(device, repo, true);
+        printf("\n%s (%s)%s:\n", wake_sim_device_name(device), wake_sim_device_app(device),
+               found ? "" : ", sources not all found");
+        wake_sim_device_print(device);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    wake_sim_device_t *device = argc > 1 ? wake_sim_device_find(argv[1]) : NULL;
+    const char *repo = "../..";
+    for (int i = 2; i < argc; i++) {
+        if (strncmp(argv[i], "repo=", 5) == 0) {
+            repo = argv[i] + 5;
+        }
+    }
+    if (device == NULL) {
+        usage(repo);
+        return 2;
+    }
+
+    bool h2 = wake_sim_device_h2(device);
+    for (int i = 2; i < argc; i++) {
+        char *eq = strchr(argv[i], '=');
+        if (eq == NULL) {
+            usage(repo);
+            return 2;
+        }
+        *eq = '\0';
+        if (strcmp(argv[i], "chip") == 0) {
+            h2 = strcmp(eq + 1, "h2") == 0;
+            continue;
+        }
+        if (strcmp(argv[i], "repo") == 0) {
+            continue;
+        }
+        if (!wake_sim_device_set(device, argv[i], strtol(eq + 1, NULL, 0))) {
+            fprintf(stderr, "%s has no parameter %s\n", wake_sim_device_name(device), argv[i]);
+            return 2;
+        }
+    }
+    if (!wake_sim_device_resolve(device, repo, false)) {
+        return 2;
+    }
+
+    wake_sim_t sim;
+    wake_sim_device_run(device, &sim, h2);
+    printf("%s (%s)\n", wake_sim_device_name(device), wake_sim_device_app(device));
+    wake_sim_report(&sim, wake_sim_device_param(device, "battery_mah"));
+
+    // What the firmware's policy would pick for the intervals just simulated
+    wake_sim_verdict_t verdict = wake_sim_device_verdict(device, &sim);
+    printf("  sleep_policy at a wake per %lu s, uplink per %lu s: deep %.1f uA, light %.1f uA, picks %s\n",
+           (unsigned long)verdict.wake_s, (unsigned long)verdict.uplink_s, verdict.deep_na / 1000.0,
+           verdict.light_na / 1000.0, sleep_policy_mode_name(verdict.mode));
+    return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host tests for the wake-cycle simulator's device models
+ *
+ * The models re-script the applications' wake sequences and read their
+ * timers and thresholds from the firmware sources, so they drift silently
+ * when the firmware changes. This runs every model against the tree and
+ * checks:
+ * - each figure read from the sources, so a changed Kconfig default,
+ *   sdkconfig entry or constant shows up here and the model can be reviewed;
+ * - the sleep policy's verdicts that Kconfig help and the READMEs state, and
+ *   that the simulated deep and light sleep runs agree with them;
+ * - that light sleep between wakes counts as asleep, not as one long wake.
+ *
+ * Compile and run from the component directory, like wake_sim_main.c:
+ *
+ *   C=../../zigbee-co2/components
+ *   cc -O2 -Iinclude -I$C/wake_interval/include -I$C/report_policy/include \
+ *      -I$C/scd40/include -I$C/sensirion_i2c/include -I../sleep_policy/include \
+ *      -I../host_test -I<stubs> -DCONFIG_SENSIRION_I2C_MAX_WORDS=16 host/wake_sim.c \
+ *      host/wake_sim_devices.c host/wake_sim_test.c $C/wake_interval/wake_interval.c \
+ *      $C/report_policy/report_policy.c $C/scd40/scd40_strategy.c $C/scd40/scd40_common.c \
+ *      $C/sensirion_i2c/sensirion_i2c.c ../sleep_policy/sleep_policy.c -lm -o wake_sim_test \
+ *      && ./wake_sim_test
+ */
+
+#include <stdio.h>
+#include "wake_sim_devices.h"
+#include "host_test.h"
+
+#define REPO    "../.."
+
+typedef struct {
+    const char *name;
+    int32_t value;
+} expected_t;
+
+/* Figures the models read from the tree, by device */
+static const expected_t s_co2[] = {
+    { "poll_interval_ms", 3000 }, { "wake_min", 30 }, { "wake_max", 600 }, { "stable_slope", 2 },
+    { "fast_slope", 20 }, { "fast_level", 1000 }, { "refresh", 900 }, { "deadband_co2", 50 },
+    { "deadband_t", 50 }, { "deadband_rh", 100 }, { "silence", 600 }, { "alert", 1200 },
+    { "alert_hyst", 100 }, { "ring", 32 }, { NULL },
+};
+
+static const expected_t s_remote[] = {
+    { "poll_interval_ms", 4000 }, { "wake_s", 20 }, { "presleep_ms", 5000 }, { "wake_pin", 7 }, { NULL },
+};
+
+static const expected_t s_motion[] = {
+    { "poll_interval_ms", 3000 }, { "heartbeat_s", 180 }, { "strip_leds", 3 }, { NULL },
+};
+
+static const expected_t s_ot[] = {
+    { "poll_interval_ms", 30000 }, { "wake_s", 20 }, { "presleep_ms", 5000 }, { NULL },
+};
+
+static wake_sim_device_t *device_get(const char *name)
+{
+    wake_sim_device_t *device = wake_sim_device_find(name);
+    CHECK_EQ(device != NULL, true);
+    return device;
+}
+
+/* Run a resolved model, average current in nA */
+static uint32_t run(wake_sim_device_t *device, wake_sim_t *sim)
+{
+    wake_sim_device_run(device, sim, wake_sim_device_h2(device));
+    double uc = sim->load_uc;
+    for (int i = 0; i < WAKE_SIM_STATE_MAX; i++) {
+        uc += sim->state_uc[i];
+    }
+    return (uint32_t)(uc * 1e9 / sim->now_us);
+}
+
+static void test_sources(void)
+{
+    static const struct {
+        const char *device;
+        const expected_t *expected;
+    } devices[] = {
+        { "co2", s_co2 }, { "remote", s_remote }, { "motion", s_motion }, { "ot", s_ot },
+    };
+
+    for (size_t d = 0; d < sizeof(devices) / sizeof(devices[0]); d++) {
+        wake_sim_device_t *device = device_get(devices[d].device);
+        if (device == NULL) {
+            continue;
+        }
+        if (!wake_sim_device_resolve(device, REPO, false)) {
+            CHECK_FAIL("%s: figures missing from the tree", devices[d].device);
+            continue;
+        }
+        for (const expected_t *e = devices[d].expected; e->name != NULL; e++) {
+            int32_t value = wake_sim_device_param(device, e->name);
+            if (value != e->value) {
+                CHECK_FAIL("%s %s = %ld in the tree, the model was checked at %ld",
+                           devices[d].device, e->name, (long)value, (long)e->value);
+            }
+        }
+    }
+
+    // Every model's figures must be found
+    wake_sim_device_t *device;
+    for (size_t d = 0; (device = wake_sim_device_at(d)) != NULL; d++) {
+        CHECK_EQ(wake_sim_device_resolve(device, REPO, false), true);
+    }
+}
+
+static void test_light_sleep_is_asleep(void)
+{
+    wake_sim_device_t *remote = device_get("remote");
+    wake_sim_device_t *co2 = device_get("co2");
+    wake_sim_t sim;
+
+    // Joined once, no presses: one wake of boot, join and blinks
+    wake_sim_device_set(remote, "light", 1);
+    run(remote, &sim);
+    wake_sim_device_set(remote, "light", 0);
+    CHECK_EQ(sim.wakes, 1);
+    CHECK_EQ(sim.now_us - sim.asleep_us < 10000000, true);
+
+    // A light-sleep wake is shorter than a deep-sleep one: no boot, no rejoin
+    run(co2, &sim);
+    uint64_t deep_awake_us = (sim.now_us - sim.asleep_us) / sim.wakes;
+    wake_sim_device_set(co2, "light", 1);
+    run(co2, &sim);
+    wake_sim_device_set(co2, "light", 0);
+    uint64_t light_awake_us = (sim.now_us - sim.asleep_us) / sim.wakes;
+    CHECK_EQ(light_awake_us < deep_awake_us, true);
+    CHECK_EQ(light_awake_us < 2000000, true);
+}
+
+/* The policy's pick for a model, and the cheaper of its simulated deep and light runs */
+static void check_verdict(wake_sim_device_t *device, sleep_mode_t expected)
+{
+    wake_sim_t sim;
+    uint32_t deep_na = run(device, &sim);
+    wake_sim_verdict_t verdict = wake_sim_device_verdict(device, &sim);
+    CHECK_EQ(verdict.mode, expected);
+
+    wake_sim_device_set(device, "light", 1);
+    uint32_t light_na = run(device, &sim);
+    wake_sim_device_set(device, "light", 0);
+    CHECK_EQ(light_na < deep_na ? SLEEP_MODE_LIGHT : SLEEP_MODE_DEEP, expected);
+}
+
+static void test_verdicts(void)
+{
+    wake_sim_device_t *remote = device_get("remote");
+    wake_sim_device_t *co2 = device_get("co2");
+    wake_sim_t sim;
+
+    // REMOTE_SLEEP_AUTO: "With the 20 s timer this picks light sleep", at the
+    // timer plus the one-shot, as sleep_mode_select() passes it
+    check_verdict(remote, SLEEP_MODE_LIGHT);
+    run(remote, &sim);
+    wake_sim_verdict_t verdict = wake_sim_device_verdict(remote, &sim);
+    CHECK_EQ(verdict.wake_s, 25);
+    CHECK_EQ(verdict.uplink_s, 25);
+
+    // zigbee-co2 README: deep sleep stays ahead with the default intervals,
+    // light sleep pays off with short intervals and frequent reports
+    check_verdict(co2, SLEEP_MODE_DEEP);
+    wake_sim_device_set(co2, "wake_min", 10);
+    wake_sim_device_set(co2, "wake_max", 60);
+    wake_sim_device_set(co2, "silence", 60);
+    check_verdict(co2, SLEEP_MODE_LIGHT);
+
+    // The one-shot devices would be cheaper joined, had they the choice
+    run(device_get("motion"), &sim);
+    verdict = wake_sim_device_verdict(device_get("motion"), &sim);
+    CHECK_EQ(verdict.wake_s, 180);
+    CHECK_EQ(verdict.mode, SLEEP_MODE_LIGHT);
+    run(device_get("ot"), &sim);
+    verdict = wake_sim_device_verdict(device_get("ot"), &sim);
+    CHECK_EQ(verdict.wake_s, 25);
+    CHECK_EQ(verdict.mode, SLEEP_MODE_LIGHT);
+}
+
+int main(void)
+{
+    test_sources();
+    test_light_sleep_is_asleep();
+    test_verdicts();
+
+    return host_test_summary("wake_sim");
+}
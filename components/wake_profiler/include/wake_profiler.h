@@ -0,0 +1,135 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Wake-cycle profiler for sleepy devices
+ *
+ * Times the phases of a deep-sleep wake with esp_timer_get_time() and folds
+ * them into min/avg/max statistics kept in RTC memory, so energy
+ * regressions show up over many wakes instead of in one log line. Phases may
+ * overlap (e.g. measurement and rejoin run in parallel); each is timed on
+ * its own.
+ *
+ * Boot is measured from esp_timer start to wake_profiler_boot(), so the ROM
+ * and second-stage bootloader time is not included.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Phases of a wake
+ */
+typedef enum {
+    WAKE_PHASE_BOOT,            /**< Startup until wake_profiler_boot() */
+    WAKE_PHASE_SENSOR_INIT,     /**< Sensor bus and sensor bring-up */
+    WAKE_PHASE_MEASURE,         /**< Taking the measurement */
+    WAKE_PHASE_STACK_INIT,      /**< Zigbee stack and device setup until esp_zb_start() */
+    WAKE_PHASE_REJOIN,          /**< esp_zb_start() until on the network */
+    WAKE_PHASE_REPORT,          /**< Reports sent until confirmed */
+    WAKE_PHASE_AWAKE,           /**< Whole wake, until deep sleep entry */
+    WAKE_PHASE_MAX,
+} wake_phase_t;
+
+/**
+ * @brief Statistics of one phase, in milliseconds
+ */
+typedef struct {
+    uint32_t count;             /**< Wakes that ran the phase */
+    uint32_t min_ms;            /**< Shortest duration */
+    uint32_t max_ms;            /**< Longest duration */
+    uint32_t sum_ms;            /**< Sum of durations, for the average */
+} wake_profiler_stats_t;
+
+/**
+ * @brief Size of the encoding produced by wake_profiler_encode()
+ *
+ * Layout (little endian): uint32 wake count, then per phase in
+ * wake_phase_t order uint16 min, avg and max in ms (saturated at 65535).
+ */
+#define WAKE_PROFILER_ENCODED_LEN   (4 + WAKE_PHASE_MAX * 6)
+
+/**
+ * @brief Start profiling a wake
+ *
+ * Call first thing in app_main. Records the boot phase and logs how long
+ * the device slept.
+ */
+void wake_profiler_boot(void);
+
+/**
+ * @brief Start profiling a wake from light sleep
+ *
+ * For a device that stays up between wakes (a joined sleepy end device):
+ * starts a new wake at the current time, without a boot phase. Pair with
+ * wake_profiler_sleep() before the device goes idle again.
+ */
+void wake_profiler_resume(void);
+
+/**
+ * @brief Mark the start of a phase
+ */
+void wake_profiler_begin(wake_phase_t phase);
+
+/**
+ * @brief Mark the end of a phase
+ *
+ * Ignored if the phase was not begun during this wake.
+ */
+void wake_profiler_end(wake_phase_t phase);
+
+/**
+ * @brief When a phase started during this wake
+ *
+ * @return Microseconds since boot, -1 if the phase has not started
+ */
+int64_t wake_profiler_start_us(wake_phase_t phase);
+
+/**
+ * @brief How long a phase took during this wake
+ *
+ * @return Microseconds, -1 if the phase has not completed
+ */
+int64_t wake_profiler_duration_us(wake_phase_t phase);
+
+/**
+ * @brief Finish the wake
+ *
+ * Call right before esp_deep_sleep_start(), or before going idle after
+ * wake_profiler_resume(). Ends the awake phase, folds all
+ * completed phases into the retained statistics and logs them.
+ */
+void wake_profiler_sleep(void);
+
+/**
+ * @brief Retained statistics of a phase
+ */
+const wake_profiler_stats_t *wake_profiler_stats(wake_phase_t phase);
+
+/**
+ * @brief Number of completed wakes since power-on or the last reset
+ */
+uint32_t wake_profiler_wakes(void);
+
+/**
+ * @brief Clear the retained statistics
+ */
+void wake_profiler_reset(void);
+
+/**
+ * @brief Serialize the statistics
+ *
+ * @param buf Output buffer
+ * @param len Size of buf
+ * @return Bytes written, 0 if buf is smaller than WAKE_PROFILER_ENCODED_LEN
+ */
+size_t wake_profiler_encode(uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,41 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Wake profiler statistics as a manufacturer-specific Zigbee cluster
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_zigbee_core.h"
+#include "wake_profiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WAKE_PROFILER_CLUSTER_ID        0xFC01  /**< Manufacturer-specific wake profile cluster */
+#define WAKE_PROFILER_ATTR_WAKES        0x0000  /**< uint32, completed wakes */
+#define WAKE_PROFILER_ATTR_PROFILE      0x0001  /**< Octet string, wake_profiler_encode() layout */
+
+/**
+ * @brief Create the wake profile cluster
+ *
+ * Add the result to the endpoint's cluster list as a server cluster.
+ *
+ * @return Attribute list of the cluster
+ */
+esp_zb_attribute_list_t *wake_profiler_zcl_cluster_create(void);
+
+/**
+ * @brief Write the current statistics into the cluster's attributes
+ *
+ * Takes the Zigbee lock; do not call with the lock held.
+ *
+ * @param endpoint Endpoint the cluster was registered on
+ */
+void wake_profiler_zcl_update(uint8_t endpoint);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,169 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Wake-cycle profiler for sleepy devices
+ */
+
+#include "wake_profiler.h"
+#include <string.h>
+#include <sys/time.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "wake_profiler";
+
+static const char *const s_phase_names[WAKE_PHASE_MAX] = {
+    [WAKE_PHASE_BOOT] = "boot",
+    [WAKE_PHASE_SENSOR_INIT] = "sensor_init",
+    [WAKE_PHASE_MEASURE] = "measure",
+    [WAKE_PHASE_STACK_INIT] = "stack_init",
+    [WAKE_PHASE_REJOIN] = "rejoin",
+    [WAKE_PHASE_REPORT] = "report",
+    [WAKE_PHASE_AWAKE] = "awake",
+};
+
+/* Statistics retained across deep sleep */
+typedef struct {
+    uint32_t wakes;
+    wake_profiler_stats_t phases[WAKE_PHASE_MAX];
+} wake_profiler_rtc_t;
+
+static RTC_DATA_ATTR wake_profiler_rtc_t s_rtc;
+static RTC_DATA_ATTR struct timeval s_sleep_enter_time;
+
+/* Phases of the current wake */
+static int64_t s_start_us[WAKE_PHASE_MAX];
+static int64_t s_duration_us[WAKE_PHASE_MAX];
+
+void wake_profiler_boot(void)
+{
+    for (int i = 0; i < WAKE_PHASE_MAX; i++) {
+        s_start_us[i] = -1;
+        s_duration_us[i] = -1;
+    }
+    s_start_us[WAKE_PHASE_BOOT] = 0;
+    s_start_us[WAKE_PHASE_AWAKE] = 0;
+    s_duration_us[WAKE_PHASE_BOOT] = esp_timer_get_time();
+
+    if (s_sleep_enter_time.tv_sec != 0) {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        int sleep_time_ms = (now.tv_sec - s_sleep_enter_time.tv_sec) * 1000 +
+                            (now.tv_usec - s_sleep_enter_time.tv_usec) / 1000;
+        ESP_LOGI(TAG, "Time spent in deep sleep and boot: %dms", sleep_time_ms);
+    }
+}
+
+void wake_profiler_resume(void)
+{
+    for (int i = 0; i < WAKE_PHASE_MAX; i++) {
+        s_start_us[i] = -1;
+        s_duration_us[i] = -1;
+    }
+    s_start_us[WAKE_PHASE_AWAKE] = esp_timer_get_time();
+}
+
+void wake_profiler_begin(wake_phase_t phase)
+{
+    if (phase < WAKE_PHASE_MAX) {
+        s_start_us[phase] = esp_timer_get_time();
+        s_duration_us[phase] = -1;
+    }
+}
+
+void wake_profiler_end(wake_phase_t phase)
+{
+    if (phase < WAKE_PHASE_MAX && s_start_us[phase] >= 0) {
+        s_duration_us[phase] = esp_timer_get_time() - s_start_us[phase];
+    }
+}
+
+int64_t wake_profiler_start_us(wake_phase_t phase)
+{
+    return phase < WAKE_PHASE_MAX ? s_start_us[phase] : -1;
+}
+
+int64_t wake_profiler_duration_us(wake_phase_t phase)
+{
+    return phase < WAKE_PHASE_MAX ? s_duration_us[phase] : -1;
+}
+
+static void wake_profiler_accumulate(wake_profiler_stats_t *stats, uint32_t ms)
+{
+    if (stats->count == 0 || ms < stats->min_ms) {
+        stats->min_ms = ms;
+    }
+    if (ms > stats->max_ms) {
+        stats->max_ms = ms;
+    }
+    stats->count++;
+    stats->sum_ms += ms;
+}
+
+void wake_profiler_sleep(void)
+{
+    wake_profiler_end(WAKE_PHASE_AWAKE);
+
+    s_rtc.wakes++;
+    for (int i = 0; i < WAKE_PHASE_MAX; i++) {
+        if (s_duration_us[i] < 0) {
+            continue;
+        }
+        wake_profiler_stats_t *stats = &s_rtc.phases[i];
+        wake_profiler_accumulate(stats, s_duration_us[i] / 1000);
+        ESP_LOGI(TAG, "%-11s %6lld ms (min %lu, avg %lu, max %lu over %lu wakes)",
+                 s_phase_names[i], s_duration_us[i] / 1000, (unsigned long)stats->min_ms,
+                 (unsigned long)(stats->sum_ms / stats->count), (unsigned long)stats->max_ms,
+                 (unsigned long)stats->count);
+    }
+
+    gettimeofday(&s_sleep_enter_time, NULL);
+}
+
+const wake_profiler_stats_t *wake_profiler_stats(wake_phase_t phase)
+{
+    return phase < WAKE_PHASE_MAX ? &s_rtc.phases[phase] : NULL;
+}
+
+uint32_t wake_profiler_wakes(void)
+{
+    return s_rtc.wakes;
+}
+
+void wake_profiler_reset(void)
+{
+    memset(&s_rtc, 0, sizeof(s_rtc));
+}
+
+static void put_u16(uint8_t *buf, uint32_t value)
+{
+    if (value > UINT16_MAX) {
+        value = UINT16_MAX;
+    }
+    buf[0] = value & 0xFF;
+    buf[1] = value >> 8;
+}
+
+size_t wake_profiler_encode(uint8_t *buf, size_t len)
+{
+    if (len < WAKE_PROFILER_ENCODED_LEN) {
+        return 0;
+    }
+
+    buf[0] = s_rtc.wakes & 0xFF;
+    buf[1] = (s_rtc.wakes >> 8) & 0xFF;
+    buf[2] = (s_rtc.wakes >> 16) & 0xFF;
+    buf[3] = s_rtc.wakes >> 24;
+
+    uint8_t *pos = &buf[4];
+    for (int i = 0; i < WAKE_PHASE_MAX; i++) {
+        const wake_profiler_stats_t *stats = &s_rtc.phases[i];
+        put_u16(&pos[0], stats->min_ms);
+        put_u16(&pos[2], stats->count ? stats->sum_ms / stats->count : 0);
+        put_u16(&pos[4], stats->max_ms);
+        pos += 6;
+    }
+
+    return WAKE_PROFILER_ENCODED_LEN;
+}
@@ -0,0 +1,38 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Wake profiler statistics as a manufacturer-specific Zigbee cluster
+ */
+
+#include "wake_profiler_zcl.h"
+
+/* Attribute storage: wake count and ZCL octet string (length byte + data) */
+static uint32_t s_wakes;
+static uint8_t s_profile[1 + WAKE_PROFILER_ENCODED_LEN];
+
+esp_zb_attribute_list_t *wake_profiler_zcl_cluster_create(void)
+{
+    s_wakes = wake_profiler_wakes();
+    s_profile[0] = wake_profiler_encode(&s_profile[1], WAKE_PROFILER_ENCODED_LEN);
+
+    esp_zb_attribute_list_t *cluster = esp_zb_zcl_attr_list_create(WAKE_PROFILER_CLUSTER_ID);
+    esp_zb_custom_cluster_add_custom_attr(cluster, WAKE_PROFILER_ATTR_WAKES, ESP_ZB_ZCL_ATTR_TYPE_U32,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_wakes);
+    esp_zb_custom_cluster_add_custom_attr(cluster, WAKE_PROFILER_ATTR_PROFILE, ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING,
+                                          s_profile);
+    return cluster;
+}
+
+void wake_profiler_zcl_update(uint8_t endpoint)
+{
+    s_wakes = wake_profiler_wakes();
+    s_profile[0] = wake_profiler_encode(&s_profile[1], WAKE_PROFILER_ENCODED_LEN);
+
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_zb_zcl_set_attribute_val(endpoint, WAKE_PROFILER_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 WAKE_PROFILER_ATTR_WAKES, &s_wakes, false);
+    esp_zb_zcl_set_attribute_val(endpoint, WAKE_PROFILER_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 WAKE_PROFILER_ATTR_PROFILE, s_profile, false);
+    esp_zb_lock_release();
+}
@@ -0,0 +1,142 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Device settings persisted in one NVS blob
+ */
+
+#include "device_config.h"
+#include <stddef.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+
+static const char *TAG = "device_config";
+
+#define DEVICE_CONFIG_NAMESPACE         "device_cfg"
+#define DEVICE_CONFIG_KEY               "config"
+
+_Static_assert(sizeof(device_config_t) == 16, "device_config_t must not contain padding");
+_Static_assert(sizeof(device_config_blob_t) == 24, "device_config_blob_t must not contain padding");
+
+static uint32_t device_config_crc(const device_config_blob_t *blob)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)blob, offsetof(device_config_blob_t, crc));
+}
+
+static void device_config_seal(device_config_blob_t *blob)
+{
+    blob->version = DEVICE_CONFIG_VERSION;
+    blob->size = sizeof(device_config_t);
+    blob->crc = device_config_crc(blob);
+}
+
+bool device_config_blob_valid(const device_config_blob_t *blob)
+{
+    return blob->version == DEVICE_CONFIG_VERSION &&
+           blob->size == sizeof(device_config_t) &&
+           blob->crc == device_config_crc(blob);
+}
+
+static esp_err_t device_config_read(device_config_blob_t *blob)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(DEVICE_CONFIG_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) {
+        // The namespace only exists once something was saved
+        return ret == ESP_ERR_NVS_NOT_FOUND ? ESP_ERR_NOT_FOUND : ret;
+    }
+
+    size_t len = sizeof(*blob);
+    ret = nvs_get_blob(handle, DEVICE_CONFIG_KEY, blob, &len);
+    nvs_close(handle);
+
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (ret == ESP_ERR_NVS_INVALID_LENGTH || (ret == ESP_OK && len != sizeof(*blob))) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (blob->version != DEVICE_CONFIG_VERSION || blob->size != sizeof(device_config_t)) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    return blob->crc == device_config_crc(blob) ? ESP_OK : ESP_ERR_INVALID_CRC;
+}
+
+esp_err_t device_config_load(device_config_blob_t *blob, const device_config_t *defaults)
+{
+    if (device_config_blob_valid(blob)) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = device_config_read(blob);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Loaded settings from NVS");
+        return ESP_OK;
+    }
+
+    if (ret != ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "Stored settings unusable (%s), using defaults", esp_err_to_name(ret));
+    }
+    memset(blob, 0, sizeof(*blob));
+    blob->config = *defaults;
+    device_config_sanitize(&blob->config);
+    device_config_seal(blob);
+    return ret;
+}
+
+esp_err_t device_config_save(device_config_blob_t *blob)
+{
+    device_config_seal(blob);
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(DEVICE_CONFIG_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = nvs_set_blob(handle, DEVICE_CONFIG_KEY, blob, sizeof(*blob));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save settings: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static bool device_config_clamp(uint16_t *value, uint16_t min, uint16_t max)
+{
+    uint16_t clamped = *value < min ? min : (*value > max ? max : *value);
+    bool changed = clamped != *value;
+    *value = clamped;
+    return changed;
+}
+
+bool device_config_sanitize(device_config_t *config)
+{
+    bool changed = false;
+
+    changed |= device_config_clamp(&config->wake_min_s, DEVICE_CONFIG_WAKE_MIN_S, DEVICE_CONFIG_WAKE_MAX_S);
+    changed |= device_config_clamp(&config->wake_max_s, config->wake_min_s, DEVICE_CONFIG_WAKE_MAX_S);
+    changed |= device_config_clamp(&config->temperature_offset, 0, DEVICE_CONFIG_TEMPERATURE_OFFSET_MAX);
+    changed |= device_config_clamp(&config->altitude_m, 0, DEVICE_CONFIG_ALTITUDE_MAX_M);
+    changed |= device_config_clamp(&config->deadband_co2_ppm, 0, DEVICE_CONFIG_DEADBAND_CO2_MAX);
+    changed |= device_config_clamp(&config->deadband_temperature, 0, DEVICE_CONFIG_DEADBAND_TEMPERATURE_MAX);
+    changed |= device_config_clamp(&config->deadband_humidity, 0, DEVICE_CONFIG_DEADBAND_HUMIDITY_MAX);
+    if (config->asc_enabled > 1) {
+        config->asc_enabled = 1;
+        changed = true;
+    }
+    if (config->sleep_mode > DEVICE_CONFIG_SLEEP_AUTO) {
+        config->sleep_mode = DEVICE_CONFIG_SLEEP_DEFAULT;
+        changed = true;
+    }
+    return changed;
+}
@@ -0,0 +1,109 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Device settings as a manufacturer-specific Zigbee cluster
+ */
+
+#include "device_config_zcl.h"
+#include <string.h>
+#include "esp_log.h"
+
+static const char *TAG = "device_config";
+
+/* Attribute storage, separate from the settings so a write is seen as a change */
+static device_config_t s_attr;
+
+/* Attribute ID to its uint16 field, NULL for the others */
+static uint16_t *device_config_zcl_field(device_config_t *config, uint16_t attr_id)
+{
+    switch (attr_id) {
+    case DEVICE_CONFIG_ATTR_WAKE_MIN:
+        return &config->wake_min_s;
+    case DEVICE_CONFIG_ATTR_WAKE_MAX:
+        return &config->wake_max_s;
+    case DEVICE_CONFIG_ATTR_TEMPERATURE_OFFSET:
+        return &config->temperature_offset;
+    case DEVICE_CONFIG_ATTR_ALTITUDE:
+        return &config->altitude_m;
+    case DEVICE_CONFIG_ATTR_DEADBAND_CO2:
+        return &config->deadband_co2_ppm;
+    case DEVICE_CONFIG_ATTR_DEADBAND_TEMPERATURE:
+        return &config->deadband_temperature;
+    case DEVICE_CONFIG_ATTR_DEADBAND_HUMIDITY:
+        return &config->deadband_humidity;
+    default:
+        return NULL;
+    }
+}
+
+static void device_config_zcl_add_u16(esp_zb_attribute_list_t *cluster, uint16_t attr_id)
+{
+    esp_zb_custom_cluster_add_custom_attr(cluster, attr_id, ESP_ZB_ZCL_ATTR_TYPE_U16,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE,
+                                          device_config_zcl_field(&s_attr, attr_id));
+}
+
+esp_zb_attribute_list_t *device_config_zcl_cluster_create(const device_config_t *config)
+{
+    s_attr = *config;
+
+    esp_zb_attribute_list_t *cluster = esp_zb_zcl_attr_list_create(DEVICE_CONFIG_CLUSTER_ID);
+    device_config_zcl_add_u16(cluster, DEVICE_CONFIG_ATTR_WAKE_MIN);
+    device_config_zcl_add_u16(cluster, DEVICE_CONFIG_ATTR_WAKE_MAX);
+    device_config_zcl_add_u16(cluster, DEVICE_CONFIG_ATTR_TEMPERATURE_OFFSET);
+    device_config_zcl_add_u16(cluster, DEVICE_CONFIG_ATTR_ALTITUDE);
+    esp_zb_custom_cluster_add_custom_attr(cluster, DEVICE_CONFIG_ATTR_ASC, ESP_ZB_ZCL_ATTR_TYPE_BOOL,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &s_attr.asc_enabled);
+    device_config_zcl_add_u16(cluster, DEVICE_CONFIG_ATTR_DEADBAND_CO2);
+    device_config_zcl_add_u16(cluster, DEVICE_CONFIG_ATTR_DEADBAND_TEMPERATURE);
+    device_config_zcl_add_u16(cluster, DEVICE_CONFIG_ATTR_DEADBAND_HUMIDITY);
+    esp_zb_custom_cluster_add_custom_attr(cluster, DEVICE_CONFIG_ATTR_SLEEP_MODE, ESP_ZB_ZCL_ATTR_TYPE_8BIT_ENUM,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &s_attr.sleep_mode);
+    return cluster;
+}
+
+bool device_config_zcl_write(uint8_t endpoint, device_config_t *config,
+                             const esp_zb_zcl_set_attr_value_message_t *message)
+{
+    uint16_t attr_id = message->attribute.id;
+    const void *value = message->attribute.data.value;
+    device_config_t updated = *config;
+
+    if (value == NULL) {
+        return false;
+    }
+    if (attr_id == DEVICE_CONFIG_ATTR_ASC && message->attribute.data.type == ESP_ZB_ZCL_ATTR_TYPE_BOOL) {
+        updated.asc_enabled = *(const uint8_t *)value ? 1 : 0;
+    } else if (attr_id == DEVICE_CONFIG_ATTR_SLEEP_MODE && message->attribute.data.type == ESP_ZB_ZCL_ATTR_TYPE_8BIT_ENUM) {
+        updated.sleep_mode = *(const uint8_t *)value;
+    } else if (device_config_zcl_field(&updated, attr_id) != NULL &&
+               message->attribute.data.type == ESP_ZB_ZCL_ATTR_TYPE_U16) {
+        memcpy(device_config_zcl_field(&updated, attr_id), value, sizeof(uint16_t));
+    } else {
+        ESP_LOGW(TAG, "Ignoring write to attribute 0x%04x", attr_id);
+        return false;
+    }
+
+    if (device_config_sanitize(&updated)) {
+        // Show the value actually in use; the handler runs in the Zigbee task
+        ESP_LOGW(TAG, "Attribute 0x%04x out of range, clamped", attr_id);
+        for (uint16_t id = DEVICE_CONFIG_ATTR_WAKE_MIN; id <= DEVICE_CONFIG_ATTR_DEADBAND_HUMIDITY; id++) {
+            uint16_t *field = device_config_zcl_field(&updated, id);
+            if (field != NULL && *field != *device_config_zcl_field(&s_attr, id)) {
+                esp_zb_zcl_set_attribute_val(endpoint, DEVICE_CONFIG_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                             id, field, false);
+            }
+        }
+        if (updated.sleep_mode != s_attr.sleep_mode) {
+            esp_zb_zcl_set_attribute_val(endpoint, DEVICE_CONFIG_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                         DEVICE_CONFIG_ATTR_SLEEP_MODE, &updated.sleep_mode, false);
+        }
+    }
+    s_attr = updated;
+
+    if (memcmp(&updated, config, sizeof(updated)) == 0) {
+        return false;
+    }
+    *config = updated;
+    return true;
+}
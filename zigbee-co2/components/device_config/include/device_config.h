@@ -0,0 +1,117 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Device settings persisted in one NVS blob
+ *
+ * Settings that used to be compile-time (wake interval bounds, sensor
+ * temperature offset, altitude and ASC, report deadbands, sleep mode) are kept in a
+ * single versioned, CRC-protected blob. The blob is meant to live in RTC
+ * memory: device_config_load() keeps an RTC copy that still passes its CRC
+ * after deep sleep and reads NVS only after power-on, so a timer wake does
+ * not touch flash.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Layout version of device_config_t; bump on any change
+ */
+#define DEVICE_CONFIG_VERSION           1
+
+/**
+ * @brief Settings
+ *
+ * Fields are ordered so the struct has no padding; the CRC covers its bytes.
+ */
+typedef struct {
+    uint16_t wake_min_s;                /**< Shortest deep-sleep period */
+    uint16_t wake_max_s;                /**< Longest deep-sleep period */
+    uint16_t temperature_offset;        /**< Sensor temperature offset in 0.01 °C */
+    uint16_t altitude_m;                /**< Sensor altitude in meters */
+    uint16_t deadband_co2_ppm;          /**< CO2 report deadband */
+    uint16_t deadband_temperature;      /**< Temperature report deadband in 0.01 °C */
+    uint16_t deadband_humidity;         /**< Humidity report deadband in 0.01 %RH */
+    uint8_t asc_enabled;                /**< Sensor automatic self-calibration */
+    uint8_t sleep_mode;                 /**< DEVICE_CONFIG_SLEEP_*; was a zero reserved byte */
+} device_config_t;
+
+/**
+ * @brief Stored form: header, settings and CRC
+ */
+typedef struct {
+    uint16_t version;                   /**< DEVICE_CONFIG_VERSION when written */
+    uint16_t size;                      /**< sizeof(device_config_t) when written */
+    device_config_t config;             /**< Settings */
+    uint32_t crc;                       /**< CRC-32 of the fields above */
+} device_config_blob_t;
+
+/**
+ * @brief Values of device_config_t::sleep_mode
+ *
+ * Zero keeps the build-time choice, so blobs written before the field
+ * existed behave as before.
+ */
+#define DEVICE_CONFIG_SLEEP_DEFAULT     0   /* Kconfig choice */
+#define DEVICE_CONFIG_SLEEP_DEEP        1
+#define DEVICE_CONFIG_SLEEP_LIGHT       2
+#define DEVICE_CONFIG_SLEEP_AUTO        3
+
+/**
+ * @brief Limits enforced by device_config_sanitize()
+ */
+#define DEVICE_CONFIG_WAKE_MIN_S        5
+#define DEVICE_CONFIG_WAKE_MAX_S        3600
+#define DEVICE_CONFIG_TEMPERATURE_OFFSET_MAX 2000   /* 20 °C */
+#define DEVICE_CONFIG_ALTITUDE_MAX_M    3000
+#define DEVICE_CONFIG_DEADBAND_CO2_MAX  1000
+#define DEVICE_CONFIG_DEADBAND_TEMPERATURE_MAX 1000
+#define DEVICE_CONFIG_DEADBAND_HUMIDITY_MAX 2000
+
+/**
+ * @brief Whether a blob has the current version and a correct CRC
+ */
+bool device_config_blob_valid(const device_config_blob_t *blob);
+
+/**
+ * @brief Make blob hold the stored settings
+ *
+ * Keeps blob as it is when it is already valid (the RTC copy after deep
+ * sleep). Otherwise reads it from NVS, and falls back to defaults when NVS
+ * has no valid blob. In every case blob is valid on return.
+ *
+ * @param blob Blob to fill, normally in RTC memory
+ * @param defaults Settings used when nothing valid is stored
+ * @return
+ *     - ESP_OK if blob was valid or loaded from NVS
+ *     - ESP_ERR_NOT_FOUND if nothing was stored
+ *     - ESP_ERR_INVALID_VERSION if the stored blob has another layout
+ *     - ESP_ERR_INVALID_CRC if the stored blob is corrupt
+ */
+esp_err_t device_config_load(device_config_blob_t *blob, const device_config_t *defaults);
+
+/**
+ * @brief Seal blob->config with a new header and CRC and write it to NVS
+ *
+ * @param blob Blob with updated settings
+ * @return ESP_OK on success, NVS error otherwise (blob is still sealed)
+ */
+esp_err_t device_config_save(device_config_blob_t *blob);
+
+/**
+ * @brief Clamp settings to the supported ranges
+ *
+ * @return true if anything was changed
+ */
+bool device_config_sanitize(device_config_t *config);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,56 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Device settings as a manufacturer-specific Zigbee cluster
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_zigbee_core.h"
+#include "device_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEVICE_CONFIG_CLUSTER_ID                0xFC02  /**< Manufacturer-specific settings cluster */
+#define DEVICE_CONFIG_ATTR_WAKE_MIN             0x0000  /**< uint16, s */
+#define DEVICE_CONFIG_ATTR_WAKE_MAX             0x0001  /**< uint16, s */
+#define DEVICE_CONFIG_ATTR_TEMPERATURE_OFFSET   0x0002  /**< uint16, 0.01 °C */
+#define DEVICE_CONFIG_ATTR_ALTITUDE             0x0003  /**< uint16, m */
+#define DEVICE_CONFIG_ATTR_ASC                  0x0004  /**< bool */
+#define DEVICE_CONFIG_ATTR_DEADBAND_CO2         0x0005  /**< uint16, ppm */
+#define DEVICE_CONFIG_ATTR_DEADBAND_TEMPERATURE 0x0006  /**< uint16, 0.01 °C */
+#define DEVICE_CONFIG_ATTR_DEADBAND_HUMIDITY    0x0007  /**< uint16, 0.01 %RH */
+#define DEVICE_CONFIG_ATTR_SLEEP_MODE           0x0008  /**< enum8, DEVICE_CONFIG_SLEEP_* */
+
+/**
+ * @brief Create the settings cluster with the current values
+ *
+ * Add the result to the endpoint's cluster list as a server cluster.
+ *
+ * @param config Current settings
+ * @return Attribute list of the cluster
+ */
+esp_zb_attribute_list_t *device_config_zcl_cluster_create(const device_config_t *config);
+
+/**
+ * @brief Apply a written attribute to the settings
+ *
+ * Call from the ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID handler for this cluster.
+ * Out-of-range values are clamped and the clamped value is written back to
+ * the attribute.
+ *
+ * @param endpoint Endpoint the cluster was registered on
+ * @param config Settings, updated
+ * @param message Write callback message
+ * @return true if the settings changed
+ */
+bool device_config_zcl_write(uint8_t endpoint, device_config_t *config,
+                             const esp_zb_zcl_set_attr_value_message_t *message);
+
+#ifdef __cplusplus
+}
+#endif
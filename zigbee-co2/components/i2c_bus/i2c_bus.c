@@ -0,0 +1,279 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Shared I2C bus manager
+ */
+
+#include "i2c_bus.h"
+#include "esp_log.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+
+static const char *TAG = "i2c_bus";
+
+struct i2c_bus {
+    i2c_bus_config_t config;            /**< Pins the bus was created with */
+    i2c_master_bus_handle_t handle;     /**< Driver bus handle, NULL until created */
+    QueueHandle_t queue;                /**< Pending i2c_bus_txn_t pointers */
+    TaskHandle_t task;                  /**< Executes the queue */
+};
+
+struct i2c_bus_device {
+    struct i2c_bus *bus;                /**< Bus the device is attached to */
+    i2c_master_dev_handle_t handle;     /**< Driver device handle */
+    SemaphoreHandle_t lock;             /**< Serializes blocking helpers on this device */
+    SemaphoreHandle_t done;             /**< Given when a blocking helper's transaction completes */
+};
+
+static struct i2c_bus s_buses[I2C_NUM_MAX];
+
+/* Guards bus creation; created on first use */
+static portMUX_TYPE s_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static StaticSemaphore_t s_mutex_storage;
+static SemaphoreHandle_t s_mutex;
+
+static void i2c_bus_lock(void)
+{
+    portENTER_CRITICAL(&s_spinlock);
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutexStatic(&s_mutex_storage);
+    }
+    portEXIT_CRITICAL(&s_spinlock);
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+}
+
+static void i2c_bus_unlock(void)
+{
+    xSemaphoreGive(s_mutex);
+}
+
+static esp_err_t i2c_bus_execute(i2c_bus_txn_t *txn)
+{
+    i2c_master_dev_handle_t dev = txn->device->handle;
+
+    switch (txn->op) {
+    case I2C_BUS_OP_WRITE:
+        return i2c_master_transmit(dev, txn->tx, txn->tx_len, txn->timeout_ms);
+    case I2C_BUS_OP_READ:
+        return i2c_master_receive(dev, txn->rx, txn->rx_len, txn->timeout_ms);
+    case I2C_BUS_OP_WRITE_READ:
+        return i2c_master_transmit_receive(dev, txn->tx, txn->tx_len, txn->rx, txn->rx_len, txn->timeout_ms);
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+}
+
+static void i2c_bus_complete(i2c_bus_txn_t *txn, esp_err_t result)
+{
+    txn->result = result;
+    if (txn->callback) {
+        txn->callback(txn, txn->user_ctx);
+    }
+    if (txn->done) {
+        xSemaphoreGive(txn->done);
+    }
+}
+
+static void i2c_bus_task(void *arg)
+{
+    struct i2c_bus *bus = (struct i2c_bus *)arg;
+    i2c_bus_txn_t *txn;
+
+    while (true) {
+        // Blocks without a timeout, so an idle bus never keeps the CPU out of light sleep
+        if (xQueueReceive(bus->queue, &txn, portMAX_DELAY) == pdTRUE) {
+            i2c_bus_complete(txn, i2c_bus_execute(txn));
+        }
+    }
+}
+
+static esp_err_t i2c_bus_create(struct i2c_bus *bus, const i2c_bus_config_t *config)
+{
+    i2c_master_bus_config_t bus_config = {
+        .i2c_port = config->port,
+        .sda_io_num = config->sda_io_num,
+        .scl_io_num = config->scl_io_num,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .flags.enable_internal_pullup = config->enable_internal_pullup,
+    };
+
+    esp_err_t ret = i2c_new_master_bus(&bus_config, &bus->handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create I2C bus %d: %s", config->port, esp_err_to_name(ret));
+        return ret;
+    }
+
+    bus->queue = xQueueCreate(CONFIG_I2C_BUS_QUEUE_DEPTH, sizeof(i2c_bus_txn_t *));
+    if (bus->queue == NULL ||
+        xTaskCreate(i2c_bus_task, "i2c_bus", CONFIG_I2C_BUS_TASK_STACK_SIZE, bus,
+                    CONFIG_I2C_BUS_TASK_PRIORITY, &bus->task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start I2C bus %d task", config->port);
+        if (bus->queue) {
+            vQueueDelete(bus->queue);
+            bus->queue = NULL;
+        }
+        i2c_del_master_bus(bus->handle);
+        bus->handle = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    bus->config = *config;
+    ESP_LOGI(TAG, "I2C bus %d created (SDA %d, SCL %d)", config->port, config->sda_io_num, config->scl_io_num);
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_get(const i2c_bus_config_t *config, i2c_bus_handle_t *bus)
+{
+    if (config == NULL || bus == NULL || config->port < 0 || config->port >= I2C_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct i2c_bus *entry = &s_buses[config->port];
+    esp_err_t ret = ESP_OK;
+
+    i2c_bus_lock();
+    if (entry->handle == NULL) {
+        ret = i2c_bus_create(entry, config);
+    } else if (entry->config.sda_io_num != config->sda_io_num || entry->config.scl_io_num != config->scl_io_num) {
+        ESP_LOGE(TAG, "I2C bus %d already uses SDA %d, SCL %d", config->port,
+                 entry->config.sda_io_num, entry->config.scl_io_num);
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    i2c_bus_unlock();
+
+    if (ret == ESP_OK) {
+        *bus = entry;
+    }
+    return ret;
+}
+
+esp_err_t i2c_bus_device_add(i2c_bus_handle_t bus, uint16_t address, uint32_t scl_speed_hz,
+                             i2c_bus_device_handle_t *device)
+{
+    if (bus == NULL || device == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct i2c_bus_device *dev = calloc(1, sizeof(*dev));
+    if (dev == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    dev->bus = bus;
+    dev->lock = xSemaphoreCreateMutex();
+    dev->done = xSemaphoreCreateBinary();
+    if (dev->lock == NULL || dev->done == NULL) {
+        i2c_bus_device_remove(dev);
+        return ESP_ERR_NO_MEM;
+    }
+
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = address,
+        .scl_speed_hz = scl_speed_hz,
+    };
+
+    esp_err_t ret = i2c_master_bus_add_device(bus->handle, &dev_config, &dev->handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add I2C device 0x%02X: %s", address, esp_err_to_name(ret));
+        i2c_bus_device_remove(dev);
+        return ret;
+    }
+
+    *device = dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_device_remove(i2c_bus_device_handle_t device)
+{
+    if (device == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    if (device->handle) {
+        ret = i2c_master_bus_rm_device(device->handle);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to remove I2C device: %s", esp_err_to_name(ret));
+        }
+    }
+    if (device->lock) {
+        vSemaphoreDelete(device->lock);
+    }
+    if (device->done) {
+        vSemaphoreDelete(device->done);
+    }
+    free(device);
+
+    return ret;
+}
+
+esp_err_t i2c_bus_submit(i2c_bus_txn_t *txn)
+{
+    if (txn == NULL || txn->device == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct i2c_bus *bus = txn->device->bus;
+    txn->result = ESP_ERR_NOT_FINISHED;
+
+    // The bus task must not wait on its own queue
+    TickType_t wait = xTaskGetCurrentTaskHandle() == bus->task ? 0 : portMAX_DELAY;
+    if (xQueueSend(bus->queue, &txn, wait) != pdTRUE) {
+        ESP_LOGE(TAG, "I2C bus %d queue full", bus->config.port);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t i2c_bus_run(i2c_bus_device_handle_t device, i2c_bus_op_t op, const uint8_t *tx, size_t tx_len,
+                             uint8_t *rx, size_t rx_len, int timeout_ms)
+{
+    if (device == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    i2c_bus_txn_t txn = {
+        .device = device,
+        .op = op,
+        .tx = tx,
+        .tx_len = tx_len,
+        .rx = rx,
+        .rx_len = rx_len,
+        .timeout_ms = timeout_ms,
+    };
+
+    // Called from a completion callback: the bus is ours right now
+    if (xTaskGetCurrentTaskHandle() == device->bus->task) {
+        return i2c_bus_execute(&txn);
+    }
+
+    xSemaphoreTake(device->lock, portMAX_DELAY);
+    txn.done = device->done;
+    esp_err_t ret = i2c_bus_submit(&txn);
+    if (ret == ESP_OK) {
+        xSemaphoreTake(device->done, portMAX_DELAY);
+        ret = txn.result;
+    }
+    xSemaphoreGive(device->lock);
+
+    return ret;
+}
+
+esp_err_t i2c_bus_transmit(i2c_bus_device_handle_t device, const uint8_t *data, size_t len, int timeout_ms)
+{
+    return i2c_bus_run(device, I2C_BUS_OP_WRITE, data, len, NULL, 0, timeout_ms);
+}
+
+esp_err_t i2c_bus_receive(i2c_bus_device_handle_t device, uint8_t *data, size_t len, int timeout_ms)
+{
+    return i2c_bus_run(device, I2C_BUS_OP_READ, NULL, 0, data, len, timeout_ms);
+}
+
+esp_err_t i2c_bus_transmit_receive(i2c_bus_device_handle_t device, const uint8_t *tx, size_t tx_len,
+                                   uint8_t *rx, size_t rx_len, int timeout_ms)
+{
+    return i2c_bus_run(device, I2C_BUS_OP_WRITE_READ, tx, tx_len, rx, rx_len, timeout_ms);
+}
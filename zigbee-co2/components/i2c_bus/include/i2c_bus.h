@@ -0,0 +1,159 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Shared I2C bus manager
+ *
+ * Owns the I2C master buses so several sensor drivers can sit on the same
+ * pins. A bus is created on first use and then kept for the lifetime of the
+ * firmware (until reset or deep sleep), so a driver that is deinitialized
+ * and set up again - or a bus that idles through light sleep - does not pay
+ * the bus setup again.
+ *
+ * Every bus has one task that executes transactions from a queue in
+ * submission order. Drivers either submit a transaction and get a callback,
+ * or use the blocking helpers, which queue a transaction and wait for it on
+ * a per-device semaphore (so the caller's task notifications are untouched).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/i2c_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct i2c_bus *i2c_bus_handle_t;
+typedef struct i2c_bus_device *i2c_bus_device_handle_t;
+typedef struct i2c_bus_txn i2c_bus_txn_t;
+
+/**
+ * @brief Bus pins and options
+ */
+typedef struct {
+    i2c_port_num_t port;            /**< I2C port number */
+    int sda_io_num;                 /**< GPIO number for SDA */
+    int scl_io_num;                 /**< GPIO number for SCL */
+    bool enable_internal_pullup;    /**< Use the internal pull-ups (external ones are preferred) */
+} i2c_bus_config_t;
+
+/**
+ * @brief Transaction type
+ */
+typedef enum {
+    I2C_BUS_OP_WRITE,               /**< Write tx */
+    I2C_BUS_OP_READ,                /**< Read rx */
+    I2C_BUS_OP_WRITE_READ,          /**< Write tx, repeated START, read rx */
+} i2c_bus_op_t;
+
+/**
+ * @brief Completion callback
+ *
+ * Runs in the bus task. Must not block for long; it may submit further
+ * transactions, and blocking helpers called from here run inline.
+ */
+typedef void (*i2c_bus_cb_t)(i2c_bus_txn_t *txn, void *user_ctx);
+
+/**
+ * @brief A queued transaction
+ *
+ * Storage (and the buffers) are owned by the caller and must stay valid
+ * until completion.
+ */
+struct i2c_bus_txn {
+    i2c_bus_device_handle_t device; /**< Target device */
+    i2c_bus_op_t op;                /**< What to do */
+    const uint8_t *tx;              /**< Bytes to write */
+    size_t tx_len;                  /**< Number of bytes to write */
+    uint8_t *rx;                    /**< Buffer for read bytes */
+    size_t rx_len;                  /**< Number of bytes to read */
+    int timeout_ms;                 /**< Transfer timeout, -1 to wait forever */
+    esp_err_t result;               /**< ESP_ERR_NOT_FINISHED until completed */
+    i2c_bus_cb_t callback;          /**< Optional completion callback */
+    void *user_ctx;                 /**< Passed to callback */
+    SemaphoreHandle_t done;         /**< Optional semaphore given on completion */
+};
+
+/**
+ * @brief Get the bus on a port, creating it on first use
+ *
+ * Later calls for the same port return the cached bus; their pins must
+ * match the first configuration.
+ *
+ * @param config Bus configuration
+ * @param bus Output bus handle
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if arguments are invalid
+ *     - ESP_ERR_INVALID_STATE if the port is already in use with other pins
+ *     - ESP_ERR_NO_MEM if the queue or task cannot be created
+ *     - I2C driver error otherwise
+ */
+esp_err_t i2c_bus_get(const i2c_bus_config_t *config, i2c_bus_handle_t *bus);
+
+/**
+ * @brief Attach a device to a bus
+ *
+ * @param bus Bus handle
+ * @param address 7-bit device address
+ * @param scl_speed_hz SCL frequency used for this device
+ * @param device Output device handle
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if arguments are invalid
+ *     - ESP_ERR_NO_MEM if out of memory
+ *     - I2C driver error otherwise
+ */
+esp_err_t i2c_bus_device_add(i2c_bus_handle_t bus, uint16_t address, uint32_t scl_speed_hz,
+                             i2c_bus_device_handle_t *device);
+
+/**
+ * @brief Detach a device; the bus itself stays up
+ *
+ * No transaction for the device may be pending.
+ *
+ * @param device Device handle
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if device is NULL
+ *     - I2C driver error otherwise
+ */
+esp_err_t i2c_bus_device_remove(i2c_bus_device_handle_t device);
+
+/**
+ * @brief Queue a transaction
+ *
+ * Blocks only while the bus queue is full.
+ *
+ * @param txn Filled transaction
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if the transaction is invalid
+ */
+esp_err_t i2c_bus_submit(i2c_bus_txn_t *txn);
+
+/**
+ * @brief Write bytes to a device and wait for completion
+ */
+esp_err_t i2c_bus_transmit(i2c_bus_device_handle_t device, const uint8_t *data, size_t len, int timeout_ms);
+
+/**
+ * @brief Read bytes from a device and wait for completion
+ */
+esp_err_t i2c_bus_receive(i2c_bus_device_handle_t device, uint8_t *data, size_t len, int timeout_ms);
+
+/**
+ * @brief Write then read with a repeated START and wait for completion
+ */
+esp_err_t i2c_bus_transmit_receive(i2c_bus_device_handle_t device, const uint8_t *tx, size_t tx_len,
+                                   uint8_t *rx, size_t rx_len, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
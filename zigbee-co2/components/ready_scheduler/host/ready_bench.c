@@ -0,0 +1,149 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host benchmark: time until a conversion is read
+ *
+ * Simulates sensors whose conversion latency is off the datasheet value by
+ * a few percent and jitters from sample to sample, and measures how long
+ * the host waits per sample (trigger to the poll that finds data) with the
+ * former fixed retry schedule - poll right after starting periodic mode or
+ * after the datasheet single-shot time, then every 3 s - and with the
+ * data-ready scheduler. Prints median and 90th percentile wait
+ * and the average number of data-ready polls. The first wakes of every
+ * sensor are included, so the learning phase counts.
+ *
+ * Not part of any IDF build:
+ *
+ *   cc -O2 -Iinclude host/ready_bench.c ready_scheduler.c -o ready_bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ready_scheduler.h"
+
+#define BENCH_SENSORS       9
+#define BENCH_WAKES         200
+#define BENCH_POLL_COST_MS  2           /* get_data_ready_status: transfer plus 1 ms execution */
+#define LEGACY_RETRY_MS     3000
+
+typedef struct {
+    const char *name;
+    uint32_t datasheet_ms;              /* What the firmware assumes */
+    uint32_t jitter_ms;                 /* Sample to sample, +/- */
+    uint32_t legacy_first_ms;           /* First poll of the fixed schedule */
+} bench_case_t;
+
+typedef struct {
+    uint32_t wait_ms[BENCH_SENSORS * BENCH_WAKES];
+    uint32_t count;
+    uint32_t polls;
+} bench_result_t;
+
+static uint32_t s_rng = 0x12345678;
+
+static uint32_t rng_next(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+/* Uniform in [-range, range] */
+static int32_t rng_spread(uint32_t range)
+{
+    return range ? (int32_t)(rng_next() % (2 * range + 1)) - (int32_t)range : 0;
+}
+
+/* Sensor offsets from -4 % to +4 % of the datasheet latency */
+static uint32_t sensor_latency_ms(const bench_case_t *c, int sensor)
+{
+    return c->datasheet_ms + (int32_t)c->datasheet_ms * (sensor - BENCH_SENSORS / 2) / 100;
+}
+
+/* Former behaviour: first poll (right away, or after the datasheet time), then every 3 s */
+static uint32_t legacy_wait(const bench_case_t *c, uint32_t latency_ms, uint32_t *polls)
+{
+    uint32_t now_ms = c->legacy_first_ms;
+    while (true) {
+        (*polls)++;
+        now_ms += BENCH_POLL_COST_MS;
+        if (now_ms >= latency_ms) {
+            return now_ms;
+        }
+        now_ms += LEGACY_RETRY_MS;
+    }
+}
+
+static uint32_t scheduler_wait(const ready_scheduler_config_t *config, ready_scheduler_estimate_t *estimate,
+                               uint32_t latency_ms, uint32_t *polls)
+{
+    ready_scheduler_wait_t wait;
+    int32_t poll_ms = ready_scheduler_begin(&wait, config, estimate);
+    uint32_t now_ms = 0;
+
+    while (poll_ms >= 0) {
+        if ((uint32_t)poll_ms > now_ms) {
+            now_ms = poll_ms;
+        }
+        uint32_t sampled_ms = now_ms;
+        (*polls)++;
+        now_ms += BENCH_POLL_COST_MS;
+        poll_ms = ready_scheduler_poll(&wait, sampled_ms, sampled_ms >= latency_ms);
+    }
+    return now_ms;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report(const char *name, bench_result_t *r)
+{
+    qsort(r->wait_ms, r->count, sizeof(r->wait_ms[0]), compare_u32);
+    printf("  %-10s median %5lu ms  p90 %5lu ms  polls %.2f\n", name,
+           (unsigned long)r->wait_ms[r->count / 2], (unsigned long)r->wait_ms[r->count * 9 / 10],
+           (double)r->polls / r->count);
+}
+
+int main(void)
+{
+    static const bench_case_t cases[] = {
+        { "first periodic sample", 5000, 30, 0 },
+        { "single shot", 5000, 30, 5000 },
+        { "single shot RH/T", 50, 3, 50 },
+    };
+    static bench_result_t legacy, scheduler;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const bench_case_t *c = &cases[i];
+        const ready_scheduler_config_t config = {
+            .initial_ms = c->datasheet_ms,
+            .poll_min_ms = 10,
+            .poll_max_ms = 500,
+            .timeout_ms = c->datasheet_ms * 2 + 1000,
+        };
+        legacy.count = legacy.polls = 0;
+        scheduler.count = scheduler.polls = 0;
+
+        for (int sensor = 0; sensor < BENCH_SENSORS; sensor++) {
+            ready_scheduler_estimate_t estimate = { 0 };
+            for (int wake = 0; wake < BENCH_WAKES; wake++) {
+                uint32_t latency_ms = sensor_latency_ms(c, sensor) + rng_spread(c->jitter_ms);
+                legacy.wait_ms[legacy.count++] = legacy_wait(c, latency_ms, &legacy.polls);
+                scheduler.wait_ms[scheduler.count++] = scheduler_wait(&config, &estimate, latency_ms,
+                                                                      &scheduler.polls);
+            }
+        }
+
+        printf("%s (datasheet %lu ms, sensors -4..+4 %%, jitter +/-%lu ms)\n", c->name,
+               (unsigned long)c->datasheet_ms, (unsigned long)c->jitter_ms);
+        report("fixed", &legacy);
+        report("scheduler", &scheduler);
+    }
+
+    return 0;
+}
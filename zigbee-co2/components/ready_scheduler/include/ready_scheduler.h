@@ -0,0 +1,92 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Data-ready scheduler
+ *
+ * Decides when to ask a sensor whether its conversion is done. It keeps a
+ * running estimate of the sensor's real conversion latency, sleeps right up
+ * to the expected ready time and then polls with a short, growing backoff,
+ * so a ready sample is read within a few milliseconds instead of after a
+ * fixed retry sleep.
+ *
+ * The estimate is meant to live in RTC memory (RTC_DATA_ATTR), one per
+ * sensor and kind of conversion; a zero-initialized estimate starts from
+ * the configured datasheet latency. Times are milliseconds since the
+ * conversion was triggered.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Returned instead of a poll time when the wait is over
+ */
+#define READY_SCHEDULER_READY       (-1)
+#define READY_SCHEDULER_TIMEOUT     (-2)
+
+/**
+ * @brief Scheduler settings for one kind of conversion
+ */
+typedef struct {
+    uint32_t initial_ms;        /**< Expected latency before anything was learned */
+    uint32_t poll_min_ms;       /**< First poll interval after the expected ready time */
+    uint32_t poll_max_ms;       /**< Backoff limit */
+    uint32_t timeout_ms;        /**< Give up this long after the trigger */
+} ready_scheduler_config_t;
+
+/**
+ * @brief Learned latency, retained across deep sleep
+ */
+typedef struct {
+    uint32_t latency_x8;        /**< Smoothed latency in 1/8 ms, 0 until the first sample */
+    uint32_t samples;           /**< Conversions learned from */
+} ready_scheduler_estimate_t;
+
+/**
+ * @brief One wait for a conversion
+ */
+typedef struct {
+    const ready_scheduler_config_t *config;
+    ready_scheduler_estimate_t *estimate;
+    uint32_t step_ms;           /**< Current backoff */
+    uint32_t last_miss_ms;      /**< Time of the last poll that found no data */
+    uint32_t ready_ms;          /**< Time of the poll that found data */
+    uint16_t polls;             /**< Polls so far */
+} ready_scheduler_wait_t;
+
+/**
+ * @brief Start waiting for a conversion
+ *
+ * @param wait Wait to set up
+ * @param config Scheduler settings, must outlive the wait
+ * @param estimate Retained estimate, updated when the data turns up
+ * @return Time of the first poll
+ */
+int32_t ready_scheduler_begin(ready_scheduler_wait_t *wait, const ready_scheduler_config_t *config,
+                              ready_scheduler_estimate_t *estimate);
+
+/**
+ * @brief Feed the result of a poll
+ *
+ * @param wait Wait in progress
+ * @param now_ms Time the poll was made
+ * @param ready Whether the sensor reported data
+ * @return Time of the next poll, READY_SCHEDULER_READY or READY_SCHEDULER_TIMEOUT
+ */
+int32_t ready_scheduler_poll(ready_scheduler_wait_t *wait, uint32_t now_ms, bool ready);
+
+/**
+ * @brief Current latency estimate in ms
+ */
+uint32_t ready_scheduler_expected_ms(const ready_scheduler_config_t *config,
+                                     const ready_scheduler_estimate_t *estimate);
+
+#ifdef __cplusplus
+}
+#endif
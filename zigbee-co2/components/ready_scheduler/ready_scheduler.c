@@ -0,0 +1,82 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Data-ready scheduler
+ */
+
+#include "ready_scheduler.h"
+
+/* Weight of a new latency sample in the running average, as a shift (1/4) */
+#define READY_SCHEDULER_LATENCY_SHIFT   2
+
+static uint32_t min_u32(uint32_t a, uint32_t b)
+{
+    return a < b ? a : b;
+}
+
+uint32_t ready_scheduler_expected_ms(const ready_scheduler_config_t *config,
+                                     const ready_scheduler_estimate_t *estimate)
+{
+    if (estimate->samples == 0) {
+        return config->initial_ms;
+    }
+    return (estimate->latency_x8 + 4) / 8;
+}
+
+static void ready_scheduler_learn(ready_scheduler_estimate_t *estimate, uint32_t latency_ms)
+{
+    int32_t sample_x8 = (int32_t)(latency_ms * 8);
+
+    if (estimate->samples == 0) {
+        estimate->latency_x8 = sample_x8;
+    } else {
+        estimate->latency_x8 += (sample_x8 - (int32_t)estimate->latency_x8) >> READY_SCHEDULER_LATENCY_SHIFT;
+    }
+    if (estimate->samples < UINT32_MAX) {
+        estimate->samples++;
+    }
+}
+
+int32_t ready_scheduler_begin(ready_scheduler_wait_t *wait, const ready_scheduler_config_t *config,
+                              ready_scheduler_estimate_t *estimate)
+{
+    wait->config = config;
+    wait->estimate = estimate;
+    wait->step_ms = config->poll_min_ms;
+    wait->last_miss_ms = 0;
+    wait->ready_ms = 0;
+    wait->polls = 0;
+
+    return (int32_t)min_u32(ready_scheduler_expected_ms(config, estimate), config->timeout_ms);
+}
+
+int32_t ready_scheduler_poll(ready_scheduler_wait_t *wait, uint32_t now_ms, bool ready)
+{
+    const ready_scheduler_config_t *config = wait->config;
+    wait->polls++;
+
+    if (ready) {
+        wait->ready_ms = now_ms;
+        uint32_t latency_ms;
+        if (wait->polls > 1) {
+            // Ready somewhere between the last miss and now
+            latency_ms = wait->last_miss_ms + (now_ms - wait->last_miss_ms) / 2;
+        } else {
+            // Ready on the first poll only bounds the latency from above; lean
+            // one poll step earlier so an estimate that is too late comes down
+            uint32_t bound_ms = min_u32(now_ms, ready_scheduler_expected_ms(config, wait->estimate));
+            latency_ms = bound_ms > config->poll_min_ms ? bound_ms - config->poll_min_ms : 0;
+        }
+        ready_scheduler_learn(wait->estimate, min_u32(latency_ms, config->timeout_ms));
+        return READY_SCHEDULER_READY;
+    }
+
+    wait->last_miss_ms = now_ms;
+    if (now_ms >= config->timeout_ms) {
+        return READY_SCHEDULER_TIMEOUT;
+    }
+
+    uint32_t next_ms = min_u32(now_ms + wait->step_ms, config->timeout_ms);
+    wait->step_ms = min_u32(wait->step_ms * 2, config->poll_max_ms);
+    return (int32_t)next_ms;
+}
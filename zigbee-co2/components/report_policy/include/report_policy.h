@@ -0,0 +1,108 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change-driven report policy
+ *
+ * Decides on each wake whether the latest readings are worth an uplink.
+ * Every channel (measurand) has a deadband around the last reported value
+ * and an optional alert level with hysteresis; a maximum silence interval
+ * forces a report even when nothing changed. The state is small and meant
+ * to live in RTC memory (RTC_DATA_ATTR); a zero-initialized state reports
+ * on the first evaluation.
+ *
+ * Evaluation is side-effect free. The state only advances through
+ * report_policy_commit() once a report has actually been delivered, so a
+ * failed uplink is retried on the next wake.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REPORT_POLICY_MAX_CHANNELS  4
+
+/**
+ * @brief Why a report is due, a bitmask
+ */
+typedef enum {
+    REPORT_POLICY_NONE      = 0,
+    REPORT_POLICY_FIRST     = 1 << 0,   /**< Nothing reported yet */
+    REPORT_POLICY_CHANGE    = 1 << 1,   /**< A channel left its deadband */
+    REPORT_POLICY_SILENCE   = 1 << 2,   /**< Maximum silence interval elapsed */
+    REPORT_POLICY_ALERT     = 1 << 3,   /**< A channel entered or left its alert state */
+} report_policy_reason_t;
+
+/**
+ * @brief Per-channel settings, in the channel's own units
+ */
+typedef struct {
+    int32_t deadband;           /**< Report when |value - last reported| >= deadband, 0 reports every change */
+    bool alert_enabled;         /**< Use the alert level below */
+    int32_t alert_level;        /**< Enter alert when value >= alert_level */
+    int32_t alert_hysteresis;   /**< Leave alert when value < alert_level - alert_hysteresis */
+} report_policy_channel_t;
+
+/**
+ * @brief Policy settings
+ */
+typedef struct {
+    uint8_t num_channels;                                   /**< Channels in use */
+    report_policy_channel_t channels[REPORT_POLICY_MAX_CHANNELS];
+    uint32_t max_silence_s;                                 /**< Report at least this often, 0 for never */
+} report_policy_config_t;
+
+/**
+ * @brief Policy state, retained across deep sleep
+ */
+typedef struct {
+    bool reported;                                  /**< At least one report was delivered */
+    uint8_t alert_mask;                             /**< Channels in alert state, bit per channel */
+    uint32_t last_report_s;                         /**< Time of the last delivered report */
+    int32_t reference[REPORT_POLICY_MAX_CHANNELS];  /**< Last reported values */
+} report_policy_state_t;
+
+/**
+ * @brief Decide whether a report is due for the given readings
+ *
+ * @param config Policy settings
+ * @param state Retained state, not modified
+ * @param values One reading per channel
+ * @param now_s Current time in seconds
+ * @return Bitmask of report_policy_reason_t, REPORT_POLICY_NONE to stay silent
+ */
+uint32_t report_policy_evaluate(const report_policy_config_t *config, const report_policy_state_t *state,
+                                const int32_t *values, uint32_t now_s);
+
+/**
+ * @brief Whether the silence interval forces a report, regardless of readings
+ *
+ * Lets the caller start the radio before the readings are available.
+ *
+ * @param config Policy settings
+ * @param state Retained state
+ * @param now_s Current time in seconds
+ * @return true if a report is due anyway
+ */
+bool report_policy_due(const report_policy_config_t *config, const report_policy_state_t *state, uint32_t now_s);
+
+/**
+ * @brief Record that the given readings have been delivered
+ *
+ * Moves the deadbands to the reported values and updates the alert states.
+ *
+ * @param config Policy settings
+ * @param state Retained state to update
+ * @param values The delivered readings, one per channel
+ * @param now_s Current time in seconds
+ */
+void report_policy_commit(const report_policy_config_t *config, report_policy_state_t *state,
+                          const int32_t *values, uint32_t now_s);
+
+#ifdef __cplusplus
+}
+#endif
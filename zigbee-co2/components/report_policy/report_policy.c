@@ -0,0 +1,75 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change-driven report policy
+ */
+
+#include "report_policy.h"
+#include <stdlib.h>
+
+/**
+ * @brief Alert state of a channel after seeing a value (Schmitt trigger)
+ */
+static bool report_policy_alert(const report_policy_channel_t *channel, bool in_alert, int32_t value)
+{
+    if (!channel->alert_enabled) {
+        return false;
+    }
+    if (in_alert) {
+        return value >= channel->alert_level - channel->alert_hysteresis;
+    }
+    return value >= channel->alert_level;
+}
+
+bool report_policy_due(const report_policy_config_t *config, const report_policy_state_t *state, uint32_t now_s)
+{
+    if (!state->reported) {
+        return true;
+    }
+    // Unsigned difference also copes with the clock wrapping
+    return config->max_silence_s > 0 && now_s - state->last_report_s >= config->max_silence_s;
+}
+
+uint32_t report_policy_evaluate(const report_policy_config_t *config, const report_policy_state_t *state,
+                                const int32_t *values, uint32_t now_s)
+{
+    if (!state->reported) {
+        return REPORT_POLICY_FIRST;
+    }
+
+    uint32_t reasons = REPORT_POLICY_NONE;
+    if (report_policy_due(config, state, now_s)) {
+        reasons |= REPORT_POLICY_SILENCE;
+    }
+
+    for (uint8_t i = 0; i < config->num_channels && i < REPORT_POLICY_MAX_CHANNELS; i++) {
+        const report_policy_channel_t *channel = &config->channels[i];
+        int32_t delta = abs(values[i] - state->reference[i]);
+        if (delta > 0 && delta >= channel->deadband) {
+            reasons |= REPORT_POLICY_CHANGE;
+        }
+
+        bool in_alert = state->alert_mask & (1u << i);
+        if (report_policy_alert(channel, in_alert, values[i]) != in_alert) {
+            reasons |= REPORT_POLICY_ALERT;
+        }
+    }
+
+    return reasons;
+}
+
+void report_policy_commit(const report_policy_config_t *config, report_policy_state_t *state,
+                          const int32_t *values, uint32_t now_s)
+{
+    for (uint8_t i = 0; i < config->num_channels && i < REPORT_POLICY_MAX_CHANNELS; i++) {
+        bool in_alert = state->alert_mask & (1u << i);
+        if (report_policy_alert(&config->channels[i], in_alert, values[i])) {
+            state->alert_mask |= 1u << i;
+        } else {
+            state->alert_mask &= ~(1u << i);
+        }
+        state->reference[i] = values[i];
+    }
+    state->last_report_s = now_s;
+    state->reported = true;
+}
@@ -0,0 +1,124 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Ring buffer of timestamped measurements
+ *
+ * Meant to live in RTC slow memory (RTC_DATA_ATTR) so samples taken on wakes
+ * that do not start the radio survive deep sleep and can be sent later in
+ * one burst. A zero-initialized instance is an empty buffer.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SAMPLE_RING_CAPACITY        CONFIG_SAMPLE_RING_CAPACITY
+
+/**
+ * @brief Samples per encoded frame
+ *
+ * Keeps a frame well below the unfragmented APS payload limit.
+ */
+#define SAMPLE_RING_FRAME_SAMPLES   6
+
+/**
+ * @brief Size of an encoded frame holding SAMPLE_RING_FRAME_SAMPLES samples
+ *
+ * Layout (little endian): uint32 timestamp of the first sample in seconds,
+ * uint8 sample count, then per sample uint16 seconds since the first sample,
+ * uint16 CO2 in ppm, int16 temperature in 0.01 °C and uint16 humidity in
+ * 0.01 %RH.
+ */
+#define SAMPLE_RING_FRAME_MAX_LEN   (5 + SAMPLE_RING_FRAME_SAMPLES * 8)
+
+/**
+ * @brief One measurement, in Zigbee attribute units
+ */
+typedef struct {
+    uint32_t timestamp_s;       /**< RTC time of the measurement */
+    uint16_t co2_ppm;           /**< CO2 in ppm */
+    int16_t temperature;        /**< Temperature in 0.01 °C */
+    uint16_t humidity;          /**< Relative humidity in 0.01 % */
+} sample_ring_sample_t;
+
+/**
+ * @brief Ring buffer state
+ */
+typedef struct {
+    uint8_t head;                                       /**< Index of the oldest sample */
+    uint8_t count;                                      /**< Number of buffered samples */
+    uint32_t overwritten;                               /**< Samples lost because the buffer was full */
+    sample_ring_sample_t samples[SAMPLE_RING_CAPACITY]; /**< Storage */
+} sample_ring_t;
+
+/**
+ * @brief Reset the buffer if its state is inconsistent
+ *
+ * RTC memory holds garbage after some resets (e.g. brownout during a write);
+ * call once per boot before using the buffer.
+ *
+ * @param ring Buffer to check
+ * @return true if the buffer was reset
+ */
+bool sample_ring_validate(sample_ring_t *ring);
+
+/**
+ * @brief Append a sample, overwriting the oldest one if the buffer is full
+ */
+void sample_ring_push(sample_ring_t *ring, const sample_ring_sample_t *sample);
+
+/**
+ * @brief Number of buffered samples
+ */
+static inline uint8_t sample_ring_count(const sample_ring_t *ring)
+{
+    return ring->count;
+}
+
+/**
+ * @brief Whether the next push overwrites a sample
+ */
+static inline bool sample_ring_full(const sample_ring_t *ring)
+{
+    return ring->count == SAMPLE_RING_CAPACITY;
+}
+
+/**
+ * @brief Get a buffered sample
+ *
+ * @param ring Buffer
+ * @param index 0 for the oldest sample
+ * @return The sample, or NULL if index is out of range
+ */
+const sample_ring_sample_t *sample_ring_peek(const sample_ring_t *ring, uint8_t index);
+
+/**
+ * @brief Remove the oldest samples
+ *
+ * @param ring Buffer
+ * @param n Number of samples to remove, clamped to the buffer count
+ */
+void sample_ring_drop(sample_ring_t *ring, uint8_t n);
+
+/**
+ * @brief Encode up to SAMPLE_RING_FRAME_SAMPLES samples into a frame
+ *
+ * @param ring Buffer
+ * @param first Index of the first sample to encode (0 for the oldest)
+ * @param buf Output buffer
+ * @param len Size of buf, at least SAMPLE_RING_FRAME_MAX_LEN for a full frame
+ * @param[out] encoded Number of samples written to the frame
+ * @return Frame length in bytes, 0 if nothing was encoded
+ */
+size_t sample_ring_encode(const sample_ring_t *ring, uint8_t first, uint8_t *buf, size_t len, uint8_t *encoded);
+
+#ifdef __cplusplus
+}
+#endif
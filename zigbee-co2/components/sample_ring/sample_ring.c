@@ -0,0 +1,88 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Ring buffer of timestamped measurements
+ */
+
+#include "sample_ring.h"
+#include <string.h>
+
+static void put_u16(uint8_t *buf, uint16_t value)
+{
+    buf[0] = value & 0xFF;
+    buf[1] = value >> 8;
+}
+
+bool sample_ring_validate(sample_ring_t *ring)
+{
+    if (ring->head < SAMPLE_RING_CAPACITY && ring->count <= SAMPLE_RING_CAPACITY) {
+        return false;
+    }
+    memset(ring, 0, sizeof(*ring));
+    return true;
+}
+
+void sample_ring_push(sample_ring_t *ring, const sample_ring_sample_t *sample)
+{
+    uint8_t index = (ring->head + ring->count) % SAMPLE_RING_CAPACITY;
+    ring->samples[index] = *sample;
+
+    if (sample_ring_full(ring)) {
+        ring->head = (ring->head + 1) % SAMPLE_RING_CAPACITY;
+        ring->overwritten++;
+    } else {
+        ring->count++;
+    }
+}
+
+const sample_ring_sample_t *sample_ring_peek(const sample_ring_t *ring, uint8_t index)
+{
+    if (index >= ring->count) {
+        return NULL;
+    }
+    return &ring->samples[(ring->head + index) % SAMPLE_RING_CAPACITY];
+}
+
+void sample_ring_drop(sample_ring_t *ring, uint8_t n)
+{
+    if (n > ring->count) {
+        n = ring->count;
+    }
+    ring->head = (ring->head + n) % SAMPLE_RING_CAPACITY;
+    ring->count -= n;
+}
+
+size_t sample_ring_encode(const sample_ring_t *ring, uint8_t first, uint8_t *buf, size_t len, uint8_t *encoded)
+{
+    *encoded = 0;
+    const sample_ring_sample_t *base = sample_ring_peek(ring, first);
+    if (base == NULL || len < 5 + 8) {
+        return 0;
+    }
+
+    buf[0] = base->timestamp_s & 0xFF;
+    buf[1] = (base->timestamp_s >> 8) & 0xFF;
+    buf[2] = (base->timestamp_s >> 16) & 0xFF;
+    buf[3] = base->timestamp_s >> 24;
+
+    size_t pos = 5;
+    uint8_t n = 0;
+    while (n < SAMPLE_RING_FRAME_SAMPLES && pos + 8 <= len) {
+        const sample_ring_sample_t *sample = sample_ring_peek(ring, first + n);
+        if (sample == NULL) {
+            break;
+        }
+        // Offsets beyond ~18 h saturate; the uplink interval is far shorter
+        uint32_t delta_s = sample->timestamp_s - base->timestamp_s;
+        put_u16(&buf[pos], delta_s > UINT16_MAX ? UINT16_MAX : delta_s);
+        put_u16(&buf[pos + 2], sample->co2_ppm);
+        put_u16(&buf[pos + 4], (uint16_t)sample->temperature);
+        put_u16(&buf[pos + 6], sample->humidity);
+        pos += 8;
+        n++;
+    }
+
+    buf[4] = n;
+    *encoded = n;
+    return pos;
+}
@@ -0,0 +1,182 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host benchmark: cost and timing of the asynchronous command engine
+ *
+ * First the CPU time per command: the same commands issued and fetched
+ * directly over the simulated bus, as a driver sleeping in vTaskDelay would,
+ * and through the engine's queue, which scd40.c now runs every command on. The difference is the bookkeeping the engine adds.
+ *
+ * Then the wake sequences of the application on the virtual clock: how long
+ * such a driver would keep the calling task in vTaskDelay, how long the
+ * engine takes from submit to the last completion and how often it runs
+ * (once on submit, then once per deadline). The engine must finish each
+ * sequence in the summed execution times, with one run per command besides
+ * the first. wake_up is never acknowledged, so the init sequence shows one
+ * NACK.
+ *
+ * Compile from the component directory with the same stand-ins as
+ * strategy_bench.c:
+ *
+ *   cc -O2 -Iinclude -I../sensirion_i2c/include -I<stubs> -DCONFIG_IDF_TARGET_LINUX=1 \
+ *      -DCONFIG_SENSIRION_I2C_MAX_WORDS=16 host/async_bench.c scd40_common.c \
+ *      scd40_async.c scd40_fake_bus.c scd40_strategy.c ../sensirion_i2c/sensirion_i2c.c \
+ *      <stubs>/freertos_stubs.c -o async_bench
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "scd40_async.h"
+#include "scd40_fake_bus.h"
+
+#define BENCH_COMMANDS      200000
+#define BENCH_SEQUENCE_MAX  8
+
+typedef struct {
+    scd40_fake_bus_t bus;
+    scd40_async_t engine;
+    int64_t now_us;
+    unsigned runs;
+} bench_t;
+
+typedef struct {
+    const char *name;
+    scd40_command_t commands[BENCH_SEQUENCE_MAX];
+    size_t count;
+} sequence_t;
+
+static volatile uint16_t s_sink;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void bench_init(bench_t *b)
+{
+    scd40_fake_bus_init(&b->bus);
+    scd40_async_init(&b->engine, scd40_fake_bus_transport(&b->bus));
+    b->now_us = 0;
+    b->runs = 0;
+}
+
+/* Run the engine from deadline to deadline until its queue is empty */
+static void bench_drain(bench_t *b)
+{
+    while (true) {
+        scd40_fake_bus_set_time(&b->bus, b->now_us);
+        b->runs++;
+        int64_t next_us = scd40_async_process(&b->engine, b->now_us);
+        if (next_us == SCD40_ASYNC_IDLE) {
+            break;
+        }
+        b->now_us = next_us;
+    }
+}
+
+/* ns per command, issued and fetched directly (engine == false) or through the engine */
+static double bench_cpu(scd40_command_t command, bool engine)
+{
+    static bench_t b;
+    const scd40_command_desc_t *desc = scd40_command_desc(command);
+    const scd40_transport_t *transport = scd40_fake_bus_transport(&b.bus);
+    scd40_async_request_t request;
+    uint16_t words[SCD40_MAX_RX_WORDS];
+
+    bench_init(&b);
+    int64_t start_ns = now_ns();
+    for (int i = 0; i < BENCH_COMMANDS; i++) {
+        if (engine) {
+            scd40_async_request_init(&request, command, 0);
+            scd40_async_submit(&b.engine, &request);
+            bench_drain(&b);
+            s_sink = request.words[0];
+        } else {
+            scd40_command_issue(transport, command, 0);
+            b.now_us += (int64_t)desc->exec_time_ms * 1000;
+            scd40_fake_bus_set_time(&b.bus, b.now_us);
+            if (desc->rx_words) {
+                scd40_command_fetch(transport, words, desc->rx_words);
+                s_sink = words[0];
+            }
+        }
+    }
+    double ns = (double)(now_ns() - start_ns) / BENCH_COMMANDS;
+
+    scd40_async_deinit(&b.engine);
+    return ns;
+}
+
+static void bench_sequence(const sequence_t *sequence)
+{
+    static bench_t b;
+    scd40_async_request_t requests[BENCH_SEQUENCE_MAX];
+    int64_t blocked_us = 0;
+    size_t failed = 0;
+
+    bench_init(&b);
+    // Low-power periodic sequences start from a running sensor
+    if (sequence->commands[0] == SCD40_READ_MEASUREMENT) {
+        scd40_async_request_init(&requests[0], SCD40_START_LOW_POWER_PERIODIC_MEASUREMENT, 0);
+        scd40_async_submit(&b.engine, &requests[0]);
+        bench_drain(&b);
+        b.now_us = 30000000;
+        b.runs = 0;
+    }
+    int64_t start_us = b.now_us;
+
+    for (size_t i = 0; i < sequence->count; i++) {
+        blocked_us += (int64_t)scd40_command_desc(sequence->commands[i])->exec_time_ms * 1000;
+        scd40_async_request_init(&requests[i], sequence->commands[i], 0);
+        scd40_async_submit(&b.engine, &requests[i]);
+    }
+    bench_drain(&b);
+    for (size_t i = 0; i < sequence->count; i++) {
+        failed += requests[i].result != ESP_OK;
+    }
+
+    printf("%-28s %8.1f ms %8.1f ms %6u %9u %6u%s\n", sequence->name, blocked_us / 1000.0,
+           (b.now_us - start_us) / 1000.0, b.runs, (unsigned)sequence->count, b.bus.stats.nacks,
+           failed ? "  FAILED" : "");
+    scd40_async_deinit(&b.engine);
+}
+
+int main(void)
+{
+    static const scd40_command_t cpu_commands[] = {
+        SCD40_GET_DATA_READY_STATUS, SCD40_GET_SERIAL_NUMBER, SCD40_SET_AMBIENT_PRESSURE,
+    };
+    static const sequence_t sequences[] = {
+        { "init (wake, stop, serial)",
+          { SCD40_WAKE_UP, SCD40_STOP_PERIODIC_MEASUREMENT, SCD40_GET_SERIAL_NUMBER }, 3 },
+        { "single shot + read",
+          { SCD40_MEASURE_SINGLE_SHOT, SCD40_READ_MEASUREMENT }, 2 },
+        { "single shot RH/T + read",
+          { SCD40_MEASURE_SINGLE_SHOT_RHT_ONLY, SCD40_READ_MEASUREMENT }, 2 },
+        { "low-power periodic read",
+          { SCD40_READ_MEASUREMENT }, 1 },
+        { "settings (3 set, persist)",
+          { SCD40_SET_TEMPERATURE_OFFSET, SCD40_SET_SENSOR_ALTITUDE,
+            SCD40_SET_AUTOMATIC_SELF_CALIBRATION, SCD40_PERSIST_SETTINGS }, 4 },
+    };
+
+    printf("CPU time per command on the simulated bus (%d commands)\n", BENCH_COMMANDS);
+    printf("%-28s %11s %11s %11s\n", "command", "direct", "engine", "overhead");
+    for (size_t i = 0; i < sizeof(cpu_commands) / sizeof(cpu_commands[0]); i++) {
+        double direct = bench_cpu(cpu_commands[i], false);
+        double engine = bench_cpu(cpu_commands[i], true);
+        printf("%-28s %8.1f ns %8.1f ns %8.1f ns\n", scd40_command_desc(cpu_commands[i])->name,
+               direct, engine, engine - direct);
+    }
+
+    printf("\nWake sequences on the virtual clock\n");
+    printf("%-28s %11s %11s %6s %9s %6s\n", "sequence", "blocking", "engine", "runs", "commands", "nacks");
+    for (size_t i = 0; i < sizeof(sequences) / sizeof(sequences[0]); i++) {
+        bench_sequence(&sequences[i]);
+    }
+    printf("blocking: issue, vTaskDelay, fetch; engine: submit to last completion\n");
+
+    return 0;
+}
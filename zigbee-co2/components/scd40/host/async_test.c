@@ -0,0 +1,388 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host tests for the asynchronous command engine
+ *
+ * Runs the engine against the simulated sensor on a virtual clock and checks
+ * that requests complete in submission order after exactly the execution
+ * time of their command, that a completion callback can queue the next
+ * request, and that NACKs of a busy sensor and broken CRCs fail only the
+ * request they hit. Frames held on the bus park the engine until the bus
+ * completes them.
+ *
+ * Compile and run from the component directory:
+ *
+ *   cc -O2 -Iinclude -I../sensirion_i2c/include -I../../../components/host_test -I<stubs> \
+ *      -DCONFIG_IDF_TARGET_LINUX=1 -DCONFIG_SENSIRION_I2C_MAX_WORDS=16 host/async_test.c \
+ *      scd40_common.c scd40_async.c scd40_fake_bus.c scd40_strategy.c \
+ *      ../sensirion_i2c/sensirion_i2c.c -o async_test && ./async_test
+ *
+ * <stubs> needs esp_err.h, esp_log.h, sdkconfig.h and freertos/event_groups.h
+ * declaring the calls implemented below.
+ */
+
+#include <stdio.h>
+#include "scd40_async.h"
+#include "scd40_fake_bus.h"
+#include "host_test.h"
+
+/* The FreeRTOS and IDF calls the engine makes */
+typedef struct {
+    EventBits_t bits;
+} event_group_t;
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    return ((event_group_t *)group)->bits |= bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    EventBits_t before = ((event_group_t *)group)->bits;
+    ((event_group_t *)group)->bits &= ~bits;
+    return before;
+}
+
+const char *esp_err_to_name(esp_err_t err)
+{
+    return err == ESP_OK ? "ESP_OK" : "error";
+}
+
+typedef struct {
+    scd40_fake_bus_t bus;
+    scd40_async_t engine;
+    int64_t now_us;
+    unsigned runs;                      // scd40_async_process() calls, i.e. timer wakeups on target
+} rig_t;
+
+static rig_t s_rig;
+
+static void rig_init(rig_t *rig)
+{
+    scd40_fake_bus_init(&rig->bus);
+    scd40_async_init(&rig->engine, scd40_fake_bus_transport(&rig->bus));
+    rig->now_us = 0;
+    rig->runs = 0;
+}
+
+/* Advance the engine by one step, as its timer would */
+static int64_t rig_step(rig_t *rig)
+{
+    scd40_fake_bus_set_time(&rig->bus, rig->now_us);
+    rig->runs++;
+    return scd40_async_process(&rig->engine, rig->now_us);
+}
+
+/* Jump from deadline to deadline until the queue is empty */
+static void rig_run(rig_t *rig)
+{
+    int64_t next_us;
+
+    while ((next_us = rig_step(rig)) != SCD40_ASYNC_IDLE) {
+        rig->now_us = next_us;
+    }
+}
+
+/* Completion log shared by the callbacks below */
+static scd40_command_t s_order[16];
+static int64_t s_done_us[16];
+static size_t s_done;
+
+static void record_cb(scd40_async_request_t *request, void *user_ctx)
+{
+    rig_t *rig = (rig_t *)user_ctx;
+
+    if (s_done < sizeof(s_order) / sizeof(s_order[0])) {
+        s_order[s_done] = request->command;
+        s_done_us[s_done] = rig->now_us;
+    }
+    s_done++;
+}
+
+static void submit(rig_t *rig, scd40_async_request_t *request, scd40_command_t command, uint16_t arg)
+{
+    scd40_async_request_init(request, command, arg);
+    request->callback = record_cb;
+    request->user_ctx = rig;
+    CHECK_EQ(scd40_async_submit(&rig->engine, request), ESP_OK);
+}
+
+static void test_exec_time(void)
+{
+    static const scd40_command_t commands[] = {
+        SCD40_GET_SERIAL_NUMBER, SCD40_STOP_PERIODIC_MEASUREMENT, SCD40_REINIT, SCD40_PERSIST_SETTINGS,
+    };
+    rig_t *rig = &s_rig;
+    scd40_async_request_t request;
+
+    rig_init(rig);
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        const scd40_command_desc_t *desc = scd40_command_desc(commands[i]);
+        int64_t start_us = rig->now_us;
+
+        submit(rig, &request, commands[i], 0);
+        // Sent right away, then nothing until the execution time has passed
+        int64_t deadline_us = rig_step(rig);
+        CHECK_EQ(deadline_us, start_us + desc->exec_time_ms * 1000LL);
+        CHECK_EQ(request.result, ESP_ERR_NOT_FINISHED);
+        rig->now_us = deadline_us - 1;
+        CHECK_EQ(rig_step(rig), deadline_us);
+        CHECK_EQ(request.result, ESP_ERR_NOT_FINISHED);
+
+        rig->now_us = deadline_us;
+        CHECK_EQ(rig_step(rig), SCD40_ASYNC_IDLE);
+        CHECK_EQ(request.result, ESP_OK);
+    }
+    CHECK_EQ(rig->bus.stats.nacks, 0);
+    CHECK_EQ(rig->bus.stats.eeprom_writes, 1);
+
+    // A late timer only delays the read, it does not fail it
+    submit(rig, &request, SCD40_GET_SERIAL_NUMBER, 0);
+    rig_step(rig);
+    rig->now_us += 250000;
+    CHECK_EQ(rig_step(rig), SCD40_ASYNC_IDLE);
+    CHECK_EQ(request.result, ESP_OK);
+    CHECK_EQ(request.words[2], 0x7F21);
+}
+
+static void test_queue_order(void)
+{
+    rig_t *rig = &s_rig;
+    scd40_async_request_t requests[5];
+    event_group_t events = { 0 };
+
+    rig_init(rig);
+    s_done = 0;
+    submit(rig, &requests[0], SCD40_WAKE_UP, 0);
+    submit(rig, &requests[1], SCD40_STOP_PERIODIC_MEASUREMENT, 0);
+    submit(rig, &requests[2], SCD40_SET_TEMPERATURE_OFFSET, 1498);
+    submit(rig, &requests[3], SCD40_GET_TEMPERATURE_OFFSET, 0);
+    scd40_async_request_init(&requests[4], SCD40_GET_SERIAL_NUMBER, 0);
+    requests[4].event_group = &events;
+    requests[4].done_bits = BIT0;
+    scd40_async_submit(&rig->engine, &requests[4]);
+
+    rig_run(rig);
+
+    CHECK_EQ(s_done, 4);
+    CHECK_EQ(s_order[0], SCD40_WAKE_UP);
+    CHECK_EQ(s_order[1], SCD40_STOP_PERIODIC_MEASUREMENT);
+    CHECK_EQ(s_order[2], SCD40_SET_TEMPERATURE_OFFSET);
+    CHECK_EQ(s_order[3], SCD40_GET_TEMPERATURE_OFFSET);
+    for (int i = 0; i < 5; i++) {
+        CHECK_EQ(requests[i].result, ESP_OK);
+    }
+    CHECK_EQ(requests[3].words[0], 1498);
+    CHECK_EQ(events.bits, BIT0);
+    CHECK_EQ(rig->engine.completed, 5);
+
+    // Back to back: each command starts when the previous one finished
+    CHECK_EQ(s_done_us[0], 20000);
+    CHECK_EQ(s_done_us[1], 520000);
+    CHECK_EQ(s_done_us[2], 521000);
+    CHECK_EQ(s_done_us[3], 522000);
+    CHECK_EQ(rig->now_us, 523000);
+    // One run per deadline plus the first
+    CHECK_EQ(rig->runs, 6);
+
+    // Requests still queued on deinit are failed, not dropped
+    submit(rig, &requests[0], SCD40_GET_SERIAL_NUMBER, 0);
+    submit(rig, &requests[1], SCD40_GET_SERIAL_NUMBER, 0);
+    rig_step(rig);
+    CHECK_EQ(scd40_async_deinit(&rig->engine), ESP_OK);
+    CHECK_EQ(requests[0].result, ESP_ERR_INVALID_STATE);
+    CHECK_EQ(requests[1].result, ESP_ERR_INVALID_STATE);
+    CHECK_EQ(rig->engine.head == NULL, true);
+}
+
+/* Polls get_data_ready_status from its own completion until a sample is there, then reads it */
+typedef struct {
+    rig_t *rig;
+    scd40_async_request_t request;
+    scd40_measurement_t measurement;
+    unsigned polls;
+    bool done;
+} poller_t;
+
+static void poll_cb(scd40_async_request_t *request, void *user_ctx)
+{
+    poller_t *poller = (poller_t *)user_ctx;
+
+    if (request->result != ESP_OK) {
+        poller->done = true;
+        return;
+    }
+    if (request->command == SCD40_READ_MEASUREMENT) {
+        scd40_async_get_measurement(request, &poller->measurement);
+        poller->done = true;
+        return;
+    }
+
+    poller->polls++;
+    bool ready = (request->words[0] & 0x07FF) != 0;
+    scd40_async_request_init(request, ready ? SCD40_READ_MEASUREMENT : SCD40_GET_DATA_READY_STATUS, 0);
+    request->callback = poll_cb;
+    request->user_ctx = poller;
+    CHECK_EQ(scd40_async_submit(&poller->rig->engine, request), ESP_OK);
+}
+
+static void test_resubmit_from_callback(void)
+{
+    rig_t *rig = &s_rig;
+    scd40_async_request_t start;
+    poller_t poller = { .rig = rig };
+
+    rig_init(rig);
+    s_done = 0;
+    scd40_fake_bus_set_sample(&rig->bus, 812, 26214, 32768);
+    submit(rig, &start, SCD40_START_PERIODIC_MEASUREMENT, 0);
+    scd40_async_request_init(&poller.request, SCD40_GET_DATA_READY_STATUS, 0);
+    poller.request.callback = poll_cb;
+    poller.request.user_ctx = &poller;
+    scd40_async_submit(&rig->engine, &poller.request);
+
+    // Leave at least 100 ms between polls, like a poll interval
+    while (!poller.done && rig->now_us < 10000000) {
+        int64_t next_us = rig_step(rig);
+        if (next_us == SCD40_ASYNC_IDLE) {
+            break;
+        }
+        rig->now_us = next_us > rig->now_us + 100000 ? next_us : rig->now_us + 100000;
+    }
+
+    CHECK_EQ(poller.done, true);
+    CHECK_EQ(poller.request.command, SCD40_READ_MEASUREMENT);
+    CHECK_EQ(poller.request.result, ESP_OK);
+    CHECK_EQ(poller.measurement.co2_ppm, 812);
+    CHECK_EQ(poller.measurement.temperature, 2500);
+    CHECK_EQ(poller.measurement.humidity, 5000);
+    // First sample 5 s after the start, polled every 100 ms
+    CHECK_EQ(poller.polls >= 49 && poller.polls <= 51, true);
+    CHECK_EQ(rig->now_us >= 5000000 && rig->now_us <= 5300000, true);
+    CHECK_EQ(rig->bus.stats.nacks, 0);
+    CHECK_EQ(rig->engine.head == NULL, true);
+}
+
+static void test_nack_while_busy(void)
+{
+    rig_t *rig = &s_rig;
+    scd40_async_request_t requests[3];
+
+    rig_init(rig);
+    s_done = 0;
+
+    // Someone else started a 500 ms command behind the engine's back
+    CHECK_EQ(scd40_command_issue(scd40_fake_bus_transport(&rig->bus), SCD40_STOP_PERIODIC_MEASUREMENT, 0), ESP_OK);
+    rig->now_us = 499000;
+    submit(rig, &requests[0], SCD40_GET_SERIAL_NUMBER, 0);
+    submit(rig, &requests[1], SCD40_WAKE_UP, 0);
+    submit(rig, &requests[2], SCD40_GET_SERIAL_NUMBER, 0);
+    rig_run(rig);
+
+    // The first is NACKed and fails alone; wake_up is never acknowledged, but succeeds
+    CHECK_EQ(requests[0].result, ESP_FAIL);
+    CHECK_EQ(requests[1].result, ESP_OK);
+    CHECK_EQ(requests[2].result, ESP_OK);
+    CHECK_EQ(s_done, 3);
+    CHECK_EQ(rig->bus.stats.nacks, 2);
+
+    // A read before the sensor has data is NACKed in the read phase
+    submit(rig, &requests[0], SCD40_READ_MEASUREMENT, 0);
+    rig_run(rig);
+    CHECK_EQ(requests[0].result, ESP_FAIL);
+    CHECK_EQ(rig->bus.stats.nacks, 3);
+
+    // Commands the variant lacks are NACKed as well
+    rig->bus.variant = SCD4X_VARIANT_SCD40;
+    submit(rig, &requests[0], SCD40_MEASURE_SINGLE_SHOT, 0);
+    rig_run(rig);
+    CHECK_EQ(requests[0].result, ESP_FAIL);
+}
+
+static void test_crc_failure(void)
+{
+    rig_t *rig = &s_rig;
+    scd40_async_request_t requests[2];
+    scd40_measurement_t measurement;
+
+    rig_init(rig);
+    rig->bus.corrupt_next_crc = true;
+    submit(rig, &requests[0], SCD40_GET_SERIAL_NUMBER, 0);
+    submit(rig, &requests[1], SCD40_GET_SERIAL_NUMBER, 0);
+    rig_run(rig);
+
+    CHECK_EQ(requests[0].result, ESP_ERR_INVALID_CRC);
+    CHECK_EQ(requests[1].result, ESP_OK);
+    CHECK_EQ(requests[1].words[0], 0xB15D);
+
+    // A failed read is reported by the decoder too
+    submit(rig, &requests[0], SCD40_MEASURE_SINGLE_SHOT, 0);
+    submit(rig, &requests[1], SCD40_READ_MEASUREMENT, 0);
+    rig_step(rig);
+    rig->bus.corrupt_next_crc = true;
+    rig_run(rig);
+    CHECK_EQ(requests[0].result, ESP_OK);
+    CHECK_EQ(scd40_async_get_measurement(&requests[1], &measurement), ESP_ERR_INVALID_CRC);
+    CHECK_EQ(scd40_async_get_measurement(&requests[0], &measurement), ESP_ERR_INVALID_ARG);
+}
+
+static void test_frame_on_bus(void)
+{
+    rig_t *rig = &s_rig;
+    scd40_async_request_t request;
+
+    rig_init(rig);
+    rig->bus.hold_submitted = true;
+    submit(rig, &request, SCD40_GET_SERIAL_NUMBER, 0);
+
+    // The command frame waits in the bus queue; nothing to time until it is sent
+    CHECK_EQ(rig_step(rig), SCD40_ASYNC_TRANSFER);
+    CHECK_EQ(rig->bus.submitted.pending, true);
+    CHECK_EQ(rig->bus.submitted.read, false);
+    CHECK_EQ(rig->bus.submitted.len, 2);
+    CHECK_EQ(scd40_async_deinit(&rig->engine), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(rig_step(rig), SCD40_ASYNC_TRANSFER);
+
+    // The execution time counts from the run after the frame went out
+    rig->now_us = 3000;
+    CHECK_EQ(scd40_fake_bus_complete(&rig->bus), true);
+    CHECK_EQ(rig_step(rig), 4000);
+    rig->now_us = 4000;
+    CHECK_EQ(rig_step(rig), SCD40_ASYNC_TRANSFER);
+    CHECK_EQ(rig->bus.submitted.read, true);
+    CHECK_EQ(rig->bus.submitted.len, SENSIRION_READ_FRAME_LEN(3));
+    CHECK_EQ(request.result, ESP_ERR_NOT_FINISHED);
+
+    CHECK_EQ(scd40_fake_bus_complete(&rig->bus), true);
+    CHECK_EQ(scd40_fake_bus_complete(&rig->bus), false);
+    CHECK_EQ(rig_step(rig), SCD40_ASYNC_IDLE);
+    CHECK_EQ(request.result, ESP_OK);
+    CHECK_EQ(request.words[0], 0xB15D);
+    CHECK_EQ(scd40_async_deinit(&rig->engine), ESP_OK);
+}
+
+static void test_invalid(void)
+{
+    rig_t *rig = &s_rig;
+    scd40_async_request_t request;
+
+    rig_init(rig);
+    scd40_async_request_init(&request, SCD40_COMMAND_MAX, 0);
+    CHECK_EQ(scd40_async_submit(&rig->engine, &request), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(scd40_async_submit(NULL, &request), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(scd40_async_init(&rig->engine, NULL), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(rig_step(rig), SCD40_ASYNC_IDLE);
+}
+
+int main(void)
+{
+    test_exec_time();
+    test_queue_order();
+    test_resubmit_from_callback();
+    test_nack_while_busy();
+    test_crc_failure();
+    test_frame_on_bus();
+    test_invalid();
+
+    return host_test_summary("scd40_async");
+}
@@ -0,0 +1,135 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host check: fixed-point raw word to ZCL unit conversion
+ *
+ * Checks scd40_temperature_from_raw(), scd40_humidity_from_raw() and
+ * scd40_co2_fraction_bits() against a double-precision reference for every
+ * possible 16-bit input, then times them next to the float conversion they
+ * replace (float engineering units, scaled by 100 and truncated, then
+ * ppm / 1000000.0f for CO2).
+ *
+ * The reference is exact: 17500 * raw / 65536 and 10000 * raw / 65536 are
+ * dyadic rationals a double holds without error, and a single-precision
+ * division of two exactly representable operands is correctly rounded.
+ *
+ * The timings are host figures only and say nothing about the ESP32-C6/H2,
+ * which have no FPU: on an x86 host the CO2 bit assembly is slower than the
+ * hardware float division. No cycle counts have been taken on target.
+ *
+ * Not part of any IDF build. Compile it from the component directory together
+ * with host stand-ins for esp_err.h and esp_log.h (e.g. those of an IDF linux
+ * target build):
+ *
+ *   cc -O2 -Iinclude -I../sensirion_i2c/include -I<stubs> -DCONFIG_IDF_TARGET_LINUX=1 \
+ *      -DCONFIG_SENSIRION_I2C_MAX_WORDS=16 host/convert_bench.c scd40_common.c \
+ *      ../sensirion_i2c/sensirion_i2c.c -lm -o convert_bench
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "scd40_protocol.h"
+
+#define BENCH_ROUNDS        200
+
+static volatile uint32_t s_sink;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Exact value rounded to nearest, halves up */
+static long round_half_up(double value)
+{
+    return (long)floor(value + 0.5);
+}
+
+static uint32_t float_bits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static int check(void)
+{
+    int errors = 0;
+
+    for (uint32_t raw = 0; raw <= UINT16_MAX; raw++) {
+        long temperature = round_half_up(-4500.0 + 17500.0 * raw / 65536.0);
+        long humidity = round_half_up(10000.0 * raw / 65536.0);
+        uint32_t co2 = float_bits((float)raw / 1000000.0f);
+
+        if (scd40_temperature_from_raw(raw) != temperature) {
+            printf("temperature 0x%04lX: %d, expected %ld\n", (unsigned long)raw,
+                   scd40_temperature_from_raw(raw), temperature);
+            errors++;
+        }
+        if (scd40_humidity_from_raw(raw) != humidity) {
+            printf("humidity 0x%04lX: %u, expected %ld\n", (unsigned long)raw,
+                   scd40_humidity_from_raw(raw), humidity);
+            errors++;
+        }
+        if (scd40_co2_fraction_bits(raw) != co2) {
+            printf("co2 %lu: 0x%08lX, expected 0x%08lX\n", (unsigned long)raw,
+                   (unsigned long)scd40_co2_fraction_bits(raw), (unsigned long)co2);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+/* Temperature and humidity, float: as the application converted them before */
+static void float_rht(uint32_t raw)
+{
+    float temperature_c = -45.0f + 175.0f * raw / 65536.0f;
+    float humidity_rh = 100.0f * raw / 65536.0f;
+    s_sink = (uint16_t)(int16_t)(temperature_c * 100) + (uint16_t)(humidity_rh * 100);
+}
+
+static void fixed_rht(uint32_t raw)
+{
+    s_sink = (uint16_t)scd40_temperature_from_raw(raw) + scd40_humidity_from_raw(raw);
+}
+
+static void float_co2(uint32_t raw)
+{
+    s_sink = float_bits((float)raw / 1000000.0f);
+}
+
+static void fixed_co2(uint32_t raw)
+{
+    s_sink = scd40_co2_fraction_bits(raw);
+}
+
+/* Average ns per conversion over every raw word */
+static double bench(void (*convert)(uint32_t raw))
+{
+    int64_t start = now_ns();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (uint32_t raw = 0; raw <= UINT16_MAX; raw++) {
+            convert(raw);
+        }
+    }
+    return (double)(now_ns() - start) / BENCH_ROUNDS / 65536;
+}
+
+int main(void)
+{
+    int errors = check();
+    printf("bit-exact check over 65536 raw words: %s (%d mismatches)\n", errors ? "FAIL" : "ok", errors);
+
+    double float_ns = bench(float_rht);
+    double fixed_ns = bench(fixed_rht);
+    printf("temperature + humidity: float %.2f ns, fixed %.2f ns (host)\n", float_ns, fixed_ns);
+    float_ns = bench(float_co2);
+    fixed_ns = bench(fixed_co2);
+    printf("co2 fraction:           float %.2f ns, fixed %.2f ns (host)\n", float_ns, fixed_ns);
+
+    return errors ? 1 : 0;
+}
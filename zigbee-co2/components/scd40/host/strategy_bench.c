@@ -0,0 +1,171 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host benchmark: energy per sample of each measurement strategy
+ *
+ * Runs the wake cycle of every strategy against the simulated sensor for a
+ * range of sampling intervals, integrates the sensor current on the fake bus
+ * plus the host waiting for the conversion, and prints the result next to
+ * the scd40_strategy.h estimate. The strategy scd40_strategy_select() would
+ * pick is marked with '*' (CO2 needed) and '+' (CO2 may be skipped).
+ *
+ * Not part of any IDF build. Compile it from the component directory together
+ * with host stand-ins for esp_err.h, esp_log.h and the FreeRTOS event group
+ * API (e.g. those of an IDF linux target build):
+ *
+ *   cc -O2 -Iinclude -I../sensirion_i2c/include -I<stubs> -DCONFIG_IDF_TARGET_LINUX=1 \
+ *      -DCONFIG_SENSIRION_I2C_MAX_WORDS=16 host/strategy_bench.c scd40_common.c \
+ *      scd40_async.c scd40_fake_bus.c scd40_strategy.c ../sensirion_i2c/sensirion_i2c.c \
+ *      <stubs>/freertos_stubs.c -o strategy_bench
+ */
+
+#include <stdio.h>
+#include "scd40_async.h"
+#include "scd40_fake_bus.h"
+#include "scd40_strategy.h"
+
+#define BENCH_WAKES         20
+
+typedef struct {
+    scd40_fake_bus_t bus;
+    scd40_async_t engine;
+    int64_t now_us;
+} bench_t;
+
+/* Run one command to completion on the virtual clock */
+static esp_err_t bench_run(bench_t *b, scd40_command_t command)
+{
+    scd40_async_request_t request;
+    scd40_async_request_init(&request, command, 0);
+    scd40_async_submit(&b->engine, &request);
+
+    while (true) {
+        scd40_fake_bus_set_time(&b->bus, b->now_us);
+        int64_t next_us = scd40_async_process(&b->engine, b->now_us);
+        if (next_us == SCD40_ASYNC_IDLE) {
+            break;
+        }
+        b->now_us = next_us;
+    }
+    return request.result;
+}
+
+static void bench_wait(bench_t *b, uint32_t ms)
+{
+    b->now_us += (int64_t)ms * 1000;
+    scd40_fake_bus_set_time(&b->bus, b->now_us);
+}
+
+/* Bring the sensor into the state it is left in between wakes */
+static void bench_prepare(bench_t *b, scd40_strategy_t strategy)
+{
+    if (strategy == SCD40_STRATEGY_LOW_POWER_PERIODIC) {
+        bench_run(b, SCD40_START_LOW_POWER_PERIODIC_MEASUREMENT);
+    } else if (strategy == SCD40_STRATEGY_PERIODIC) {
+        bench_run(b, SCD40_POWER_DOWN);
+    }
+}
+
+/* One wake: obtain a sample the way the application does */
+static esp_err_t bench_wake(bench_t *b, scd40_strategy_t strategy)
+{
+    switch (strategy) {
+    case SCD40_STRATEGY_PERIODIC:
+        bench_run(b, SCD40_WAKE_UP);
+        bench_run(b, SCD40_START_PERIODIC_MEASUREMENT);
+        bench_wait(b, scd40_strategy_wait_ms(strategy));
+        if (bench_run(b, SCD40_READ_MEASUREMENT) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        bench_run(b, SCD40_STOP_PERIODIC_MEASUREMENT);
+        return bench_run(b, SCD40_POWER_DOWN);
+    case SCD40_STRATEGY_LOW_POWER_PERIODIC:
+        return bench_run(b, SCD40_READ_MEASUREMENT);
+    case SCD40_STRATEGY_SINGLE_SHOT:
+        bench_run(b, SCD40_MEASURE_SINGLE_SHOT);
+        return bench_run(b, SCD40_READ_MEASUREMENT);
+    case SCD40_STRATEGY_SINGLE_SHOT_RHT_ONLY:
+        bench_run(b, SCD40_MEASURE_SINGLE_SHOT_RHT_ONLY);
+        return bench_run(b, SCD40_READ_MEASUREMENT);
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+}
+
+/* Measured charge per sample in µC, or UINT32_MAX if the strategy failed */
+static uint32_t bench_strategy(scd40_variant_t variant, scd40_strategy_t strategy, uint32_t interval_s)
+{
+    static bench_t b;
+    scd40_fake_bus_init(&b.bus);
+    b.bus.variant = variant;
+    b.now_us = 0;
+    scd40_async_init(&b.engine, scd40_fake_bus_transport(&b.bus));
+
+    bench_prepare(&b, strategy);
+    uint64_t start_pc = 0;
+    uint64_t host_wait_ms = 0;
+    int64_t wake_us = 0;
+
+    // The first wake is a warm-up that leaves the sensor in its steady state
+    for (int wake = 0; wake <= BENCH_WAKES; wake++) {
+        wake_us += (int64_t)interval_s * 1000000;
+        scd40_fake_bus_set_time(&b.bus, wake_us);
+        b.now_us = wake_us;
+        if (wake == 1) {
+            start_pc = b.bus.stats.charge_pc;
+        }
+
+        if (bench_wake(&b, strategy) != ESP_OK) {
+            scd40_async_deinit(&b.engine);
+            return UINT32_MAX;
+        }
+        if (wake > 0) {
+            host_wait_ms += (b.now_us - wake_us) / 1000;
+        }
+    }
+    // Close the last interval so every sample carries a full period
+    scd40_fake_bus_set_time(&b.bus, wake_us + (int64_t)interval_s * 1000000);
+    scd40_async_deinit(&b.engine);
+
+    const scd40_energy_model_t model = SCD40_ENERGY_MODEL_DEFAULT();
+    uint64_t pc = b.bus.stats.charge_pc - start_pc + (uint64_t)model.host_wait_na * host_wait_ms;
+    return (uint32_t)(pc / 1000000 / BENCH_WAKES);
+}
+
+int main(void)
+{
+    static const uint32_t intervals[] = { 30, 60, 120, 300, 600 };
+    static const scd40_variant_t variants[] = { SCD4X_VARIANT_SCD40, SCD4X_VARIANT_SCD41 };
+    const scd40_energy_model_t model = SCD40_ENERGY_MODEL_DEFAULT();
+
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        printf("%s: sensor + host charge per sample at 3.3 V, measured / model (mJ)\n",
+               scd40_variant_name(variants[v]));
+        printf("%-22s", "interval");
+        for (size_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++) {
+            printf("%16lus", (unsigned long)intervals[i]);
+        }
+        printf("\n");
+
+        for (int s = 0; s < SCD40_STRATEGY_MAX; s++) {
+            scd40_strategy_t strategy = (scd40_strategy_t)s;
+            printf("%-22s", scd40_strategy_name(strategy));
+            for (size_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++) {
+                if (!scd40_strategy_supported(variants[v], strategy)) {
+                    printf("%17s", "-");
+                    continue;
+                }
+                uint32_t measured = bench_strategy(variants[v], strategy, intervals[i]);
+                uint32_t estimate = scd40_strategy_charge_uc(&model, strategy, intervals[i]);
+                bool co2_pick = scd40_strategy_select(&model, variants[v], intervals[i], true) == strategy;
+                bool rht_pick = scd40_strategy_select(&model, variants[v], intervals[i], false) == strategy;
+                printf("%7.1f / %6.1f%c%c", measured * 3.3 / 1000, estimate * 3.3 / 1000,
+                       co2_pick ? '*' : ' ', rht_pick ? '+' : ' ');
+            }
+            printf("\n");
+        }
+        printf("* cheapest with CO2, + cheapest when CO2 may be skipped\n\n");
+    }
+
+    return 0;
+}
@@ -4,7 +4,11 @@
  * SCD40 CO2 Sensor Driver
  * 
  * This driver provides an interface to the Sensirion SCD40 CO2 sensor
- * using I2C communication protocol with the new I2C master driver API.
+ * over a bus shared through the i2c_bus component. Every command runs
+ * through the handle's scd40_async engine: the calling task blocks on an
+ * event group for the sensor's execution time rather than in vTaskDelay,
+ * and the same engine takes requests queued directly by the application.
+ * The blocking calls on one handle must come from one task at a time.
  */
 
 #pragma once
@@ -12,7 +16,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "driver/i2c_master.h"
+#include "i2c_bus.h"
 #include "esp_err.h"
+#include "scd40_protocol.h"
+#include "scd40_async.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,18 +44,25 @@ typedef struct {
  * @brief SCD40 sensor handle
  */
 typedef struct {
-    i2c_master_bus_handle_t bus_handle;  /**< I2C master bus handle */
-    i2c_master_dev_handle_t dev_handle;  /**< I2C device handle */
+    i2c_bus_handle_t bus;                /**< Shared I2C bus */
+    i2c_bus_device_handle_t device;      /**< SCD40 on that bus */
+    scd40_transport_t transport;         /**< Transport over device, usable with scd40_async */
+    i2c_bus_txn_t txn;                   /**< Frame queued by transport.submit */
+    sensirion_done_cb_t txn_done;        /**< Its completion */
+    void *txn_arg;                       /**< Passed to txn_done */
+    scd40_async_t engine;                /**< Runs every command, also open to scd40_async_submit() */
+    EventGroupHandle_t events;           /**< Completion of the blocking calls' requests */
 } scd40_handle_t;
 
 /**
- * @brief SCD40 measurement data structure
+ * @brief Settings the sensor keeps in its EEPROM
  */
 typedef struct {
-    uint16_t co2_ppm;       /**< CO2 concentration in ppm */
-    float temperature_c;    /**< Temperature in degrees Celsius */
-    float humidity_rh;      /**< Relative humidity in percent */
-} scd40_measurement_t;
+    bool valid;                     /**< The fields reflect the sensor */
+    uint16_t temperature_offset;    /**< Raw set_temperature_offset word */
+    uint16_t altitude_m;            /**< Sensor altitude in meters */
+    bool asc_enabled;               /**< Automatic self-calibration */
+} scd40_settings_t;
 
 /**
  * @brief Initialize SCD40 sensor
@@ -58,17 +72,23 @@ typedef struct {
  * @return
  *     - ESP_OK on success
  *     - ESP_ERR_INVALID_ARG if arguments are NULL
+ *     - ESP_ERR_NO_MEM if the event group cannot be created
  *     - ESP_FAIL on I2C initialization failure
  */
 esp_err_t scd40_init(const scd40_config_t *config, scd40_handle_t *handle);
 
 /**
  * @brief Deinitialize SCD40 sensor and free resources
+ *
+ * Detaches the sensor from its I2C bus. The bus itself is kept by the i2c_bus
+ * component for other devices and the next scd40_init(). Requests still
+ * queued on the engine complete with ESP_ERR_INVALID_STATE.
  * 
  * @param handle Pointer to sensor handle
  * @return
  *     - ESP_OK on success
  *     - ESP_ERR_INVALID_ARG if handle is NULL
+ *     - ESP_ERR_INVALID_STATE if a frame is on the bus; the handle stays usable
  */
 esp_err_t scd40_deinit(scd40_handle_t *handle);
 
@@ -85,6 +105,22 @@ esp_err_t scd40_deinit(scd40_handle_t *handle);
  */
 esp_err_t scd40_get_serial_number(scd40_handle_t *handle, uint64_t *serial);
 
+/**
+ * @brief Detect which SCD4x variant is connected
+ *
+ * Asks the sensor with get_sensor_variant. Older firmware does not know
+ * that command; the driver then probes with a 50 ms RH/T single shot,
+ * which only the SCD41 accepts (its sample is read and dropped).
+ * The sensor must be idle, i.e. not in a periodic measurement mode.
+ *
+ * @param handle Pointer to sensor handle
+ * @param variant Detected variant
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if arguments are NULL
+ */
+esp_err_t scd40_detect_variant(scd40_handle_t *handle, scd40_variant_t *variant);
+
 /**
  * @brief Start periodic measurement mode
  * 
@@ -98,6 +134,21 @@ esp_err_t scd40_get_serial_number(scd40_handle_t *handle, uint64_t *serial);
  */
 esp_err_t scd40_start_periodic_measurement(scd40_handle_t *handle);
 
+/**
+ * @brief Start low-power periodic measurement mode
+ * 
+ * Measurements are available approximately every 30 seconds. The sensor
+ * keeps measuring on its own, so the host may deep-sleep in between and
+ * only issue scd40_read_measurement() after waking up.
+ * 
+ * @param handle Pointer to sensor handle
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if handle is NULL
+ *     - ESP_FAIL on communication error
+ */
+esp_err_t scd40_start_low_power_periodic_measurement(scd40_handle_t *handle);
+
 /**
  * @brief Stop periodic measurement mode
  * 
@@ -163,6 +214,38 @@ esp_err_t scd40_perform_self_test(scd40_handle_t *handle, uint16_t *result);
  */
 esp_err_t scd40_perform_factory_reset(scd40_handle_t *handle);
 
+/**
+ * @brief Store the current settings in EEPROM
+ *
+ * Takes 800 ms. The EEPROM is rated for about 2000 write cycles, so call it
+ * only when a setting actually changed.
+ *
+ * @param handle Pointer to sensor handle
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if handle is NULL
+ *     - ESP_FAIL on communication error
+ */
+esp_err_t scd40_persist_settings(scd40_handle_t *handle);
+
+/**
+ * @brief Make the sensor's persisted settings match the desired ones
+ *
+ * Writes only the settings that differ from *known and persists them with a
+ * single persist_settings; nothing is sent when they already match. The
+ * sensor must be idle.
+ *
+ * @param handle Pointer to sensor handle
+ * @param desired Settings to apply (valid is ignored)
+ * @param known What the sensor holds. Read from the sensor first when
+ *              known->valid is false; updated to the desired settings on success.
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if arguments are NULL
+ *     - Communication error otherwise; known is invalidated
+ */
+esp_err_t scd40_sync_settings(scd40_handle_t *handle, const scd40_settings_t *desired, scd40_settings_t *known);
+
 /**
  * @brief Reinitialize the sensor
  * 
@@ -270,7 +353,8 @@ esp_err_t scd40_get_automatic_self_calibration(scd40_handle_t *handle, bool *ena
 /**
  * @brief Put sensor into low power single-shot measurement mode
  * 
- * Measurement takes 5 seconds.
+ * Returns once the 5 s conversion has passed; the sample is then read
+ * with scd40_read_measurement().
  * 
  * @param handle Pointer to sensor handle
  * @return
@@ -282,6 +366,8 @@ esp_err_t scd40_measure_single_shot(scd40_handle_t *handle);
 
 /**
  * @brief Put sensor into low power mode with RH/T only
+ *
+ * Returns once the 50 ms conversion has passed.
  * 
  * @param handle Pointer to sensor handle
  * @return
@@ -0,0 +1,190 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * SCD40 asynchronous command engine
+ *
+ * Commands are queued and executed one at a time. Instead of blocking the
+ * caller for the sensor's execution time, the engine arms a one-shot
+ * esp_timer and reads the response when it fires, so the submitting task
+ * can block on an event group (and the CPU can light-sleep) meanwhile.
+ * The frames themselves go through the transport's submit, i.e. the shared
+ * I2C bus queue on target, so neither the submitting task nor the timer
+ * waits for a transfer.
+ *
+ * The engine is driven by scd40_async_process(). On target this happens from
+ * the esp_timer task and from the I2C bus task when a frame completes; host
+ * builds call it directly with a virtual clock, which together with
+ * scd40_fake_bus.h allows running the engine on Linux.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "scd40_protocol.h"
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_timer.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Returned by scd40_async_process() when no command is pending
+ */
+#define SCD40_ASYNC_IDLE INT64_MAX
+
+/**
+ * @brief Returned by scd40_async_process() while a frame is on the bus
+ *
+ * The frame's completion runs the engine again on target; host builds call
+ * scd40_async_process() once the transport has completed it.
+ */
+#define SCD40_ASYNC_TRANSFER (INT64_MAX - 1)
+
+typedef struct scd40_async_request scd40_async_request_t;
+
+/**
+ * @brief Completion callback
+ *
+ * Called from the context that runs scd40_async_process() (the I2C bus task
+ * or the esp_timer task on target). Must not block; submitting a follow-up
+ * request is allowed.
+ *
+ * @param request Completed request, request->result holds the outcome
+ * @param user_ctx Context given in the request
+ */
+typedef void (*scd40_async_cb_t)(scd40_async_request_t *request, void *user_ctx);
+
+/**
+ * @brief A single queued command
+ *
+ * Storage is owned by the caller and must stay valid until completion.
+ */
+struct scd40_async_request {
+    scd40_command_t command;                /**< Command to execute */
+    uint16_t arg;                           /**< Argument word for commands that take one */
+    uint16_t words[SCD40_MAX_RX_WORDS];     /**< Response words, valid when result is ESP_OK */
+    esp_err_t result;                       /**< ESP_ERR_NOT_FINISHED until completed */
+    scd40_async_cb_t callback;              /**< Optional completion callback */
+    void *user_ctx;                         /**< Passed to callback */
+    EventGroupHandle_t event_group;         /**< Optional event group to signal on completion */
+    EventBits_t done_bits;                  /**< Bits set in event_group on completion */
+    scd40_async_request_t *next;            /**< Internal queue link */
+};
+
+/**
+ * @brief Where the request at the head of the queue is
+ */
+typedef enum {
+    SCD40_ASYNC_PHASE_QUEUED,               /**< Not sent yet */
+    SCD40_ASYNC_PHASE_SEND,                 /**< Command frame on the bus */
+    SCD40_ASYNC_PHASE_EXECUTE,              /**< Sensor executing until deadline_us */
+    SCD40_ASYNC_PHASE_FETCH,                /**< Response frame on the bus */
+} scd40_async_phase_t;
+
+/**
+ * @brief Engine state
+ */
+typedef struct {
+    const scd40_transport_t *transport;     /**< Transport to the sensor */
+    scd40_async_request_t *head;            /**< Request in flight or next to issue */
+    scd40_async_request_t *tail;            /**< Last queued request */
+    int64_t deadline_us;                    /**< When the in-flight command finishes */
+    scd40_async_phase_t phase;              /**< Progress of head */
+    bool transfer_done;                     /**< The frame of the SEND or FETCH phase completed */
+    esp_err_t transfer_result;              /**< Its result */
+    uint8_t frame[SENSIRION_READ_FRAME_LEN(SCD40_MAX_RX_WORDS)]; /**< Command or response frame on the bus */
+    bool processing;                        /**< scd40_async_process() is running */
+    uint32_t completed;                     /**< Number of completed requests */
+    portMUX_TYPE lock;                      /**< Protects the queue */
+#if !CONFIG_IDF_TARGET_LINUX
+    esp_timer_handle_t timer;               /**< Fires at deadline_us */
+#endif
+} scd40_async_t;
+
+/**
+ * @brief Initialize the engine
+ *
+ * @param engine Engine to initialize
+ * @param transport Transport to the sensor, e.g. &handle->transport
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if arguments are NULL or the transport has no submit
+ *     - esp_timer error otherwise
+ */
+esp_err_t scd40_async_init(scd40_async_t *engine, const scd40_transport_t *transport);
+
+/**
+ * @brief Release the engine's timer
+ *
+ * Pending requests are completed with ESP_ERR_INVALID_STATE. A frame on
+ * the bus cannot be recalled, so this fails while one is; wait for the
+ * request in flight first.
+ *
+ * @param engine Engine to deinitialize
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if engine is NULL
+ *     - ESP_ERR_INVALID_STATE if a frame is on the bus
+ */
+esp_err_t scd40_async_deinit(scd40_async_t *engine);
+
+/**
+ * @brief Prepare a request for submission
+ *
+ * @param request Request to fill
+ * @param command Command to execute
+ * @param arg Argument word (ignored if the command takes none)
+ */
+void scd40_async_request_init(scd40_async_request_t *request, scd40_command_t command, uint16_t arg);
+
+/**
+ * @brief Queue a request
+ *
+ * Returns immediately. On target the command frame is queued on the bus
+ * right away if the engine is idle; completion is signalled through the request's callback
+ * and/or event group bits.
+ *
+ * @param engine Engine
+ * @param request Prepared request
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if arguments are invalid
+ */
+esp_err_t scd40_async_submit(scd40_async_t *engine, scd40_async_request_t *request);
+
+/**
+ * @brief Advance the engine to the given time
+ *
+ * Issues queued commands and completes those whose execution time has
+ * elapsed. Normally called by the engine's own timer and frame completions;
+ * host builds call it directly.
+ *
+ * @param engine Engine
+ * @param now_us Current time in microseconds
+ * @return Time at which the engine needs to run next, SCD40_ASYNC_TRANSFER
+ *         while waiting for a frame, or SCD40_ASYNC_IDLE
+ */
+int64_t scd40_async_process(scd40_async_t *engine, int64_t now_us);
+
+/**
+ * @brief Decode the response of a completed read_measurement request
+ *
+ * @param request Completed SCD40_READ_MEASUREMENT request
+ * @param measurement Output measurement
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if the request is not a read_measurement
+ *     - The request's error if it failed
+ */
+esp_err_t scd40_async_get_measurement(const scd40_async_request_t *request, scd40_measurement_t *measurement);
+
+#ifdef __cplusplus
+}
+#endif
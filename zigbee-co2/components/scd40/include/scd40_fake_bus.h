@@ -0,0 +1,131 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Simulated SCD40 on a fake I2C bus
+ *
+ * Implements scd40_transport_t against a behavioural and timing model of the
+ * sensor: commands NACK while the previous one is still executing, periodic
+ * modes produce a sample every 5 s (30 s in low-power mode), single-shot
+ * conversions complete after 5 s, and only the commands the datasheet allows
+ * during periodic measurement are accepted. Time is virtual and advanced by
+ * the caller, so the command engine can be exercised on Linux without
+ * hardware or real delays. The sensor current is integrated over virtual
+ * time with an scd40_energy_model_t, and the variant can be set to an SCD40
+ * (no single-shot commands) or to firmware without get_sensor_variant.
+ * Submitted frames complete before submit returns, or are held until
+ * scd40_fake_bus_complete() to play a bus queue that is slow to get to them.
+ *
+ * Not thread-safe; intended for single-threaded host harnesses.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scd40_protocol.h"
+#include "scd40_strategy.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Operating mode of the simulated sensor
+ */
+typedef enum {
+    SCD40_FAKE_MODE_IDLE,
+    SCD40_FAKE_MODE_PERIODIC,
+    SCD40_FAKE_MODE_LOW_POWER_PERIODIC,
+    SCD40_FAKE_MODE_SLEEP,
+} scd40_fake_mode_t;
+
+/**
+ * @brief Bus traffic counters
+ */
+typedef struct {
+    uint32_t transmits;         /**< Write frames seen */
+    uint32_t receives;          /**< Read frames seen */
+    uint32_t nacks;             /**< Frames rejected by the sensor model */
+    uint32_t bytes;             /**< Bytes moved in accepted frames */
+    uint32_t eeprom_writes;     /**< persist_settings executions */
+    uint64_t charge_pc;         /**< Sensor charge drawn so far, in pC (nA * ms) */
+} scd40_fake_stats_t;
+
+/**
+ * @brief Simulated sensor state
+ */
+typedef struct {
+    int64_t now_us;                     /**< Virtual clock */
+    scd40_fake_mode_t mode;             /**< Current operating mode */
+    int64_t busy_until_us;              /**< Sensor NACKs every access until then */
+    int64_t next_sample_us;             /**< When the next conversion completes, INT64_MAX if none */
+    bool data_ready;                    /**< A sample is waiting to be read */
+    uint16_t sample[3];                 /**< Raw CO2, temperature and humidity words */
+    uint16_t response[SCD40_MAX_RX_WORDS]; /**< Pending response of the last command */
+    uint8_t response_words;             /**< Number of pending response words */
+    uint64_t serial;                    /**< 48-bit serial number */
+    uint16_t temperature_offset;        /**< Stored temperature offset (raw) */
+    uint16_t altitude;                  /**< Stored altitude in meters */
+    uint16_t ambient_pressure;          /**< Stored ambient pressure in hPa */
+    bool asc_enabled;                   /**< Automatic self-calibration setting */
+    bool corrupt_next_crc;              /**< Fault injection: break the CRC of the next read */
+    scd40_variant_t variant;            /**< Simulated part; SCD40 NACKs single-shot commands */
+    bool variant_command;               /**< Firmware knows get_sensor_variant */
+    int64_t converting_until_us;        /**< End of the running single-shot conversion */
+    bool rht_only;                      /**< Pending sample comes from an RH/T-only conversion (CO2 reads 0) */
+    scd40_energy_model_t model;         /**< Sensor currents used for stats.charge_pc (host_wait_na is ignored) */
+    bool hold_submitted;                /**< Keep submitted frames until scd40_fake_bus_complete() */
+    struct {
+        bool pending;                   /**< A frame is held */
+        bool read;                      /**< Read frame, else write */
+        uint8_t *data;                  /**< Frame buffer */
+        size_t len;                     /**< Frame length */
+        sensirion_done_cb_t done;       /**< Completion */
+        void *arg;                      /**< Passed to done */
+    } submitted;                        /**< Frame held by hold_submitted */
+    scd40_fake_stats_t stats;           /**< Traffic counters */
+    scd40_transport_t transport;        /**< Transport bound to this instance */
+} scd40_fake_bus_t;
+
+/**
+ * @brief Initialize the simulated sensor in idle mode at virtual time 0
+ *
+ * The default sample is 600 ppm, about 21 °C and 45 %RH, the part is an
+ * SCD41 that answers get_sensor_variant and the currents are
+ * SCD40_ENERGY_MODEL_DEFAULT().
+ *
+ * @param bus Instance to initialize
+ */
+void scd40_fake_bus_init(scd40_fake_bus_t *bus);
+
+/**
+ * @brief Get the transport that talks to this instance
+ */
+const scd40_transport_t *scd40_fake_bus_transport(scd40_fake_bus_t *bus);
+
+/**
+ * @brief Advance the virtual clock
+ *
+ * Completes conversions whose time has come. Time never goes backwards.
+ *
+ * @param bus Instance
+ * @param now_us New virtual time in microseconds
+ */
+void scd40_fake_bus_set_time(scd40_fake_bus_t *bus, int64_t now_us);
+
+/**
+ * @brief Execute the frame held by hold_submitted at the current virtual time
+ *
+ * @param bus Instance
+ * @return true if a frame was held and completed
+ */
+bool scd40_fake_bus_complete(scd40_fake_bus_t *bus);
+
+/**
+ * @brief Set the raw words returned by the next conversions
+ */
+void scd40_fake_bus_set_sample(scd40_fake_bus_t *bus, uint16_t co2_ppm, uint16_t temperature_raw, uint16_t humidity_raw);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,237 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * SCD40 wire protocol
+ *
+ * Command set and execution times shared by the blocking driver (scd40.h),
+ * the asynchronous command engine (scd40_async.h) and the simulated bus
+ * (scd40_fake_bus.h). Framing and CRC come from the sensirion_i2c component.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sensirion_i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maximum number of data words returned by any SCD40 command
+ */
+#define SCD40_MAX_RX_WORDS 3
+
+/**
+ * @brief Byte-level transport used to reach the sensor
+ *
+ * On target the driver installs a transport backed by the I2C master device
+ * created in scd40_init(). Host builds plug in the simulated bus instead.
+ */
+typedef sensirion_transport_t scd40_transport_t;
+
+/**
+ * @brief SCD40 commands
+ */
+typedef enum {
+    SCD40_START_PERIODIC_MEASUREMENT = 0,
+    SCD40_READ_MEASUREMENT,
+    SCD40_STOP_PERIODIC_MEASUREMENT,
+    SCD40_SET_TEMPERATURE_OFFSET,
+    SCD40_GET_TEMPERATURE_OFFSET,
+    SCD40_SET_SENSOR_ALTITUDE,
+    SCD40_GET_SENSOR_ALTITUDE,
+    SCD40_SET_AMBIENT_PRESSURE,
+    SCD40_PERFORM_FORCED_RECALIBRATION,
+    SCD40_SET_AUTOMATIC_SELF_CALIBRATION,
+    SCD40_GET_AUTOMATIC_SELF_CALIBRATION,
+    SCD40_START_LOW_POWER_PERIODIC_MEASUREMENT,
+    SCD40_GET_DATA_READY_STATUS,
+    SCD40_PERSIST_SETTINGS,
+    SCD40_GET_SERIAL_NUMBER,
+    SCD40_PERFORM_SELF_TEST,
+    SCD40_PERFORM_FACTORY_RESET,
+    SCD40_REINIT,
+    SCD40_MEASURE_SINGLE_SHOT,
+    SCD40_MEASURE_SINGLE_SHOT_RHT_ONLY,
+    SCD40_POWER_DOWN,
+    SCD40_WAKE_UP,
+    SCD40_GET_SENSOR_VARIANT,
+    SCD40_COMMAND_MAX,
+} scd40_command_t;
+
+/**
+ * @brief SCD4x family member
+ *
+ * Values are stable; they are kept in RTC memory.
+ */
+typedef enum {
+    SCD4X_VARIANT_UNKNOWN = 0,
+    SCD4X_VARIANT_SCD40,        /**< Periodic modes only */
+    SCD4X_VARIANT_SCD41,        /**< Adds single-shot measurements */
+    SCD4X_VARIANT_SCD43,        /**< SCD41 feature set */
+} scd40_variant_t;
+
+/**
+ * @brief Static description of a command
+ */
+typedef struct {
+    uint16_t code;          /**< 16-bit command code sent on the wire */
+    uint16_t exec_time_ms;  /**< Time the sensor needs before it can be read or addressed again */
+    uint8_t tx_words;       /**< Argument words sent with the command (0 or 1) */
+    uint8_t rx_words;       /**< Response words read after the execution time */
+    bool no_ack;            /**< Sensor does not acknowledge the command (wake_up) */
+    const char *name;       /**< Name for logs */
+} scd40_command_desc_t;
+
+/**
+ * @brief Datasheet conversion constants
+ *
+ * T = -45 + 175 * raw / 2^16 °C and RH = 100 * raw / 2^16 %. The measurement
+ * is kept in the ZCL units (0.01 °C, 0.01 %RH), so the scale factors are
+ * pre-multiplied by 100 and the conversion is a multiply and a shift.
+ */
+#define SCD40_RAW_SHIFT                 16
+#define SCD40_TEMPERATURE_OFFSET_C      (-45)
+#define SCD40_TEMPERATURE_SPAN_C        175
+#define SCD40_HUMIDITY_SPAN_RH          100
+#define SCD40_CENTI                     100
+#define SCD40_TEMPERATURE_SCALE         (SCD40_TEMPERATURE_SPAN_C * SCD40_CENTI)
+#define SCD40_TEMPERATURE_OFFSET        (SCD40_TEMPERATURE_OFFSET_C * SCD40_CENTI)
+#define SCD40_HUMIDITY_SCALE            (SCD40_HUMIDITY_SPAN_RH * SCD40_CENTI)
+#define SCD40_ROUND_HALF                (1UL << (SCD40_RAW_SHIFT - 1))
+
+/**
+ * @brief Humidity word reported when no humidity was measured
+ */
+#define SCD40_HUMIDITY_RAW_INVALID      0xFFFF
+
+/**
+ * @brief SCD40 measurement data structure
+ *
+ * Temperature and humidity use the units of the ZCL Temperature and Relative
+ * Humidity Measurement clusters, so they can be written to the attributes
+ * as they are.
+ */
+typedef struct {
+    uint16_t co2_ppm;       /**< CO2 concentration in ppm */
+    int16_t temperature;    /**< Temperature in 0.01 °C */
+    uint16_t humidity;      /**< Relative humidity in 0.01 %, 0 if not measured */
+} scd40_measurement_t;
+
+/**
+ * @brief Convert a raw temperature word to 0.01 °C
+ *
+ * Exact value rounded to the nearest, halves rounded up (towards +inf).
+ * The offset is a whole number of 0.01 °C, so it is added after rounding
+ * and the intermediate stays unsigned (17500 * 65535 < 2^31).
+ */
+static inline int16_t scd40_temperature_from_raw(uint16_t raw)
+{
+    return (int16_t)((int32_t)(((uint32_t)raw * SCD40_TEMPERATURE_SCALE + SCD40_ROUND_HALF) >> SCD40_RAW_SHIFT) +
+                     SCD40_TEMPERATURE_OFFSET);
+}
+
+/**
+ * @brief Convert a raw humidity word to 0.01 %RH
+ *
+ * Exact value rounded to the nearest, halves rounded up.
+ */
+static inline uint16_t scd40_humidity_from_raw(uint16_t raw)
+{
+    return (uint16_t)(((uint32_t)raw * SCD40_HUMIDITY_SCALE + SCD40_ROUND_HALF) >> SCD40_RAW_SHIFT);
+}
+
+/**
+ * @brief Convert a temperature offset in 0.01 °C to the set_temperature_offset word
+ *
+ * word = offset * 2^16 / 175 °C, rounded to the nearest.
+ */
+static inline uint16_t scd40_temperature_offset_to_raw(uint16_t offset)
+{
+    return (uint16_t)((((uint64_t)offset << SCD40_RAW_SHIFT) + SCD40_TEMPERATURE_SCALE / 2) / SCD40_TEMPERATURE_SCALE);
+}
+
+/**
+ * @brief Look up the description of a command
+ *
+ * @param command Command identifier
+ * @return Pointer to the static description, or NULL for an unknown command
+ */
+const scd40_command_desc_t *scd40_command_desc(scd40_command_t command);
+
+/**
+ * @brief Send a command (and its argument word, if any) over a transport
+ *
+ * @param transport Transport to use
+ * @param command Command identifier
+ * @param arg Argument word, ignored for commands without arguments
+ * @return
+ *     - ESP_OK on success (or on the expected NACK of wake_up)
+ *     - ESP_ERR_INVALID_ARG if arguments are invalid
+ *     - Transport error otherwise
+ */
+esp_err_t scd40_command_issue(const scd40_transport_t *transport, scd40_command_t command, uint16_t arg);
+
+/**
+ * @brief Read and CRC-check the response words of a command
+ *
+ * Must only be called once the command's execution time has elapsed.
+ *
+ * @param transport Transport to use
+ * @param words Buffer for the response words
+ * @param num_words Number of words to read
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if arguments are invalid
+ *     - ESP_ERR_INVALID_CRC on CRC validation failure
+ *     - Transport error otherwise
+ */
+esp_err_t scd40_command_fetch(const scd40_transport_t *transport, uint16_t *words, size_t num_words);
+
+/**
+ * @brief Decode the get_sensor_variant response word
+ *
+ * @param word Response word (variant in bits 15..12)
+ * @return Variant, SCD4X_VARIANT_UNKNOWN for unknown codes
+ */
+scd40_variant_t scd40_decode_variant(uint16_t word);
+
+/**
+ * @brief Whether a variant supports the single-shot commands
+ */
+bool scd40_variant_has_single_shot(scd40_variant_t variant);
+
+/**
+ * @brief Name of a variant for logs
+ */
+const char *scd40_variant_name(scd40_variant_t variant);
+
+/**
+ * @brief Convert the three read_measurement words to ZCL units
+ *
+ * Integer only; see scd40_temperature_from_raw() and scd40_humidity_from_raw().
+ *
+ * @param words Raw CO2, temperature and humidity words
+ * @param measurement Output measurement
+ */
+void scd40_decode_measurement(const uint16_t words[3], scd40_measurement_t *measurement);
+
+/**
+ * @brief CO2 as the single-precision fraction the ZCL CO2 cluster reports
+ *
+ * Returns the IEEE 754 bit pattern of ppm / 1000000 rounded to nearest,
+ * ties to even - the same bits a float division gives - computed with
+ * integer arithmetic, so no soft-float routine is pulled in.
+ *
+ * @param co2_ppm CO2 concentration in ppm
+ * @return Bit pattern of the float attribute value
+ */
+uint32_t scd40_co2_fraction_bits(uint16_t co2_ppm);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,115 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * SCD4x measurement strategies and their energy cost
+ *
+ * A battery device that samples every few minutes can get a CO2 reading in
+ * several ways, and which one is cheapest depends on the sensor variant and
+ * on the sampling interval. This module estimates the charge one sample
+ * costs for each strategy - sensor current between samples and during the
+ * conversion, plus the host staying awake while it waits for the result -
+ * and picks the cheapest one the variant supports.
+ *
+ * The same model drives the current accounting of the simulated sensor
+ * (scd40_fake_bus.h), so host benchmarks can check the estimate.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scd40_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief How a sample is obtained, and what the sensor does until the next one
+ *
+ * Values are stable; they are kept in RTC memory.
+ */
+typedef enum {
+    SCD40_STRATEGY_PERIODIC = 0,        /**< Start periodic mode, read the first sample after 5 s, power down */
+    SCD40_STRATEGY_LOW_POWER_PERIODIC,  /**< Left in low-power periodic mode, one read per wake */
+    SCD40_STRATEGY_SINGLE_SHOT,         /**< measure_single_shot (5 s), idle in between (SCD41) */
+    SCD40_STRATEGY_SINGLE_SHOT_RHT_ONLY,/**< Temperature and humidity only (50 ms), idle in between (SCD41) */
+    SCD40_STRATEGY_MAX,
+} scd40_strategy_t;
+
+/**
+ * @brief Currents of the sensor and the host, in nA at 3.3 V
+ */
+typedef struct {
+    uint32_t periodic_na;       /**< Average in periodic mode */
+    uint32_t low_power_na;      /**< Average in low-power periodic mode */
+    uint32_t conversion_na;     /**< During a single-shot conversion */
+    uint32_t idle_na;           /**< Idle, ready for a single shot */
+    uint32_t power_down_na;     /**< Powered down */
+    uint32_t host_wait_na;      /**< Host light-sleeping while it waits for a conversion */
+} scd40_energy_model_t;
+
+/**
+ * @brief Typical figures from the SCD4x datasheet
+ *
+ * The single-shot conversion current is derived from the datasheet's
+ * 0.45 mA average at one sample per 5 minutes minus the 0.15 mA idle
+ * current, spread over the 5 s conversion.
+ */
+#define SCD40_ENERGY_MODEL_DEFAULT()        \
+    {                                       \
+        .periodic_na = 15000000,            \
+        .low_power_na = 3200000,            \
+        .conversion_na = 18000000,          \
+        .idle_na = 150000,                  \
+        .power_down_na = 500,               \
+        .host_wait_na = 1000000,            \
+    }
+
+/**
+ * @brief Whether a variant can use a strategy
+ */
+bool scd40_strategy_supported(scd40_variant_t variant, scd40_strategy_t strategy);
+
+/**
+ * @brief Whether a strategy yields a CO2 value
+ */
+bool scd40_strategy_measures_co2(scd40_strategy_t strategy);
+
+/**
+ * @brief Time the host waits between triggering and reading a sample
+ *
+ * @return Milliseconds, 0 when a sample is already waiting
+ */
+uint32_t scd40_strategy_wait_ms(scd40_strategy_t strategy);
+
+/**
+ * @brief Estimated charge of one sample when sampling every interval_s seconds
+ *
+ * @param model Currents
+ * @param strategy Strategy
+ * @param interval_s Time between samples
+ * @return Charge in µC (multiply by 3.3 for µJ)
+ */
+uint32_t scd40_strategy_charge_uc(const scd40_energy_model_t *model, scd40_strategy_t strategy, uint32_t interval_s);
+
+/**
+ * @brief Pick the cheapest strategy
+ *
+ * @param model Currents
+ * @param variant Connected variant; SCD4X_VARIANT_UNKNOWN only allows the SCD40 strategies
+ * @param interval_s Time until the next sample
+ * @param co2_needed False to allow strategies that skip the CO2 conversion
+ * @return Cheapest supported strategy
+ */
+scd40_strategy_t scd40_strategy_select(const scd40_energy_model_t *model, scd40_variant_t variant,
+                                       uint32_t interval_s, bool co2_needed);
+
+/**
+ * @brief Name of a strategy for logs
+ */
+const char *scd40_strategy_name(scd40_strategy_t strategy);
+
+#ifdef __cplusplus
+}
+#endif
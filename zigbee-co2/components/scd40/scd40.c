@@ -7,143 +7,86 @@
 #include "scd40.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "freertos/event_groups.h"
 #include <string.h>
 
 static const char *TAG = "scd40";
 
-/* SCD40 Commands */
-#define SCD40_CMD_START_PERIODIC_MEASUREMENT        0x21B1
-#define SCD40_CMD_READ_MEASUREMENT                  0xEC05
-#define SCD40_CMD_STOP_PERIODIC_MEASUREMENT         0x3F86
-#define SCD40_CMD_SET_TEMPERATURE_OFFSET            0x241D
-#define SCD40_CMD_GET_TEMPERATURE_OFFSET            0x2318
-#define SCD40_CMD_SET_SENSOR_ALTITUDE               0x2427
-#define SCD40_CMD_GET_SENSOR_ALTITUDE               0x2322
-#define SCD40_CMD_SET_AMBIENT_PRESSURE              0xE000
-#define SCD40_CMD_PERFORM_FORCED_RECALIBRATION      0x362F
-#define SCD40_CMD_SET_AUTOMATIC_SELF_CALIBRATION    0x2416
-#define SCD40_CMD_GET_AUTOMATIC_SELF_CALIBRATION    0x2313
-#define SCD40_CMD_START_LOW_POWER_PERIODIC_MEAS     0x21AC
-#define SCD40_CMD_GET_DATA_READY_STATUS             0xE4B8
-#define SCD40_CMD_PERSIST_SETTINGS                  0x3615
-#define SCD40_CMD_GET_SERIAL_NUMBER                 0x3682
-#define SCD40_CMD_PERFORM_SELF_TEST                 0x3639
-#define SCD40_CMD_PERFORM_FACTORY_RESET             0x3632
-#define SCD40_CMD_REINIT                            0x3646
-#define SCD40_CMD_MEASURE_SINGLE_SHOT               0x219D
-#define SCD40_CMD_MEASURE_SINGLE_SHOT_RHT_ONLY      0x2196
-#define SCD40_CMD_POWER_DOWN                        0x36E0
-#define SCD40_CMD_WAKE_UP                           0x36F6
-
-/* Timing constants (milliseconds) */
+/* I2C transaction timeout (milliseconds) */
 #define SCD40_I2C_TIMEOUT_MS                        10000
-#define SCD40_SELF_TEST_DELAY_MS                    10000
-#define SCD40_FACTORY_RESET_DELAY_MS                1200
-#define SCD40_REINIT_DELAY_MS                       20
-#define SCD40_STOP_MEASUREMENT_DELAY_MS             500
-#define SCD40_WAKE_UP_DELAY_MS                      20
-#define SCD40_FRC_DELAY_MS                          400
 
-/* CRC-8 calculation for data integrity */
-#define SCD40_CRC8_POLYNOMIAL                       0x31
-#define SCD40_CRC8_INIT                             0xFF
+/* Set in handle->events when scd40_execute()'s request completes */
+#define SCD40_EXECUTE_DONE_BIT                      BIT0
 
-/**
- * @brief Calculate CRC-8 checksum for SCD40 data validation
- *
- * Polynomial: 0x31 (x^8 + x^5 + x^4 + 1)
- * Initialization: 0xFF
- */
-static uint8_t scd40_calculate_crc(const uint8_t *data, size_t len)
+static esp_err_t scd40_i2c_transmit(void *ctx, const uint8_t *data, size_t len)
 {
-    uint8_t crc = SCD40_CRC8_INIT;
-
-    for (size_t i = 0; i < len; i++) {
-        crc ^= data[i];
-        for (uint8_t bit = 0; bit < 8; bit++) {
-            if (crc & 0x80) {
-                crc = (crc << 1) ^ SCD40_CRC8_POLYNOMIAL;
-            } else {
-                crc = crc << 1;
-            }
-        }
-    }
-
-    return crc;
+    return i2c_bus_transmit(((scd40_handle_t *)ctx)->device, data, len, SCD40_I2C_TIMEOUT_MS);
 }
 
-/**
- * @brief Send command to SCD40 sensor
- */
-static esp_err_t scd40_send_command(i2c_master_dev_handle_t dev_handle, uint16_t cmd)
+static esp_err_t scd40_i2c_receive(void *ctx, uint8_t *data, size_t len)
 {
-    uint8_t cmd_buf[2] = {(uint8_t)(cmd >> 8), (uint8_t)(cmd & 0xFF)};
-    esp_err_t ret = i2c_master_transmit(dev_handle, cmd_buf, sizeof(cmd_buf), SCD40_I2C_TIMEOUT_MS);
-
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to send command 0x%04X: %s", cmd, esp_err_to_name(ret));
-    }
-
-    return ret;
+    return i2c_bus_receive(((scd40_handle_t *)ctx)->device, data, len, SCD40_I2C_TIMEOUT_MS);
 }
 
-/**
- * @brief Send command with data to SCD40 sensor
- */
-static esp_err_t scd40_send_command_with_data(i2c_master_dev_handle_t dev_handle, uint16_t cmd, uint16_t data)
+static void scd40_i2c_txn_done(i2c_bus_txn_t *txn, void *user_ctx)
 {
-    uint8_t buf[5];
-    buf[0] = (cmd >> 8) & 0xFF;
-    buf[1] = cmd & 0xFF;
-    buf[2] = (data >> 8) & 0xFF;
-    buf[3] = data & 0xFF;
-    buf[4] = scd40_calculate_crc(&buf[2], 2);
+    scd40_handle_t *handle = (scd40_handle_t *)user_ctx;
 
-    esp_err_t ret = i2c_master_transmit(dev_handle, buf, sizeof(buf), SCD40_I2C_TIMEOUT_MS);
+    handle->txn_done(txn->result, handle->txn_arg);
+}
 
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to send command 0x%04X with data: %s", cmd, esp_err_to_name(ret));
-    }
+static esp_err_t scd40_i2c_submit(void *ctx, bool read, uint8_t *data, size_t len,
+                                  sensirion_done_cb_t done, void *arg)
+{
+    scd40_handle_t *handle = (scd40_handle_t *)ctx;
+
+    handle->txn = (i2c_bus_txn_t) {
+        .device = handle->device,
+        .op = read ? I2C_BUS_OP_READ : I2C_BUS_OP_WRITE,
+        .tx = read ? NULL : data,
+        .tx_len = read ? 0 : len,
+        .rx = read ? data : NULL,
+        .rx_len = read ? len : 0,
+        .timeout_ms = SCD40_I2C_TIMEOUT_MS,
+        .callback = scd40_i2c_txn_done,
+        .user_ctx = handle,
+    };
+    handle->txn_done = done;
+    handle->txn_arg = arg;
 
-    return ret;
+    return i2c_bus_submit(&handle->txn);
 }
 
 /**
- * @brief Read data from SCD40 with CRC validation
+ * @brief Run one command to completion on the handle's engine
  *
- * SCD40 sends data in groups of 2 bytes + 1 CRC byte
+ * The task blocks on the handle's event group until the engine has sent the
+ * command, waited out its execution time and fetched the response, so the
+ * CPU can light-sleep meanwhile. Requests queued before it run first.
+ *
+ * @param handle Sensor handle
+ * @param command Command to execute
+ * @param arg Argument word (ignored if the command takes none)
+ * @param words Buffer for the response words (may be NULL if none)
  */
-static esp_err_t scd40_read_data_with_crc(i2c_master_dev_handle_t dev_handle, uint16_t *values, size_t num_words)
+static esp_err_t scd40_execute(scd40_handle_t *handle, scd40_command_t command, uint16_t arg, uint16_t *words)
 {
-    uint8_t buf[9]; // Maximum 3 words (6 bytes) + 3 CRC bytes
-    size_t buf_len = num_words * 3; // Each word is 2 bytes + 1 CRC
+    scd40_async_request_t request;
 
-    if (buf_len > sizeof(buf)) {
-        ESP_LOGE(TAG, "Invalid read length: %zu words (max 3)", num_words);
-        return ESP_ERR_INVALID_ARG;
-    }
+    scd40_async_request_init(&request, command, arg);
+    request.event_group = handle->events;
+    request.done_bits = SCD40_EXECUTE_DONE_BIT;
 
-    esp_err_t ret = i2c_master_receive(dev_handle, buf, buf_len, SCD40_I2C_TIMEOUT_MS);
+    esp_err_t ret = scd40_async_submit(&handle->engine, &request);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to receive data: %s", esp_err_to_name(ret));
         return ret;
     }
+    xEventGroupWaitBits(handle->events, SCD40_EXECUTE_DONE_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
 
-    // Validate CRC for each word
-    for (size_t i = 0; i < num_words; i++) {
-        uint8_t *word_data = &buf[i * 3];
-        uint8_t crc = scd40_calculate_crc(word_data, 2);
-
-        if (crc != word_data[2]) {
-            ESP_LOGE(TAG, "CRC error for word %zu: expected 0x%02X, got 0x%02X", i, crc, word_data[2]);
-            return ESP_ERR_INVALID_CRC;
-        }
-
-        values[i] = (word_data[0] << 8) | word_data[1];
+    if (request.result == ESP_OK && words != NULL) {
+        memcpy(words, request.words, scd40_command_desc(command)->rx_words * sizeof(uint16_t));
     }
-
-    return ESP_OK;
+    return request.result;
 }
 
 esp_err_t scd40_init(const scd40_config_t *config, scd40_handle_t *handle)
@@ -155,33 +98,46 @@ esp_err_t scd40_init(const scd40_config_t *config, scd40_handle_t *handle)
 
     esp_err_t ret;
 
-    // Configure I2C master bus
-    i2c_master_bus_config_t bus_config = {
-        .i2c_port = config->i2c_port,
+    // The bus is shared with other drivers and outlives this handle
+    i2c_bus_config_t bus_config = {
+        .port = config->i2c_port,
         .sda_io_num = config->sda_io_num,
         .scl_io_num = config->scl_io_num,
-        .clk_source = I2C_CLK_SRC_DEFAULT,
-        .glitch_ignore_cnt = 7,
-        .flags.enable_internal_pullup = false,
+        .enable_internal_pullup = false,
     };
 
-    ret = i2c_new_master_bus(&bus_config, &handle->bus_handle);
+    ret = i2c_bus_get(&bus_config, &handle->bus);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create I2C bus: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "Failed to get I2C bus: %s", esp_err_to_name(ret));
         return ret;
     }
 
     // Add SCD40 device to the bus
-    i2c_device_config_t dev_config = {
-        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-        .device_address = SCD40_I2C_ADDR,
-        .scl_speed_hz = config->i2c_freq_hz,
+    ret = i2c_bus_device_add(handle->bus, SCD40_I2C_ADDR, config->i2c_freq_hz, &handle->device);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add I2C device: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    handle->transport = (scd40_transport_t) {
+        .transmit = scd40_i2c_transmit,
+        .receive = scd40_i2c_receive,
+        .submit = scd40_i2c_submit,
+        .ctx = handle,
     };
 
-    ret = i2c_master_bus_add_device(handle->bus_handle, &dev_config, &handle->dev_handle);
+    handle->events = xEventGroupCreate();
+    if (handle->events == NULL) {
+        ESP_LOGE(TAG, "Failed to create event group");
+        i2c_bus_device_remove(handle->device);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ret = scd40_async_init(&handle->engine, &handle->transport);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to add I2C device: %s", esp_err_to_name(ret));
-        i2c_del_master_bus(handle->bus_handle);
+        ESP_LOGE(TAG, "Failed to initialize command engine: %s", esp_err_to_name(ret));
+        vEventGroupDelete(handle->events);
+        i2c_bus_device_remove(handle->device);
         return ret;
     }
 
@@ -197,18 +153,18 @@ esp_err_t scd40_deinit(scd40_handle_t *handle)
 
     esp_err_t ret = ESP_OK;
 
-    if (handle->dev_handle != NULL) {
-        ret = i2c_master_bus_rm_device(handle->dev_handle);
+    if (handle->events != NULL) {
+        // A frame still in the bus queue references the handle
+        ret = scd40_async_deinit(&handle->engine);
         if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to remove I2C device: %s", esp_err_to_name(ret));
+            return ret;
         }
+        vEventGroupDelete(handle->events);
     }
 
-    if (handle->bus_handle != NULL) {
-        ret = i2c_del_master_bus(handle->bus_handle);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to delete I2C bus: %s", esp_err_to_name(ret));
-        }
+    // Only the device is detached; the bus stays up for the next init and other drivers
+    if (handle->device != NULL) {
+        ret = i2c_bus_device_remove(handle->device);
     }
 
     memset(handle, 0, sizeof(scd40_handle_t));
@@ -222,20 +178,10 @@ esp_err_t scd40_get_serial_number(scd40_handle_t *handle, uint64_t *serial)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret;
     uint16_t serial_words[3];
 
-    // Send get serial number command
-    ret = scd40_send_command(handle->dev_handle, SCD40_CMD_GET_SERIAL_NUMBER);
-    if (ret != ESP_OK) {
-        return ret;
-    }
-
-    // Wait for sensor to process command (1ms)
-    vTaskDelay(pdMS_TO_TICKS(1));
-
     // Read 3 words (48 bits) with CRC
-    ret = scd40_read_data_with_crc(handle->dev_handle, serial_words, 3);
+    esp_err_t ret = scd40_execute(handle, SCD40_GET_SERIAL_NUMBER, 0, serial_words);
     if (ret != ESP_OK) {
         return ret;
     }
@@ -248,29 +194,66 @@ esp_err_t scd40_get_serial_number(scd40_handle_t *handle, uint64_t *serial)
     return ESP_OK;
 }
 
+esp_err_t scd40_detect_variant(scd40_handle_t *handle, scd40_variant_t *variant)
+{
+    if (handle == NULL || variant == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t words[SCD40_MAX_RX_WORDS];
+    esp_err_t ret = scd40_execute(handle, SCD40_GET_SENSOR_VARIANT, 0, words);
+    *variant = ret == ESP_OK ? scd40_decode_variant(words[0]) : SCD4X_VARIANT_UNKNOWN;
+
+    if (*variant == SCD4X_VARIANT_UNKNOWN) {
+        // Older firmware: only the single-shot capable parts acknowledge this
+        ret = scd40_execute(handle, SCD40_MEASURE_SINGLE_SHOT_RHT_ONLY, 0, NULL);
+        if (ret == ESP_OK) {
+            *variant = SCD4X_VARIANT_SCD41;
+            scd40_execute(handle, SCD40_READ_MEASUREMENT, 0, words);
+        } else {
+            *variant = SCD4X_VARIANT_SCD40;
+        }
+    }
+
+    ESP_LOGI(TAG, "Sensor variant: %s", scd40_variant_name(*variant));
+    return ESP_OK;
+}
+
 esp_err_t scd40_start_periodic_measurement(scd40_handle_t *handle)
 {
     if (handle == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command(handle->dev_handle, SCD40_CMD_START_PERIODIC_MEASUREMENT);
+    esp_err_t ret = scd40_execute(handle, SCD40_START_PERIODIC_MEASUREMENT, 0, NULL);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Started periodic measurement");
     }
     return ret;
 }
 
+esp_err_t scd40_start_low_power_periodic_measurement(scd40_handle_t *handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = scd40_execute(handle, SCD40_START_LOW_POWER_PERIODIC_MEASUREMENT, 0, NULL);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Started low power periodic measurement");
+    }
+    return ret;
+}
+
 esp_err_t scd40_stop_periodic_measurement(scd40_handle_t *handle)
 {
     if (handle == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command(handle->dev_handle, SCD40_CMD_STOP_PERIODIC_MEASUREMENT);
+    // Waits for sensor to stop measurements (500ms as per datasheet)
+    esp_err_t ret = scd40_execute(handle, SCD40_STOP_PERIODIC_MEASUREMENT, 0, NULL);
     if (ret == ESP_OK) {
-        // Wait for sensor to stop measurements (500ms as per datasheet)
-        vTaskDelay(pdMS_TO_TICKS(SCD40_STOP_MEASUREMENT_DELAY_MS));
         ESP_LOGI(TAG, "Stopped periodic measurement");
     }
     return ret;
@@ -282,20 +265,8 @@ esp_err_t scd40_get_data_ready_status(scd40_handle_t *handle, bool *data_ready)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret;
     uint16_t status;
-
-    // Send get data ready status command
-    ret = scd40_send_command(handle->dev_handle, SCD40_CMD_GET_DATA_READY_STATUS);
-    if (ret != ESP_OK) {
-        return ret;
-    }
-
-    // Wait for sensor response (1ms)
-    vTaskDelay(pdMS_TO_TICKS(1));
-
-    // Read status word (2 bytes + 1 CRC)
-    ret = scd40_read_data_with_crc(handle->dev_handle, &status, 1);
+    esp_err_t ret = scd40_execute(handle, SCD40_GET_DATA_READY_STATUS, 0, &status);
     if (ret != ESP_OK) {
         return ret;
     }
@@ -312,20 +283,10 @@ esp_err_t scd40_read_measurement(scd40_handle_t *handle, scd40_measurement_t *me
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret;
     uint16_t data[3];
 
-    // Send read measurement command
-    ret = scd40_send_command(handle->dev_handle, SCD40_CMD_READ_MEASUREMENT);
-    if (ret != ESP_OK) {
-        return ret;
-    }
-
-    // Wait for sensor response (1ms)
-    vTaskDelay(pdMS_TO_TICKS(1));
-
     // Read 3 words: CO2, Temperature, Humidity
-    ret = scd40_read_data_with_crc(handle->dev_handle, data, 3);
+    esp_err_t ret = scd40_execute(handle, SCD40_READ_MEASUREMENT, 0, data);
     if (ret != ESP_OK) {
         return ret;
     }
@@ -334,21 +295,10 @@ esp_err_t scd40_read_measurement(scd40_handle_t *handle, scd40_measurement_t *me
     ESP_LOGI(TAG, "Raw values - CO2: 0x%04X (%u), Temp: 0x%04X (%u), Humidity: 0x%04X (%u)",
              data[0], data[0], data[1], data[1], data[2], data[2]);
 
-    // Convert raw values according to SCD40 datasheet
-    measurement->co2_ppm = data[0];
-    measurement->temperature_c = -45.0f + 175.0f * data[1] / 65536.0f;
-    
-    // Check for invalid humidity reading (0xFFFF indicates sensor error or unavailable data)
-    // This happens when using single-shot mode on SCD41 without RHT measurement
-    if (data[2] == 0xFFFF) {
-        ESP_LOGW(TAG, "Humidity data unavailable (0xFFFF) - sensor may need RHT single-shot measurement");
-        measurement->humidity_rh = 0.0f; // Set to 0 to indicate invalid
-    } else {
-        measurement->humidity_rh = 100.0f * data[2] / 65536.0f;
-    }
+    scd40_decode_measurement(data, measurement);
 
-    ESP_LOGD(TAG, "CO2: %d ppm, Temp: %.2f °C, Humidity: %.2f %%",
-             measurement->co2_ppm, measurement->temperature_c, measurement->humidity_rh);
+    ESP_LOGD(TAG, "CO2: %d ppm, Temp: %d x0.01 °C, Humidity: %d x0.01 %%",
+             measurement->co2_ppm, measurement->temperature, measurement->humidity);
 
     return ESP_OK;
 }
@@ -359,15 +309,8 @@ esp_err_t scd40_perform_self_test(scd40_handle_t *handle, uint16_t *result)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command(handle->dev_handle, SCD40_CMD_PERFORM_SELF_TEST);
-    if (ret != ESP_OK) {
-        return ret;
-    }
-
-    // Wait for self-test to complete (10 seconds)
-    vTaskDelay(pdMS_TO_TICKS(SCD40_SELF_TEST_DELAY_MS));
-
-    ret = scd40_read_data_with_crc(handle->dev_handle, result, 1);
+    // Waits for self-test to complete (10 seconds)
+    esp_err_t ret = scd40_execute(handle, SCD40_PERFORM_SELF_TEST, 0, result);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Self-test result: 0x%04X", *result);
     }
@@ -381,24 +324,84 @@ esp_err_t scd40_perform_factory_reset(scd40_handle_t *handle)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command(handle->dev_handle, SCD40_CMD_PERFORM_FACTORY_RESET);
+    esp_err_t ret = scd40_execute(handle, SCD40_PERFORM_FACTORY_RESET, 0, NULL);
     if (ret == ESP_OK) {
-        vTaskDelay(pdMS_TO_TICKS(SCD40_FACTORY_RESET_DELAY_MS));
         ESP_LOGI(TAG, "Factory reset completed");
     }
     return ret;
 }
 
+esp_err_t scd40_persist_settings(scd40_handle_t *handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = scd40_execute(handle, SCD40_PERSIST_SETTINGS, 0, NULL);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Settings persisted to EEPROM");
+    }
+    return ret;
+}
+
+esp_err_t scd40_sync_settings(scd40_handle_t *handle, const scd40_settings_t *desired, scd40_settings_t *known)
+{
+    if (handle == NULL || desired == NULL || known == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    if (!known->valid) {
+        ret = scd40_get_temperature_offset(handle, &known->temperature_offset);
+        if (ret == ESP_OK) {
+            ret = scd40_get_sensor_altitude(handle, &known->altitude_m);
+        }
+        if (ret == ESP_OK) {
+            ret = scd40_get_automatic_self_calibration(handle, &known->asc_enabled);
+        }
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        known->valid = true;
+    }
+
+    bool changed = false;
+    if (desired->temperature_offset != known->temperature_offset) {
+        ret = scd40_set_temperature_offset(handle, desired->temperature_offset);
+        changed = true;
+    }
+    if (ret == ESP_OK && desired->altitude_m != known->altitude_m) {
+        ret = scd40_set_sensor_altitude(handle, desired->altitude_m);
+        changed = true;
+    }
+    if (ret == ESP_OK && desired->asc_enabled != known->asc_enabled) {
+        ret = scd40_set_automatic_self_calibration(handle, desired->asc_enabled);
+        changed = true;
+    }
+    if (ret == ESP_OK && changed) {
+        ret = scd40_persist_settings(handle);
+    }
+
+    if (ret != ESP_OK) {
+        // Some settings may have been written: read them back next time
+        known->valid = false;
+        return ret;
+    }
+
+    *known = *desired;
+    known->valid = true;
+    return ESP_OK;
+}
+
 esp_err_t scd40_reinit(scd40_handle_t *handle)
 {
     if (handle == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command(handle->dev_handle, SCD40_CMD_REINIT);
+    // Waits for sensor to reinitialize (20ms as per datasheet)
+    esp_err_t ret = scd40_execute(handle, SCD40_REINIT, 0, NULL);
     if (ret == ESP_OK) {
-        // Wait for sensor to reinitialize (20ms as per datasheet)
-        vTaskDelay(pdMS_TO_TICKS(SCD40_REINIT_DELAY_MS));
         ESP_LOGI(TAG, "Sensor reinitialized");
     }
     return ret;
@@ -410,7 +413,7 @@ esp_err_t scd40_set_temperature_offset(scd40_handle_t *handle, uint16_t offset)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command_with_data(handle->dev_handle, SCD40_CMD_SET_TEMPERATURE_OFFSET, offset);
+    esp_err_t ret = scd40_execute(handle, SCD40_SET_TEMPERATURE_OFFSET, offset, NULL);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Temperature offset set to %d", offset);
     }
@@ -423,14 +426,7 @@ esp_err_t scd40_get_temperature_offset(scd40_handle_t *handle, uint16_t *offset)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command(handle->dev_handle, SCD40_CMD_GET_TEMPERATURE_OFFSET);
-    if (ret != ESP_OK) {
-        return ret;
-    }
-
-    vTaskDelay(pdMS_TO_TICKS(1));
-
-    return scd40_read_data_with_crc(handle->dev_handle, offset, 1);
+    return scd40_execute(handle, SCD40_GET_TEMPERATURE_OFFSET, 0, offset);
 }
 
 esp_err_t scd40_set_sensor_altitude(scd40_handle_t *handle, uint16_t altitude)
@@ -439,7 +435,7 @@ esp_err_t scd40_set_sensor_altitude(scd40_handle_t *handle, uint16_t altitude)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command_with_data(handle->dev_handle, SCD40_CMD_SET_SENSOR_ALTITUDE, altitude);
+    esp_err_t ret = scd40_execute(handle, SCD40_SET_SENSOR_ALTITUDE, altitude, NULL);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Sensor altitude set to %d m", altitude);
     }
@@ -452,14 +448,7 @@ esp_err_t scd40_get_sensor_altitude(scd40_handle_t *handle, uint16_t *altitude)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command(handle->dev_handle, SCD40_CMD_GET_SENSOR_ALTITUDE);
-    if (ret != ESP_OK) {
-        return ret;
-    }
-
-    vTaskDelay(pdMS_TO_TICKS(1));
-
-    return scd40_read_data_with_crc(handle->dev_handle, altitude, 1);
+    return scd40_execute(handle, SCD40_GET_SENSOR_ALTITUDE, 0, altitude);
 }
 
 esp_err_t scd40_perform_forced_recalibration(scd40_handle_t *handle, uint16_t target_co2, uint16_t *frc_correction)
@@ -468,14 +457,7 @@ esp_err_t scd40_perform_forced_recalibration(scd40_handle_t *handle, uint16_t ta
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command_with_data(handle->dev_handle, SCD40_CMD_PERFORM_FORCED_RECALIBRATION, target_co2);
-    if (ret != ESP_OK) {
-        return ret;
-    }
-
-    vTaskDelay(pdMS_TO_TICKS(SCD40_FRC_DELAY_MS));
-
-    ret = scd40_read_data_with_crc(handle->dev_handle, frc_correction, 1);
+    esp_err_t ret = scd40_execute(handle, SCD40_PERFORM_FORCED_RECALIBRATION, target_co2, frc_correction);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "FRC correction: 0x%04X (target: %d ppm)", *frc_correction, target_co2);
     }
@@ -490,7 +472,7 @@ esp_err_t scd40_set_automatic_self_calibration(scd40_handle_t *handle, bool enab
     }
 
     uint16_t value = enable ? 1 : 0;
-    esp_err_t ret = scd40_send_command_with_data(handle->dev_handle, SCD40_CMD_SET_AUTOMATIC_SELF_CALIBRATION, value);
+    esp_err_t ret = scd40_execute(handle, SCD40_SET_AUTOMATIC_SELF_CALIBRATION, value, NULL);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Automatic self-calibration %s", enable ? "enabled" : "disabled");
     }
@@ -503,15 +485,8 @@ esp_err_t scd40_get_automatic_self_calibration(scd40_handle_t *handle, bool *ena
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command(handle->dev_handle, SCD40_CMD_GET_AUTOMATIC_SELF_CALIBRATION);
-    if (ret != ESP_OK) {
-        return ret;
-    }
-
-    vTaskDelay(pdMS_TO_TICKS(1));
-
     uint16_t value;
-    ret = scd40_read_data_with_crc(handle->dev_handle, &value, 1);
+    esp_err_t ret = scd40_execute(handle, SCD40_GET_AUTOMATIC_SELF_CALIBRATION, 0, &value);
     if (ret == ESP_OK) {
         *enabled = (value != 0);
     }
@@ -525,9 +500,10 @@ esp_err_t scd40_measure_single_shot(scd40_handle_t *handle)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command(handle->dev_handle, SCD40_CMD_MEASURE_SINGLE_SHOT);
+    // The engine's timer covers the 5 s conversion
+    esp_err_t ret = scd40_execute(handle, SCD40_MEASURE_SINGLE_SHOT, 0, NULL);
     if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "Single-shot measurement initiated");
+        ESP_LOGI(TAG, "Single-shot measurement completed");
     }
     return ret;
 }
@@ -538,9 +514,9 @@ esp_err_t scd40_measure_single_shot_rht_only(scd40_handle_t *handle)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command(handle->dev_handle, SCD40_CMD_MEASURE_SINGLE_SHOT_RHT_ONLY);
+    esp_err_t ret = scd40_execute(handle, SCD40_MEASURE_SINGLE_SHOT_RHT_ONLY, 0, NULL);
     if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "Single-shot RH/T measurement initiated");
+        ESP_LOGI(TAG, "Single-shot RH/T measurement completed");
     }
     return ret;
 }
@@ -551,7 +527,7 @@ esp_err_t scd40_power_down(scd40_handle_t *handle)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command(handle->dev_handle, SCD40_CMD_POWER_DOWN);
+    esp_err_t ret = scd40_execute(handle, SCD40_POWER_DOWN, 0, NULL);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Sensor powered down");
     }
@@ -564,9 +540,8 @@ esp_err_t scd40_wake_up(scd40_handle_t *handle)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t ret = scd40_send_command(handle->dev_handle, SCD40_CMD_WAKE_UP);
+    esp_err_t ret = scd40_execute(handle, SCD40_WAKE_UP, 0, NULL);
     if (ret == ESP_OK) {
-        vTaskDelay(pdMS_TO_TICKS(SCD40_WAKE_UP_DELAY_MS));
         ESP_LOGI(TAG, "Sensor woken up");
     }
     return ret;
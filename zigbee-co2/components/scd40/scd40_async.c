@@ -0,0 +1,301 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * SCD40 asynchronous command engine
+ */
+
+#include "scd40_async.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "scd40_async";
+
+#if !CONFIG_IDF_TARGET_LINUX
+static void scd40_async_run(scd40_async_t *engine);
+#endif
+
+static void scd40_async_complete(scd40_async_t *engine, scd40_async_request_t *request, esp_err_t result)
+{
+    portENTER_CRITICAL(&engine->lock);
+    engine->head = request->next;
+    if (engine->head == NULL) {
+        engine->tail = NULL;
+    }
+    engine->phase = SCD40_ASYNC_PHASE_QUEUED;
+    engine->completed++;
+    portEXIT_CRITICAL(&engine->lock);
+
+    request->next = NULL;
+    request->result = result;
+
+    if (result != ESP_OK) {
+        ESP_LOGW(TAG, "%s failed: %s", scd40_command_desc(request->command)->name, esp_err_to_name(result));
+    }
+
+    if (request->callback) {
+        request->callback(request, request->user_ctx);
+    }
+    if (request->event_group) {
+        xEventGroupSetBits(request->event_group, request->done_bits);
+    }
+}
+
+/**
+ * @brief Frame completion from the transport
+ *
+ * On target this runs in the I2C bus task and picks the engine up from there,
+ * unless scd40_async_process() is running and sees the flag itself.
+ */
+static void scd40_async_transfer_done(esp_err_t result, void *arg)
+{
+    scd40_async_t *engine = (scd40_async_t *)arg;
+
+    portENTER_CRITICAL(&engine->lock);
+    engine->transfer_result = result;
+    engine->transfer_done = true;
+#if !CONFIG_IDF_TARGET_LINUX
+    bool kick = !engine->processing;
+    engine->processing = true;
+#endif
+    portEXIT_CRITICAL(&engine->lock);
+
+#if !CONFIG_IDF_TARGET_LINUX
+    if (kick) {
+        scd40_async_run(engine);
+    }
+#endif
+}
+
+/* Put engine->frame on the bus for the given phase */
+static void scd40_async_transfer(scd40_async_t *engine, scd40_async_phase_t phase, size_t len)
+{
+    const scd40_transport_t *transport = engine->transport;
+
+    portENTER_CRITICAL(&engine->lock);
+    engine->phase = phase;
+    engine->transfer_done = false;
+    portEXIT_CRITICAL(&engine->lock);
+
+    esp_err_t ret = transport->submit(transport->ctx, phase == SCD40_ASYNC_PHASE_FETCH, engine->frame, len,
+                                      scd40_async_transfer_done, engine);
+    if (ret != ESP_OK) {
+        scd40_async_transfer_done(ret, engine);
+    }
+}
+
+int64_t scd40_async_process(scd40_async_t *engine, int64_t now_us)
+{
+    while (true) {
+        portENTER_CRITICAL(&engine->lock);
+        scd40_async_request_t *request = engine->head;
+        scd40_async_phase_t phase = engine->phase;
+        bool on_bus = (phase == SCD40_ASYNC_PHASE_SEND || phase == SCD40_ASYNC_PHASE_FETCH) &&
+                      !engine->transfer_done;
+        esp_err_t transfer_result = engine->transfer_result;
+        if (request == NULL || on_bus) {
+            // Checked and released under the lock, so a completion arriving now kicks the engine again
+            engine->processing = false;
+        }
+        portEXIT_CRITICAL(&engine->lock);
+
+        if (request == NULL) {
+            return SCD40_ASYNC_IDLE;
+        }
+        if (on_bus) {
+            return SCD40_ASYNC_TRANSFER;
+        }
+
+        const scd40_command_desc_t *desc = scd40_command_desc(request->command);
+
+        switch (phase) {
+        case SCD40_ASYNC_PHASE_QUEUED:
+            scd40_async_transfer(engine, SCD40_ASYNC_PHASE_SEND,
+                                 sensirion_encode_command(desc->code, &request->arg, desc->tx_words, engine->frame));
+            break;
+
+        case SCD40_ASYNC_PHASE_SEND:
+            // The sensor does not acknowledge some commands by design
+            if (transfer_result != ESP_OK && !desc->no_ack) {
+                scd40_async_complete(engine, request, transfer_result);
+                break;
+            }
+            portENTER_CRITICAL(&engine->lock);
+            engine->deadline_us = now_us + (int64_t)desc->exec_time_ms * 1000;
+            engine->phase = SCD40_ASYNC_PHASE_EXECUTE;
+            portEXIT_CRITICAL(&engine->lock);
+            break;
+
+        case SCD40_ASYNC_PHASE_EXECUTE:
+            if (now_us < engine->deadline_us) {
+                portENTER_CRITICAL(&engine->lock);
+                engine->processing = false;
+                portEXIT_CRITICAL(&engine->lock);
+                return engine->deadline_us;
+            }
+            if (desc->rx_words == 0) {
+                scd40_async_complete(engine, request, ESP_OK);
+            } else {
+                scd40_async_transfer(engine, SCD40_ASYNC_PHASE_FETCH, SENSIRION_READ_FRAME_LEN(desc->rx_words));
+            }
+            break;
+
+        case SCD40_ASYNC_PHASE_FETCH:
+            if (transfer_result == ESP_OK) {
+                transfer_result = sensirion_decode_words(engine->frame, desc->rx_words, request->words);
+            }
+            scd40_async_complete(engine, request, transfer_result);
+            break;
+        }
+    }
+}
+
+#if !CONFIG_IDF_TARGET_LINUX
+/**
+ * @brief Run the engine now and re-arm the timer for its next deadline
+ *
+ * The caller must have claimed engine->processing; scd40_async_process()
+ * releases it before returning. While a frame is on the bus no timer is
+ * needed: its completion runs the engine.
+ */
+static void scd40_async_run(scd40_async_t *engine)
+{
+    int64_t now_us = esp_timer_get_time();
+    int64_t next_us = scd40_async_process(engine, now_us);
+    if (next_us == SCD40_ASYNC_IDLE || next_us == SCD40_ASYNC_TRANSFER) {
+        return;
+    }
+
+    esp_timer_stop(engine->timer);
+    esp_err_t ret = esp_timer_start_once(engine->timer, next_us > now_us ? next_us - now_us : 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to arm timer: %s", esp_err_to_name(ret));
+    }
+}
+
+static void scd40_async_timer_cb(void *arg)
+{
+    scd40_async_t *engine = (scd40_async_t *)arg;
+
+    portENTER_CRITICAL(&engine->lock);
+    bool busy = engine->processing;
+    engine->processing = true;
+    portEXIT_CRITICAL(&engine->lock);
+
+    if (!busy) {
+        scd40_async_run(engine);
+    }
+}
+#endif
+
+esp_err_t scd40_async_init(scd40_async_t *engine, const scd40_transport_t *transport)
+{
+    if (engine == NULL || transport == NULL || transport->submit == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(engine, 0, sizeof(*engine));
+    engine->transport = transport;
+    engine->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+
+#if !CONFIG_IDF_TARGET_LINUX
+    const esp_timer_create_args_t timer_args = {
+        .callback = &scd40_async_timer_cb,
+        .arg = engine,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "scd40_async",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &engine->timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+#endif
+
+    return ESP_OK;
+}
+
+esp_err_t scd40_async_deinit(scd40_async_t *engine)
+{
+    if (engine == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&engine->lock);
+    bool on_bus = (engine->phase == SCD40_ASYNC_PHASE_SEND || engine->phase == SCD40_ASYNC_PHASE_FETCH) &&
+                  !engine->transfer_done;
+    portEXIT_CRITICAL(&engine->lock);
+    if (on_bus) {
+        ESP_LOGE(TAG, "Cannot deinit with a frame on the bus");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+#if !CONFIG_IDF_TARGET_LINUX
+    if (engine->timer) {
+        esp_timer_stop(engine->timer);
+        esp_timer_delete(engine->timer);
+        engine->timer = NULL;
+    }
+#endif
+
+    while (engine->head != NULL) {
+        scd40_async_complete(engine, engine->head, ESP_ERR_INVALID_STATE);
+    }
+
+    return ESP_OK;
+}
+
+void scd40_async_request_init(scd40_async_request_t *request, scd40_command_t command, uint16_t arg)
+{
+    memset(request, 0, sizeof(*request));
+    request->command = command;
+    request->arg = arg;
+    request->result = ESP_ERR_NOT_FINISHED;
+}
+
+esp_err_t scd40_async_submit(scd40_async_t *engine, scd40_async_request_t *request)
+{
+    if (engine == NULL || request == NULL || scd40_command_desc(request->command) == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    request->result = ESP_ERR_NOT_FINISHED;
+    request->next = NULL;
+    if (request->event_group) {
+        xEventGroupClearBits(request->event_group, request->done_bits);
+    }
+
+    portENTER_CRITICAL(&engine->lock);
+    if (engine->tail) {
+        engine->tail->next = request;
+    } else {
+        engine->head = request;
+    }
+    engine->tail = request;
+#if !CONFIG_IDF_TARGET_LINUX
+    // Only kick the engine if nobody is running it; otherwise it picks the request up itself
+    bool kick = !engine->processing;
+    engine->processing = true;
+#endif
+    portEXIT_CRITICAL(&engine->lock);
+
+#if !CONFIG_IDF_TARGET_LINUX
+    if (kick) {
+        scd40_async_run(engine);
+    }
+#endif
+
+    return ESP_OK;
+}
+
+esp_err_t scd40_async_get_measurement(const scd40_async_request_t *request, scd40_measurement_t *measurement)
+{
+    if (request == NULL || measurement == NULL || request->command != SCD40_READ_MEASUREMENT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (request->result != ESP_OK) {
+        return request->result;
+    }
+
+    scd40_decode_measurement(request->words, measurement);
+    return ESP_OK;
+}
@@ -0,0 +1,165 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * SCD40 wire protocol: command table, CRC and framing
+ */
+
+#include "scd40_protocol.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "scd40";
+
+/*
+ * Execution times from the SCD4x datasheet. The sensor NACKs any access
+ * until a command has finished, so callers must not read earlier.
+ */
+static const scd40_command_desc_t s_commands[SCD40_COMMAND_MAX] = {
+    [SCD40_START_PERIODIC_MEASUREMENT]           = { 0x21B1,     0, 0, 0, false, "start_periodic_measurement" },
+    [SCD40_READ_MEASUREMENT]                     = { 0xEC05,     1, 0, 3, false, "read_measurement" },
+    [SCD40_STOP_PERIODIC_MEASUREMENT]            = { 0x3F86,   500, 0, 0, false, "stop_periodic_measurement" },
+    [SCD40_SET_TEMPERATURE_OFFSET]               = { 0x241D,     1, 1, 0, false, "set_temperature_offset" },
+    [SCD40_GET_TEMPERATURE_OFFSET]               = { 0x2318,     1, 0, 1, false, "get_temperature_offset" },
+    [SCD40_SET_SENSOR_ALTITUDE]                  = { 0x2427,     1, 1, 0, false, "set_sensor_altitude" },
+    [SCD40_GET_SENSOR_ALTITUDE]                  = { 0x2322,     1, 0, 1, false, "get_sensor_altitude" },
+    [SCD40_SET_AMBIENT_PRESSURE]                 = { 0xE000,     1, 1, 0, false, "set_ambient_pressure" },
+    [SCD40_PERFORM_FORCED_RECALIBRATION]         = { 0x362F,   400, 1, 1, false, "perform_forced_recalibration" },
+    [SCD40_SET_AUTOMATIC_SELF_CALIBRATION]       = { 0x2416,     1, 1, 0, false, "set_automatic_self_calibration" },
+    [SCD40_GET_AUTOMATIC_SELF_CALIBRATION]       = { 0x2313,     1, 0, 1, false, "get_automatic_self_calibration" },
+    [SCD40_START_LOW_POWER_PERIODIC_MEASUREMENT] = { 0x21AC,     0, 0, 0, false, "start_low_power_periodic_measurement" },
+    [SCD40_GET_DATA_READY_STATUS]                = { 0xE4B8,     1, 0, 1, false, "get_data_ready_status" },
+    [SCD40_PERSIST_SETTINGS]                     = { 0x3615,   800, 0, 0, false, "persist_settings" },
+    [SCD40_GET_SERIAL_NUMBER]                    = { 0x3682,     1, 0, 3, false, "get_serial_number" },
+    [SCD40_PERFORM_SELF_TEST]                    = { 0x3639, 10000, 0, 1, false, "perform_self_test" },
+    [SCD40_PERFORM_FACTORY_RESET]                = { 0x3632,  1200, 0, 0, false, "perform_factory_reset" },
+    [SCD40_REINIT]                               = { 0x3646,    20, 0, 0, false, "reinit" },
+    [SCD40_MEASURE_SINGLE_SHOT]                  = { 0x219D,  5000, 0, 0, false, "measure_single_shot" },
+    [SCD40_MEASURE_SINGLE_SHOT_RHT_ONLY]         = { 0x2196,    50, 0, 0, false, "measure_single_shot_rht_only" },
+    [SCD40_POWER_DOWN]                           = { 0x36E0,     1, 0, 0, false, "power_down" },
+    [SCD40_WAKE_UP]                              = { 0x36F6,    20, 0, 0, true,  "wake_up" },
+    [SCD40_GET_SENSOR_VARIANT]                   = { 0x202F,     1, 0, 1, false, "get_sensor_variant" },
+};
+
+const scd40_command_desc_t *scd40_command_desc(scd40_command_t command)
+{
+    if ((unsigned)command >= SCD40_COMMAND_MAX) {
+        return NULL;
+    }
+    return &s_commands[command];
+}
+
+esp_err_t scd40_command_issue(const scd40_transport_t *transport, scd40_command_t command, uint16_t arg)
+{
+    const scd40_command_desc_t *desc = scd40_command_desc(command);
+    if (transport == NULL || desc == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = sensirion_write_words(transport, desc->code, &arg, desc->tx_words);
+    if (ret != ESP_OK) {
+        if (desc->no_ack) {
+            // The sensor does not acknowledge this command by design
+            return ESP_OK;
+        }
+        ESP_LOGE(TAG, "Failed to send command 0x%04X (%s): %s", desc->code, desc->name, esp_err_to_name(ret));
+    }
+
+    return ret;
+}
+
+esp_err_t scd40_command_fetch(const scd40_transport_t *transport, uint16_t *words, size_t num_words)
+{
+    if (transport == NULL || words == NULL || num_words == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return sensirion_read_words(transport, words, num_words);
+}
+
+scd40_variant_t scd40_decode_variant(uint16_t word)
+{
+    switch (word >> 12) {
+    case 0x0:
+        return SCD4X_VARIANT_SCD40;
+    case 0x1:
+        return SCD4X_VARIANT_SCD41;
+    case 0x5:
+        return SCD4X_VARIANT_SCD43;
+    default:
+        return SCD4X_VARIANT_UNKNOWN;
+    }
+}
+
+bool scd40_variant_has_single_shot(scd40_variant_t variant)
+{
+    return variant == SCD4X_VARIANT_SCD41 || variant == SCD4X_VARIANT_SCD43;
+}
+
+const char *scd40_variant_name(scd40_variant_t variant)
+{
+    switch (variant) {
+    case SCD4X_VARIANT_SCD40:
+        return "SCD40";
+    case SCD4X_VARIANT_SCD41:
+        return "SCD41";
+    case SCD4X_VARIANT_SCD43:
+        return "SCD43";
+    default:
+        return "unknown";
+    }
+}
+
+void scd40_decode_measurement(const uint16_t words[3], scd40_measurement_t *measurement)
+{
+    // Convert raw values according to SCD40 datasheet
+    measurement->co2_ppm = words[0];
+    measurement->temperature = scd40_temperature_from_raw(words[1]);
+
+    // Check for invalid humidity reading (0xFFFF indicates sensor error or unavailable data)
+    // This happens when using single-shot mode on SCD41 without RHT measurement
+    if (words[2] == SCD40_HUMIDITY_RAW_INVALID) {
+        ESP_LOGW(TAG, "Humidity data unavailable (0xFFFF) - sensor may need RHT single-shot measurement");
+        measurement->humidity = 0; // Set to 0 to indicate invalid
+    } else {
+        measurement->humidity = scd40_humidity_from_raw(words[2]);
+    }
+}
+
+/* ZCL CO2 fraction and IEEE 754 single-precision layout */
+#define CO2_FRACTION_DIVISOR        1000000ULL
+#define FLOAT_MANTISSA_BITS         23
+#define FLOAT_EXPONENT_BIAS         127
+
+uint32_t scd40_co2_fraction_bits(uint16_t co2_ppm)
+{
+    if (co2_ppm == 0) {
+        return 0;
+    }
+
+    // Scale ppm by 2^shift so the quotient has exactly 24 significant bits
+    const uint64_t lower = CO2_FRACTION_DIVISOR << FLOAT_MANTISSA_BITS;
+    int shift = __builtin_clzll(co2_ppm) - __builtin_clzll(lower);
+    uint64_t numerator = (uint64_t)co2_ppm << shift;
+    if (numerator < lower) {
+        numerator <<= 1;
+        shift++;
+    }
+
+    // One 64-bit division (__udivdi3 on RV32); the remainder follows from it
+    uint64_t mantissa = numerator / CO2_FRACTION_DIVISOR;
+    uint64_t twice_remainder = (numerator - mantissa * CO2_FRACTION_DIVISOR) * 2;
+
+    // Round to nearest, ties to even
+    if (twice_remainder > CO2_FRACTION_DIVISOR ||
+        (twice_remainder == CO2_FRACTION_DIVISOR && (mantissa & 1))) {
+        mantissa++;
+        if (mantissa >> (FLOAT_MANTISSA_BITS + 1)) {
+            mantissa >>= 1;
+            shift--;
+        }
+    }
+
+    // value = mantissa * 2^-shift, mantissa in [2^23, 2^24)
+    uint32_t exponent = FLOAT_EXPONENT_BIAS + FLOAT_MANTISSA_BITS - shift;
+    return (exponent << FLOAT_MANTISSA_BITS) | ((uint32_t)mantissa & ((1UL << FLOAT_MANTISSA_BITS) - 1));
+}
@@ -0,0 +1,367 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Simulated SCD40 on a fake I2C bus
+ */
+
+#include "scd40_fake_bus.h"
+#include <string.h>
+
+/* Conversion times of the simulated sensor (microseconds) */
+#define FAKE_PERIODIC_INTERVAL_US               5000000LL
+#define FAKE_LOW_POWER_PERIODIC_INTERVAL_US     30000000LL
+#define FAKE_SINGLE_SHOT_US                     5000000LL
+#define FAKE_SINGLE_SHOT_RHT_US                 50000LL
+
+/* Data ready status words: lower 11 bits non-zero when a sample is available */
+#define FAKE_STATUS_READY                       0x8006
+#define FAKE_STATUS_NOT_READY                   0x8000
+
+/* I2C NACK as seen by the driver */
+#define FAKE_NACK                               ESP_FAIL
+
+static scd40_command_t fake_lookup(uint16_t code)
+{
+    for (int i = 0; i < SCD40_COMMAND_MAX; i++) {
+        if (scd40_command_desc((scd40_command_t)i)->code == code) {
+            return (scd40_command_t)i;
+        }
+    }
+    return SCD40_COMMAND_MAX;
+}
+
+static bool fake_supported(const scd40_fake_bus_t *bus, scd40_command_t command)
+{
+    switch (command) {
+    case SCD40_MEASURE_SINGLE_SHOT:
+    case SCD40_MEASURE_SINGLE_SHOT_RHT_ONLY:
+        return scd40_variant_has_single_shot(bus->variant);
+    case SCD40_GET_SENSOR_VARIANT:
+        return bus->variant_command;
+    default:
+        return true;
+    }
+}
+
+static uint32_t fake_mode_current_na(const scd40_fake_bus_t *bus)
+{
+    switch (bus->mode) {
+    case SCD40_FAKE_MODE_PERIODIC:
+        return bus->model.periodic_na;
+    case SCD40_FAKE_MODE_LOW_POWER_PERIODIC:
+        return bus->model.low_power_na;
+    case SCD40_FAKE_MODE_SLEEP:
+        return bus->model.power_down_na;
+    default:
+        return bus->model.idle_na;
+    }
+}
+
+/* Integrate the sensor current from bus->now_us to until_us */
+static void fake_account(scd40_fake_bus_t *bus, int64_t until_us)
+{
+    int64_t from_us = bus->now_us;
+
+    if (bus->converting_until_us > from_us) {
+        int64_t end_us = bus->converting_until_us < until_us ? bus->converting_until_us : until_us;
+        bus->stats.charge_pc += (uint64_t)bus->model.conversion_na * (end_us - from_us) / 1000;
+        from_us = end_us;
+    }
+    bus->stats.charge_pc += (uint64_t)fake_mode_current_na(bus) * (until_us - from_us) / 1000;
+}
+
+static bool fake_allowed_while_periodic(scd40_command_t command)
+{
+    switch (command) {
+    case SCD40_READ_MEASUREMENT:
+    case SCD40_GET_DATA_READY_STATUS:
+    case SCD40_STOP_PERIODIC_MEASUREMENT:
+    case SCD40_SET_AMBIENT_PRESSURE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void fake_respond(scd40_fake_bus_t *bus, const uint16_t *words, uint8_t count)
+{
+    memcpy(bus->response, words, count * sizeof(uint16_t));
+    bus->response_words = count;
+}
+
+static esp_err_t fake_nack(scd40_fake_bus_t *bus)
+{
+    bus->stats.nacks++;
+    return FAKE_NACK;
+}
+
+static esp_err_t fake_transmit(void *ctx, const uint8_t *data, size_t len)
+{
+    scd40_fake_bus_t *bus = (scd40_fake_bus_t *)ctx;
+    bus->stats.transmits++;
+
+    if (len < 2) {
+        return fake_nack(bus);
+    }
+
+    scd40_command_t command = fake_lookup((data[0] << 8) | data[1]);
+
+    if (bus->mode == SCD40_FAKE_MODE_SLEEP) {
+        // Only wake_up is understood in sleep, and it is never acknowledged
+        if (command == SCD40_WAKE_UP) {
+            bus->mode = SCD40_FAKE_MODE_IDLE;
+            bus->busy_until_us = bus->now_us + (int64_t)scd40_command_desc(command)->exec_time_ms * 1000;
+        }
+        return fake_nack(bus);
+    }
+
+    if (bus->now_us < bus->busy_until_us || command == SCD40_COMMAND_MAX || !fake_supported(bus, command)) {
+        return fake_nack(bus);
+    }
+
+    const scd40_command_desc_t *desc = scd40_command_desc(command);
+    if (len != 2 + desc->tx_words * 3u) {
+        return fake_nack(bus);
+    }
+
+    uint16_t arg = 0;
+    if (desc->tx_words) {
+        if (sensirion_crc8(&data[2], 2) != data[4]) {
+            return fake_nack(bus);
+        }
+        arg = (data[2] << 8) | data[3];
+    }
+
+    bool periodic = bus->mode == SCD40_FAKE_MODE_PERIODIC || bus->mode == SCD40_FAKE_MODE_LOW_POWER_PERIODIC;
+    if (periodic && !fake_allowed_while_periodic(command)) {
+        return fake_nack(bus);
+    }
+
+    bus->response_words = 0;
+    uint16_t words[SCD40_MAX_RX_WORDS] = {0};
+
+    switch (command) {
+    case SCD40_START_PERIODIC_MEASUREMENT:
+        bus->rht_only = false;
+        bus->mode = SCD40_FAKE_MODE_PERIODIC;
+        bus->next_sample_us = bus->now_us + FAKE_PERIODIC_INTERVAL_US;
+        break;
+    case SCD40_START_LOW_POWER_PERIODIC_MEASUREMENT:
+        bus->rht_only = false;
+        bus->mode = SCD40_FAKE_MODE_LOW_POWER_PERIODIC;
+        bus->next_sample_us = bus->now_us + FAKE_LOW_POWER_PERIODIC_INTERVAL_US;
+        break;
+    case SCD40_STOP_PERIODIC_MEASUREMENT:
+        bus->mode = SCD40_FAKE_MODE_IDLE;
+        bus->next_sample_us = INT64_MAX;
+        break;
+    case SCD40_READ_MEASUREMENT:
+        if (!bus->data_ready) {
+            // No new sample: the read phase will be NACKed
+            break;
+        }
+        fake_respond(bus, bus->sample, 3);
+        if (bus->rht_only) {
+            bus->response[0] = 0;
+        }
+        bus->data_ready = false;
+        break;
+    case SCD40_GET_DATA_READY_STATUS:
+        words[0] = bus->data_ready ? FAKE_STATUS_READY : FAKE_STATUS_NOT_READY;
+        fake_respond(bus, words, 1);
+        break;
+    case SCD40_MEASURE_SINGLE_SHOT:
+        bus->next_sample_us = bus->now_us + FAKE_SINGLE_SHOT_US;
+        bus->converting_until_us = bus->next_sample_us;
+        bus->rht_only = false;
+        break;
+    case SCD40_MEASURE_SINGLE_SHOT_RHT_ONLY:
+        bus->next_sample_us = bus->now_us + FAKE_SINGLE_SHOT_RHT_US;
+        bus->converting_until_us = bus->next_sample_us;
+        bus->rht_only = true;
+        break;
+    case SCD40_GET_SENSOR_VARIANT:
+        words[0] = bus->variant == SCD4X_VARIANT_SCD43 ? 0x5000 :
+                   bus->variant == SCD4X_VARIANT_SCD41 ? 0x1000 : 0x0000;
+        fake_respond(bus, words, 1);
+        break;
+    case SCD40_GET_SERIAL_NUMBER:
+        words[0] = (bus->serial >> 32) & 0xFFFF;
+        words[1] = (bus->serial >> 16) & 0xFFFF;
+        words[2] = bus->serial & 0xFFFF;
+        fake_respond(bus, words, 3);
+        break;
+    case SCD40_SET_TEMPERATURE_OFFSET:
+        bus->temperature_offset = arg;
+        break;
+    case SCD40_GET_TEMPERATURE_OFFSET:
+        fake_respond(bus, &bus->temperature_offset, 1);
+        break;
+    case SCD40_SET_SENSOR_ALTITUDE:
+        bus->altitude = arg;
+        break;
+    case SCD40_GET_SENSOR_ALTITUDE:
+        fake_respond(bus, &bus->altitude, 1);
+        break;
+    case SCD40_SET_AMBIENT_PRESSURE:
+        bus->ambient_pressure = arg;
+        break;
+    case SCD40_SET_AUTOMATIC_SELF_CALIBRATION:
+        bus->asc_enabled = arg != 0;
+        break;
+    case SCD40_GET_AUTOMATIC_SELF_CALIBRATION:
+        words[0] = bus->asc_enabled ? 1 : 0;
+        fake_respond(bus, words, 1);
+        break;
+    case SCD40_PERFORM_FORCED_RECALIBRATION:
+        // Correction is reported with a 0x8000 offset
+        words[0] = (uint16_t)(0x8000 + arg - bus->sample[0]);
+        fake_respond(bus, words, 1);
+        break;
+    case SCD40_PERFORM_SELF_TEST:
+        words[0] = 0; // No malfunction
+        fake_respond(bus, words, 1);
+        break;
+    case SCD40_PERSIST_SETTINGS:
+        bus->stats.eeprom_writes++;
+        break;
+    case SCD40_PERFORM_FACTORY_RESET:
+        bus->temperature_offset = 0;
+        bus->altitude = 0;
+        bus->asc_enabled = true;
+        bus->stats.eeprom_writes++;
+        break;
+    case SCD40_POWER_DOWN:
+        bus->mode = SCD40_FAKE_MODE_SLEEP;
+        bus->data_ready = false;
+        bus->next_sample_us = INT64_MAX;
+        break;
+    case SCD40_WAKE_UP:
+        // Already awake: still not acknowledged
+        return fake_nack(bus);
+    case SCD40_REINIT:
+    default:
+        break;
+    }
+
+    bus->busy_until_us = bus->now_us + (int64_t)desc->exec_time_ms * 1000;
+    bus->stats.bytes += len;
+    return ESP_OK;
+}
+
+static esp_err_t fake_receive(void *ctx, uint8_t *data, size_t len)
+{
+    scd40_fake_bus_t *bus = (scd40_fake_bus_t *)ctx;
+    bus->stats.receives++;
+
+    if (bus->now_us < bus->busy_until_us || bus->response_words == 0 || len > bus->response_words * 3u) {
+        return fake_nack(bus);
+    }
+
+    sensirion_encode_words(bus->response, len / SENSIRION_WORD_SIZE, data);
+    if (bus->corrupt_next_crc && len >= 3) {
+        data[2] ^= 0xFF;
+        bus->corrupt_next_crc = false;
+    }
+
+    bus->response_words = 0;
+    bus->stats.bytes += len;
+    return ESP_OK;
+}
+
+static esp_err_t fake_submit(void *ctx, bool read, uint8_t *data, size_t len, sensirion_done_cb_t done, void *arg)
+{
+    scd40_fake_bus_t *bus = (scd40_fake_bus_t *)ctx;
+
+    if (bus->submitted.pending) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    bus->submitted.read = read;
+    bus->submitted.data = data;
+    bus->submitted.len = len;
+    bus->submitted.done = done;
+    bus->submitted.arg = arg;
+    bus->submitted.pending = true;
+
+    if (!bus->hold_submitted) {
+        scd40_fake_bus_complete(bus);
+    }
+    return ESP_OK;
+}
+
+bool scd40_fake_bus_complete(scd40_fake_bus_t *bus)
+{
+    if (!bus->submitted.pending) {
+        return false;
+    }
+
+    // Cleared first: done may submit the next frame
+    bus->submitted.pending = false;
+    esp_err_t ret = bus->submitted.read ?
+                    fake_receive(bus, bus->submitted.data, bus->submitted.len) :
+                    fake_transmit(bus, bus->submitted.data, bus->submitted.len);
+    bus->submitted.done(ret, bus->submitted.arg);
+    return true;
+}
+
+void scd40_fake_bus_init(scd40_fake_bus_t *bus)
+{
+    memset(bus, 0, sizeof(*bus));
+    bus->mode = SCD40_FAKE_MODE_IDLE;
+    bus->next_sample_us = INT64_MAX;
+    bus->serial = 0xB15D8D3B7F21ULL;
+    bus->asc_enabled = true;
+    bus->variant = SCD4X_VARIANT_SCD41;
+    bus->variant_command = true;
+    bus->model = (scd40_energy_model_t)SCD40_ENERGY_MODEL_DEFAULT();
+    // 600 ppm, ~21 °C, ~45 %RH
+    scd40_fake_bus_set_sample(bus, 600, 24342, 29491);
+    bus->transport = (scd40_transport_t) {
+        .transmit = fake_transmit,
+        .receive = fake_receive,
+        .submit = fake_submit,
+        .ctx = bus,
+    };
+}
+
+const scd40_transport_t *scd40_fake_bus_transport(scd40_fake_bus_t *bus)
+{
+    return &bus->transport;
+}
+
+void scd40_fake_bus_set_time(scd40_fake_bus_t *bus, int64_t now_us)
+{
+    if (now_us < bus->now_us) {
+        return;
+    }
+    fake_account(bus, now_us);
+    bus->now_us = now_us;
+
+    if (now_us < bus->next_sample_us) {
+        return;
+    }
+
+    bus->data_ready = true;
+    switch (bus->mode) {
+    case SCD40_FAKE_MODE_PERIODIC:
+        while (bus->next_sample_us <= now_us) {
+            bus->next_sample_us += FAKE_PERIODIC_INTERVAL_US;
+        }
+        break;
+    case SCD40_FAKE_MODE_LOW_POWER_PERIODIC:
+        while (bus->next_sample_us <= now_us) {
+            bus->next_sample_us += FAKE_LOW_POWER_PERIODIC_INTERVAL_US;
+        }
+        break;
+    default:
+        bus->next_sample_us = INT64_MAX;
+        break;
+    }
+}
+
+void scd40_fake_bus_set_sample(scd40_fake_bus_t *bus, uint16_t co2_ppm, uint16_t temperature_raw, uint16_t humidity_raw)
+{
+    bus->sample[0] = co2_ppm;
+    bus->sample[1] = temperature_raw;
+    bus->sample[2] = humidity_raw;
+}
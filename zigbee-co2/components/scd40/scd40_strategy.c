@@ -0,0 +1,115 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * SCD4x measurement strategies and their energy cost
+ */
+
+#include "scd40_strategy.h"
+
+/* First sample after start_periodic_measurement, and single-shot conversion times */
+#define PERIODIC_FIRST_SAMPLE_MS                    5000
+#define SINGLE_SHOT_MS                              5000
+#define SINGLE_SHOT_RHT_MS                          50
+
+/* nA * ms is pC */
+static uint64_t charge_pc(uint32_t current_na, uint64_t time_ms)
+{
+    return (uint64_t)current_na * time_ms;
+}
+
+bool scd40_strategy_supported(scd40_variant_t variant, scd40_strategy_t strategy)
+{
+    switch (strategy) {
+    case SCD40_STRATEGY_PERIODIC:
+    case SCD40_STRATEGY_LOW_POWER_PERIODIC:
+        return true;
+    case SCD40_STRATEGY_SINGLE_SHOT:
+    case SCD40_STRATEGY_SINGLE_SHOT_RHT_ONLY:
+        return scd40_variant_has_single_shot(variant);
+    default:
+        return false;
+    }
+}
+
+bool scd40_strategy_measures_co2(scd40_strategy_t strategy)
+{
+    return strategy != SCD40_STRATEGY_SINGLE_SHOT_RHT_ONLY;
+}
+
+uint32_t scd40_strategy_wait_ms(scd40_strategy_t strategy)
+{
+    switch (strategy) {
+    case SCD40_STRATEGY_PERIODIC:
+        return PERIODIC_FIRST_SAMPLE_MS;
+    case SCD40_STRATEGY_SINGLE_SHOT:
+        return SINGLE_SHOT_MS;
+    case SCD40_STRATEGY_SINGLE_SHOT_RHT_ONLY:
+        return SINGLE_SHOT_RHT_MS;
+    default:
+        return 0;
+    }
+}
+
+uint32_t scd40_strategy_charge_uc(const scd40_energy_model_t *model, scd40_strategy_t strategy, uint32_t interval_s)
+{
+    uint64_t interval_ms = (uint64_t)interval_s * 1000;
+    uint64_t active_ms = scd40_strategy_wait_ms(strategy);
+    uint64_t rest_ms = interval_ms > active_ms ? interval_ms - active_ms : 0;
+    uint64_t pc = charge_pc(model->host_wait_na, active_ms);
+
+    switch (strategy) {
+    case SCD40_STRATEGY_PERIODIC:
+        pc += charge_pc(model->periodic_na, active_ms) + charge_pc(model->power_down_na, rest_ms);
+        break;
+    case SCD40_STRATEGY_LOW_POWER_PERIODIC:
+        pc += charge_pc(model->low_power_na, interval_ms);
+        break;
+    case SCD40_STRATEGY_SINGLE_SHOT:
+    case SCD40_STRATEGY_SINGLE_SHOT_RHT_ONLY:
+        pc += charge_pc(model->conversion_na, active_ms) + charge_pc(model->idle_na, rest_ms);
+        break;
+    default:
+        return UINT32_MAX;
+    }
+
+    uint64_t uc = pc / 1000000;
+    return uc > UINT32_MAX ? UINT32_MAX : (uint32_t)uc;
+}
+
+scd40_strategy_t scd40_strategy_select(const scd40_energy_model_t *model, scd40_variant_t variant,
+                                       uint32_t interval_s, bool co2_needed)
+{
+    scd40_strategy_t best = SCD40_STRATEGY_PERIODIC;
+    uint32_t best_uc = UINT32_MAX;
+
+    for (int i = 0; i < SCD40_STRATEGY_MAX; i++) {
+        scd40_strategy_t strategy = (scd40_strategy_t)i;
+        if (!scd40_strategy_supported(variant, strategy) ||
+            (co2_needed && !scd40_strategy_measures_co2(strategy))) {
+            continue;
+        }
+        uint32_t uc = scd40_strategy_charge_uc(model, strategy, interval_s);
+        if (uc < best_uc) {
+            best = strategy;
+            best_uc = uc;
+        }
+    }
+
+    return best;
+}
+
+const char *scd40_strategy_name(scd40_strategy_t strategy)
+{
+    switch (strategy) {
+    case SCD40_STRATEGY_PERIODIC:
+        return "periodic";
+    case SCD40_STRATEGY_LOW_POWER_PERIODIC:
+        return "low-power periodic";
+    case SCD40_STRATEGY_SINGLE_SHOT:
+        return "single shot";
+    case SCD40_STRATEGY_SINGLE_SHOT_RHT_ONLY:
+        return "single shot RH/T";
+    default:
+        return "unknown";
+    }
+}
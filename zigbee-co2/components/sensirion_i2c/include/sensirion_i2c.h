@@ -0,0 +1,179 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Sensirion I2C word transport
+ *
+ * Sensirion sensors (SCD4x, SCD30, SEN5x, SHT4x, ...) share the same framing:
+ * a 16-bit big-endian command, followed by or answered with 16-bit words,
+ * each word followed by a CRC-8 (poly 0x31, init 0xFF). This component
+ * implements that framing once, on top of a byte-level transport, so sensor
+ * drivers only describe their command set.
+ *
+ * The CRC is table driven (256-byte table in flash), one lookup per byte
+ * instead of eight shift/xor steps. Reads and writes of any number of words
+ * go out as a single I2C transaction, as the sensors require.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Words per frame handled by the stack-buffered helpers
+ */
+#define SENSIRION_I2C_MAX_WORDS         CONFIG_SENSIRION_I2C_MAX_WORDS
+
+/**
+ * @brief Bytes on the wire for one data word (2 data bytes + CRC)
+ */
+#define SENSIRION_WORD_SIZE             3
+
+/**
+ * @brief Bytes on the wire for a command code
+ */
+#define SENSIRION_COMMAND_SIZE          2
+
+/**
+ * @brief Wire size of a read of num_words words
+ */
+#define SENSIRION_READ_FRAME_LEN(num_words)     ((num_words) * SENSIRION_WORD_SIZE)
+
+/**
+ * @brief Wire size of a command followed by num_words argument words
+ */
+#define SENSIRION_WRITE_FRAME_LEN(num_words)    (SENSIRION_COMMAND_SIZE + (num_words) * SENSIRION_WORD_SIZE)
+
+/**
+ * @brief Completion of a frame queued with sensirion_transport_t.submit
+ *
+ * @param result ESP_OK, or the transport error (a NACK included)
+ * @param arg Argument given to submit
+ */
+typedef void (*sensirion_done_cb_t)(esp_err_t result, void *arg);
+
+/**
+ * @brief Byte-level transport used to reach a sensor
+ *
+ * Each callback moves exactly one I2C frame (START ... STOP). transmit and
+ * receive block until the frame is done. submit queues a frame and returns,
+ * for callers that must not block (timer callbacks): done runs once the
+ * frame is done, possibly before submit returns, and not at all if submit
+ * fails. At most one submitted frame is in flight per transport, and its
+ * data must stay valid until done.
+ */
+typedef struct {
+    esp_err_t (*transmit)(void *ctx, const uint8_t *data, size_t len); /**< Write one I2C frame */
+    esp_err_t (*receive)(void *ctx, uint8_t *data, size_t len);        /**< Read one I2C frame */
+    esp_err_t (*submit)(void *ctx, bool read, uint8_t *data, size_t len,
+                        sensirion_done_cb_t done, void *arg);           /**< Queue a write (read false) or read frame */
+    void *ctx;                                                          /**< Passed to all callbacks */
+} sensirion_transport_t;
+
+/**
+ * @brief CRC-8 used by Sensirion sensors (poly 0x31, init 0xFF)
+ *
+ * @param data Bytes to checksum
+ * @param len Number of bytes
+ * @return CRC over data
+ */
+uint8_t sensirion_crc8(const uint8_t *data, size_t len);
+
+/**
+ * @brief Frame words for the wire: big-endian data bytes, each pair followed by its CRC
+ *
+ * @param words Words to encode
+ * @param num_words Number of words
+ * @param frame Output, SENSIRION_READ_FRAME_LEN(num_words) bytes
+ */
+void sensirion_encode_words(const uint16_t *words, size_t num_words, uint8_t *frame);
+
+/**
+ * @brief Check the CRC of every word in a received frame and extract the words
+ *
+ * words may alias frame: the words are compacted in place at the start of
+ * the buffer.
+ *
+ * @param frame Received frame, SENSIRION_READ_FRAME_LEN(num_words) bytes
+ * @param num_words Number of words in the frame
+ * @param words Output words
+ * @return
+ *     - ESP_OK if all CRCs match
+ *     - ESP_ERR_INVALID_CRC on the first mismatch (words before it are valid)
+ */
+esp_err_t sensirion_decode_words(const uint8_t *frame, size_t num_words, uint16_t *words);
+
+/**
+ * @brief Build the frame of a command and its argument words
+ *
+ * For transports used through submit, where the frame has to outlive the call.
+ *
+ * @param command 16-bit command code
+ * @param words Argument words (may be NULL if num_words is 0)
+ * @param num_words Number of argument words
+ * @param frame Output, SENSIRION_WRITE_FRAME_LEN(num_words) bytes
+ * @return Frame length in bytes
+ */
+size_t sensirion_encode_command(uint16_t command, const uint16_t *words, size_t num_words, uint8_t *frame);
+
+/**
+ * @brief Send a command and its argument words in one I2C transaction
+ *
+ * @param transport Transport to use
+ * @param command 16-bit command code
+ * @param words Argument words (may be NULL if num_words is 0)
+ * @param num_words Number of argument words, at most SENSIRION_I2C_MAX_WORDS
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if arguments are invalid
+ *     - ESP_ERR_INVALID_SIZE if num_words exceeds SENSIRION_I2C_MAX_WORDS
+ *     - Transport error otherwise
+ */
+esp_err_t sensirion_write_words(const sensirion_transport_t *transport, uint16_t command,
+                                const uint16_t *words, size_t num_words);
+
+/**
+ * @brief sensirion_write_words() with a caller-provided frame buffer, for any length
+ *
+ * @param frame Scratch buffer of SENSIRION_WRITE_FRAME_LEN(num_words) bytes
+ */
+esp_err_t sensirion_write_words_buf(const sensirion_transport_t *transport, uint16_t command,
+                                    const uint16_t *words, size_t num_words, uint8_t *frame);
+
+/**
+ * @brief Read and CRC-check num_words words in one I2C transaction
+ *
+ * @param transport Transport to use
+ * @param words Output words
+ * @param num_words Number of words, at most SENSIRION_I2C_MAX_WORDS
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if arguments are invalid
+ *     - ESP_ERR_INVALID_SIZE if num_words exceeds SENSIRION_I2C_MAX_WORDS
+ *     - ESP_ERR_INVALID_CRC on CRC validation failure
+ *     - Transport error otherwise
+ */
+esp_err_t sensirion_read_words(const sensirion_transport_t *transport, uint16_t *words, size_t num_words);
+
+/**
+ * @brief sensirion_read_words() with a caller-provided frame buffer, for any length
+ *
+ * The frame is received into the buffer and the words are extracted from it,
+ * so frame may be the words array itself when it is large enough, e.g.
+ * (uint8_t *)words with room for SENSIRION_READ_FRAME_LEN(num_words) bytes.
+ *
+ * @param frame Scratch buffer of SENSIRION_READ_FRAME_LEN(num_words) bytes
+ */
+esp_err_t sensirion_read_words_buf(const sensirion_transport_t *transport, uint16_t *words,
+                                   size_t num_words, uint8_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
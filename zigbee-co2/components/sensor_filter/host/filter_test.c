@@ -0,0 +1,182 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host unit tests for the streaming sensor filter
+ *
+ * Compile and run from the component directory:
+ *
+ *   cc -O2 -I../../../components/host_test -Iinclude -I<stubs> -DCONFIG_SENSOR_FILTER_WINDOW_MAX=5 \
+ *      host/filter_test.c sensor_filter.c -o filter_test && ./filter_test
+ *
+ * <stubs> only needs an empty sdkconfig.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sensor_filter.h"
+#include "host_test.h"
+
+static const sensor_filter_config_t s_passthrough = { .outlier = SENSOR_FILTER_OUTLIER_NONE };
+
+static void test_passthrough(void)
+{
+    sensor_filter_state_t state = { 0 };
+    static const int32_t input[] = { 400, -5, 40000, 0, 123 };
+
+    for (size_t i = 0; i < sizeof(input) / sizeof(input[0]); i++) {
+        CHECK_EQ(sensor_filter_update(&s_passthrough, &state, input[i], NULL), input[i]);
+    }
+}
+
+static void test_ema(void)
+{
+    const sensor_filter_config_t config = { .outlier = SENSOR_FILTER_OUTLIER_NONE, .ema_shift = 1 };
+    sensor_filter_state_t state = { 0 };
+
+    // First sample primes the average
+    CHECK_EQ(sensor_filter_update(&config, &state, 1000, NULL), 1000);
+    // Half way each step, halves round up
+    CHECK_EQ(sensor_filter_update(&config, &state, 1001, NULL), 1001);
+    CHECK_EQ(sensor_filter_update(&config, &state, 2000, NULL), 1500);
+    CHECK_EQ(sensor_filter_update(&config, &state, 2000, NULL), 1750);
+
+    // Converges to a constant input, also below zero
+    for (int i = 0; i < 40; i++) {
+        sensor_filter_update(&config, &state, -2500, NULL);
+    }
+    CHECK_EQ(sensor_filter_update(&config, &state, -2500, NULL), -2500);
+}
+
+static void test_median(void)
+{
+    const sensor_filter_config_t config = { .outlier = SENSOR_FILTER_OUTLIER_MEDIAN, .window = 3 };
+    sensor_filter_state_t state = { 0 };
+
+    CHECK_EQ(sensor_filter_update(&config, &state, 500, NULL), 500);
+    // Two samples: midpoint
+    CHECK_EQ(sensor_filter_update(&config, &state, 510, NULL), 505);
+    // A single spike never gets through a median of three
+    CHECK_EQ(sensor_filter_update(&config, &state, 5000, NULL), 510);
+    CHECK_EQ(sensor_filter_update(&config, &state, 520, NULL), 520);
+    CHECK_EQ(sensor_filter_update(&config, &state, 530, NULL), 530);
+    // Even count with negative values rounds down
+    sensor_filter_reset(&state);
+    sensor_filter_update(&config, &state, -3, NULL);
+    CHECK_EQ(sensor_filter_update(&config, &state, -2, NULL), -3);
+}
+
+static void test_hampel(void)
+{
+    const sensor_filter_config_t config = {
+        .outlier = SENSOR_FILTER_OUTLIER_HAMPEL,
+        .window = 5,
+        .hampel_k_x8 = 24,
+        .hampel_min_dev = 50,
+    };
+    sensor_filter_state_t state = { 0 };
+    static const int32_t noisy[] = { 600, 610, 590, 605, 595 };
+    bool rejected;
+
+    // Too little history: everything passes
+    CHECK_EQ(sensor_filter_update(&config, &state, 600, &rejected), 600);
+    CHECK_EQ(sensor_filter_update(&config, &state, 3000, &rejected), 3000);
+    CHECK_EQ(rejected, false);
+
+    sensor_filter_reset(&state);
+    for (size_t i = 0; i < sizeof(noisy) / sizeof(noisy[0]); i++) {
+        CHECK_EQ(sensor_filter_update(&config, &state, noisy[i], &rejected), noisy[i]);
+        CHECK_EQ(rejected, false);
+    }
+
+    // A spike is replaced by the median of the window...
+    CHECK_EQ(sensor_filter_update(&config, &state, 2000, &rejected), 600);
+    CHECK_EQ(rejected, true);
+    // ...normal noise within the MAD band passes unchanged
+    CHECK_EQ(sensor_filter_update(&config, &state, 620, &rejected), 620);
+    CHECK_EQ(rejected, false);
+
+    // A real step is accepted once it holds the majority of the window
+    int32_t out = 0;
+    int steps = 0;
+    while (out != 1200 && steps < 10) {
+        out = sensor_filter_update(&config, &state, 1200, &rejected);
+        steps++;
+    }
+    CHECK_EQ(out, 1200);
+    CHECK_EQ(steps, 3);
+}
+
+static void test_hampel_flat(void)
+{
+    const sensor_filter_config_t config = {
+        .outlier = SENSOR_FILTER_OUTLIER_HAMPEL,
+        .window = 5,
+        .hampel_k_x8 = 24,
+        .hampel_min_dev = 30,
+    };
+    sensor_filter_state_t state = { 0 };
+    bool rejected;
+
+    // Identical samples give a MAD of zero; the floor still lets small changes through
+    for (int i = 0; i < 5; i++) {
+        sensor_filter_update(&config, &state, 2150, NULL);
+    }
+    CHECK_EQ(sensor_filter_update(&config, &state, 2180, &rejected), 2180);
+    CHECK_EQ(rejected, false);
+    CHECK_EQ(sensor_filter_update(&config, &state, 2181 + 30, &rejected), 2150);
+    CHECK_EQ(rejected, true);
+}
+
+static void test_hampel_then_ema(void)
+{
+    const sensor_filter_config_t config = {
+        .outlier = SENSOR_FILTER_OUTLIER_HAMPEL,
+        .window = 5,
+        .ema_shift = 2,
+        .hampel_k_x8 = 24,
+        .hampel_min_dev = 50,
+    };
+    sensor_filter_state_t state = { 0 };
+
+    for (int i = 0; i < 5; i++) {
+        sensor_filter_update(&config, &state, 800, NULL);
+    }
+    // The spike never reaches the average
+    CHECK_EQ(sensor_filter_update(&config, &state, 9000, NULL), 800);
+    // A quarter of a real change per sample
+    CHECK_EQ(sensor_filter_update(&config, &state, 840, NULL), 810);
+}
+
+static void test_window_clamp(void)
+{
+    const sensor_filter_config_t config = { .outlier = SENSOR_FILTER_OUTLIER_MEDIAN, .window = 200 };
+    sensor_filter_state_t state = { 0 };
+
+    // Window longer than the history: uses all of it, and the ring wraps
+    for (int i = 1; i <= 3 * SENSOR_FILTER_WINDOW_MAX; i++) {
+        int32_t out = sensor_filter_update(&config, &state, i * 10, NULL);
+        int n = i < SENSOR_FILTER_WINDOW_MAX ? i : SENSOR_FILTER_WINDOW_MAX;
+        // Median of the last n samples i*10, (i-1)*10, ...
+        CHECK_EQ(out, i * 10 - (n - 1) * 5);
+    }
+}
+
+static void test_state_size(void)
+{
+    // Three channels must fit comfortably in RTC memory
+    CHECK_EQ(sizeof(sensor_filter_state_t), 4 * SENSOR_FILTER_WINDOW_MAX + 8);
+}
+
+int main(void)
+{
+    test_passthrough();
+    test_ema();
+    test_median();
+    test_hampel();
+    test_hampel_flat();
+    test_hampel_then_ema();
+    test_window_clamp();
+    test_state_size();
+
+    return host_test_summary("sensor_filter");
+}
@@ -0,0 +1,81 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Streaming sensor filter
+ *
+ * Per-channel, integer-only smoothing for slow sensor readings: an outlier
+ * stage over the last few samples - a running median, or a Hampel filter
+ * that only replaces samples further than k scaled MADs from the median -
+ * followed by an exponential moving average. Values are in the channel's
+ * own integer unit (ppm, 0.01 °C, ...).
+ *
+ * The state is a few dozen bytes and has no pointers, so it can live in RTC
+ * memory (RTC_DATA_ATTR) and keep filtering across deep sleep. A
+ * zero-initialized state is empty; the first sample passes through.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Samples of history per channel
+ */
+#define SENSOR_FILTER_WINDOW_MAX        CONFIG_SENSOR_FILTER_WINDOW_MAX
+
+/**
+ * @brief Outlier stage
+ */
+typedef enum {
+    SENSOR_FILTER_OUTLIER_NONE = 0,     /**< Pass samples through */
+    SENSOR_FILTER_OUTLIER_MEDIAN,       /**< Median of the window */
+    SENSOR_FILTER_OUTLIER_HAMPEL,       /**< Replace outliers by the median of the previous samples */
+} sensor_filter_outlier_t;
+
+/**
+ * @brief Filter settings of one channel
+ */
+typedef struct {
+    sensor_filter_outlier_t outlier;    /**< Outlier stage */
+    uint8_t window;                     /**< Samples the outlier stage looks at, 1..SENSOR_FILTER_WINDOW_MAX */
+    uint8_t ema_shift;                  /**< EMA weight of a new sample is 1/2^shift, 0 disables the EMA */
+    uint8_t hampel_k_x8;                /**< Hampel threshold in scaled MADs, in 1/8 (3.0 = 24) */
+    int32_t hampel_min_dev;             /**< Smallest deviation ever rejected, keeps flat signals from locking up */
+} sensor_filter_config_t;
+
+/**
+ * @brief Filter state of one channel
+ */
+typedef struct {
+    int32_t history[SENSOR_FILTER_WINDOW_MAX];  /**< Raw samples, ring buffer */
+    int32_t ema_x256;                   /**< EMA output in 1/256 units */
+    uint8_t count;                      /**< Valid samples in history */
+    uint8_t head;                       /**< Next history slot */
+} sensor_filter_state_t;
+
+/**
+ * @brief Forget all history, e.g. after the sensor was replaced
+ */
+void sensor_filter_reset(sensor_filter_state_t *state);
+
+/**
+ * @brief Filter one sample
+ *
+ * @param config Channel settings
+ * @param state Channel state, updated
+ * @param value New raw sample, within +/-2^23
+ * @param rejected Optional, set when the Hampel stage replaced the sample
+ * @return Filtered value
+ */
+int32_t sensor_filter_update(const sensor_filter_config_t *config, sensor_filter_state_t *state,
+                             int32_t value, bool *rejected);
+
+#ifdef __cplusplus
+}
+#endif
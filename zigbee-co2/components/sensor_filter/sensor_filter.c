@@ -0,0 +1,145 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Streaming sensor filter
+ */
+
+#include "sensor_filter.h"
+#include <string.h>
+
+/* MAD to standard deviation for normally distributed noise (1.4826), in 1/1024 */
+#define SENSOR_FILTER_MAD_SCALE_Q10     1518
+
+/* Fraction bits of the EMA accumulator */
+#define SENSOR_FILTER_EMA_BITS          8
+
+/* Fewest previous samples the Hampel stage needs for a meaningful MAD */
+#define SENSOR_FILTER_HAMPEL_MIN        3
+
+static int32_t abs_i32(int32_t value)
+{
+    return value < 0 ? -value : value;
+}
+
+/* Median of n values; sorts them in place (insertion sort, n is tiny) */
+static int32_t sensor_filter_median(int32_t *values, int n)
+{
+    for (int i = 1; i < n; i++) {
+        int32_t v = values[i];
+        int j = i - 1;
+        while (j >= 0 && values[j] > v) {
+            values[j + 1] = values[j];
+            j--;
+        }
+        values[j + 1] = v;
+    }
+
+    if (n & 1) {
+        return values[n / 2];
+    }
+    // Even count: lower middle plus half the gap, rounds down for negatives too
+    return values[n / 2 - 1] + (values[n / 2] - values[n / 2 - 1]) / 2;
+}
+
+/* Copy the latest samples the outlier stage looks at, newest first */
+static int sensor_filter_window(const sensor_filter_config_t *config, const sensor_filter_state_t *state,
+                                int32_t *out)
+{
+    int window = config->window;
+    if (window < 1) {
+        window = 1;
+    } else if (window > SENSOR_FILTER_WINDOW_MAX) {
+        window = SENSOR_FILTER_WINDOW_MAX;
+    }
+
+    int n = state->count < window ? state->count : window;
+    for (int i = 0; i < n; i++) {
+        int slot = (state->head + SENSOR_FILTER_WINDOW_MAX - 1 - i) % SENSOR_FILTER_WINDOW_MAX;
+        out[i] = state->history[slot];
+    }
+    return n;
+}
+
+static void sensor_filter_push(sensor_filter_state_t *state, int32_t value)
+{
+    state->history[state->head] = value;
+    state->head = (state->head + 1) % SENSOR_FILTER_WINDOW_MAX;
+    if (state->count < SENSOR_FILTER_WINDOW_MAX) {
+        state->count++;
+    }
+}
+
+/* Replace value by the median of the previous samples if it is too far from it */
+static int32_t sensor_filter_hampel(const sensor_filter_config_t *config, const sensor_filter_state_t *state,
+                                    int32_t value, bool *rejected)
+{
+    int32_t window[SENSOR_FILTER_WINDOW_MAX];
+    int n = sensor_filter_window(config, state, window);
+    if (n < SENSOR_FILTER_HAMPEL_MIN) {
+        return value;
+    }
+
+    int32_t median = sensor_filter_median(window, n);
+    for (int i = 0; i < n; i++) {
+        window[i] = abs_i32(window[i] - median);
+    }
+    int32_t mad = sensor_filter_median(window, n);
+
+    int64_t threshold = ((int64_t)mad * SENSOR_FILTER_MAD_SCALE_Q10 * config->hampel_k_x8) >> (10 + 3);
+    if (threshold < config->hampel_min_dev) {
+        threshold = config->hampel_min_dev;
+    }
+
+    int64_t deviation = (int64_t)value - median;
+    if (deviation > threshold || -deviation > threshold) {
+        *rejected = true;
+        return median;
+    }
+    return value;
+}
+
+void sensor_filter_reset(sensor_filter_state_t *state)
+{
+    memset(state, 0, sizeof(*state));
+}
+
+int32_t sensor_filter_update(const sensor_filter_config_t *config, sensor_filter_state_t *state,
+                             int32_t value, bool *rejected)
+{
+    bool outlier = false;
+    bool first = state->count == 0;
+    int32_t output = value;
+
+    switch (config->outlier) {
+    case SENSOR_FILTER_OUTLIER_HAMPEL:
+        // History keeps the raw samples, so a real step is accepted once it
+        // holds the majority of the window
+        output = sensor_filter_hampel(config, state, value, &outlier);
+        sensor_filter_push(state, value);
+        break;
+    case SENSOR_FILTER_OUTLIER_MEDIAN: {
+        sensor_filter_push(state, value);
+        int32_t window[SENSOR_FILTER_WINDOW_MAX];
+        int n = sensor_filter_window(config, state, window);
+        output = sensor_filter_median(window, n);
+        break;
+    }
+    default:
+        sensor_filter_push(state, value);
+        break;
+    }
+
+    if (rejected) {
+        *rejected = outlier;
+    }
+
+    int32_t output_x256 = output * (1 << SENSOR_FILTER_EMA_BITS);
+    if (first || config->ema_shift == 0) {
+        state->ema_x256 = output_x256;
+        return output;
+    }
+    state->ema_x256 += (output_x256 - state->ema_x256) >> config->ema_shift;
+
+    // Round half up
+    return (state->ema_x256 + (1 << (SENSOR_FILTER_EMA_BITS - 1))) >> SENSOR_FILTER_EMA_BITS;
+}
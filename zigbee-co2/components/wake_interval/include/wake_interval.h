@@ -0,0 +1,66 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Adaptive wake interval
+ *
+ * Picks the next deep-sleep period from the CO2 trend: the interval grows
+ * while CO2 is flat, halves when it moves, and drops straight to the
+ * minimum when CO2 rises quickly or reaches a high level (a room filling
+ * up). The state is meant to live in RTC memory (RTC_DATA_ATTR); a
+ * zero-initialized state starts at the minimum interval.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Scheduler settings
+ */
+typedef struct {
+    uint32_t min_interval_s;    /**< Shortest sleep */
+    uint32_t max_interval_s;    /**< Longest sleep */
+    int32_t stable_slope;       /**< |slope| at or below this (ppm/min) stretches the interval */
+    int32_t fast_slope;         /**< Rising at or above this (ppm/min) jumps to the minimum */
+    uint16_t high_level_ppm;    /**< CO2 at or above this jumps to the minimum, 0 to disable */
+} wake_interval_config_t;
+
+/**
+ * @brief Scheduler state, retained across deep sleep
+ */
+typedef struct {
+    bool valid;                 /**< A previous sample exists */
+    uint16_t last_co2_ppm;      /**< Previous sample */
+    uint32_t last_time_s;       /**< Time of the previous sample */
+    int32_t slope_x16;          /**< Smoothed slope in 1/16 ppm/min */
+    uint32_t interval_s;        /**< Current interval */
+} wake_interval_state_t;
+
+/**
+ * @brief Feed a sample and get the next sleep period
+ *
+ * @param config Scheduler settings
+ * @param state Retained state, updated
+ * @param co2_ppm Latest CO2 reading
+ * @param now_s Time of the reading in seconds
+ * @return Seconds to sleep until the next wake
+ */
+uint32_t wake_interval_update(const wake_interval_config_t *config, wake_interval_state_t *state,
+                              uint16_t co2_ppm, uint32_t now_s);
+
+/**
+ * @brief Smoothed CO2 slope in ppm per minute
+ */
+static inline int32_t wake_interval_slope(const wake_interval_state_t *state)
+{
+    return state->slope_x16 / 16;
+}
+
+#ifdef __cplusplus
+}
+#endif
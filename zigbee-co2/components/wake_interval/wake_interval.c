@@ -0,0 +1,60 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Adaptive wake interval
+ */
+
+#include "wake_interval.h"
+#include <stdlib.h>
+
+/* Weight of a new slope in the running average, as a shift (1/4) */
+#define WAKE_INTERVAL_SLOPE_SHIFT   2
+
+static uint32_t wake_interval_clamp(const wake_interval_config_t *config, uint32_t interval_s)
+{
+    if (interval_s < config->min_interval_s) {
+        return config->min_interval_s;
+    }
+    if (interval_s > config->max_interval_s) {
+        return config->max_interval_s;
+    }
+    return interval_s;
+}
+
+uint32_t wake_interval_update(const wake_interval_config_t *config, wake_interval_state_t *state,
+                              uint16_t co2_ppm, uint32_t now_s)
+{
+    if (!state->valid) {
+        state->valid = true;
+        state->slope_x16 = 0;
+        state->interval_s = config->min_interval_s;
+    } else {
+        uint32_t dt_s = now_s - state->last_time_s;
+        if (dt_s == 0) {
+            dt_s = 1;
+        }
+        int32_t slope_x16 = ((int32_t)co2_ppm - state->last_co2_ppm) * 60 * 16 / (int32_t)dt_s;
+        state->slope_x16 += (slope_x16 - state->slope_x16) >> WAKE_INTERVAL_SLOPE_SHIFT;
+
+        // The latest slope reacts within one wake, the average keeps a single
+        // quiet sample from stretching the interval in the middle of a trend
+        int32_t slope = slope_x16 / 16;
+        int32_t average = wake_interval_slope(state);
+        bool high = config->high_level_ppm > 0 && co2_ppm >= config->high_level_ppm;
+
+        if (high || slope >= config->fast_slope) {
+            // Something is happening: fastest sampling right away
+            state->interval_s = config->min_interval_s;
+        } else if (abs(slope) <= config->stable_slope && abs(average) <= config->stable_slope) {
+            // Flat: back off gradually
+            state->interval_s += state->interval_s / 2;
+        } else {
+            state->interval_s /= 2;
+        }
+    }
+
+    state->interval_s = wake_interval_clamp(config, state->interval_s);
+    state->last_co2_ppm = co2_ppm;
+    state->last_time_s = now_s;
+    return state->interval_s;
+}
@@ -10,6 +10,8 @@
  */
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "esp_err.h"
 #include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
@@ -18,24 +20,45 @@
 #include "esp_check.h"
 #include "nvs_flash.h"
 #include "esp_zigbee_core.h"
+#include "aps/esp_zigbee_aps.h"
 #include "ha/esp_zigbee_ha_standard.h"
 #include "scd40.h"
+#include "scd40_async.h"
+#include "scd40_strategy.h"
+#include "sample_ring.h"
+#include "report_policy.h"
+#include "wake_interval.h"
+#include "ready_scheduler.h"
+#include "sensor_filter.h"
+#include "wake_profiler.h"
+#include "wake_profiler_zcl.h"
+#include "device_config.h"
+#include "device_config_zcl.h"
+#include "sleep_policy.h"
+#include "battery.h"
+#include "battery_zcl.h"
 #include "esp_sleep.h"
+#include "esp_pm.h"
+#include "freertos/event_groups.h"
 #include "esp_timer.h"
 #include "driver/rtc_io.h"
 #include <sys/time.h>
 #include "led_signal.h"
+#include "esp_system.h"
+#include "flash_log.h"
+#include "flash_log_zcl.h"
 
 static const char *TAG = "ZIGBEE_CO2_SENSOR";
 
 /* Zigbee Configuration */
+#define ED_KEEP_ALIVE_MS            3000    /* Data poll period while joined */
 #define ESP_ZB_ZED_CONFIG()                               \
     {                                                     \
         .esp_zb_role = ESP_ZB_DEVICE_TYPE_ED,            \
         .install_code_policy = false,                     \
         .nwk_cfg.zed_cfg = {                             \
             .ed_timeout = ESP_ZB_ED_AGING_TIMEOUT_64MIN, \
-            .keep_alive = 3000,                           \
+            .keep_alive = ED_KEEP_ALIVE_MS,               \
         },                                                \
     }
 
@@ -44,6 +67,11 @@ static const char *TAG = "ZIGBEE_CO2_SENSOR";
 #define ESP_MANUFACTURER_NAME       "\x0B""Espressif"
 #define ESP_MODEL_IDENTIFIER        "\x0A""CO2-Sensor"
 
+/* Manufacturer-specific cluster carrying the buffered sample history as an
+ * octet string, one sample_ring frame per report */
+#define CO2_HISTORY_CLUSTER_ID      0xFC00
+#define CO2_HISTORY_ATTR_ID         0x0000
+
 /* I2C Configuration */
 #define I2C_MASTER_NUM              I2C_NUM_0
 #define I2C_MASTER_SCL_IO           23       /*!< GPIO number used for I2C master clock */
@@ -54,89 +82,451 @@ static const char *TAG = "ZIGBEE_CO2_SENSOR";
 #define MAX_RETRIES                 3
 #define RETRY_DELAY_MS              1000
 
-#define WAKE_UP_TIME_SEC            60
-
-/* Global sensor handle */
+/* Sensor event bits */
+#define SENSOR_PREPARED_BIT         BIT0
+#define ZIGBEE_READY_BIT            BIT1    /*!< Stack started and (re)joined the network */
+#define REPORT_CONFIRMED_BIT        BIT2    /*!< Every attribute report was confirmed */
+
+/* Reports go to the coordinator's first endpoint */
+#define REPORT_DST_ADDR             0x0000
+#define REPORT_DST_ENDPOINT         1
+
+/* One pending bit per reported attribute, in the order the reports are sent */
+#define REPORT_TEMPERATURE          BIT0
+#define REPORT_HUMIDITY             BIT1
+#define REPORT_CO2                  BIT2
+#define REPORT_PROFILE              BIT3
+#define REPORT_HISTORY              BIT4
+#define REPORT_BATTERY_VOLTAGE      BIT5
+#define REPORT_BATTERY_PERCENTAGE   BIT6
+#define REPORT_BATTERY              (REPORT_BATTERY_VOLTAGE | REPORT_BATTERY_PERCENTAGE)
+#define REPORT_MEASUREMENTS         (REPORT_TEMPERATURE | REPORT_HUMIDITY | REPORT_CO2)
+#define REPORT_COUNT                7
+
+/* ZCL "unknown" values, reported until the first measurement is written */
+#define ZCL_TEMPERATURE_UNKNOWN     ((int16_t)0x8000)
+#define ZCL_HUMIDITY_UNKNOWN        0xFFFF
+
+/* Sign, whole and hundredths of a value in 0.01 units, for "%s%d.%02d" */
+#define CENTI_PARTS(v)              ((v) < 0 ? "-" : ""), abs((v) / 100), abs((v) % 100)
+
+/* Global sensor handle; its command engine also takes the queued chains below */
 static scd40_handle_t g_sensor;
+static EventGroupHandle_t s_sensor_events;
+
+/* What the SCD4x is doing; anything but UNKNOWN and PERIODIC survives deep sleep */
+typedef enum {
+    SENSOR_MODE_UNKNOWN = 0,            /* Cold boot or interrupted wake: full init needed */
+    SENSOR_MODE_POWERED_DOWN,
+    SENSOR_MODE_IDLE,
+    SENSOR_MODE_LOW_POWER_PERIODIC,     /* Keeps measuring while we sleep */
+    SENSOR_MODE_PERIODIC,               /* Only while awake */
+} sensor_mode_t;
+
+/* Sensor state retained across deep sleep */
+typedef struct {
+    uint8_t mode;               /* sensor_mode_t */
+    uint8_t variant;            /* scd40_variant_t of the sensor with this serial */
+    uint8_t strategy;           /* scd40_strategy_t chosen for the next wake */
+    uint16_t co2_ppm;           /* Last CO2 reading, reused by RH/T-only samples */
+    uint32_t co2_time_s;        /* When it was taken */
+    uint64_t serial;            /* Serial number read at the last full init */
+    scd40_settings_t settings;  /* What the sensor's EEPROM holds */
+    ready_scheduler_estimate_t ready[SCD40_STRATEGY_MAX]; /* Learned conversion latency per strategy */
+} sensor_rtc_state_t;
+
+static RTC_DATA_ATTR sensor_rtc_state_t s_sensor_state;
+
+/* Sensor and host currents the measurement strategy is chosen by */
+static const scd40_energy_model_t s_energy_model = SCD40_ENERGY_MODEL_DEFAULT();
+
+/* Reports still waiting for confirmation and the ZCL sequence number each was
+ * sent with, only touched from the Zigbee task or under the Zigbee lock */
+static uint8_t s_reports_pending;
+static uint8_t s_report_tsn[REPORT_COUNT];
+static bool s_report_failed;
+
+/* Joined by network steering during this wake rather than rejoined from NVRAM */
+static bool s_fresh_join;
+
+/* Samples not yet delivered, kept across deep sleep so most wakes can skip the radio */
+static RTC_DATA_ATTR sample_ring_t s_samples;
+
+/* Report policy channels, in Zigbee attribute units */
+enum {
+    POLICY_CO2,             /* ppm */
+    POLICY_TEMPERATURE,     /* 0.01 °C */
+    POLICY_HUMIDITY,        /* 0.01 %RH */
+    POLICY_CHANNELS,
+};
+
+/* Deadbands match the reportable changes the Z2M converter configures;
+ * config_apply() replaces them with the stored settings */
+static report_policy_config_t s_policy_config = {
+    .num_channels = POLICY_CHANNELS,
+    .channels = {
+        [POLICY_CO2] = {
+            .deadband = CONFIG_CO2_SENSOR_DEADBAND_CO2_PPM,
+            .alert_enabled = CONFIG_CO2_SENSOR_ALERT_PPM > 0,
+            .alert_level = CONFIG_CO2_SENSOR_ALERT_PPM,
+            .alert_hysteresis = CONFIG_CO2_SENSOR_ALERT_HYSTERESIS_PPM,
+        },
+        [POLICY_TEMPERATURE] = { .deadband = CONFIG_CO2_SENSOR_DEADBAND_TEMPERATURE },
+        [POLICY_HUMIDITY] = { .deadband = CONFIG_CO2_SENSOR_DEADBAND_HUMIDITY },
+    },
+    .max_silence_s = CONFIG_CO2_SENSOR_MAX_SILENCE_SEC,
+};
+
+/* Last delivered values and alert states, decides whether a wake needs the radio */
+static RTC_DATA_ATTR report_policy_state_t s_policy_state;
+
+#if CONFIG_CO2_SENSOR_FILTER_HAMPEL
+#define FILTER_OUTLIER              SENSOR_FILTER_OUTLIER_HAMPEL
+#elif CONFIG_CO2_SENSOR_FILTER_MEDIAN
+#define FILTER_OUTLIER              SENSOR_FILTER_OUTLIER_MEDIAN
+#else
+#define FILTER_OUTLIER              SENSOR_FILTER_OUTLIER_NONE
+#endif
+
+#define FILTER_CONFIG(min_dev)                                  \
+    {                                                           \
+        .outlier = FILTER_OUTLIER,                              \
+        .window = CONFIG_CO2_SENSOR_FILTER_WINDOW,              \
+        .ema_shift = CONFIG_CO2_SENSOR_FILTER_EMA_SHIFT,        \
+        .hampel_k_x8 = CONFIG_CO2_SENSOR_FILTER_HAMPEL_K_X8,    \
+        .hampel_min_dev = (min_dev),                            \
+    }
 
-/* Deep sleep variables */
-static RTC_DATA_ATTR struct timeval s_sleep_enter_time;
-static esp_timer_handle_t s_oneshot_timer;
-
-/********************* Deep Sleep Functions *********************/
+/* Smoothing per channel; Hampel floors are a few times the sensor's repeatability */
+static const sensor_filter_config_t s_filter_config[POLICY_CHANNELS] = {
+    [POLICY_CO2] = FILTER_CONFIG(50),               /* ppm */
+    [POLICY_TEMPERATURE] = FILTER_CONFIG(30),       /* 0.01 °C */
+    [POLICY_HUMIDITY] = FILTER_CONFIG(150),         /* 0.01 %RH */
+};
+
+/* Recent raw readings and averages of each channel */
+static RTC_DATA_ATTR sensor_filter_state_t s_filter_state[POLICY_CHANNELS];
+
+/* Interval bounds are replaced by config_apply() */
+static wake_interval_config_t s_wake_config = {
+    .min_interval_s = CONFIG_CO2_SENSOR_WAKE_MIN_SEC,
+    .max_interval_s = CONFIG_CO2_SENSOR_WAKE_MAX_SEC,
+    .stable_slope = CONFIG_CO2_SENSOR_WAKE_STABLE_SLOPE,
+    .fast_slope = CONFIG_CO2_SENSOR_WAKE_FAST_SLOPE,
+    .high_level_ppm = CONFIG_CO2_SENSOR_WAKE_FAST_LEVEL_PPM,
+};
+
+/* CO2 trend and current sleep period */
+static RTC_DATA_ATTR wake_interval_state_t s_wake_state;
+
+/* Settings writable over Zigbee, loaded from NVS after power-on only */
+static RTC_DATA_ATTR device_config_blob_t s_config;
+
+#if CONFIG_CO2_SENSOR_ASC
+#define CONFIG_DEFAULT_ASC          1
+#else
+#define CONFIG_DEFAULT_ASC          0
+#endif
+
+#if CONFIG_CO2_SENSOR_SLEEP_LIGHT
+#define CONFIG_DEFAULT_SLEEP_MODE   DEVICE_CONFIG_SLEEP_LIGHT
+#elif CONFIG_CO2_SENSOR_SLEEP_AUTO
+#define CONFIG_DEFAULT_SLEEP_MODE   DEVICE_CONFIG_SLEEP_AUTO
+#else
+#define CONFIG_DEFAULT_SLEEP_MODE   DEVICE_CONFIG_SLEEP_DEEP
+#endif
+
+static const device_config_t s_config_defaults = {
+    .wake_min_s = CONFIG_CO2_SENSOR_WAKE_MIN_SEC,
+    .wake_max_s = CONFIG_CO2_SENSOR_WAKE_MAX_SEC,
+    .temperature_offset = CONFIG_CO2_SENSOR_TEMPERATURE_OFFSET,
+    .altitude_m = CONFIG_CO2_SENSOR_ALTITUDE_M,
+    .deadband_co2_ppm = CONFIG_CO2_SENSOR_DEADBAND_CO2_PPM,
+    .deadband_temperature = CONFIG_CO2_SENSOR_DEADBAND_TEMPERATURE,
+    .deadband_humidity = CONFIG_CO2_SENSOR_DEADBAND_HUMIDITY,
+    .asc_enabled = CONFIG_DEFAULT_ASC,
+};
+
+/* Zigbee task has been created during this wake */
+static bool s_zigbee_started;
+
+/* How the device sleeps; chosen after boot, light sleep may fall back to deep */
+static sleep_mode_t s_sleep_mode;
+
+#if CONFIG_CO2_SENSOR_BATTERY
+static const battery_config_t s_battery_config = {
+    .adc_channel = CONFIG_CO2_SENSOR_BATTERY_ADC_CHANNEL,
+    .divider = CONFIG_CO2_SENSOR_BATTERY_DIVIDER,
+    .oversample_log2 = 4,
+    .sample_every = CONFIG_CO2_SENSOR_BATTERY_SAMPLE_WAKES,
+    .capacity_mah = CONFIG_CO2_SENSOR_BATTERY_CAPACITY_MAH,
+    .curve = battery_curve_liion,
+    .curve_len = BATTERY_CURVE_LIION_LEN,
+    .load = BATTERY_LOAD_DEFAULT(),
+};
+
+/* Level estimate, and the level the coordinator last confirmed (0xFF: none) */
+static RTC_DATA_ATTR battery_state_t s_battery;
+static RTC_DATA_ATTR uint8_t s_battery_reported_x2 = 0xFF;
+#endif
+
+/* ZCL octet string value of the history attribute: length byte, then the frame */
+static uint8_t s_history_value[1 + SAMPLE_RING_FRAME_MAX_LEN];
+
+/********************* Settings *********************/
 
 /**
- * @brief One-shot timer callback to enter deep sleep
+ * @brief Use the stored settings for wake scheduling and reporting
  */
-static void s_oneshot_timer_callback(void *arg)
+static void config_apply(void)
 {
-    ESP_LOGI(TAG, "Enter deep sleep");
-    led_signal_set_state(LED_STATE_DEEP_SLEEP_PREPARE);
-    vTaskDelay(pdMS_TO_TICKS(1000)); // Show LED pattern before sleep
-    led_signal_stop();
-    gettimeofday(&s_sleep_enter_time, NULL);
-    esp_deep_sleep_start();
+    const device_config_t *config = &s_config.config;
+
+    s_wake_config.min_interval_s = config->wake_min_s;
+    s_wake_config.max_interval_s = config->wake_max_s;
+    s_policy_config.channels[POLICY_CO2].deadband = config->deadband_co2_ppm;
+    s_policy_config.channels[POLICY_TEMPERATURE].deadband = config->deadband_temperature;
+    s_policy_config.channels[POLICY_HUMIDITY].deadband = config->deadband_humidity;
 }
 
 /**
- * @brief Initialize deep sleep configuration
+ * @brief Sensor EEPROM settings the stored settings ask for
  */
-static void zb_deep_sleep_init(void)
+static scd40_settings_t config_sensor_settings(void)
 {
-    // Create one-shot timer for deep sleep entry
-    const esp_timer_create_args_t s_oneshot_timer_args = {
-        .callback = &s_oneshot_timer_callback,
-        .name = "deep-sleep-timer"
+    const device_config_t *config = &s_config.config;
+    scd40_settings_t settings = {
+        .valid = true,
+        .temperature_offset = scd40_temperature_offset_to_raw(config->temperature_offset),
+        .altitude_m = config->altitude_m,
+        .asc_enabled = config->asc_enabled,
     };
-    ESP_ERROR_CHECK(esp_timer_create(&s_oneshot_timer_args, &s_oneshot_timer));
+    return settings;
+}
 
-    // Print wake-up reason
-    struct timeval now;
-    gettimeofday(&now, NULL);
-    int sleep_time_ms = (now.tv_sec - s_sleep_enter_time.tv_sec) * 1000 +
-                        (now.tv_usec - s_sleep_enter_time.tv_usec) / 1000;
+/**
+ * @brief Whether the sensor still needs a settings update (idle sensor only)
+ */
+static bool config_sensor_pending(void)
+{
+    scd40_settings_t desired = config_sensor_settings();
+    const scd40_settings_t *known = &s_sensor_state.settings;
+
+    return !known->valid || known->temperature_offset != desired.temperature_offset ||
+           known->altitude_m != desired.altitude_m || known->asc_enabled != desired.asc_enabled;
+}
+
+/********************* Battery *********************/
+
+/**
+ * @brief Sample the battery voltage if this wake is due for it
+ */
+static void battery_sample(void)
+{
+#if CONFIG_CO2_SENSOR_BATTERY
+    uint16_t mv;
+    if (battery_sample_due(&s_battery_config, &s_battery) &&
+        battery_read_mv(&s_battery_config, &mv) == ESP_OK) {
+        battery_update_voltage(&s_battery_config, &s_battery, mv);
+    }
+#endif
+}
 
+/**
+ * @brief Count the charge of this wake and of the sleep that follows
+ *
+ * Between wakes the chip draws its deep-sleep current, or the light-sleep
+ * floor plus the SED data polls; the sensor's share comes from its energy
+ * model for the strategy chosen for the next wake.
+ *
+ * @param sleep_s Seconds until the next wake
+ */
+static void battery_account(uint32_t sleep_s)
+{
+#if CONFIG_CO2_SENSOR_BATTERY
+    sleep_policy_model_t model = SLEEP_POLICY_MODEL_DEFAULT();
+    model.poll_interval_ms = ED_KEEP_ALIVE_MS;
+    uint32_t sleep_ua = s_sleep_mode == SLEEP_MODE_LIGHT ?
+                        sleep_policy_average_na(&model, SLEEP_MODE_LIGHT, sleep_s, sleep_s) / 1000 :
+                        model.deep_sleep_ua;
+    if (sleep_s > 0) {
+        sleep_ua += scd40_strategy_charge_uc(&s_energy_model, (scd40_strategy_t)s_sensor_state.strategy,
+                                             sleep_s) / sleep_s;
+    }
+    battery_account_wake(&s_battery_config, &s_battery, sleep_s, sleep_ua);
+    ESP_LOGI(TAG, "Battery %u.%u%% (%u mV, %lu mAh used since power-on)",
+             battery_percent_x2(&s_battery_config, &s_battery) / 2,
+             battery_percent_x2(&s_battery_config, &s_battery) % 2 * 5, s_battery.voltage_mv,
+             (unsigned long)(s_battery.total_nc / 3600000000ULL));
+#endif
+}
+
+/**
+ * @brief Write the battery estimate into its cluster
+ *
+ * @return REPORT_BATTERY if the level differs from the one last confirmed, 0 otherwise
+ */
+static uint8_t battery_publish(void)
+{
+#if CONFIG_CO2_SENSOR_BATTERY
+    battery_zcl_update(HA_ESP_SENSOR_ENDPOINT, &s_battery_config, &s_battery);
+    return battery_percent_x2(&s_battery_config, &s_battery) != s_battery_reported_x2 ? REPORT_BATTERY : 0;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief The coordinator confirmed the battery reports
+ */
+static void battery_commit(void)
+{
+#if CONFIG_CO2_SENSOR_BATTERY
+    s_battery_reported_x2 = battery_percent_x2(&s_battery_config, &s_battery);
+#endif
+}
+
+/********************* Deep Sleep Functions *********************/
+
+/**
+ * @brief Initialize deep sleep configuration
+ */
+static void zb_deep_sleep_init(void)
+{
+    // Print wake-up reason; the profiler logs the time spent asleep
     esp_sleep_wakeup_cause_t wake_up_cause = esp_sleep_get_wakeup_cause();
     switch (wake_up_cause) {
     case ESP_SLEEP_WAKEUP_TIMER:
-        ESP_LOGI(TAG, "Wake up from timer. Time spent in deep sleep and boot: %dms", sleep_time_ms);
+        ESP_LOGI(TAG, "Wake up from timer");
         break;
     case ESP_SLEEP_WAKEUP_UNDEFINED:
     default:
         ESP_LOGI(TAG, "Not a deep sleep reset");
         break;
     }
+}
 
-    // Configure RTC timer wake-up for x seconds
-    ESP_LOGI(TAG, "Enabling timer wakeup, %ds", WAKE_UP_TIME_SEC);
-    ESP_ERROR_CHECK(esp_sleep_enable_timer_wakeup(WAKE_UP_TIME_SEC * 1000000));
+/**
+ * @brief Enter deep sleep right away
+ *
+ * Called once the reports of this wake are confirmed (or timed out), so
+ * nothing is left for the radio to do.
+ *
+ * @param sleep_s Seconds until the timer wake
+ */
+static void go_to_deep_sleep(uint32_t sleep_s)
+{
+    ESP_LOGI(TAG, "Enter deep sleep for %lus", (unsigned long)sleep_s);
+    ESP_ERROR_CHECK(esp_sleep_enable_timer_wakeup((uint64_t)sleep_s * 1000000));
+    led_signal_stop();
+    battery_account(sleep_s);
+    wake_profiler_sleep();
+    esp_deep_sleep_start();
 }
 
+/********************* Sleep Mode *********************/
+
 /**
- * @brief Check if conditions are met for deep sleep and trigger if ready
+ * @brief Mode to sleep in for a wake interval
+ *
+ * The setting written over Zigbee wins over the build-time choice. The
+ * automatic mode compares both with the profiled boot, stack start and
+ * rejoin times.
+ *
+ * @param sleep_s Time until the next wake
  */
-static void go_to_deep_sleep()
+static sleep_mode_t sleep_mode_select(uint32_t sleep_s)
 {
-    const int before_deep_sleep_time_sec = 10;
-    ESP_LOGI(TAG, "Starting one-shot timer for %ds before entering deep sleep", before_deep_sleep_time_sec);
-    ESP_ERROR_CHECK(esp_timer_start_once(s_oneshot_timer, before_deep_sleep_time_sec * 1000000));
+    uint8_t mode = s_config.config.sleep_mode;
+    if (mode == DEVICE_CONFIG_SLEEP_DEFAULT) {
+        mode = CONFIG_DEFAULT_SLEEP_MODE;
+    }
+
+    switch (mode) {
+    case DEVICE_CONFIG_SLEEP_LIGHT:
+        return SLEEP_MODE_LIGHT;
+    case DEVICE_CONFIG_SLEEP_AUTO: {
+        sleep_policy_model_t model = SLEEP_POLICY_MODEL_DEFAULT();
+        model.poll_interval_ms = ED_KEEP_ALIVE_MS;
+        sleep_policy_model_from_profiler(&model);
+        uint32_t uplink_s = sleep_policy_uplink_interval_s(sleep_s);
+        sleep_mode_t selected = sleep_policy_select(&model, s_sleep_mode, sleep_s, uplink_s);
+        ESP_LOGI(TAG, "Sleep policy at %lus per wake, %lus per uplink: deep %lu nA, light %lu nA, using %s",
+                 (unsigned long)sleep_s, (unsigned long)uplink_s,
+                 (unsigned long)sleep_policy_average_na(&model, SLEEP_MODE_DEEP, sleep_s, uplink_s),
+                 (unsigned long)sleep_policy_average_na(&model, SLEEP_MODE_LIGHT, sleep_s, uplink_s),
+                 sleep_policy_mode_name(selected));
+        return selected;
+    }
+    default:
+        return SLEEP_MODE_DEEP;
+    }
+}
+
+/**
+ * @brief Sleep until the next wake
+ *
+ * Deep sleep does not return. In light sleep the device stays joined: the
+ * task blocks, and with tickless idle the chip light-sleeps between the
+ * stack's data polls. A light-sleeping device falls back to deep sleep when
+ * the setting or the policy says so; the way back is at the next boot.
+ *
+ * @param sleep_s Seconds until the next wake
+ */
+static void sensor_sleep(uint32_t sleep_s)
+{
+    if (s_sleep_mode == SLEEP_MODE_LIGHT) {
+        s_sleep_mode = sleep_mode_select(sleep_s);
+    }
+    if (s_sleep_mode == SLEEP_MODE_DEEP) {
+        go_to_deep_sleep(sleep_s);
+    }
+
+    ESP_LOGI(TAG, "Light sleep for %lus", (unsigned long)sleep_s);
+    led_signal_set_state(LED_STATE_OFF);
+    battery_account(sleep_s);
+    wake_profiler_sleep();
+    vTaskDelay(pdMS_TO_TICKS(sleep_s * 1000));
+    wake_profiler_resume();
 }
 
 
 
+/********************* Power Management *********************/
+
+/**
+ * @brief Let the CPU light-sleep whenever all tasks are blocked
+ */
+static esp_err_t power_save_init(void)
+{
+    esp_err_t rc = ESP_OK;
+#ifdef CONFIG_PM_ENABLE
+    int cur_cpu_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = cur_cpu_freq_mhz,
+        .min_freq_mhz = cur_cpu_freq_mhz,
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        .light_sleep_enable = true
+#endif
+    };
+    rc = esp_pm_configure(&pm_config);
+#endif
+    return rc;
+}
+
 /********************* Sensor Functions *********************/
 
 /**
- * @brief Initialize the SCD40 sensor and read serial number
+ * @brief Attach the SCD40 to its I2C bus, along with the handle's command engine
+ *
+ * Does not talk to the sensor, so it is safe while it keeps measuring.
  *
  * @return ESP_OK on success, error code otherwise
  */
-static esp_err_t sensor_init(void)
+static esp_err_t sensor_bus_init(void)
 {
     esp_err_t ret;
 
-    ESP_LOGI(TAG, "Initializing SCD40 CO2 sensor...");
-
     // Configure SCD40 sensor
     scd40_config_t sensor_config = {
         .scl_io_num = I2C_MASTER_SCL_IO,
@@ -164,61 +554,163 @@ static esp_err_t sensor_init(void)
         }
     }
 
-    ret = scd40_wake_up(&g_sensor);
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Wake up returned: %s", esp_err_to_name(ret));
-    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Initialize the SCD40 sensor and read serial number
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+static esp_err_t sensor_init(void)
+{
+    ESP_LOGI(TAG, "Initializing SCD40 CO2 sensor...");
 
-    // Stop any ongoing periodic measurements (non-critical)
-    ret = scd40_stop_periodic_measurement(&g_sensor);
+    esp_err_t ret = sensor_bus_init();
     if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Stop periodic measurement returned: %s (may not have been running)",
-                 esp_err_to_name(ret));
+        return ret;
     }
 
-    // Small delay to ensure sensor is ready
-    vTaskDelay(pdMS_TO_TICKS(100));
-
-    // Get and display serial number (non-critical)
-    uint64_t serial_number = 0;
-    ret = scd40_get_serial_number(&g_sensor, &serial_number);
-    if (ret == ESP_OK) {
+    // The chain below stops whatever the sensor was doing
+    s_sensor_state.mode = SENSOR_MODE_UNKNOWN;
+
+    // Wake up, stop any ongoing periodic measurement and read the serial number
+    // in one queued chain. Failures are non-critical; the engine logs them.
+    // The task blocks on the event group, so the CPU can light-sleep through
+    // the 500 ms stop time instead of spinning in vTaskDelay.
+    scd40_async_request_t wake_req, stop_req, serial_req;
+    scd40_async_request_init(&wake_req, SCD40_WAKE_UP, 0);
+    scd40_async_request_init(&stop_req, SCD40_STOP_PERIODIC_MEASUREMENT, 0);
+    scd40_async_request_init(&serial_req, SCD40_GET_SERIAL_NUMBER, 0);
+    serial_req.event_group = s_sensor_events;
+    serial_req.done_bits = SENSOR_PREPARED_BIT;
+
+    scd40_async_submit(&g_sensor.engine, &wake_req);
+    scd40_async_submit(&g_sensor.engine, &stop_req);
+    scd40_async_submit(&g_sensor.engine, &serial_req);
+    xEventGroupWaitBits(s_sensor_events, SENSOR_PREPARED_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+
+    if (serial_req.result == ESP_OK) {
+        uint64_t serial = ((uint64_t)serial_req.words[0] << 32) |
+                          ((uint64_t)serial_req.words[1] << 16) | serial_req.words[2];
+        if (serial != s_sensor_state.serial) {
+            // Different sensor: probe its variant and learn its latencies again
+            s_sensor_state.variant = SCD4X_VARIANT_UNKNOWN;
+            s_sensor_state.serial = serial;
+            memset(s_sensor_state.ready, 0, sizeof(s_sensor_state.ready));
+            s_sensor_state.settings.valid = false;
+            for (int i = 0; i < POLICY_CHANNELS; i++) {
+                sensor_filter_reset(&s_filter_state[i]);
+            }
+        }
         ESP_LOGI(TAG, "SCD40 Serial Number: %04X-%04X-%04X",
-                 (uint16_t)(serial_number >> 32),
-                 (uint16_t)(serial_number >> 16),
-                 (uint16_t)(serial_number & 0xFFFF));
+                 serial_req.words[0], serial_req.words[1], serial_req.words[2]);
     } else {
         ESP_LOGW(TAG, "Failed to read serial number: %s (continuing anyway)",
-                 esp_err_to_name(ret));
+                 esp_err_to_name(serial_req.result));
+    }
+    s_sensor_state.mode = SENSOR_MODE_IDLE;
+
+    // The scd40.h calls queue on the same engine and block on its event group.
+    // Probed once per sensor, then kept in RTC memory
+    if (s_sensor_state.variant == SCD4X_VARIANT_UNKNOWN) {
+        scd40_variant_t variant;
+        scd40_detect_variant(&g_sensor, &variant);
+        s_sensor_state.variant = variant;
+    }
+
+    // Written and persisted only when they changed, to spare the EEPROM
+    scd40_settings_t desired = config_sensor_settings();
+    ret = scd40_sync_settings(&g_sensor, &desired, &s_sensor_state.settings);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to apply sensor settings: %s (retrying next wake)", esp_err_to_name(ret));
     }
 
     return ESP_OK;
 }
 
-static esp_err_t start_measure_single_shot(void)
+/**
+ * @brief Attach to the sensor for this wake
+ *
+ * After a sleep the sensor is in the state the last wake left it in
+ * (powered down, idle or low-power periodic) and only the bus needs to be
+ * attached; everything else, including a settings change still to be
+ * written to the sensor, is a full init.
+ *
+ * @param resumed Woken by the timer rather than powered on or reset
+ * @return ESP_OK on success, error code otherwise
+ */
+static esp_err_t sensor_prepare(bool resumed)
 {
-    esp_err_t ret;
+    bool retained = (s_sensor_state.mode == SENSOR_MODE_POWERED_DOWN ||
+                     s_sensor_state.mode == SENSOR_MODE_IDLE ||
+                     s_sensor_state.mode == SENSOR_MODE_LOW_POWER_PERIODIC) &&
+                    resumed && !config_sensor_pending();
+
+    wake_profiler_begin(WAKE_PHASE_SENSOR_INIT);
+    esp_err_t ret = retained ? sensor_bus_init() : sensor_init();
+    wake_profiler_end(WAKE_PHASE_SENSOR_INIT);
+    return ret;
+}
 
-    // Start periodic measurement with retries
-    for (int attempt = 1; attempt <= MAX_RETRIES; attempt++) {
-        ret = scd40_measure_single_shot(&g_sensor);
-        if (ret == ESP_OK) {
-            break;
+/**
+ * @brief Wait until the sensor has a sample
+ *
+ * Sleeps until the learned conversion latency has passed, then polls
+ * get_data_ready_status with a short backoff.
+ *
+ * @param strategy How the conversion was started, selects the latency estimate
+ * @param start_us When the conversion was started (esp_timer time)
+ * @return ESP_OK when data is ready, ESP_ERR_TIMEOUT otherwise
+ */
+static esp_err_t sensor_wait_ready(scd40_strategy_t strategy, int64_t start_us)
+{
+    const ready_scheduler_config_t config = {
+        .initial_ms = scd40_strategy_wait_ms(strategy),
+        .poll_min_ms = CONFIG_CO2_SENSOR_READY_POLL_MIN_MS,
+        .poll_max_ms = CONFIG_CO2_SENSOR_READY_POLL_MAX_MS,
+        .timeout_ms = CONFIG_CO2_SENSOR_READY_TIMEOUT_MS,
+    };
+    ready_scheduler_estimate_t *estimate = &s_sensor_state.ready[strategy];
+    ready_scheduler_wait_t wait;
+
+    int32_t poll_ms = ready_scheduler_begin(&wait, &config, estimate);
+    while (poll_ms >= 0) {
+        int64_t elapsed_ms = (esp_timer_get_time() - start_us) / 1000;
+        if (poll_ms > elapsed_ms) {
+            vTaskDelay(pdMS_TO_TICKS(poll_ms - elapsed_ms));
         }
 
-        ESP_LOGW(TAG, "Start measurement single shot attempt %d/%d failed: %s",
-                 attempt, MAX_RETRIES, esp_err_to_name(ret));
+        uint32_t now_ms = (esp_timer_get_time() - start_us) / 1000;
+        bool data_ready = false;
+        esp_err_t ret = scd40_get_data_ready_status(&g_sensor, &data_ready);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Data ready status failed: %s", esp_err_to_name(ret));
+        }
+        poll_ms = ready_scheduler_poll(&wait, now_ms, ret == ESP_OK && data_ready);
     }
 
-    return ret;
+    if (poll_ms == READY_SCHEDULER_TIMEOUT) {
+        ESP_LOGW(TAG, "No data %lu ms after start (%u polls)",
+                 (unsigned long)wait.last_miss_ms, wait.polls);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    ESP_LOGI(TAG, "Data ready after %lu ms (%u polls), %s latency now %lu ms",
+             (unsigned long)wait.ready_ms, wait.polls, scd40_strategy_name(strategy),
+             (unsigned long)ready_scheduler_expected_ms(&config, estimate));
+    return ESP_OK;
 }
+
 /**
  * @brief Get CO2, temperature, and humidity data from sensor
  *
+ * @param strategy How the conversion was started
+ * @param start_us When the conversion was started (esp_timer time)
  * @param data Pointer to measurement structure to fill
  * @return ESP_OK on success, error code otherwise
  */
-static esp_err_t sensor_get_data(scd40_measurement_t *data)
+static esp_err_t sensor_get_data(scd40_strategy_t strategy, int64_t start_us, scd40_measurement_t *data)
 {
     esp_err_t ret;
 
@@ -226,31 +718,15 @@ static esp_err_t sensor_get_data(scd40_measurement_t *data)
         return ESP_ERR_INVALID_ARG;
     }
 
-    bool data_ready = false;
-
-    // Wait for data ready status with retries
-    for (int attempt = 1; attempt <= MAX_RETRIES; attempt++) {
-        ret = scd40_get_data_ready_status(&g_sensor, &data_ready);
-        if (ret == ESP_OK && data_ready) {
-            break;
-        }
-        if (ret != ESP_OK) {
-            ESP_LOGW(TAG, "Wait for data ready status attempt %d/%d failed: %s",
-                     attempt, MAX_RETRIES, esp_err_to_name(ret));
-        }
-        if (!data_ready) {
-            ESP_LOGW(TAG, "Data not ready %d/%d", attempt, MAX_RETRIES);
-        }
-
-        vTaskDelay(pdMS_TO_TICKS(RETRY_DELAY_MS*3));
-    }
+    // A late sample is still read: the retries below report the failure
+    sensor_wait_ready(strategy, start_us);
 
     // Read measurement with retries
     for (int attempt = 1; attempt <= MAX_RETRIES; attempt++) {
         ret = scd40_read_measurement(&g_sensor, data);
         if (ret == ESP_OK) {
-            ESP_LOGI(TAG, "CO2: %d ppm | Temperature: %.2f °C | Humidity: %.2f %%",
-                     data->co2_ppm, data->temperature_c, data->humidity_rh);
+            ESP_LOGI(TAG, "CO2: %d ppm | Temperature: %s%d.%02d °C | Humidity: %d.%02d %%",
+                     data->co2_ppm, CENTI_PARTS(data->temperature), data->humidity / 100, data->humidity % 100);
             return ESP_OK;
         }
 
@@ -267,16 +743,153 @@ static esp_err_t sensor_get_data(scd40_measurement_t *data)
 }
 
 /**
- * @brief Cleanup sensor resources
+ * @brief Read one sample from a sensor left in low-power periodic mode
+ *
+ * This is the whole sensor work of a retained wake: a single
+ * read_measurement on a freshly attached bus.
+ *
+ * @param data Pointer to measurement structure to fill
+ * @return ESP_OK on success, error code otherwise
+ */
+static esp_err_t sensor_read_retained(scd40_measurement_t *data)
+{
+    esp_err_t ret = scd40_read_measurement(&g_sensor, data);
+    if (ret == ESP_OK && data->co2_ppm > 0) {
+        ESP_LOGI(TAG, "Retained sample ready %lld ms after boot - CO2: %d ppm | Temperature: %s%d.%02d °C | Humidity: %d.%02d %%",
+                 esp_timer_get_time() / 1000, data->co2_ppm, CENTI_PARTS(data->temperature),
+                 data->humidity / 100, data->humidity % 100);
+        return ESP_OK;
+    }
+
+    // Sensor lost its state or has no new sample: fall back to a full restart
+    ESP_LOGW(TAG, "Retained read failed (%s), restarting sensor", esp_err_to_name(ret));
+    scd40_stop_periodic_measurement(&g_sensor);
+    s_sensor_state.mode = SENSOR_MODE_IDLE;
+    return ret == ESP_OK ? ESP_ERR_INVALID_RESPONSE : ret;
+}
+
+/**
+ * @brief Take a single-shot sample on an SCD41 left idle or powered down
+ *
+ * RH/T-only samples carry the last CO2 reading.
+ *
+ * @param strategy SCD40_STRATEGY_SINGLE_SHOT or SCD40_STRATEGY_SINGLE_SHOT_RHT_ONLY
+ * @param data Pointer to measurement structure to fill
+ * @return ESP_OK on success, error code otherwise
+ */
+static esp_err_t sensor_single_shot(scd40_strategy_t strategy, scd40_measurement_t *data)
+{
+    bool rht_only = strategy == SCD40_STRATEGY_SINGLE_SHOT_RHT_ONLY;
+    int shots = 1;
+
+    if (s_sensor_state.mode == SENSOR_MODE_POWERED_DOWN) {
+        // The first single shot after wake_up must be discarded
+        scd40_wake_up(&g_sensor);
+        shots = 2;
+    }
+    s_sensor_state.mode = SENSOR_MODE_IDLE;
+
+    esp_err_t ret = ESP_OK;
+    for (int shot = 0; shot < shots && ret == ESP_OK; shot++) {
+        // Returns once the conversion time has passed, so the first poll normally finds the sample
+        int64_t start_us = esp_timer_get_time();
+        ret = rht_only ? scd40_measure_single_shot_rht_only(&g_sensor) : scd40_measure_single_shot(&g_sensor);
+        if (ret == ESP_OK) {
+            ret = sensor_get_data(strategy, start_us, data);
+        }
+    }
+
+    if (ret == ESP_OK && rht_only) {
+        data->co2_ppm = s_sensor_state.co2_ppm;
+    }
+    return ret;
+}
+
+/**
+ * @brief Choose how the next wake takes its sample
+ *
+ * @param sleep_s Time until the next wake
+ * @param now_s Current RTC time
+ * @return Strategy for the next wake
+ */
+static scd40_strategy_t sensor_next_strategy(uint32_t sleep_s, uint32_t now_s)
+{
+    scd40_variant_t variant = (scd40_variant_t)s_sensor_state.variant;
+    scd40_strategy_t strategy;
+
+#if CONFIG_CO2_SENSOR_STRATEGY_AUTO
+    // While CO2 is flat a recent reading can stand in for a new conversion
+    int32_t slope = wake_interval_slope(&s_wake_state);
+    bool co2_needed = CONFIG_CO2_SENSOR_CO2_REFRESH_SEC == 0 ||
+                      slope > s_wake_config.stable_slope || slope < -s_wake_config.stable_slope ||
+                      now_s + sleep_s - s_sensor_state.co2_time_s > CONFIG_CO2_SENSOR_CO2_REFRESH_SEC;
+    strategy = scd40_strategy_select(&s_energy_model, variant, sleep_s, co2_needed);
+#elif CONFIG_CO2_SENSOR_STRATEGY_LOW_POWER_PERIODIC
+    strategy = SCD40_STRATEGY_LOW_POWER_PERIODIC;
+#elif CONFIG_CO2_SENSOR_STRATEGY_SINGLE_SHOT
+    strategy = scd40_variant_has_single_shot(variant) ? SCD40_STRATEGY_SINGLE_SHOT : SCD40_STRATEGY_PERIODIC;
+#else
+    strategy = SCD40_STRATEGY_PERIODIC;
+#endif
+
+    ESP_LOGI(TAG, "Next sample: %s on %s, about %lu uC", scd40_strategy_name(strategy),
+             scd40_variant_name(variant),
+             (unsigned long)scd40_strategy_charge_uc(&s_energy_model, strategy, sleep_s));
+    return strategy;
+}
+
+/**
+ * @brief Leave the sensor in the state the next wake's strategy expects
+ *
+ * Low-power periodic keeps measuring, single shot stays idle (a power-down
+ * would cost a discarded shot) and periodic is powered down.
+ *
+ * @param next Strategy of the next wake
  */
-static void sensor_cleanup(void)
+static void sensor_cleanup(scd40_strategy_t next)
 {
+    esp_err_t ret = ESP_OK;
+
     ESP_LOGI(TAG, "Cleaning up sensor resources...");
-    esp_err_t ret = scd40_power_down(&g_sensor);
+    if (s_sensor_state.mode == SENSOR_MODE_PERIODIC ||
+        (s_sensor_state.mode == SENSOR_MODE_LOW_POWER_PERIODIC && next != SCD40_STRATEGY_LOW_POWER_PERIODIC)) {
+        scd40_stop_periodic_measurement(&g_sensor);
+        s_sensor_state.mode = SENSOR_MODE_IDLE;
+    }
+
+    switch (next) {
+    case SCD40_STRATEGY_LOW_POWER_PERIODIC:
+        if (s_sensor_state.mode != SENSOR_MODE_LOW_POWER_PERIODIC) {
+            ret = scd40_start_low_power_periodic_measurement(&g_sensor);
+            if (ret == ESP_OK) {
+                s_sensor_state.mode = SENSOR_MODE_LOW_POWER_PERIODIC;
+            }
+        }
+        break;
+    case SCD40_STRATEGY_SINGLE_SHOT:
+    case SCD40_STRATEGY_SINGLE_SHOT_RHT_ONLY:
+        break;
+    default:
+        if (s_sensor_state.mode != SENSOR_MODE_POWERED_DOWN) {
+            ret = scd40_power_down(&g_sensor);
+            if (ret == ESP_OK) {
+                s_sensor_state.mode = SENSOR_MODE_POWERED_DOWN;
+            }
+        }
+        break;
+    }
+
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to power down sensor: %s", esp_err_to_name(ret));
+        // Unknown sensor state: the next wake does a full init
+        ESP_LOGE(TAG, "Failed to prepare sensor for %s: %s", scd40_strategy_name(next), esp_err_to_name(ret));
+        s_sensor_state.mode = SENSOR_MODE_UNKNOWN;
+    }
+    s_sensor_state.strategy = next;
+
+    // A frame still in the bus queue references g_sensor; keep the device until it completes
+    if (scd40_deinit(&g_sensor) != ESP_OK) {
+        return;
     }
-    scd40_deinit(&g_sensor);
     ESP_LOGI(TAG, "Sensor cleanup complete");
 }
 
@@ -313,7 +926,8 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
             } else {
                 ESP_LOGI(TAG, "Device rebooted");
                 led_signal_set_state(LED_STATE_CONNECTED);
-                go_to_deep_sleep();
+                wake_profiler_end(WAKE_PHASE_REJOIN);
+                xEventGroupSetBits(s_sensor_events, ZIGBEE_READY_BIT);
             }
         } else {
             ESP_LOGW(TAG, "Failed to initialize Zigbee stack (status: %s)",
@@ -333,7 +947,9 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
                      esp_zb_get_pan_id(), esp_zb_get_current_channel(), esp_zb_get_short_address());
 
             led_signal_set_state(LED_STATE_CONNECTED);
-            go_to_deep_sleep();
+            s_fresh_join = true;
+            wake_profiler_end(WAKE_PHASE_REJOIN);
+            xEventGroupSetBits(s_sensor_events, ZIGBEE_READY_BIT);
         } else {
             ESP_LOGI(TAG, "Network steering was not successful (status: %s)",
                      esp_err_to_name(err_status));
@@ -342,6 +958,10 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
                                    ESP_ZB_BDB_MODE_NETWORK_STEERING, 1000);
         }
         break;
+    case ESP_ZB_COMMON_SIGNAL_CAN_SLEEP:
+        // Raised only with esp_zb_sleep_enable(), i.e. in light-sleep mode
+        esp_zb_sleep_now();
+        break;
     default:
         ESP_LOGI(TAG, "ZDO signal: %s (0x%x), status: %s",
                  esp_zb_zdo_signal_to_string(sig_type), sig_type,
@@ -350,14 +970,96 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
     }
 }
 
+/**
+ * @brief Mark reports as confirmed and wake the sensor task when none is left
+ *
+ * @param reports REPORT_* bits that were confirmed
+ */
+static void report_confirmed(uint8_t reports)
+{
+    if (s_reports_pending == 0) {
+        return;
+    }
+    s_reports_pending &= ~reports;
+    if (s_reports_pending == 0) {
+        wake_profiler_end(WAKE_PHASE_REPORT);
+        xEventGroupSetBits(s_sensor_events, REPORT_CONFIRMED_BIT);
+    }
+}
+
+/**
+ * @brief Pending report sent with a ZCL sequence number
+ *
+ * @return Its REPORT_* bit, 0 if no pending report has that number
+ */
+static uint8_t report_bit_for_tsn(uint8_t tsn)
+{
+    for (int i = 0; i < REPORT_COUNT; i++) {
+        if ((s_reports_pending & BIT(i)) && s_report_tsn[i] == tsn) {
+            return BIT(i);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief APS data confirm: the only source of report confirmations
+ *
+ * The confirm carries the frame that was sent, so its ZCL sequence number
+ * names the report. Confirms of anything else, including reports given up
+ * on after the timeout, are ignored. Default responses are not counted:
+ * the coordinator may not send them, and counting both would confirm a
+ * report twice.
+ */
+static void zb_aps_data_confirm_handler(esp_zb_apsde_data_confirm_t confirm)
+{
+    if (confirm.src_endpoint != HA_ESP_SENSOR_ENDPOINT || s_reports_pending == 0 || confirm.asdu == NULL) {
+        return;
+    }
+    // ZCL header: frame control, manufacturer code if manufacturer specific, sequence number
+    uint32_t tsn_offset = (confirm.asdu_length > 0 && (confirm.asdu[0] & 0x04)) ? 3 : 1;
+    if (confirm.asdu_length <= tsn_offset) {
+        return;
+    }
+    uint8_t report = report_bit_for_tsn(confirm.asdu[tsn_offset]);
+    if (report == 0) {
+        return;
+    }
+    if (confirm.status != 0) {
+        // Undelivered history stays buffered for the next uplink
+        ESP_LOGW(TAG, "Report delivery failed (APS status: 0x%x)", confirm.status);
+        s_report_failed = true;
+    }
+    report_confirmed(report);
+}
+
 static esp_err_t zb_action_handler(esp_zb_core_action_callback_id_t callback_id, const void *message)
 {
     esp_err_t ret = ESP_OK;
     switch (callback_id) {
-    case ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID:
-        // Handle attribute writes if needed in the future
-        ESP_LOGI(TAG, "Received attribute callback");
+    case ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID: {
+        const esp_zb_zcl_set_attr_value_message_t *set = message;
+        if (set->info.status != ESP_ZB_ZCL_STATUS_SUCCESS || set->info.cluster != DEVICE_CONFIG_CLUSTER_ID) {
+            ESP_LOGI(TAG, "Received attribute callback");
+            break;
+        }
+        // Sensor EEPROM settings follow on the next wake that fully inits the sensor
+        if (device_config_zcl_write(set->info.dst_endpoint, &s_config.config, set)) {
+            ESP_LOGI(TAG, "Setting 0x%04x changed", set->attribute.id);
+            device_config_save(&s_config);
+            config_apply();
+        }
         break;
+    }
+    case ESP_ZB_CORE_CMD_DEFAULT_RESP_CB_ID: {
+        const esp_zb_zcl_cmd_default_resp_message_t *resp = message;
+        // Delivery is confirmed by the APS acknowledgement; only a refusal is worth a log line
+        if (resp->resp_to_cmd == ESP_ZB_ZCL_CMD_REPORT_ATTRIB && resp->status_code != ESP_ZB_ZCL_STATUS_SUCCESS) {
+            ESP_LOGW(TAG, "Report refused (cluster: 0x%04x, status: 0x%x)",
+                     resp->info.cluster, resp->status_code);
+        }
+        break;
+    }
     default:
         ESP_LOGW(TAG, "Receive Zigbee action(0x%x) callback", callback_id);
         break;
@@ -365,37 +1067,33 @@ static esp_err_t zb_action_handler(esp_zb_core_action_callback_id_t callback_id,
     return ret;
 }
 
-static void create_zigbee_sensor_device(const scd40_measurement_t *data)
+/**
+ * @brief Register the sensor endpoint
+ *
+ * The device is created before the first sample exists, so measured values
+ * start as "unknown" and are filled in by zigbee_update_sensor_attributes().
+ */
+static void create_zigbee_sensor_device(void)
 {
-    // Convert sensor measurements to Zigbee attribute format
-    int16_t temp_value = (int16_t)(data->temperature_c * 100);      // Zigbee uses 0.01°C units
-    uint16_t humidity_value = (uint16_t)(data->humidity_rh * 100);  // Zigbee uses 0.01% RH units
-    float co2_value = (float)data->co2_ppm / 1000000.0f;            // Zigbee uses fraction (ppm/1000000)
-
-    ESP_LOGI(TAG, "Creating Zigbee sensor device with:");
-    ESP_LOGI(TAG, "  Temperature: %.2f°C (raw: %d)", data->temperature_c, temp_value);
-    ESP_LOGI(TAG, "  Humidity: %.2f%% (raw: %u)", data->humidity_rh, humidity_value);
-    ESP_LOGI(TAG, "  CO2: %d ppm (raw: %.6f)", data->co2_ppm, co2_value);
-
-    // Create temperature measurement cluster with actual sensor data
+    // Create temperature measurement cluster
     esp_zb_temperature_meas_cluster_cfg_t temp_cfg = {
-        .measured_value = temp_value,
+        .measured_value = ZCL_TEMPERATURE_UNKNOWN,
         .min_value = -5000,   // -50°C
         .max_value = 10000,   // 100°C
     };
     esp_zb_attribute_list_t *temp_cluster = esp_zb_temperature_meas_cluster_create(&temp_cfg);
 
-    // Create humidity measurement cluster with actual sensor data
+    // Create humidity measurement cluster
     esp_zb_humidity_meas_cluster_cfg_t humidity_cfg = {
-        .measured_value = humidity_value,
+        .measured_value = ZCL_HUMIDITY_UNKNOWN,
         .min_value = 0,
         .max_value = 10000,   // 100% RH
     };
     esp_zb_attribute_list_t *humidity_cluster = esp_zb_humidity_meas_cluster_create(&humidity_cfg);
 
-    // Create CO2 measurement cluster with actual sensor data
+    // Create CO2 measurement cluster
     esp_zb_carbon_dioxide_measurement_cluster_cfg_t co2_cfg = {
-        .measured_value = co2_value,
+        .measured_value = 0.0f,
         .min_measured_value = 0.0f,      // 0 ppm
         .max_measured_value = 0.01f,     // 10,000 ppm (1%)
     };
@@ -404,7 +1102,11 @@ static void create_zigbee_sensor_device(const scd40_measurement_t *data)
     // Create basic cluster with manufacturer info
     esp_zb_basic_cluster_cfg_t basic_cfg = {
         .zcl_version = ESP_ZB_ZCL_BASIC_ZCL_VERSION_DEFAULT_VALUE,
+#if CONFIG_CO2_SENSOR_BATTERY
+        .power_source = ESP_ZB_ZCL_BASIC_POWER_SOURCE_BATTERY,
+#else
         .power_source = ESP_ZB_ZCL_BASIC_POWER_SOURCE_DEFAULT_VALUE,
+#endif
     };
     esp_zb_attribute_list_t *basic_cluster = esp_zb_basic_cluster_create(&basic_cfg);
     esp_zb_basic_cluster_add_attr(basic_cluster, ESP_ZB_ZCL_ATTR_BASIC_MANUFACTURER_NAME_ID,
@@ -418,6 +1120,14 @@ static void create_zigbee_sensor_device(const scd40_measurement_t *data)
     };
     esp_zb_attribute_list_t *identify_cluster = esp_zb_identify_cluster_create(&identify_cfg);
 
+    // Create history cluster. The initial value is a full-length, empty frame
+    // so the attribute storage fits every frame sent later.
+    s_history_value[0] = SAMPLE_RING_FRAME_MAX_LEN;
+    esp_zb_attribute_list_t *history_cluster = esp_zb_zcl_attr_list_create(CO2_HISTORY_CLUSTER_ID);
+    esp_zb_custom_cluster_add_custom_attr(history_cluster, CO2_HISTORY_ATTR_ID, ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING,
+                                          s_history_value);
+
     // Create cluster list and add all clusters
     esp_zb_cluster_list_t *cluster_list = esp_zb_zcl_cluster_list_create();
     esp_zb_cluster_list_add_basic_cluster(cluster_list, basic_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
@@ -425,6 +1135,15 @@ static void create_zigbee_sensor_device(const scd40_measurement_t *data)
     esp_zb_cluster_list_add_temperature_meas_cluster(cluster_list, temp_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
     esp_zb_cluster_list_add_humidity_meas_cluster(cluster_list, humidity_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
     esp_zb_cluster_list_add_carbon_dioxide_measurement_cluster(cluster_list, co2_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+    esp_zb_cluster_list_add_custom_cluster(cluster_list, history_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+    esp_zb_cluster_list_add_custom_cluster(cluster_list, wake_profiler_zcl_cluster_create(), ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+    esp_zb_cluster_list_add_custom_cluster(cluster_list, flash_log_zcl_cluster_create(), ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+#if CONFIG_CO2_SENSOR_BATTERY
+    esp_zb_cluster_list_add_power_config_cluster(cluster_list, battery_zcl_cluster_create(&s_battery_config, &s_battery),
+                                                 ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+#endif
+    esp_zb_cluster_list_add_custom_cluster(cluster_list, device_config_zcl_cluster_create(&s_config.config),
+                                           ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
 
     // Create endpoint and add cluster list
     esp_zb_ep_list_t *ep_list = esp_zb_ep_list_create();
@@ -439,25 +1158,349 @@ static void create_zigbee_sensor_device(const scd40_measurement_t *data)
     // Register the device
     esp_zb_device_register(ep_list);
     esp_zb_core_action_handler_register(zb_action_handler);
+    esp_zb_aps_data_confirm_handler_register(zb_aps_data_confirm_handler);
 
     ESP_LOGI(TAG, "Zigbee multi-sensor device created with all 3 measurements");
 }
 
+/**
+ * @brief Convert a measurement to Zigbee attribute units and timestamp it
+ *
+ * @param data Measurement from the sensor
+ * @param sample Output sample
+ */
+static void sample_from_measurement(const scd40_measurement_t *data, sample_ring_sample_t *sample)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    sample->timestamp_s = now.tv_sec;
+    sample->co2_ppm = data->co2_ppm;
+    sample->temperature = data->temperature;                        // Already in Zigbee 0.01°C units
+    sample->humidity = data->humidity;                              // Already in Zigbee 0.01% RH units
+}
+
+/**
+ * @brief Smooth a sample before it is stored and reported
+ *
+ * @param sample Sample, filtered in place
+ * @param co2_fresh False when CO2 was carried over from an earlier wake; it is not fed again
+ */
+static void sample_filter(sample_ring_sample_t *sample, bool co2_fresh)
+{
+    bool rejected;
+
+    if (co2_fresh) {
+        int32_t co2 = sensor_filter_update(&s_filter_config[POLICY_CO2], &s_filter_state[POLICY_CO2],
+                                           sample->co2_ppm, &rejected);
+        if (rejected) {
+            ESP_LOGW(TAG, "CO2 outlier %u ppm replaced by %ld ppm", sample->co2_ppm, (long)co2);
+        }
+        sample->co2_ppm = (uint16_t)co2;
+    }
+
+    int32_t temperature = sensor_filter_update(&s_filter_config[POLICY_TEMPERATURE],
+                                               &s_filter_state[POLICY_TEMPERATURE], sample->temperature, &rejected);
+    if (rejected) {
+        ESP_LOGW(TAG, "Temperature outlier %d replaced by %ld", sample->temperature, (long)temperature);
+    }
+    sample->temperature = (int16_t)temperature;
+
+    // 0 marks a missing humidity reading; keep it out of the history
+    if (sample->humidity != 0) {
+        int32_t humidity = sensor_filter_update(&s_filter_config[POLICY_HUMIDITY],
+                                                &s_filter_state[POLICY_HUMIDITY], sample->humidity, &rejected);
+        if (rejected) {
+            ESP_LOGW(TAG, "Humidity outlier %u replaced by %ld", sample->humidity, (long)humidity);
+        }
+        sample->humidity = (uint16_t)humidity;
+    }
+}
+
+/**
+ * @brief Write a sample into the sensor endpoint's attributes
+ *
+ * @param sample Sample to publish
+ */
+static void zigbee_update_sensor_attributes(const sample_ring_sample_t *sample)
+{
+    int16_t temp_value = sample->temperature;
+    uint16_t humidity_value = sample->humidity;
+    uint32_t co2_value = scd40_co2_fraction_bits(sample->co2_ppm);  // Zigbee uses float fraction (ppm/1000000)
+
+    ESP_LOGI(TAG, "Updating Zigbee attributes with:");
+    ESP_LOGI(TAG, "  Temperature: raw %d", temp_value);
+    ESP_LOGI(TAG, "  Humidity: raw %u", humidity_value);
+    ESP_LOGI(TAG, "  CO2: %u ppm (raw: 0x%08lX)", sample->co2_ppm, (unsigned long)co2_value);
+
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_zb_zcl_set_attribute_val(HA_ESP_SENSOR_ENDPOINT,
+                                 ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+                                 ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID,
+                                 &temp_value, false);
+    esp_zb_zcl_set_attribute_val(HA_ESP_SENSOR_ENDPOINT,
+                                 ESP_ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT,
+                                 ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 ESP_ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_ID,
+                                 &humidity_value, false);
+    esp_zb_zcl_set_attribute_val(HA_ESP_SENSOR_ENDPOINT,
+                                 ESP_ZB_ZCL_CLUSTER_ID_CARBON_DIOXIDE_MEASUREMENT,
+                                 ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 ESP_ZB_ZCL_ATTR_CARBON_DIOXIDE_MEASUREMENT_MEASURED_VALUE_ID,
+                                 &co2_value, false);
+    esp_zb_lock_release();
+}
+
+/**
+ * @brief Send one attribute report and mark it pending
+ *
+ * Must be called under the Zigbee lock, so its confirm cannot arrive before
+ * the sequence number is recorded.
+ *
+ * @param report REPORT_* bit of the attribute
+ */
+static void zigbee_report_attribute(uint8_t report, uint16_t cluster_id, uint16_t attr_id)
+{
+    esp_zb_zcl_report_attr_cmd_t report_cmd = {
+        .zcl_basic_cmd = {
+            .dst_addr_u.addr_short = REPORT_DST_ADDR,
+            .dst_endpoint = REPORT_DST_ENDPOINT,
+            .src_endpoint = HA_ESP_SENSOR_ENDPOINT,
+        },
+        .address_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+        .clusterID = cluster_id,
+        .direction = ESP_ZB_ZCL_CMD_DIRECTION_TO_CLI,
+        .attributeID = attr_id,
+    };
+    s_report_tsn[__builtin_ctz(report)] = esp_zb_zcl_report_attr_cmd_req(&report_cmd);
+    s_reports_pending |= report;
+}
+
+/**
+ * @brief Send one frame of buffered samples
+ *
+ * The frame is written into the history attribute and reported. Frames are
+ * sent one at a time so the attribute is not overwritten before the stack
+ * has built the report.
+ *
+ * @param first Index of the first buffered sample to send
+ * @return Number of samples in the frame, 0 if there is nothing to send
+ */
+static uint8_t zigbee_report_history(uint8_t first)
+{
+    uint8_t encoded;
+    size_t len = sample_ring_encode(&s_samples, first, &s_history_value[1], SAMPLE_RING_FRAME_MAX_LEN, &encoded);
+    if (len == 0) {
+        return 0;
+    }
+    s_history_value[0] = len;
+
+    xEventGroupClearBits(s_sensor_events, REPORT_CONFIRMED_BIT);
+
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_zb_zcl_set_attribute_val(HA_ESP_SENSOR_ENDPOINT, CO2_HISTORY_CLUSTER_ID,
+                                 ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, CO2_HISTORY_ATTR_ID,
+                                 s_history_value, false);
+    s_report_failed = false;
+    s_reports_pending = 0;
+    zigbee_report_attribute(REPORT_HISTORY, CO2_HISTORY_CLUSTER_ID, CO2_HISTORY_ATTR_ID);
+    esp_zb_lock_release();
+
+    return encoded;
+}
 
 /**
- * @brief Main sensor task that periodically takes measurements
+ * @brief Wait until the reports in flight are confirmed
+ *
+ * On timeout the reports are given up on, so a late confirm cannot be taken
+ * for one of the next reports.
+ *
+ * @return true if every report was confirmed and none failed
+ */
+static bool zigbee_wait_reports(void)
+{
+    EventBits_t bits = xEventGroupWaitBits(s_sensor_events, REPORT_CONFIRMED_BIT, pdFALSE, pdTRUE,
+                                           pdMS_TO_TICKS(CONFIG_CO2_SENSOR_REPORT_TIMEOUT_MS));
+    if (!(bits & REPORT_CONFIRMED_BIT)) {
+        ESP_LOGW(TAG, "Report not confirmed within %d ms", CONFIG_CO2_SENSOR_REPORT_TIMEOUT_MS);
+        esp_zb_lock_acquire(portMAX_DELAY);
+        s_reports_pending = 0;
+        esp_zb_lock_release();
+        return false;
+    }
+    return !s_report_failed;
+}
+
+/**
+ * @brief Deliver the buffered history, oldest first
+ *
+ * Delivered samples are removed from the buffer; the rest stays for the
+ * next uplink.
+ */
+static void zigbee_flush_history(void)
+{
+    uint8_t sent = 0;
+    while (sent < sample_ring_count(&s_samples)) {
+        uint8_t n = zigbee_report_history(sent);
+        if (n == 0 || !zigbee_wait_reports()) {
+            break;
+        }
+        sent += n;
+    }
+
+    ESP_LOGI(TAG, "Flushed %u/%u buffered samples (%lu overwritten so far)",
+             sent, sample_ring_count(&s_samples), (unsigned long)s_samples.overwritten);
+    sample_ring_drop(&s_samples, sent);
+}
+
+static void policy_values(const sample_ring_sample_t *sample, int32_t values[POLICY_CHANNELS])
+{
+    values[POLICY_CO2] = sample->co2_ppm;
+    values[POLICY_TEMPERATURE] = sample->temperature;
+    values[POLICY_HUMIDITY] = sample->humidity;
+}
+
+/**
+ * @brief Send the measured values, the wake profile and a changed battery level
+ *
+ * The profile holds the statistics of the previous wakes; this one is
+ * folded in when it goes to sleep. Completion is signalled with
+ * REPORT_CONFIRMED_BIT once every report has been confirmed by its APS
+ * acknowledgement.
+ */
+static void zigbee_report_sensor_attributes(void)
+{
+    xEventGroupClearBits(s_sensor_events, REPORT_CONFIRMED_BIT);
+    wake_profiler_zcl_update(HA_ESP_SENSOR_ENDPOINT);
+    flash_log_zcl_update(HA_ESP_SENSOR_ENDPOINT);
+    uint8_t battery = battery_publish();
+
+    // Holding the lock keeps confirmations out until all reports are queued
+    esp_zb_lock_acquire(portMAX_DELAY);
+    s_report_failed = false;
+    s_reports_pending = 0;
+    zigbee_report_attribute(REPORT_TEMPERATURE, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+                            ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID);
+    zigbee_report_attribute(REPORT_HUMIDITY, ESP_ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT,
+                            ESP_ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_ID);
+    zigbee_report_attribute(REPORT_CO2, ESP_ZB_ZCL_CLUSTER_ID_CARBON_DIOXIDE_MEASUREMENT,
+                            ESP_ZB_ZCL_ATTR_CARBON_DIOXIDE_MEASUREMENT_MEASURED_VALUE_ID);
+    zigbee_report_attribute(REPORT_PROFILE, WAKE_PROFILER_CLUSTER_ID, WAKE_PROFILER_ATTR_PROFILE);
+    if (battery) {
+        zigbee_report_attribute(REPORT_BATTERY_VOLTAGE, ESP_ZB_ZCL_CLUSTER_ID_POWER_CONFIG,
+                                ESP_ZB_ZCL_ATTR_POWER_CONFIG_BATTERY_VOLTAGE_ID);
+        zigbee_report_attribute(REPORT_BATTERY_PERCENTAGE, ESP_ZB_ZCL_CLUSTER_ID_POWER_CONFIG,
+                                ESP_ZB_ZCL_ATTR_POWER_CONFIG_BATTERY_PERCENTAGE_REMAINING_ID);
+    }
+    esp_zb_lock_release();
+}
+
+/**
+ * @brief Log how long each phase of this wake took
+ *
+ * Measurement and rejoin overlap, so the time saved against running them
+ * back to back is their sum minus the span they actually covered.
+ */
+static void log_wake_timing(void)
+{
+    int64_t measure_start_us = wake_profiler_start_us(WAKE_PHASE_MEASURE);
+    int64_t zb_start_us = wake_profiler_start_us(WAKE_PHASE_STACK_INIT);
+    int64_t report_us = wake_profiler_start_us(WAKE_PHASE_REPORT);
+    int64_t measure_ms = wake_profiler_duration_us(WAKE_PHASE_MEASURE) / 1000;
+    int64_t join_ms = (wake_profiler_duration_us(WAKE_PHASE_STACK_INIT) +
+                       wake_profiler_duration_us(WAKE_PHASE_REJOIN)) / 1000;
+    int64_t first_us = measure_start_us < zb_start_us ? measure_start_us : zb_start_us;
+    int64_t span_ms = (report_us - first_us) / 1000;
+    int64_t confirm_us = wake_profiler_duration_us(WAKE_PHASE_REPORT);
+
+    if (zb_start_us < 0) {
+        // Joined SED: nothing overlapped
+        ESP_LOGI(TAG, "Wake timing: measure %lld ms, confirmed after %lld ms",
+                 measure_ms, confirm_us < 0 ? -1 : confirm_us / 1000);
+        return;
+    }
+
+    ESP_LOGI(TAG, "Wake timing: measure %lld ms, stack start and rejoin %lld ms, radio on %lld ms before report, "
+             "report at %lld ms after boot (overlap saved %lld ms), confirmed after %lld ms",
+             measure_ms, join_ms, (report_us - zb_start_us) / 1000, report_us / 1000,
+             measure_ms + join_ms - span_ms, confirm_us < 0 ? -1 : confirm_us / 1000);
+}
+
+/**
+ * @brief Zigbee task: start the stack and rejoin while the sensor measures
  *
  * @param args Task arguments (unused)
  */
-static void sensor_task(void *args)
+static void zigbee_task(void *args)
+{
+    // Initialize Zigbee stack; a joined SED lets it put the radio to sleep between polls
+    wake_profiler_begin(WAKE_PHASE_STACK_INIT);
+    if (s_sleep_mode == SLEEP_MODE_LIGHT) {
+        esp_zb_sleep_enable(true);
+    }
+    esp_zb_cfg_t zb_nwk_cfg = ESP_ZB_ZED_CONFIG();
+    esp_zb_init(&zb_nwk_cfg);
+
+    // Create Zigbee device
+    create_zigbee_sensor_device();
+    wake_profiler_end(WAKE_PHASE_STACK_INIT);
+
+    // Start Zigbee stack
+    wake_profiler_begin(WAKE_PHASE_REJOIN);
+    ESP_ERROR_CHECK(esp_zb_start(false));
+
+    // Main Zigbee loop
+    esp_zb_stack_main_loop();
+}
+
+static void zigbee_start(void)
+{
+    if (!s_zigbee_started) {
+        s_zigbee_started = true;
+        xTaskCreate(zigbee_task, "Zigbee_main", 4096, NULL, 5, NULL);
+    }
+}
+
+
+/**
+ * @brief Take a sample and report it if it is worth it
+ *
+ * @return Seconds until the next wake
+ */
+static uint32_t sensor_wake(void)
 {
     scd40_measurement_t measurement;
     esp_err_t ret;
+    bool sampled = false;
+    bool co2_fresh = true;
+    scd40_strategy_t strategy = (scd40_strategy_t)s_sensor_state.strategy;
 
+    wake_profiler_begin(WAKE_PHASE_MEASURE);
 
-    while (true) {
+    if (s_sensor_state.mode == SENSOR_MODE_LOW_POWER_PERIODIC) {
+        led_signal_set_state(LED_STATE_SENSOR_READING);
+        sampled = (sensor_read_retained(&measurement) == ESP_OK);
+    } else if ((strategy == SCD40_STRATEGY_SINGLE_SHOT || strategy == SCD40_STRATEGY_SINGLE_SHOT_RHT_ONLY) &&
+               scd40_variant_has_single_shot((scd40_variant_t)s_sensor_state.variant)) {
         led_signal_set_state(LED_STATE_SENSOR_READING);
+        sampled = (sensor_single_shot(strategy, &measurement) == ESP_OK && measurement.co2_ppm > 0);
+        co2_fresh = strategy != SCD40_STRATEGY_SINGLE_SHOT_RHT_ONLY;
+    }
+    if (sampled) {
+        led_signal_set_state(LED_STATE_COMMAND_RECEIVED);
+    }
+
+    // Periodic measurement, also the fallback for every other strategy
+    while (!sampled) {
+        led_signal_set_state(LED_STATE_SENSOR_READING);
+        co2_fresh = true;
 
+        if (s_sensor_state.mode == SENSOR_MODE_POWERED_DOWN) {
+            scd40_wake_up(&g_sensor);
+            s_sensor_state.mode = SENSOR_MODE_IDLE;
+        }
+        int64_t start_us = esp_timer_get_time();
         ret = scd40_start_periodic_measurement(&g_sensor);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to start periodic measurement");
@@ -465,12 +1508,13 @@ static void sensor_task(void *args)
             vTaskDelay(pdMS_TO_TICKS(5000));
             continue;
         } else {
+            s_sensor_state.mode = SENSOR_MODE_PERIODIC;
             ESP_LOGI(TAG, "Periodic measurement started");
         }
 
 
         // Get sensor data
-        ret = sensor_get_data(&measurement);
+        ret = sensor_get_data(SCD40_STRATEGY_PERIODIC, start_us, &measurement);
         if (ret == ESP_OK && measurement.co2_ppm > 0) {
             // Update Zigbee attributes with new sensor data
             led_signal_set_state(LED_STATE_COMMAND_RECEIVED);
@@ -483,45 +1527,142 @@ static void sensor_task(void *args)
         }
     }
 
-    // Wait 5 seconds before next measurement
     ESP_LOGI(TAG, "Measurement completed");
+    // The sensor is idle now, so the voltage is read with the lightest load
+    battery_sample();
+
+    sample_ring_sample_t sample;
+    sample_from_measurement(&measurement, &sample);
+    sample_filter(&sample, co2_fresh);
+    sample_ring_push(&s_samples, &sample);
+    if (co2_fresh) {
+        s_sensor_state.co2_ppm = sample.co2_ppm;
+        s_sensor_state.co2_time_s = sample.timestamp_s;
+    }
 
-    sensor_cleanup();
-    // Initialize Zigbee stack
-    esp_zb_cfg_t zb_nwk_cfg = ESP_ZB_ZED_CONFIG();
-    esp_zb_init(&zb_nwk_cfg);
+    // Next sleep period from the CO2 trend
+    uint32_t sleep_s = wake_interval_update(&s_wake_config, &s_wake_state, sample.co2_ppm, sample.timestamp_s);
+    ESP_LOGI(TAG, "CO2 slope %ld ppm/min, next wake in %lus",
+             (long)wake_interval_slope(&s_wake_state), (unsigned long)sleep_s);
+
+    // The sensor is left ready for the cheapest way to take the next sample
+    sensor_cleanup(sensor_next_strategy(sleep_s, sample.timestamp_s));
+    wake_profiler_end(WAKE_PHASE_MEASURE);
+
+    int32_t values[POLICY_CHANNELS];
+    policy_values(&sample, values);
+    uint32_t reasons = report_policy_evaluate(&s_policy_config, &s_policy_state, values, sample.timestamp_s);
+    if (reasons != REPORT_POLICY_NONE && !s_zigbee_started) {
+        ESP_LOGI(TAG, "Report due (reasons 0x%lx), starting Zigbee", (unsigned long)reasons);
+        zigbee_start();
+    }
+    // A joined SED buffers on the terms a timer wake does without the radio
+    bool hold = s_sleep_mode == SLEEP_MODE_LIGHT && reasons == REPORT_POLICY_NONE &&
+                sample_ring_count(&s_samples) < SAMPLE_RING_CAPACITY;
+    if (!s_zigbee_started || hold) {
+        // Nothing worth reporting: the radio is never brought up
+        ESP_LOGI(TAG, "Readings unchanged, buffered sample %u, wake took %lld ms",
+                 sample_ring_count(&s_samples),
+                 (esp_timer_get_time() - wake_profiler_start_us(WAKE_PHASE_AWAKE)) / 1000);
+        return sleep_s;
+    }
 
-    // Create Zigbee device
-    create_zigbee_sensor_device(&measurement);
+    // The stack has been rejoining meanwhile; publish once it is on the network
+    xEventGroupWaitBits(s_sensor_events, ZIGBEE_READY_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+    wake_profiler_begin(WAKE_PHASE_REPORT);
+    zigbee_update_sensor_attributes(&sample);
+    zigbee_report_sensor_attributes();
 
-    // Start Zigbee stack
-    ESP_ERROR_CHECK(esp_zb_start(false));
+    // Sleep as soon as the coordinator has the values, bounded by the timeout
+    if (zigbee_wait_reports()) {
+        report_policy_commit(&s_policy_config, &s_policy_state, values, sample.timestamp_s);
+        battery_commit();
+    }
+    zigbee_flush_history();
+    log_wake_timing();
+
+    if (s_fresh_join) {
+        // Give the coordinator time to interview the new device
+        ESP_LOGI(TAG, "Fresh join, staying awake %d ms for the interview", CONFIG_CO2_SENSOR_JOIN_GRACE_MS);
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_CO2_SENSOR_JOIN_GRACE_MS));
+        s_fresh_join = false;
+    }
 
-    // Main Zigbee loop
-    esp_zb_stack_main_loop();
+    return sleep_s;
+}
+
+/**
+ * @brief Main sensor task: prepare the sensor, sample, sleep, repeat
+ *
+ * The sensor is prepared here rather than in app_main, so a full init after
+ * power-on overlaps with the stack startup like the measurement does. Only
+ * a light-sleeping device gets past the first sleep.
+ *
+ * @param args Task arguments (unused)
+ */
+static void sensor_task(void *args)
+{
+    bool resumed = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
 
+    for (;;) {
+        uint32_t sleep_s;
+        if (sensor_prepare(resumed) == ESP_OK) {
+            sleep_s = sensor_wake();
+        } else {
+            ESP_LOGE(TAG, "Sensor initialization failed, retrying in %lus",
+                     (unsigned long)s_wake_config.min_interval_s);
+            led_signal_set_state(LED_STATE_ERROR);
+            sleep_s = s_wake_config.min_interval_s;
+        }
+        sensor_sleep(sleep_s);
+        resumed = true;
+    }
 }
 
 /********************* Main Function *********************/
 
 void app_main(void)
 {
+    wake_profiler_boot();
+
     // Initialize NVS
     ESP_ERROR_CHECK(nvs_flash_init());
 
+    // Keep warnings and errors across resets, and show what led up to a crash
+    if (flash_log_init() == ESP_OK) {
+        flash_log_capture_esp_log();
+        switch (esp_reset_reason()) {
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+        case ESP_RST_BROWNOUT:
+            flash_log_dump(20);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Settings survive deep sleep in RTC memory; NVS is read after power-on.
+    // Missing or unusable settings fall back to the Kconfig defaults.
+    device_config_load(&s_config, &s_config_defaults);
+    config_apply();
+
+    ESP_ERROR_CHECK(power_save_init());
+
+    s_sensor_events = xEventGroupCreate();
+    if (s_sensor_events == NULL) {
+        ESP_LOGE(TAG, "Failed to create sensor event group");
+        return;
+    }
+
     // Initialize LED signal
     led_signal_init();
 
     // Initialize deep sleep configuration
     zb_deep_sleep_init();
 
-    esp_err_t ret = sensor_init();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Sensor initialization failed, terminating application");
-        led_signal_set_state(LED_STATE_ERROR);
-        return;
-    }
-
     // Initialize Zigbee platform
     esp_zb_platform_config_t config = {
         .radio_config = {.radio_mode = ZB_RADIO_MODE_NATIVE},
@@ -529,6 +1670,35 @@ void app_main(void)
     };
     ESP_ERROR_CHECK(esp_zb_platform_config(&config));
 
-    // Create sensor task
+    // Most timer wakes only sample into the RTC buffer. The radio comes up
+    // right away after power-on, when the silence interval has run out or
+    // before the buffer would overwrite samples; the sensor task starts it
+    // later if the reading itself is worth a report.
+    if (sample_ring_validate(&s_samples)) {
+        ESP_LOGW(TAG, "Sample buffer was corrupt, cleared");
+    }
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    // Decided for the interval the last wake scheduled. A light-sleeping
+    // SED joins now and stays on the network.
+    uint32_t interval_s = s_wake_state.interval_s ? s_wake_state.interval_s : s_wake_config.min_interval_s;
+    s_sleep_mode = sleep_mode_select(interval_s);
+    ESP_LOGI(TAG, "Sleeping in %s mode", sleep_policy_mode_name(s_sleep_mode));
+
+    bool uplink = s_sleep_mode == SLEEP_MODE_LIGHT ||
+                  esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER ||
+                  report_policy_due(&s_policy_config, &s_policy_state, now.tv_sec) ||
+                  sample_ring_count(&s_samples) + 1 >= SAMPLE_RING_CAPACITY;
+
+    // Measure and rejoin in parallel. Both tasks are created before either
+    // runs, so the sensor task sees the uplink decision and, having the higher
+    // priority, starts preparing the sensor before the stack starts; it then
+    // blocks on the sensor's command engine while the Zigbee task rejoins.
+    vTaskSuspendAll();
     xTaskCreate(sensor_task, "sensor_task", 4096, NULL, 6, NULL);
+    if (uplink) {
+        zigbee_start();
+    }
+    xTaskResumeAll();
 }
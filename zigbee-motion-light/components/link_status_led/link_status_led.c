@@ -6,132 +6,65 @@
 
 #include "link_status_led.h"
 #include "light_driver.h"
+#include "status_led.h"
 #include "esp_check.h"
 #include "esp_log.h"
-#include "esp_timer.h"
-#include "freertos/portmacro.h"
 
 static const char *TAG = "LINK_STATUS_LED";
 
-#define ORANGE_PULSE_US  280000
+#define ORANGE_PULSE_MS  280
 
-typedef enum {
-    LS_BASE_OFF = 0,
-    LS_BASE_BLUE,
-    LS_BASE_GREEN,
-    LS_BASE_PURPLE,
-} ls_base_t;
+STATUS_LED_PATTERN_DEFINE(s_blue, STATUS_LED_HOLD(0x0000FF));
+STATUS_LED_PATTERN_DEFINE(s_green, STATUS_LED_HOLD(0x00FF00));
+STATUS_LED_PATTERN_DEFINE(s_purple, STATUS_LED_HOLD(0x800080));
+/* Flashed once over the base, which is shown again after it */
+STATUS_LED_PATTERN_DEFINE(s_orange_pulse, STATUS_LED_STEP(0xFFA500, ORANGE_PULSE_MS));
 
-static ls_base_t s_base = LS_BASE_OFF;
-static bool s_orange_overlay;
-static esp_timer_handle_t s_orange_timer;
-static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static bool s_initialized;
 
-static void redraw(void)
+/* Pixel 0 of the strip owned by light_driver; the animation uses the rest */
+static void status_pixel_set(void *ctx, uint8_t red, uint8_t green, uint8_t blue)
 {
-    bool orange;
-    ls_base_t base;
-    portENTER_CRITICAL(&s_mux);
-    orange = s_orange_overlay;
-    base = s_base;
-    portEXIT_CRITICAL(&s_mux);
-
-    if (orange) {
-        light_driver_set_pixel(0, 255, 165, 0);
-        return;
-    }
-
-    switch (base) {
-    case LS_BASE_OFF:
-        light_driver_set_pixel(0, 0, 0, 0);
-        break;
-    case LS_BASE_BLUE:
-        light_driver_set_pixel(0, 0, 0, 255);
-        break;
-    case LS_BASE_GREEN:
-        light_driver_set_pixel(0, 0, 255, 0);
-        break;
-    case LS_BASE_PURPLE:
-        light_driver_set_pixel(0, 128, 0, 128);
-        break;
-    default:
-        break;
-    }
-}
-
-static void orange_timer_cb(void *arg)
-{
-    portENTER_CRITICAL(&s_mux);
-    s_orange_overlay = false;
-    portEXIT_CRITICAL(&s_mux);
-    redraw();
+    light_driver_set_pixel(0, red, green, blue);
 }
 
 void link_status_led_init(void)
 {
-    if (s_orange_timer == NULL) {
-        const esp_timer_create_args_t targs = {
-            .callback = &orange_timer_cb,
-            .name = "ls_orange",
+    if (!s_initialized) {
+        const status_led_backend_t backend = {
+            .set = status_pixel_set,
         };
-        ESP_ERROR_CHECK(esp_timer_create(&targs, &s_orange_timer));
+        ESP_ERROR_CHECK(status_led_init(&backend));
+        s_initialized = true;
     }
     link_status_led_off();
 }
 
 void link_status_led_off(void)
 {
-    if (s_orange_timer) {
-        esp_timer_stop(s_orange_timer);
-    }
-    portENTER_CRITICAL(&s_mux);
-    s_orange_overlay = false;
-    s_base = LS_BASE_OFF;
-    portEXIT_CRITICAL(&s_mux);
-    redraw();
+    status_led_stop();
 }
 
 void link_status_led_set_steering(void)
 {
-    portENTER_CRITICAL(&s_mux);
-    s_base = LS_BASE_BLUE;
-    portEXIT_CRITICAL(&s_mux);
-    redraw();
+    status_led_set(&s_blue);
 }
 
 void link_status_led_set_joined(void)
 {
-    portENTER_CRITICAL(&s_mux);
-    s_base = LS_BASE_GREEN;
-    portEXIT_CRITICAL(&s_mux);
-    redraw();
+    status_led_set(&s_green);
 }
 
 void link_status_led_set_time_synced_from_coordinator(void)
 {
-    portENTER_CRITICAL(&s_mux);
-    s_base = LS_BASE_PURPLE;
-    portEXIT_CRITICAL(&s_mux);
-    redraw();
+    status_led_set(&s_purple);
 }
 
 void link_status_led_notify_occupancy_issued(void)
 {
-    if (s_orange_timer == NULL) {
-        ESP_LOGW(TAG, "Timer not initialized");
+    if (!s_initialized) {
+        ESP_LOGW(TAG, "Not initialized");
         return;
     }
-    esp_timer_stop(s_orange_timer);
-    portENTER_CRITICAL(&s_mux);
-    s_orange_overlay = true;
-    portEXIT_CRITICAL(&s_mux);
-    redraw();
-    esp_err_t err = esp_timer_start_once(s_orange_timer, ORANGE_PULSE_US);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Orange timer start: %s", esp_err_to_name(err));
-        portENTER_CRITICAL(&s_mux);
-        s_orange_overlay = false;
-        portEXIT_CRITICAL(&s_mux);
-        redraw();
-    }
+    status_led_flash(&s_orange_pulse, 1);
 }
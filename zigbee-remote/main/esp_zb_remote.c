@@ -18,6 +18,7 @@
 #include "time.h"
 #include "sys/time.h"
 #include "driver/rtc_io.h"
+#include "driver/gpio.h"
 #include "driver/uart.h"
 #include "driver/ledc.h"
 #include "esp_sleep.h"
@@ -26,6 +27,10 @@
 #include "ha/esp_zigbee_ha_standard.h"
 #include "esp_zb_remote.h"
 #include "light_driver.h"
+#include "status_led.h"
+#include "wake_profiler.h"
+#include "wake_profiler_zcl.h"
+#include "sleep_policy.h"
 
 #ifdef CONFIG_PM_ENABLE
 #include "esp_pm.h"
@@ -34,9 +39,24 @@
 
 static const char *TAG = "ESP_ZB_DEEP_SLEEP";
 
-static RTC_DATA_ATTR struct timeval s_sleep_enter_time;
 static esp_timer_handle_t s_oneshot_timer;
 
+/* How the remote sleeps, chosen once after boot */
+static sleep_mode_t s_sleep_mode;
+
+/* Timer wake-up from deep sleep */
+#define REMOTE_WAKE_SEC 20
+
+#if CONFIG_IDF_TARGET_ESP32C6
+/* For ESP32C6 boards, RTCIO only supports GPIO0~GPIO7 */
+/* GPIO7 pull down to wake up */
+#define REMOTE_WAKE_PIN 7
+#elif CONFIG_IDF_TARGET_ESP32H2
+/* You can wake up by pulling down GPIO9. On ESP32H2 development boards, the BOOT button is connected to GPIO9.
+You can use the BOOT button to wake up the boards directly.*/
+#define REMOTE_WAKE_PIN 9
+#endif
+
 #if CONFIG_IDF_TARGET_ESP32H2
 #define LED_PIN GPIO_NUM_8  // Using GPIO8 for ESP32-H2
 #else
@@ -52,12 +72,126 @@ static esp_timer_handle_t s_oneshot_timer;
 #define LEDC_DUTY_ON          (8191) // 100% duty cycle with 13-bit resolution
 #define LEDC_DUTY_OFF         (0)    // 0% duty cycle
 
+/* Status blinks, flashed a number of times over a dark LED */
+STATUS_LED_PATTERN_DEFINE(s_blink_init, STATUS_LED_BLINK(LED_COLOR_INIT, 1000, 100));
+STATUS_LED_PATTERN_DEFINE(s_blink_sleep, STATUS_LED_BLINK(LED_COLOR_SLEEP, 1000, 100));
+STATUS_LED_PATTERN_DEFINE(s_blink_sleep_long, STATUS_LED_BLINK(LED_COLOR_SLEEP, 3000, 100));
+STATUS_LED_PATTERN_DEFINE(s_blink_steering, STATUS_LED_BLINK(LED_COLOR_STEERING, 200, 200));
+STATUS_LED_PATTERN_DEFINE(s_blink_success, STATUS_LED_BLINK(LED_COLOR_SUCCESS, 200, 200));
+STATUS_LED_PATTERN_DEFINE(s_blink_error, STATUS_LED_BLINK(LED_COLOR_ERROR, 300, 300));
+STATUS_LED_PATTERN_DEFINE(s_blink_warning, STATUS_LED_BLINK(LED_COLOR_WARNING, 200, 200));
+
 /********************* Define functions **************************/
+static TaskHandle_t s_button_task;
+
+/* Status LED back end: pixel 0 of the light_driver strip */
+static void status_pixel_set(void *ctx, uint8_t red, uint8_t green, uint8_t blue)
+{
+    light_driver_set_pixel(0, red, green, blue);
+}
+
+static void status_led_start(void)
+{
+    const status_led_backend_t backend = {
+        .set = status_pixel_set,
+    };
+    ESP_ERROR_CHECK(status_led_init(&backend));
+}
+
+static void IRAM_ATTR button_isr_handler(void *arg)
+{
+    /* Level interrupt: masked until the button task has seen the release */
+    BaseType_t woken = pdFALSE;
+    gpio_intr_disable(REMOTE_WAKE_PIN);
+    vTaskNotifyGiveFromISR(s_button_task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void button_task(void *arg)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        ESP_LOGI(TAG, "Wake up from GPIO %d", REMOTE_WAKE_PIN);
+        status_led_flash(&s_blink_sleep, REMOTE_WAKE_PIN + 1);
+        status_led_wait(STATUS_LED_WAIT_FOREVER);
+        while (gpio_get_level(REMOTE_WAKE_PIN) == 0)
+        {
+            vTaskDelay(pdMS_TO_TICKS(50));
+        }
+        gpio_intr_enable(REMOTE_WAKE_PIN);
+    }
+}
+
+static void zb_light_sleep_init(void)
+{
+    /* Joined SED: the stack decides when to light-sleep, the button wakes it.
+    The light-sleep GPIO wake-up is level triggered on any pin, so the same
+    pull-up and active-low level as for deep sleep apply. */
+    status_led_flash(&s_blink_sleep_long, 1);
+    status_led_wait(STATUS_LED_WAIT_FOREVER);
+
+    const gpio_config_t button_config = {
+        .pin_bit_mask = 1ULL << REMOTE_WAKE_PIN,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_LOW_LEVEL,
+    };
+    ESP_ERROR_CHECK(gpio_config(&button_config));
+    xTaskCreate(button_task, "button", 3072, NULL, 4, &s_button_task);
+    ESP_ERROR_CHECK(gpio_install_isr_service(0));
+    ESP_ERROR_CHECK(gpio_isr_handler_add(REMOTE_WAKE_PIN, button_isr_handler, NULL));
+    ESP_ERROR_CHECK(gpio_wakeup_enable(REMOTE_WAKE_PIN, GPIO_INTR_LOW_LEVEL));
+    ESP_ERROR_CHECK(esp_sleep_enable_gpio_wakeup());
+}
+
+static sleep_mode_t zb_sleep_mode_select(void)
+{
+#if CONFIG_REMOTE_SLEEP_LIGHT
+    return SLEEP_MODE_LIGHT;
+#elif CONFIG_REMOTE_SLEEP_AUTO
+    /* Every deep-sleep wake rejoins, so wakes and uplinks coincide */
+    sleep_policy_model_t model = SLEEP_POLICY_MODEL_DEFAULT();
+    model.poll_interval_ms = ED_KEEP_ALIVE;
+    sleep_policy_model_from_profiler(&model);
+    uint32_t wake_s = REMOTE_WAKE_SEC + 5; // plus the one-shot before deep sleep
+    return sleep_policy_select(&model, SLEEP_MODE_DEEP, wake_s, wake_s);
+#else
+    return SLEEP_MODE_DEEP;
+#endif
+}
+
+static esp_err_t esp_zb_power_save_init(void)
+{
+    esp_err_t rc = ESP_OK;
+#ifdef CONFIG_PM_ENABLE
+    int cur_cpu_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = cur_cpu_freq_mhz,
+        .min_freq_mhz = cur_cpu_freq_mhz,
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        .light_sleep_enable = true
+#endif
+    };
+    rc = esp_pm_configure(&pm_config);
+#endif
+    return rc;
+}
+
 static void s_oneshot_timer_callback(void *arg)
 {
+    /* Let the wake-up blinks finish first */
+    if (!status_led_wait(0))
+    {
+        esp_timer_start_once(s_oneshot_timer, 200 * 1000);
+        return;
+    }
+    status_led_stop();
+
     /* Enter deep sleep */
     ESP_LOGI(TAG, "Enter deep sleep");
-    gettimeofday(&s_sleep_enter_time, NULL);
+    wake_profiler_sleep();
     esp_deep_sleep_start();
 }
 
@@ -75,17 +209,14 @@ static void zb_deep_sleep_init(void)
 
     ESP_ERROR_CHECK(esp_timer_create(&s_oneshot_timer_args, &s_oneshot_timer));
 
-    // Print the wake-up reason:
-    struct timeval now;
-    gettimeofday(&now, NULL);
-    int sleep_time_ms = (now.tv_sec - s_sleep_enter_time.tv_sec) * 1000 + (now.tv_usec - s_sleep_enter_time.tv_usec) / 1000;
+    // Print the wake-up reason, the profiler logs the time spent asleep:
     esp_sleep_wakeup_cause_t wake_up_cause = esp_sleep_get_wakeup_cause();
     switch (wake_up_cause)
     {
     case ESP_SLEEP_WAKEUP_TIMER:
     {
-        ESP_LOGI(TAG, "Wake up from timer. Time spent in deep sleep and boot: %dms", sleep_time_ms);
-        light_driver_blink(LED_COLOR_SLEEP, 2, 1000, 100); 
+        ESP_LOGI(TAG, "Wake up from timer");
+        status_led_flash(&s_blink_sleep, 2);
         break;
     }
     case ESP_SLEEP_WAKEUP_EXT1:
@@ -93,34 +224,25 @@ static void zb_deep_sleep_init(void)
         uint64_t wakeup_pin = esp_sleep_get_ext1_wakeup_status();
         int pin_num = __builtin_ffsll(wakeup_pin) - 1;
         ESP_LOGI(TAG, "Wake up from GPIO %d", pin_num);
-        ESP_LOGI(TAG, "Wake up from GPIO. Time spent in deep sleep and boot: %dms", sleep_time_ms);
         // Blink different number of times based on which pin woke us up
-        light_driver_blink(LED_COLOR_SLEEP, pin_num + 1, 1000, 100);
+        status_led_flash(&s_blink_sleep, pin_num + 1);
         break;
     }
     case ESP_SLEEP_WAKEUP_UNDEFINED:
     default:
         ESP_LOGI(TAG, "Not a deep sleep reset");
-        light_driver_blink(LED_COLOR_SLEEP, 1, 3000, 100);
+        status_led_flash(&s_blink_sleep_long, 1);
         break;
     }
+    status_led_wait(STATUS_LED_WAIT_FOREVER);
 
     /* Set the methods of how to wake up: */
     /* 1. RTC timer waking-up */
-    const int wakeup_time_sec = 20;
-    ESP_LOGI(TAG, "Enabling timer wakeup, %ds\n", wakeup_time_sec);
-    ESP_ERROR_CHECK(esp_sleep_enable_timer_wakeup(wakeup_time_sec * 1000000));
+    ESP_LOGI(TAG, "Enabling timer wakeup, %ds\n", REMOTE_WAKE_SEC);
+    ESP_ERROR_CHECK(esp_sleep_enable_timer_wakeup(REMOTE_WAKE_SEC * 1000000));
 
     /* 2. GPIO waking-up */
-#if CONFIG_IDF_TARGET_ESP32C6
-    /* For ESP32C6 boards, RTCIO only supports GPIO0~GPIO7 */
-    /* GPIO7 pull down to wake up */
-    const int gpio_wakeup_pin = 7;
-#elif CONFIG_IDF_TARGET_ESP32H2
-    /* You can wake up by pulling down GPIO9. On ESP32H2 development boards, the BOOT button is connected to GPIO9.
-    You can use the BOOT button to wake up the boards directly.*/
-    const int gpio_wakeup_pin = 9;
-#endif
+    const int gpio_wakeup_pin = REMOTE_WAKE_PIN;
     const uint64_t gpio_wakeup_pin_mask = 1ULL << gpio_wakeup_pin;
     /* The configuration mode depends on your hardware design.
     Since the BOOT button is connected to a pull-up resistor, the wake-up mode is configured as LOW. */
@@ -138,6 +260,12 @@ static void zb_deep_sleep_init(void)
 
 static void zb_deep_sleep_start(void)
 {
+    /* A light-sleeping SED stays joined */
+    if (s_sleep_mode != SLEEP_MODE_DEEP)
+    {
+        return;
+    }
+
     /* Start the one-shot timer */
     const int before_deep_sleep_time_sec = 5;
     ESP_LOGI(TAG, "Start one-shot timer for %ds to enter the deep sleep", before_deep_sleep_time_sec);
@@ -159,7 +287,7 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
     case ESP_ZB_ZDO_SIGNAL_SKIP_STARTUP:
         ESP_LOGI(TAG, "Initialize Zigbee stack");
         esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_INITIALIZATION);
-        light_driver_blink(LED_COLOR_INIT, 1, 1000, 100); // Two quick white blinks for initialization
+        status_led_flash(&s_blink_init, 1); // One white blink for initialization
         break;
     case ESP_ZB_BDB_SIGNAL_DEVICE_FIRST_START:
     case ESP_ZB_BDB_SIGNAL_DEVICE_REBOOT:
@@ -170,13 +298,12 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
             {
                 ESP_LOGI(TAG, "Start network steering");
                 esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_NETWORK_STEERING);
-                light_driver_blink(LED_COLOR_STEERING, 3, 200, 200); // Three medium blue blinks for network steering
+                status_led_flash(&s_blink_steering, 3); // Three medium blue blinks for network steering
             }
             else
             {
-                //zb_deep_sleep_start();
-                light_driver_blink(LED_COLOR_SUCCESS, 2, 200, 200);
-                light_driver_set_power(false); // Turn off LED before sleep
+                wake_profiler_end(WAKE_PHASE_REJOIN);
+                status_led_flash(&s_blink_success, 2);
                 zb_deep_sleep_start();
             }
         }
@@ -184,7 +311,7 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
         {
             ESP_LOGW(TAG, "%s failed with status: %s, retrying", esp_zb_zdo_signal_to_string(sig_type),
                      esp_err_to_name(err_status));
-            light_driver_blink(LED_COLOR_ERROR, 5, 300, 300); // Five quick red blinks for error
+            status_led_flash(&s_blink_error, 5); // Five quick red blinks for error
             esp_zb_scheduler_alarm((esp_zb_callback_t)bdb_start_top_level_commissioning_cb,
                                    ESP_ZB_BDB_MODE_INITIALIZATION, 3000);
         }
@@ -199,21 +326,26 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
                      "Address: 0x%04hx)",
                      extended_pan_id[7], extended_pan_id[6], extended_pan_id[5], extended_pan_id[4], extended_pan_id[3], extended_pan_id[2],
                      extended_pan_id[1], extended_pan_id[0], esp_zb_get_pan_id(), esp_zb_get_current_channel(), esp_zb_get_short_address());
-            light_driver_blink(LED_COLOR_SUCCESS, 4, 200, 200);  // Set LED to green
+            wake_profiler_end(WAKE_PHASE_REJOIN);
+            status_led_flash(&s_blink_success, 4); // Four green blinks
             
             zb_deep_sleep_start();
         }
         else
         {
             ESP_LOGI(TAG, "Network steering was not successful (status: %d)", err_status);
-            light_driver_blink(LED_COLOR_WARNING, 4, 200, 200); // Four medium orange blinks for steering failure
+            status_led_flash(&s_blink_warning, 4); // Four medium orange blinks for steering failure
             esp_zb_scheduler_alarm((esp_zb_callback_t)bdb_start_top_level_commissioning_cb, ESP_ZB_BDB_MODE_NETWORK_STEERING, 1000);
         }
         break;
     case ESP_ZB_COMMON_SIGNAL_CAN_SLEEP:
         ESP_LOGI(TAG, "Can sleep");
 
-        light_driver_set_power(false); // Turn off LED before sleep
+        /* The status LED goes dark by itself once its blinks end */
+        if (s_sleep_mode == SLEEP_MODE_LIGHT)
+        {
+            esp_zb_sleep_now();
+        }
         break;
     default:
         ESP_LOGI(TAG, "ZDO signal: %s (0x%x), status: %s", esp_zb_zdo_signal_to_string(sig_type), sig_type, esp_err_to_name(err_status));
@@ -270,6 +402,11 @@ void esp_zb_task()
     /* load Zigbee light_bulb platform config to initialization */
     ESP_ERROR_CHECK(esp_zb_platform_config(&config));
     /* initialize Zigbee stack with Zigbee end-device config */
+    wake_profiler_begin(WAKE_PHASE_STACK_INIT);
+    if (s_sleep_mode == SLEEP_MODE_LIGHT)
+    {
+        esp_zb_sleep_enable(true);
+    }
     esp_zb_cfg_t zb_nwk_cfg = ESP_ZB_ZED_CONFIG();
     esp_zb_init(&zb_nwk_cfg);
     /* set the on-off light device config */
@@ -281,21 +418,36 @@ void esp_zb_task()
     };
 
     esp_zcl_utility_add_ep_basic_manufacturer_info(esp_zb_on_off_light_ep, HA_ESP_LIGHT_ENDPOINT, &info);
+    /* wake profile statistics of the previous wakes, readable while awake */
+    esp_zb_cluster_list_add_custom_cluster(esp_zb_ep_list_get_ep(esp_zb_on_off_light_ep, HA_ESP_LIGHT_ENDPOINT),
+                                           wake_profiler_zcl_cluster_create(), ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
     esp_zb_device_register(esp_zb_on_off_light_ep);
     esp_zb_core_action_handler_register(zb_action_handler);
+    wake_profiler_end(WAKE_PHASE_STACK_INIT);
+    wake_profiler_begin(WAKE_PHASE_REJOIN);
     ESP_ERROR_CHECK(esp_zb_start(false));
     esp_zb_stack_main_loop();
 }
 
 void app_main(void)
 {
+    wake_profiler_boot();
  
     ESP_ERROR_CHECK(nvs_flash_init());
-    
-    
+    ESP_ERROR_CHECK(esp_zb_power_save_init());
 
-    light_driver_init(true); // Initialize LED
-    zb_deep_sleep_init();
+    light_driver_init(false); // Initialize LED
+    status_led_start();
+    s_sleep_mode = zb_sleep_mode_select();
+    ESP_LOGI(TAG, "Sleeping in %s mode", sleep_policy_mode_name(s_sleep_mode));
+    if (s_sleep_mode == SLEEP_MODE_LIGHT)
+    {
+        zb_light_sleep_init();
+    }
+    else
+    {
+        zb_deep_sleep_init();
+    }
 
     esp_zb_task();
 }
\ No newline at end of file
@@ -52,6 +52,13 @@ void light_driver_set_power(bool power)
     ESP_ERROR_CHECK(led_strip_refresh(s_led_strip));
 }
 
+void light_driver_set_pixel(uint8_t index, uint8_t red, uint8_t green, uint8_t blue)
+{
+    if (index >= CONFIG_EXAMPLE_STRIP_LED_NUMBER) return;
+    ESP_ERROR_CHECK(led_strip_set_pixel(s_led_strip, index, red, green, blue));
+    ESP_ERROR_CHECK(led_strip_refresh(s_led_strip));
+}
+
 void light_driver_set_rgb(uint8_t red, uint8_t green, uint8_t blue)
 {
     s_red = red;
@@ -87,34 +94,3 @@ void light_driver_init(bool power)
     ESP_ERROR_CHECK(led_strip_new_rmt_device(&led_strip_conf, &rmt_conf, &s_led_strip));
     light_driver_set_power(power);
 }
-
-void light_driver_blink(uint8_t red, uint8_t green, uint8_t blue, 
-                       uint8_t times, uint32_t on_time_ms, uint32_t off_time_ms)
-{
-    // Store current LED state
-    uint8_t prev_red = s_red;
-    uint8_t prev_green = s_green;
-    uint8_t prev_blue = s_blue;
-    
-    // Set new color
-    light_driver_set_rgb(red, green, blue);
-    
-    // Perform blinking
-    for (int i = 0; i < times; i++) {
-        light_driver_set_power(true);
-        vTaskDelay(pdMS_TO_TICKS(on_time_ms));
-        light_driver_set_power(false);
-        if (i < times - 1) { // Don't delay after the last blink
-            vTaskDelay(pdMS_TO_TICKS(off_time_ms));
-        }
-    }
-
-    light_driver_set_power(0);
-
-
-}
-
-void light_driver_blink_white(uint8_t times, uint32_t delay_ms)
-{
-    light_driver_blink(LED_COLOR_INIT, times, delay_ms, delay_ms);
-}
@@ -52,13 +52,13 @@ extern "C" {
 #define CONFIG_EXAMPLE_STRIP_LED_GPIO   8
 #define CONFIG_EXAMPLE_STRIP_LED_NUMBER 2
 
-/* LED colors for different states */
-#define LED_COLOR_INIT      0xFF, 0xFF, 0xFF  // White
-#define LED_COLOR_SUCCESS   0x00, 0xFF, 0x00  // Green
-#define LED_COLOR_ERROR     0xFF, 0x00, 0x00  // Red
-#define LED_COLOR_STEERING  0x00, 0x00, 0xFF  // Blue
-#define LED_COLOR_WARNING   0xFF, 0xA5, 0x00  // Orange
-#define LED_COLOR_SLEEP     0x80, 0x00, 0xFF  // Purple for sleep
+/* LED colors for different states, 0xRRGGBB */
+#define LED_COLOR_INIT      0xFFFFFF  // White
+#define LED_COLOR_SUCCESS   0x00FF00  // Green
+#define LED_COLOR_ERROR     0xFF0000  // Red
+#define LED_COLOR_STEERING  0x0000FF  // Blue
+#define LED_COLOR_WARNING   0xFFA500  // Orange
+#define LED_COLOR_SLEEP     0x8000FF  // Purple for sleep
 
 
 /**
@@ -76,41 +76,30 @@ void light_driver_init(bool power);
 void light_driver_set_power(bool power);
 
 /**
- * @brief Set LED RGB color
- * 
+ * @brief Set one pixel, leaving the stored color and level alone
+ *
+ * @param index Pixel on the strip
  * @param red Red component (0-255)
  * @param green Green component (0-255)
  * @param blue Blue component (0-255)
  */
-void light_driver_set_rgb(uint8_t red, uint8_t green, uint8_t blue);
-
-/**
- * @brief Set LED brightness level
- * 
- * @param level Brightness level (0-255)
- */
-void light_driver_set_level(uint8_t level);
+void light_driver_set_pixel(uint8_t index, uint8_t red, uint8_t green, uint8_t blue);
 
 /**
- * @brief Blink LED with specified color and pattern
+ * @brief Set LED RGB color
  * 
  * @param red Red component (0-255)
  * @param green Green component (0-255)
  * @param blue Blue component (0-255)
- * @param times Number of blinks
- * @param on_time_ms Time LED stays on in milliseconds
- * @param off_time_ms Time LED stays off in milliseconds
  */
-void light_driver_blink(uint8_t red, uint8_t green, uint8_t blue, 
-                       uint8_t times, uint32_t on_time_ms, uint32_t off_time_ms);
+void light_driver_set_rgb(uint8_t red, uint8_t green, uint8_t blue);
 
 /**
- * @brief Quick helper function to blink LED in white color
+ * @brief Set LED brightness level
  * 
- * @param times Number of blinks
- * @param delay_ms Time for both on and off states
+ * @param level Brightness level (0-255)
  */
-void light_driver_blink_white(uint8_t times, uint32_t delay_ms);
+void light_driver_set_level(uint8_t level);
 
 #ifdef __cplusplus
 } // extern "C"
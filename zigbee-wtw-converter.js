@@ -52,6 +52,7 @@ export default {
     fromZigbee: [fzLocal.wtw_multistate_report, battery],
     toZigbee: [tzLocal.wtw_multistate_control, factory_reset],
     exposes: [presets.enum("switch_actions", access.ALL, ["day", "night", "shower"]).withEndpoint("button")],
+    ota: true,
     configure: async (device, coordinatorEndpoint, definition) => {
         for (const ep of device.endpoints) {
             if (ep.inputClusters.includes(21)) {
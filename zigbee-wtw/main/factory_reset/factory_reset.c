@@ -0,0 +1,78 @@
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "esp_zigbee_core.h"
+#include "sdkconfig.h"
+#include "factory_reset.h"
+#include "relay_state/relay_state.h"
+#include "logger/logger.h"
+#include "led_signal.h"
+
+static const char *TAG = "FACTORY_RESET";
+
+#define FACTORY_RESET_POLL_MS   100
+
+#if CONFIG_FACTORY_RESET_GPIO >= 0
+static void factory_reset_poll(void *arg)
+{
+    static uint32_t held_ms;
+
+    if (gpio_get_level(CONFIG_FACTORY_RESET_GPIO) != 0) {
+        held_ms = 0;
+        return;
+    }
+    held_ms += FACTORY_RESET_POLL_MS;
+    if (held_ms == FACTORY_RESET_POLL_MS) {
+        app_log(LOG_LEVEL_INFO, TAG, "Keep the button pressed for %d s to reset to factory settings",
+                CONFIG_FACTORY_RESET_HOLD_MS / 1000);
+    }
+    if (held_ms >= CONFIG_FACTORY_RESET_HOLD_MS) {
+        factory_reset();
+    }
+}
+#endif
+
+esp_err_t factory_reset_start(void)
+{
+#if CONFIG_FACTORY_RESET_GPIO >= 0
+    const gpio_config_t io_conf = {
+        .intr_type = GPIO_INTR_DISABLE,
+        .mode = GPIO_MODE_INPUT,
+        .pin_bit_mask = 1ULL << CONFIG_FACTORY_RESET_GPIO,
+        .pull_up_en = 1,
+        .pull_down_en = 0,
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    const esp_timer_create_args_t args = {
+        .callback = factory_reset_poll,
+        .name = "factory_reset",
+    };
+    esp_timer_handle_t timer;
+    ret = esp_timer_create(&args, &timer);
+    if (ret == ESP_OK) {
+        ret = esp_timer_start_periodic(timer, FACTORY_RESET_POLL_MS * 1000ULL);
+    }
+    if (ret != ESP_OK) {
+        app_log(LOG_LEVEL_WARN, TAG, "No factory reset button: %s", esp_err_to_name(ret));
+    }
+    return ret;
+#else
+    return ESP_OK;
+#endif
+}
+
+void factory_reset(void)
+{
+    app_log(LOG_LEVEL_WARN, TAG, "Factory reset: forgetting the network and the relay state");
+    led_signal_set_state(LED_STATE_ERROR);
+    relay_state_erase();
+    logger_flush(500);
+
+    // Erases the Zigbee NVRAM and restarts
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_zb_factory_reset();
+}
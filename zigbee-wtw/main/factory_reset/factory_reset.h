@@ -0,0 +1,29 @@
+#pragma once
+#ifndef FACTORY_RESET_H
+#define FACTORY_RESET_H
+
+#include "esp_err.h"
+
+/*
+ * Deliberate factory reset. The network and the relay state survive every
+ * restart; they are only forgotten by holding the button configured as
+ * CONFIG_FACTORY_RESET_GPIO for CONFIG_FACTORY_RESET_HOLD_MS while the
+ * device runs, or with the console `factory_reset` command.
+ */
+
+/**
+ * @brief Watch the factory reset button
+ *
+ * The button is polled from an esp_timer, so no task is needed. Does
+ * nothing if CONFIG_FACTORY_RESET_GPIO is -1.
+ */
+esp_err_t factory_reset_start(void);
+
+/**
+ * @brief Forget the relay state and the Zigbee network, then restart
+ *
+ * Task context, Zigbee stack started. Does not return.
+ */
+void factory_reset(void);
+
+#endif // FACTORY_RESET_H
@@ -1,13 +1,20 @@
 #include "driver/gpio.h"
 #include "gpio_control.h"
 #include "logger/logger.h"
+#include "metrics/metrics.h"
 
 static const char *TAG = "GPIO_CONTROL";
 
+static const char *const state_names[] = {"night", "day", "shower"};
+static output_state_t current_state = STATE_DAY;
+
 // Set relay outputs based on state
 void set_relay_outputs(output_state_t state)
 {
-    const char* state_names[] = {"night", "day", "shower"};
+    if (state > STATE_SHOWER) {
+        app_log(LOG_LEVEL_WARN, TAG, "Invalid state: %d", state);
+        return;
+    }
     app_log(LOG_LEVEL_INFO, TAG, "Setting relay outputs for %s mode (state %d)", state_names[state], state);
 
     // Control relays based on your logic:
@@ -30,15 +37,28 @@ void set_relay_outputs(output_state_t state)
             gpio_set_level(RELAY2_GPIO, 0);  // Relay 2 ON
             app_log(LOG_LEVEL_INFO, TAG, "Shower mode: Both relays ON");
             break;
-        default:
-            app_log(LOG_LEVEL_WARN, TAG, "Invalid state: %d", state);
-            break;
     }
+    current_state = state;
+    metrics_increment(METRIC_RELAY_CHANGES);
+    metrics_set(METRIC_RELAY_STATE, state);
+}
+
+output_state_t get_relay_outputs(void)
+{
+    return current_state;
 }
 
-// Initialize relay GPIO outputs
-void init_relay_outputs(void)
+// Initialize relay GPIO outputs in the given state
+void init_relay_outputs(output_state_t state)
 {
+    if (state > STATE_SHOWER) {
+        state = STATE_DAY;
+    }
+
+    // Latch the levels before the pins become outputs, so they never drive another state
+    gpio_set_level(RELAY1_GPIO, state == STATE_NIGHT);
+    gpio_set_level(RELAY2_GPIO, state != STATE_SHOWER);
+
     gpio_config_t io_conf = {
         .intr_type = GPIO_INTR_DISABLE,
         .mode = GPIO_MODE_OUTPUT,
@@ -52,9 +72,9 @@ void init_relay_outputs(void)
     gpio_set_drive_capability(RELAY1_GPIO, GPIO_DRIVE_CAP_3);
     gpio_set_drive_capability(RELAY2_GPIO, GPIO_DRIVE_CAP_3);
     
-    // Initialize to day mode (Relay1=ON, Relay2=OFF)
-    set_relay_outputs(STATE_DAY);
-    
-    app_log(LOG_LEVEL_INFO, TAG, "CV-021 relay outputs initialized: Relay1=%d, Relay2=%d", 
-             RELAY1_GPIO, RELAY2_GPIO);
+    current_state = state;
+    metrics_set(METRIC_RELAY_STATE, state);
+
+    app_log(LOG_LEVEL_INFO, TAG, "CV-021 relay outputs initialized in %s mode: Relay1=%d, Relay2=%d",
+             state_names[state], RELAY1_GPIO, RELAY2_GPIO);
 }
\ No newline at end of file
@@ -16,7 +16,8 @@ typedef enum {
 } output_state_t;
 
 // Function declarations
-void init_relay_outputs(void);
+void init_relay_outputs(output_state_t state);
 void set_relay_outputs(output_state_t state);
+output_state_t get_relay_outputs(void);
 
 #endif // GPIO_CONTROL_H
\ No newline at end of file
@@ -0,0 +1,175 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Expand binary app_log output (CONFIG_LOGGER_BINARY) on the host
+ *
+ * Reads serial output on stdin, replaces each "#L <base64>" line with the
+ * formatted message and passes all other lines through. Format strings and
+ * tags are looked up by address in the allocated sections of the firmware
+ * ELF, the same build that produced the output.
+ *
+ * Not part of any IDF build. Compile from main/logger:
+ *
+ *   cc -O2 -I. host/logdecode.c log_args.c -o logdecode
+ *   cat /dev/ttyUSB0 | ./logdecode ../../build/zigbee_wtw.elf
+ */
+
+#include <elf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log_args.h"
+
+#define LOGGER_BINARY_PREFIX    "#L "
+#define LOGGER_BINARY_VERSION   1
+#define LINE_MAX_LEN            1024
+
+static uint8_t *s_elf;
+static size_t s_elf_len;
+static const Elf32_Shdr *s_sections;
+static int s_section_count;
+
+static int elf_load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    s_elf_len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    s_elf = malloc(s_elf_len);
+    if (!s_elf || fread(s_elf, 1, s_elf_len, f) != s_elf_len) {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    const Elf32_Ehdr *ehdr = (const Elf32_Ehdr *)s_elf;
+    if (s_elf_len < sizeof(*ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr->e_ident[EI_CLASS] != ELFCLASS32 || ehdr->e_ident[EI_DATA] != ELFDATA2LSB) {
+        fprintf(stderr, "%s: not a 32-bit little-endian ELF\n", path);
+        return -1;
+    }
+    if (ehdr->e_shoff + (size_t)ehdr->e_shnum * sizeof(Elf32_Shdr) > s_elf_len) {
+        fprintf(stderr, "%s: truncated section table\n", path);
+        return -1;
+    }
+    s_sections = (const Elf32_Shdr *)(s_elf + ehdr->e_shoff);
+    s_section_count = ehdr->e_shnum;
+    return 0;
+}
+
+// NUL-terminated string at a target address, NULL if no loaded section holds it
+static const char *elf_string(uint32_t addr)
+{
+    for (int i = 0; i < s_section_count; i++) {
+        const Elf32_Shdr *sh = &s_sections[i];
+        if (!(sh->sh_flags & SHF_ALLOC) || sh->sh_type != SHT_PROGBITS ||
+            addr < sh->sh_addr || addr - sh->sh_addr >= sh->sh_size) {
+            continue;
+        }
+        size_t offset = sh->sh_offset + (addr - sh->sh_addr);
+        size_t end = sh->sh_offset + sh->sh_size;
+        if (end > s_elf_len || !memchr(s_elf + offset, '\0', end - offset)) {
+            return NULL;
+        }
+        return (const char *)(s_elf + offset);
+    }
+    return NULL;
+}
+
+static int base64_value(char c)
+{
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+// Decode base64 up to the first character outside the alphabet; -1 on bad padding
+static int base64_decode(uint8_t *out, size_t len, const char *in)
+{
+    size_t n = 0;
+    uint32_t acc = 0;
+    int bits = 0;
+
+    for (; *in && *in != '='; in++) {
+        int v = base64_value(*in);
+        if (v < 0) {
+            break;
+        }
+        acc = (acc << 6) | v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (n == len) {
+                return -1;
+            }
+            out[n++] = acc >> bits;
+        }
+    }
+    return n;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void decode_line(const char *b64)
+{
+    static const char letters[] = { 'I', 'W', 'E' };
+    uint8_t frame[14 + LOG_ARGS_MAX];
+    char text[LINE_MAX_LEN];
+
+    int len = base64_decode(frame, sizeof(frame), b64);
+    if (len < 14 || frame[0] != LOGGER_BINARY_VERSION || frame[1] >= sizeof(letters)) {
+        printf("?? undecodable log frame: %s", b64);
+        return;
+    }
+    uint32_t timestamp_ms = get_u32(&frame[2]);
+    const char *tag = elf_string(get_u32(&frame[6]));
+    const char *format = elf_string(get_u32(&frame[10]));
+    if (!format) {
+        printf("%c (%u) %s: ?? format 0x%08x not in ELF\n", letters[frame[1]], timestamp_ms,
+               tag ? tag : "?", get_u32(&frame[10]));
+        return;
+    }
+    log_args_format(text, sizeof(text), format, &frame[14], len - 14);
+    printf("%c (%u) %s: %s\n", letters[frame[1]], timestamp_ms, tag ? tag : "?", text);
+}
+
+int main(int argc, char **argv)
+{
+    char line[LINE_MAX_LEN];
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s firmware.elf < serial-output\n", argv[0]);
+        return 2;
+    }
+    if (elf_load(argv[1]) != 0) {
+        return 1;
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    while (fgets(line, sizeof(line), stdin)) {
+        // The prefix may follow other output that was not newline-terminated
+        char *frame = strstr(line, LOGGER_BINARY_PREFIX);
+        if (!frame) {
+            fputs(line, stdout);
+            continue;
+        }
+        if (frame != line) {
+            fwrite(line, 1, frame - line, stdout);
+            fputc('\n', stdout);
+        }
+        decode_line(frame + strlen(LOGGER_BINARY_PREFIX));
+    }
+    return 0;
+}
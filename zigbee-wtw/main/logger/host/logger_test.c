@@ -0,0 +1,235 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host tests for the deferred logger's argument capture and ring buffer
+ *
+ * Captured-then-formatted messages must match snprintf, and producer threads
+ * racing a consumer must lose nothing but counted drops.
+ *
+ * Compile and run from main/logger:
+ *
+ *   cc -O2 -pthread -I. -I../../../components/host_test host/logger_test.c log_args.c log_ring.c \
+ *      -o logger_test && ./logger_test
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "log_args.h"
+#include "log_ring.h"
+#include "host_test.h"
+
+static size_t capture(uint8_t *buf, size_t len, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    size_t n = log_args_capture(buf, len, format, args);
+    va_end(args);
+    return n;
+}
+
+// Capture, format, and compare with snprintf of the same arguments
+#define CHECK_ROUNDTRIP(format, ...)                                                        \
+    do {                                                                                    \
+        uint8_t raw_[LOG_ARGS_MAX];                                                         \
+        char got_[256], want_[256];                                                         \
+        size_t n_ = capture(raw_, sizeof(raw_), format, __VA_ARGS__);                       \
+        log_args_format(got_, sizeof(got_), format, raw_, n_);                              \
+        snprintf(want_, sizeof(want_), format, __VA_ARGS__);                                \
+        CHECK_STR(got_, want_);                                                             \
+    } while (0)
+
+static void test_args(void)
+{
+    uint8_t raw[LOG_ARGS_MAX];
+    char out[128];
+    char stack_string[16];
+
+    CHECK_ROUNDTRIP("Setting relay outputs for %s mode (state %d)", "day", 1);
+    CHECK_ROUNDTRIP("Cluster = 0x%04x (%s), Attribute = 0x%04X, Endpoint = 0x%02x", 0x12, "Basic", 0xabcd, 1);
+    CHECK_ROUNDTRIP("%" PRIu32 " %" PRId32 " %u %i %o %c", (uint32_t)4000000000u, (int32_t)-5, 7u, -8, 9, 'x');
+    CHECK_ROUNDTRIP("%lld %llu %llx", -1234567890123ll, 18446744073709551615ull, 0x123456789abull);
+    CHECK_ROUNDTRIP("%.2f %8.3e %g", 3.14159, 12345.678, 0.5);
+    CHECK_ROUNDTRIP("[%-8s] [%8s] [%.3s] [%*d] [%-*.*s]", "ab", "cd", "efghij", 6, 42, 7, 2, "xyz");
+    CHECK_ROUNDTRIP("%hhu %hd %+d % d %05d 100%%", 300, 70000, 5, 6, 42);
+    CHECK_ROUNDTRIP("no arguments at all%s", "");
+
+    // Strings are copied by value: the caller's buffer may change before formatting
+    strcpy(stack_string, "before");
+    size_t n = capture(raw, sizeof(raw), "value %s", stack_string);
+    strcpy(stack_string, "after");
+    log_args_format(out, sizeof(out), "value %s", raw, n);
+    CHECK_STR(out, "value before");
+
+    n = capture(raw, sizeof(raw), "%s|%s", (const char *)NULL, "x");
+    log_args_format(out, sizeof(out), "%s|%s", raw, n);
+    CHECK_STR(out, "(null)|x");
+
+    // Long strings are truncated to LOG_ARGS_STR_MAX
+    char long_string[LOG_ARGS_STR_MAX + 20];
+    memset(long_string, 'a', sizeof(long_string) - 1);
+    long_string[sizeof(long_string) - 1] = '\0';
+    n = capture(raw, sizeof(raw), "%s", long_string);
+    CHECK_EQ(n, 1 + LOG_ARGS_STR_MAX);
+    CHECK_EQ(log_args_format(out, sizeof(out), "%s", raw, n), LOG_ARGS_STR_MAX);
+
+    // Arguments that do not fit are shown as "?"
+    n = capture(raw, 6, "%d %d %d", 1, 2, 3);
+    CHECK_EQ(n, 4);
+    log_args_format(out, sizeof(out), "%d %d %d", raw, n);
+    CHECK_STR(out, "1 ? ?");
+
+    // Pointers use the 32-bit target width
+    n = capture(raw, sizeof(raw), "%p", (void *)(uintptr_t)0x4080abcd);
+    CHECK_EQ(n, 4);
+    log_args_format(out, sizeof(out), "%p", raw, n);
+    CHECK_STR(out, "0x4080abcd");
+
+    // Output is truncated, not overrun
+    n = capture(raw, sizeof(raw), "%s world", "hello");
+    CHECK_EQ(log_args_format(out, 8, "%s world", raw, n), 7);
+    CHECK_STR(out, "hello w");
+
+    CHECK_EQ(capture(raw, sizeof(raw), "dangling %"), 0);
+    log_args_format(out, sizeof(out), "dangling %", raw, 0);
+    CHECK_STR(out, "dangling %");
+}
+
+static void test_ring_wrap(void)
+{
+    static uint8_t buf[1024] __attribute__((aligned(4)));
+    log_ring_t ring;
+    uint32_t len;
+
+    log_ring_init(&ring, buf, sizeof(buf));
+    CHECK_EQ(log_ring_empty(&ring), 1);
+    CHECK_EQ(log_ring_peek(&ring, &len) == NULL, 1);
+
+    // Records of every size, many times around the buffer
+    for (uint32_t i = 0; i < 5000; i++) {
+        uint32_t size = i % 201;
+        bool was_empty;
+        uint8_t *p = log_ring_reserve(&ring, size, &was_empty);
+        CHECK_EQ(p != NULL, 1);
+        CHECK_EQ(was_empty, 1);
+        memset(p, (uint8_t)i, size);
+
+        // Reserved but not committed: invisible to the consumer
+        CHECK_EQ(log_ring_peek(&ring, &len) == NULL, 1);
+        log_ring_commit(&ring, p);
+
+        const uint8_t *r = log_ring_peek(&ring, &len);
+        CHECK_EQ(r == p, 1);
+        CHECK_EQ(len, size);
+        for (uint32_t j = 0; j < size; j++) {
+            if (r[j] != (uint8_t)i) {
+                CHECK_EQ(r[j], (uint8_t)i);
+                break;
+            }
+        }
+        log_ring_release(&ring);
+        CHECK_EQ(log_ring_empty(&ring), 1);
+    }
+
+    // Full ring drops and counts instead of overwriting
+    int accepted = 0;
+    while (log_ring_reserve(&ring, 100, NULL)) {
+        accepted++;
+    }
+    CHECK_EQ(accepted > 0, 1);
+    CHECK_EQ(atomic_load(&ring.dropped), 1);
+    CHECK_EQ(log_ring_reserve(&ring, LOG_RING_RECORD_MAX + 1, NULL) == NULL, 1);
+    CHECK_EQ(atomic_load(&ring.dropped), 2);
+}
+
+#define PRODUCERS           4
+#define PER_PRODUCER        200000
+
+static uint8_t s_buf[4096] __attribute__((aligned(4)));
+static log_ring_t s_ring;
+static _Atomic int s_done;
+
+typedef struct {
+    uint32_t producer;
+    uint32_t seq;
+} record_t;
+
+static void *producer(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+
+    for (uint32_t seq = 0; seq < PER_PRODUCER; seq++) {
+        // Vary the size so padding records and wrap-around are exercised
+        uint32_t size = sizeof(record_t) + (seq * 7 + id) % 57;
+        uint8_t *p = log_ring_reserve(&s_ring, size, NULL);
+        if (!p) {
+            sched_yield();
+            continue;
+        }
+        record_t r = { id, seq };
+        memcpy(p, &r, sizeof(r));
+        memset(p + sizeof(r), (uint8_t)(seq ^ id), size - sizeof(r));
+        log_ring_commit(&s_ring, p);
+    }
+    atomic_fetch_add(&s_done, 1);
+    return NULL;
+}
+
+static void test_ring_concurrent(void)
+{
+    pthread_t threads[PRODUCERS];
+    int64_t last[PRODUCERS];
+    uint32_t received = 0;
+
+    log_ring_init(&s_ring, s_buf, sizeof(s_buf));
+    for (int i = 0; i < PRODUCERS; i++) {
+        last[i] = -1;
+        pthread_create(&threads[i], NULL, producer, (void *)(uintptr_t)i);
+    }
+
+    for (;;) {
+        uint32_t len;
+        const uint8_t *p = log_ring_peek(&s_ring, &len);
+        if (!p) {
+            if (atomic_load(&s_done) == PRODUCERS && log_ring_empty(&s_ring)) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        record_t r;
+        memcpy(&r, p, sizeof(r));
+        if (r.producer >= PRODUCERS || (int64_t)r.seq <= last[r.producer] ||
+            len != sizeof(record_t) + (r.seq * 7 + r.producer) % 57) {
+            CHECK_FAIL("bad record producer %u seq %u len %u", r.producer, r.seq, len);
+            break;
+        }
+        for (uint32_t j = sizeof(r); j < len; j++) {
+            if (p[j] != (uint8_t)(r.seq ^ r.producer)) {
+                CHECK_FAIL("torn record producer %u seq %u", r.producer, r.seq);
+                break;
+            }
+        }
+        last[r.producer] = r.seq;
+        received++;
+        log_ring_release(&s_ring);
+    }
+
+    for (int i = 0; i < PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    CHECK_EQ(received + atomic_load(&s_ring.dropped), PRODUCERS * PER_PRODUCER);
+    printf("  %u received, %u dropped\n", received, atomic_load(&s_ring.dropped));
+}
+
+int main(void)
+{
+    test_args();
+    test_ring_wrap();
+    test_ring_concurrent();
+
+    return host_test_summary("logger");
+}
@@ -0,0 +1,317 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "log_args.h"
+
+#define LOG_ARGS_STR_NULL   0xFF    // Length byte of a NULL string argument
+
+typedef enum {
+    LOG_ARG_NONE,       // %% or unsupported, consumes nothing
+    LOG_ARG_INT,        // 4 bytes
+    LOG_ARG_LONG_LONG,  // 8 bytes
+    LOG_ARG_DOUBLE,     // 8 bytes
+    LOG_ARG_STRING,     // Length byte + bytes
+    LOG_ARG_POINTER,    // 4 bytes
+} log_arg_kind_t;
+
+typedef struct {
+    const char *start;          // The '%'
+    const char *end;            // Past the conversion character
+    const char *flags;          // Flag characters, flags_len of them
+    int flags_len;
+    int width;                  // -1 if absent
+    int precision;              // -1 if absent
+    bool width_star;
+    bool precision_star;
+    char length[3];             // Length modifier kept for the host printf
+    char conversion;
+    log_arg_kind_t kind;
+} log_spec_t;
+
+static int log_args_number(const char **p)
+{
+    int n = 0;
+    while (**p >= '0' && **p <= '9') {
+        n = n * 10 + (*(*p)++ - '0');
+    }
+    return n;
+}
+
+// Find the next conversion at or after p; false at the end of the format
+static bool log_args_next(const char *p, log_spec_t *spec)
+{
+    p = strchr(p, '%');
+    if (!p) {
+        return false;
+    }
+    memset(spec, 0, sizeof(*spec));
+    spec->start = p++;
+    spec->width = -1;
+    spec->precision = -1;
+
+    spec->flags = p;
+    while (*p && strchr("-+ #0", *p)) {
+        p++;
+    }
+    spec->flags_len = p - spec->flags;
+
+    if (*p == '*') {
+        spec->width_star = true;
+        p++;
+    } else if (*p >= '0' && *p <= '9') {
+        spec->width = log_args_number(&p);
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec->precision_star = true;
+            p++;
+        } else {
+            spec->precision = log_args_number(&p);
+        }
+    }
+
+    // All integer types but long long are 32 bits on the target
+    bool long_long = false;
+    if (p[0] == 'h') {
+        spec->length[0] = 'h';
+        if (p[1] == 'h') {
+            spec->length[1] = 'h';
+            p++;
+        }
+        p++;
+    } else if ((p[0] == 'l' && p[1] == 'l') || p[0] == 'q') {
+        long_long = true;
+        p += p[0] == 'q' ? 1 : 2;
+    } else if (*p && strchr("ljztL", *p)) {
+        p++;
+    }
+
+    spec->conversion = *p;
+    switch (*p) {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+            spec->kind = long_long ? LOG_ARG_LONG_LONG : LOG_ARG_INT;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            spec->kind = LOG_ARG_DOUBLE;
+            break;
+        case 's':
+            spec->kind = LOG_ARG_STRING;
+            break;
+        case 'p':
+            spec->kind = LOG_ARG_POINTER;
+            break;
+        case '\0':
+            // Dangling '%': print it as text
+            spec->end = p;
+            spec->kind = LOG_ARG_NONE;
+            return true;
+        default:
+            spec->kind = LOG_ARG_NONE;
+            break;
+    }
+    spec->end = p + 1;
+    return true;
+}
+
+static bool log_args_put(uint8_t **p, const uint8_t *end, const void *value, size_t size)
+{
+    if ((size_t)(end - *p) < size) {
+        return false;
+    }
+    memcpy(*p, value, size);
+    *p += size;
+    return true;
+}
+
+size_t log_args_capture(uint8_t *buf, size_t len, const char *format, va_list args)
+{
+    uint8_t *p = buf;
+    const uint8_t *end = buf + len;
+    log_spec_t spec;
+    va_list ap;
+    bool fits = true;
+
+    va_copy(ap, args);
+    for (const char *f = format; fits && log_args_next(f, &spec); f = spec.end) {
+        if (spec.width_star) {
+            int32_t v = va_arg(ap, int);
+            fits = log_args_put(&p, end, &v, sizeof(v));
+        }
+        if (fits && spec.precision_star) {
+            int32_t v = va_arg(ap, int);
+            fits = log_args_put(&p, end, &v, sizeof(v));
+        }
+        if (!fits) {
+            break;
+        }
+        switch (spec.kind) {
+            case LOG_ARG_INT: {
+                uint32_t v = va_arg(ap, unsigned int);
+                fits = log_args_put(&p, end, &v, sizeof(v));
+                break;
+            }
+            case LOG_ARG_LONG_LONG: {
+                uint64_t v = va_arg(ap, unsigned long long);
+                fits = log_args_put(&p, end, &v, sizeof(v));
+                break;
+            }
+            case LOG_ARG_DOUBLE: {
+                double v = va_arg(ap, double);
+                fits = log_args_put(&p, end, &v, sizeof(v));
+                break;
+            }
+            case LOG_ARG_POINTER: {
+                uint32_t v = (uint32_t)(uintptr_t)va_arg(ap, void *);
+                fits = log_args_put(&p, end, &v, sizeof(v));
+                break;
+            }
+            case LOG_ARG_STRING: {
+                const char *s = va_arg(ap, const char *);
+                uint8_t n = s ? strnlen(s, LOG_ARGS_STR_MAX) : LOG_ARGS_STR_NULL;
+                fits = log_args_put(&p, end, &n, 1) && (!s || log_args_put(&p, end, s, n));
+                break;
+            }
+            case LOG_ARG_NONE:
+                break;
+        }
+    }
+    va_end(ap);
+    return p - buf;
+}
+
+// Append to out at *pos, keeping it NUL-terminated
+static void log_args_append(char *out, size_t len, size_t *pos, const char *text, size_t n)
+{
+    if (*pos + 1 >= len) {
+        return;
+    }
+    if (n > len - 1 - *pos) {
+        n = len - 1 - *pos;
+    }
+    memcpy(out + *pos, text, n);
+    *pos += n;
+    out[*pos] = '\0';
+}
+
+static bool log_args_get(const uint8_t **p, const uint8_t *end, void *value, size_t size)
+{
+    if ((size_t)(end - *p) < size) {
+        return false;
+    }
+    memcpy(value, *p, size);
+    *p += size;
+    return true;
+}
+
+size_t log_args_format(char *out, size_t len, const char *format, const uint8_t *args, size_t args_len)
+{
+    const uint8_t *p = args;
+    const uint8_t *end = args + args_len;
+    size_t pos = 0;
+    log_spec_t spec;
+    const char *f = format;
+
+    if (len == 0) {
+        return 0;
+    }
+    out[0] = '\0';
+
+    while (log_args_next(f, &spec)) {
+        log_args_append(out, len, &pos, f, spec.start - f);
+        f = spec.end;
+
+        if (spec.kind == LOG_ARG_NONE) {
+            if (spec.conversion == '%') {
+                log_args_append(out, len, &pos, "%", 1);
+            } else if (spec.conversion != 'n') {
+                log_args_append(out, len, &pos, spec.start, spec.end - spec.start);
+            }
+            continue;
+        }
+
+        int32_t width = spec.width, precision = spec.precision;
+        bool ok = (!spec.width_star || log_args_get(&p, end, &width, sizeof(width))) &&
+                  (!spec.precision_star || log_args_get(&p, end, &precision, sizeof(precision)));
+
+        // Rebuild the conversion for the local printf, with the star values filled in
+        char conv[32];
+        int n = snprintf(conv, sizeof(conv), "%%%.*s", spec.flags_len > 5 ? 5 : spec.flags_len, spec.flags);
+        if (width >= 0) {
+            n += snprintf(conv + n, sizeof(conv) - n, "%d", (int)width);
+        }
+        if (precision >= 0) {
+            n += snprintf(conv + n, sizeof(conv) - n, ".%d", (int)precision);
+        }
+
+        char text[LOG_ARGS_STR_MAX + 64];
+        text[0] = '\0';
+        switch (spec.kind) {
+            case LOG_ARG_INT: {
+                uint32_t v;
+                if ((ok = ok && log_args_get(&p, end, &v, sizeof(v)))) {
+                    snprintf(conv + n, sizeof(conv) - n, "%s%c", spec.length, spec.conversion);
+                    if (spec.conversion == 'd' || spec.conversion == 'i') {
+                        snprintf(text, sizeof(text), conv, (int)(int32_t)v);
+                    } else {
+                        snprintf(text, sizeof(text), conv, (unsigned int)v);
+                    }
+                }
+                break;
+            }
+            case LOG_ARG_LONG_LONG: {
+                uint64_t v;
+                if ((ok = ok && log_args_get(&p, end, &v, sizeof(v)))) {
+                    snprintf(conv + n, sizeof(conv) - n, "ll%c", spec.conversion);
+                    if (spec.conversion == 'd' || spec.conversion == 'i') {
+                        snprintf(text, sizeof(text), conv, (long long)(int64_t)v);
+                    } else {
+                        snprintf(text, sizeof(text), conv, (unsigned long long)v);
+                    }
+                }
+                break;
+            }
+            case LOG_ARG_DOUBLE: {
+                double v;
+                if ((ok = ok && log_args_get(&p, end, &v, sizeof(v)))) {
+                    snprintf(conv + n, sizeof(conv) - n, "%c", spec.conversion);
+                    snprintf(text, sizeof(text), conv, v);
+                }
+                break;
+            }
+            case LOG_ARG_POINTER: {
+                uint32_t v;
+                if ((ok = ok && log_args_get(&p, end, &v, sizeof(v)))) {
+                    snprintf(text, sizeof(text), "0x%08x", (unsigned int)v);
+                }
+                break;
+            }
+            case LOG_ARG_STRING: {
+                uint8_t sl;
+                char s[LOG_ARGS_STR_MAX + 1];
+                if ((ok = ok && log_args_get(&p, end, &sl, 1))) {
+                    if (sl == LOG_ARGS_STR_NULL) {
+                        strcpy(s, "(null)");
+                    } else if ((ok = sl <= LOG_ARGS_STR_MAX && log_args_get(&p, end, s, sl))) {
+                        s[sl] = '\0';
+                    }
+                }
+                if (ok) {
+                    snprintf(conv + n, sizeof(conv) - n, "s");
+                    snprintf(text, sizeof(text), conv, s);
+                }
+                break;
+            }
+            case LOG_ARG_NONE:
+                break;
+        }
+        if (!ok) {
+            // Argument was dropped at capture time; the rest are missing too
+            p = end;
+            strcpy(text, "?");
+        }
+        log_args_append(out, len, &pos, text, strlen(text));
+    }
+    log_args_append(out, len, &pos, f, strlen(f));
+    return pos;
+}
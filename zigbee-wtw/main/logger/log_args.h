@@ -0,0 +1,40 @@
+#pragma once
+#ifndef LOG_ARGS_H
+#define LOG_ARGS_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Raw printf arguments for deferred formatting.
+ *
+ * log_args_capture() walks a format string and copies each argument it
+ * consumes into a byte buffer, in order and without formatting: integers and
+ * pointers as 4 bytes (8 for ll), floating point as an 8-byte double, `*`
+ * widths as 4 bytes, and strings by value (a length byte, then up to
+ * LOG_ARGS_STR_MAX bytes) since the pointer may not outlive the call.
+ * log_args_format() expands the format later from those bytes. Sizes are the
+ * ones of the 32-bit target, so the host decoder reads the same layout. No
+ * IDF dependencies, so the host tools build it unchanged.
+ */
+
+// Longest string argument kept, in bytes; longer ones are truncated
+#define LOG_ARGS_STR_MAX    48
+
+// Room for the arguments of any one message
+#define LOG_ARGS_MAX        128
+
+/**
+ * @brief Copy the arguments used by format into buf
+ * @return Bytes written; arguments that do not fit are dropped and formatted as "?"
+ */
+size_t log_args_capture(uint8_t *buf, size_t len, const char *format, va_list args);
+
+/**
+ * @brief Format a message from captured arguments, like snprintf
+ * @return Length of the formatted message (truncated to len - 1)
+ */
+size_t log_args_format(char *out, size_t len, const char *format, const uint8_t *args, size_t args_len);
+
+#endif // LOG_ARGS_H
@@ -0,0 +1,106 @@
+#include <string.h>
+#include "log_ring.h"
+
+// Record header: flags and payload length (padding records: their full size)
+#define LOG_RING_COMMITTED      0x80000000u
+#define LOG_RING_PADDING        0x40000000u
+#define LOG_RING_LEN_MASK       0x0000FFFFu
+
+#define LOG_RING_HEADER         4
+#define LOG_RING_ALIGN(n)       (((n) + 3u) & ~3u)
+
+static _Atomic uint32_t *log_ring_header(log_ring_t *ring, uint32_t pos)
+{
+    return (_Atomic uint32_t *)&ring->buf[pos & (ring->size - 1)];
+}
+
+void log_ring_init(log_ring_t *ring, void *buf, uint32_t size)
+{
+    memset(buf, 0, size);
+    ring->buf = buf;
+    ring->size = size;
+    atomic_init(&ring->reserve, 0);
+    atomic_init(&ring->release, 0);
+    atomic_init(&ring->dropped, 0);
+}
+
+void *log_ring_reserve(log_ring_t *ring, uint32_t len, bool *was_empty)
+{
+    uint32_t total = LOG_RING_HEADER + LOG_RING_ALIGN(len);
+    uint32_t head, tail, pad;
+
+    if (len > LOG_RING_RECORD_MAX) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    head = atomic_load_explicit(&ring->reserve, memory_order_relaxed);
+    do {
+        // Acquire pairs with log_ring_release(): the space is zeroed before it is handed back
+        tail = atomic_load_explicit(&ring->release, memory_order_acquire);
+        uint32_t room = ring->size - (head & (ring->size - 1));
+        pad = room < total ? room : 0;
+        if (head - tail + pad + total > ring->size) {
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&ring->reserve, &head, head + pad + total,
+                                                    memory_order_acq_rel, memory_order_relaxed));
+
+    if (was_empty) {
+        *was_empty = head == tail;
+    }
+    if (pad) {
+        atomic_store_explicit(log_ring_header(ring, head), LOG_RING_COMMITTED | LOG_RING_PADDING | pad,
+                              memory_order_release);
+    }
+    _Atomic uint32_t *header = log_ring_header(ring, head + pad);
+    atomic_store_explicit(header, len, memory_order_relaxed);
+    return (uint8_t *)header + LOG_RING_HEADER;
+}
+
+void log_ring_commit(log_ring_t *ring, void *payload)
+{
+    _Atomic uint32_t *header = (_Atomic uint32_t *)((uint8_t *)payload - LOG_RING_HEADER);
+    uint32_t len = atomic_load_explicit(header, memory_order_relaxed);
+    atomic_store_explicit(header, LOG_RING_COMMITTED | len, memory_order_release);
+}
+
+const void *log_ring_peek(log_ring_t *ring, uint32_t *len)
+{
+    for (;;) {
+        uint32_t tail = atomic_load_explicit(&ring->release, memory_order_relaxed);
+        if (tail == atomic_load_explicit(&ring->reserve, memory_order_acquire)) {
+            return NULL;
+        }
+        _Atomic uint32_t *header = log_ring_header(ring, tail);
+        uint32_t h = atomic_load_explicit(header, memory_order_acquire);
+        if (!(h & LOG_RING_COMMITTED)) {
+            return NULL;
+        }
+        if (h & LOG_RING_PADDING) {
+            uint32_t pad = h & LOG_RING_LEN_MASK;
+            memset((void *)header, 0, pad);
+            atomic_store_explicit(&ring->release, tail + pad, memory_order_release);
+            continue;
+        }
+        *len = h & LOG_RING_LEN_MASK;
+        return (const uint8_t *)header + LOG_RING_HEADER;
+    }
+}
+
+void log_ring_release(log_ring_t *ring)
+{
+    uint32_t tail = atomic_load_explicit(&ring->release, memory_order_relaxed);
+    _Atomic uint32_t *header = log_ring_header(ring, tail);
+    uint32_t total = LOG_RING_HEADER + LOG_RING_ALIGN(atomic_load_explicit(header, memory_order_relaxed) & LOG_RING_LEN_MASK);
+
+    memset((void *)header, 0, total);
+    atomic_store_explicit(&ring->release, tail + total, memory_order_release);
+}
+
+bool log_ring_empty(log_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->reserve, memory_order_acquire) ==
+           atomic_load_explicit(&ring->release, memory_order_acquire);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Lock-free multi-producer, single-consumer ring of variable-length records.
+ *
+ * A producer claims space by advancing `reserve` with a compare-and-swap,
+ * fills it and then publishes the record by setting the committed bit in its
+ * 4-byte header. The consumer reads records in order, stops at the first one
+ * still being written, and zeroes each record before handing the space back
+ * through `release`, so an unwritten header always reads as uncommitted.
+ * Records never wrap: a record that does not fit before the end of the buffer
+ * is preceded by a padding record. When the ring is full the record is dropped
+ * and counted instead of waiting, so producers never block and are safe in
+ * any task or ISR. No IDF dependencies, so the host test builds it unchanged.
+ */
+
+typedef struct {
+    uint8_t *buf;                   // size bytes, 4-byte aligned and zeroed
+    uint32_t size;                  // Power of two
+    _Atomic uint32_t reserve;       // Bytes claimed by producers, wraps
+    _Atomic uint32_t release;       // Bytes handed back by the consumer, wraps
+    _Atomic uint32_t dropped;       // Records that did not fit
+} log_ring_t;
+
+// Largest payload of one record
+#define LOG_RING_RECORD_MAX     256
+
+/**
+ * @brief Set up a ring over buf
+ * @param size Power of two of at least 2 * (LOG_RING_RECORD_MAX + 4)
+ */
+void log_ring_init(log_ring_t *ring, void *buf, uint32_t size);
+
+/**
+ * @brief Claim space for a record of len bytes
+ * @param was_empty Set to whether the consumer had nothing left to read; may be NULL
+ * @return Payload to fill and pass to log_ring_commit(), NULL if the record was dropped
+ */
+void *log_ring_reserve(log_ring_t *ring, uint32_t len, bool *was_empty);
+
+/**
+ * @brief Publish a reserved record
+ */
+void log_ring_commit(log_ring_t *ring, void *payload);
+
+/**
+ * @brief Oldest record, consumer only
+ * @return Payload, NULL if the ring is empty or the oldest record is not committed yet
+ */
+const void *log_ring_peek(log_ring_t *ring, uint32_t *len);
+
+/**
+ * @brief Hand back the record returned by log_ring_peek(), consumer only
+ */
+void log_ring_release(log_ring_t *ring);
+
+/**
+ * @brief Whether every reserved record has been released
+ */
+bool log_ring_empty(log_ring_t *ring);
+
+#endif // LOG_RING_H
@@ -1,12 +1,253 @@
 #include "logger.h"
 #include <esp_log.h>
+#include <inttypes.h>
 #include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "log_args.h"
+#include "log_ring.h"
+#include "metrics/metrics.h"
+#include "flash_log.h"
+
+static const esp_log_level_t s_esp_levels[] = {
+    [LOG_LEVEL_INFO] = ESP_LOG_INFO,
+    [LOG_LEVEL_WARN] = ESP_LOG_WARN,
+    [LOG_LEVEL_ERROR] = ESP_LOG_ERROR,
+};
+
+#if CONFIG_LOGGER_DEFERRED
+
+#define LOGGER_TASK_STACK       3072
+#define LOGGER_LINE_MAX         256
+
+// Binary output: one line per message, this prefix and the base64 frame
+#define LOGGER_BINARY_PREFIX    "#L "
+#define LOGGER_BINARY_VERSION   1
+
+_Static_assert((CONFIG_LOGGER_RING_SIZE & (CONFIG_LOGGER_RING_SIZE - 1)) == 0,
+               "CONFIG_LOGGER_RING_SIZE must be a power of two");
+
+// Ring record: where the message comes from and its raw arguments
+typedef struct {
+    uint32_t timestamp_ms;
+    const char *tag;
+    const char *format;
+    uint8_t level;
+    uint8_t args_len;
+    uint8_t args[];
+} log_entry_t;
+
+static const char *TAG = "LOGGER";
+
+static uint8_t s_ring_buf[CONFIG_LOGGER_RING_SIZE] __attribute__((aligned(4)));
+static log_ring_t s_ring;
+static TaskHandle_t s_task;
+static uint32_t s_dropped_reported;
+
+static void logger_defer(log_level_t level, const char *tag, const char *format, va_list args)
+{
+    uint8_t raw[LOG_ARGS_MAX];
+    size_t len = log_args_capture(raw, sizeof(raw), format, args);
+    bool was_empty;
+
+    log_entry_t *entry = log_ring_reserve(&s_ring, sizeof(log_entry_t) + len, &was_empty);
+    if (!entry) {
+        return;
+    }
+    entry->timestamp_ms = esp_log_timestamp();
+    entry->tag = tag;
+    entry->format = format;
+    entry->level = level;
+    entry->args_len = len;
+    memcpy(entry->args, raw, len);
+    log_ring_commit(&s_ring, entry);
+
+    // The task drains until empty, so it only needs waking for the first record
+    if (was_empty) {
+        if (xPortInIsrContext()) {
+            BaseType_t woken = pdFALSE;
+            vTaskNotifyGiveFromISR(s_task, &woken);
+            portYIELD_FROM_ISR(woken);
+        } else {
+            xTaskNotifyGive(s_task);
+        }
+    }
+}
+
+#if CONFIG_LOGGER_BINARY
+// The persistent log stores text, so only entries it keeps get formatted here
+static void logger_persist(const log_entry_t *entry)
+{
+    char text[LOGGER_LINE_MAX];
+
+    if (flash_log_enabled(s_esp_levels[entry->level])) {
+        log_args_format(text, sizeof(text), entry->format, entry->args, entry->args_len);
+        flash_log_write(s_esp_levels[entry->level], entry->tag, text);
+    }
+}
+
+static size_t logger_base64(char *out, const uint8_t *in, size_t len)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char *p = out;
+
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = in[i] << 16;
+        if (i + 1 < len) {
+            v |= in[i + 1] << 8;
+        }
+        if (i + 2 < len) {
+            v |= in[i + 2];
+        }
+        *p++ = alphabet[(v >> 18) & 0x3F];
+        *p++ = alphabet[(v >> 12) & 0x3F];
+        *p++ = i + 1 < len ? alphabet[(v >> 6) & 0x3F] : '=';
+        *p++ = i + 2 < len ? alphabet[v & 0x3F] : '=';
+    }
+    *p = '\0';
+    return p - out;
+}
+
+// Frame (little endian): version, level, uint32 timestamp, uint32 tag and format addresses, raw arguments
+static void logger_emit(const log_entry_t *entry)
+{
+    uint8_t frame[14 + LOG_ARGS_MAX];
+    char line[sizeof(LOGGER_BINARY_PREFIX) + (sizeof(frame) + 2) / 3 * 4 + 1];
+    uint32_t tag = (uint32_t)(uintptr_t)entry->tag;
+    uint32_t format = (uint32_t)(uintptr_t)entry->format;
+
+    logger_persist(entry);
+    if (esp_log_level_get(entry->tag) < s_esp_levels[entry->level]) {
+        return;
+    }
+    frame[0] = LOGGER_BINARY_VERSION;
+    frame[1] = entry->level;
+    memcpy(&frame[2], &entry->timestamp_ms, 4);
+    memcpy(&frame[6], &tag, 4);
+    memcpy(&frame[10], &format, 4);
+    memcpy(&frame[14], entry->args, entry->args_len);
+
+    strcpy(line, LOGGER_BINARY_PREFIX);
+    logger_base64(line + strlen(LOGGER_BINARY_PREFIX), frame, 14 + entry->args_len);
+    puts(line);
+}
+#else
+static void logger_emit(const log_entry_t *entry)
+{
+    static const char letters[] = {
+        [LOG_LEVEL_INFO] = 'I',
+        [LOG_LEVEL_WARN] = 'W',
+        [LOG_LEVEL_ERROR] = 'E',
+    };
+    static const char *const colors[] = {
+        [LOG_LEVEL_INFO] = LOG_COLOR_I,
+        [LOG_LEVEL_WARN] = LOG_COLOR_W,
+        [LOG_LEVEL_ERROR] = LOG_COLOR_E,
+    };
+    char text[LOGGER_LINE_MAX];
+
+    log_args_format(text, sizeof(text), entry->format, entry->args, entry->args_len);
+    esp_log_write(s_esp_levels[entry->level], entry->tag, "%s%c (%" PRIu32 ") %s: %s" LOG_RESET_COLOR "\n",
+                  colors[entry->level], letters[entry->level], entry->timestamp_ms, entry->tag, text);
+    if (flash_log_enabled(s_esp_levels[entry->level])) {
+        flash_log_write(s_esp_levels[entry->level], entry->tag, text);
+    }
+}
+#endif
+
+static void logger_report_dropped(void)
+{
+    uint32_t dropped = atomic_load(&s_ring.dropped);
+    if (dropped != s_dropped_reported) {
+        metrics_add(METRIC_LOG_DROPPED, dropped - s_dropped_reported);
+        ESP_LOGW(TAG, "Dropped %" PRIu32 " log messages", dropped - s_dropped_reported);
+        s_dropped_reported = dropped;
+    }
+}
+
+static void logger_task(void *pvParameters)
+{
+    for (;;) {
+        uint32_t len;
+        const log_entry_t *entry = log_ring_peek(&s_ring, &len);
+        if (entry) {
+            logger_emit(entry);
+            log_ring_release(&s_ring);
+            continue;
+        }
+
+        logger_report_dropped();
+        // Not empty means a producer is still filling the oldest record
+        ulTaskNotifyTake(pdTRUE, log_ring_empty(&s_ring) ? portMAX_DELAY : 1);
+    }
+}
+
+void logger_init(void)
+{
+    if (s_task) {
+        return;
+    }
+    log_ring_init(&s_ring, s_ring_buf, sizeof(s_ring_buf));
+    xTaskCreate(logger_task, "logger", LOGGER_TASK_STACK, NULL, CONFIG_LOGGER_TASK_PRIORITY, &s_task);
+}
+
+void logger_flush(uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    while (s_task && !log_ring_empty(&s_ring) && xTaskGetTickCount() - start < pdMS_TO_TICKS(timeout_ms)) {
+        vTaskDelay(1);
+    }
+    fflush(stdout);
+}
+
+uint32_t logger_dropped(void)
+{
+    return s_task ? atomic_load(&s_ring.dropped) : 0;
+}
+
+#else
+
+void logger_init(void)
+{
+}
+
+void logger_flush(uint32_t timeout_ms)
+{
+    fflush(stdout);
+}
+
+uint32_t logger_dropped(void)
+{
+    return 0;
+}
+
+#endif // CONFIG_LOGGER_DEFERRED
 
 // Centralized logging function
 void app_log(log_level_t level, const char *tag, const char *format, ...) {
     va_list args;
     va_start(args, format);
 
+#if CONFIG_LOGGER_DEFERRED
+    if (s_task) {
+        logger_defer(level, tag, format, args);
+        va_end(args);
+        return;
+    }
+#endif
+
+    if (flash_log_enabled(s_esp_levels[level])) {
+        char text[FLASH_LOG_TEXT_MAX + 1];
+        va_list copy;
+        va_copy(copy, args);
+        vsnprintf(text, sizeof(text), format, copy);
+        va_end(copy);
+        flash_log_write(s_esp_levels[level], tag, text);
+    }
+
     switch (level) {
         case LOG_LEVEL_INFO:
             esp_log_writev(ESP_LOG_INFO, tag, format, args);
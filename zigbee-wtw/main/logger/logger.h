@@ -2,6 +2,8 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <stdint.h>
+
 // Enum for log levels
 typedef enum {
     LOG_LEVEL_INFO,
@@ -12,4 +14,26 @@ typedef enum {
 // Function declaration for the centralized logger
 void app_log(log_level_t level, const char *tag, const char *format, ...);
 
+/**
+ * @brief Start the deferred logger (CONFIG_LOGGER_DEFERRED)
+ *
+ * From then on app_log() only copies the format pointer and raw arguments
+ * into a lock-free ring, and a low-priority task formats and prints them.
+ * Messages that do not fit are dropped and counted, never waited for. Before
+ * this call, or without CONFIG_LOGGER_DEFERRED, app_log() writes synchronously.
+ */
+void logger_init(void);
+
+/**
+ * @brief Wait until queued messages are printed, e.g. before a restart
+ *
+ * @param timeout_ms Longest wait
+ */
+void logger_flush(uint32_t timeout_ms);
+
+/**
+ * @brief Messages dropped because the ring was full
+ */
+uint32_t logger_dropped(void);
+
 #endif // LOGGER_H
@@ -6,22 +6,45 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
+#include "flash_log.h"
+#include "esp_timer.h"
 #include "esp_zigbee_core.h"
 #include "zigbee_handler/zigbee_handler.h"
+#include "gpio_control/gpio_control.h"
+#include "relay_state/relay_state.h"
+#include "factory_reset/factory_reset.h"
 #include "logger/logger.h"
 #include "metrics/metrics.h"
+#include "metrics/metrics_console.h"
 
 static const char *TAG = "MAIN";
 
 void app_main(void)
 {
-    // Initialize NVS
-    ESP_ERROR_CHECK(nvs_flash_erase());
-    ESP_ERROR_CHECK(nvs_flash_init());
+    // Initialize NVS, keeping its contents; only an unusable partition is erased
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
 
     // Initialize metrics
     metrics_init();
 
+    // Restore the relays first, long before the network is back
+    init_relay_outputs(relay_state_load());
+    uint32_t restore_us = (uint32_t)esp_timer_get_time();
+    metrics_set(METRIC_RESTORE_US, restore_us);
+
+    // Keep warnings and errors across resets
+    flash_log_init();
+
+    // Move log formatting off the calling tasks
+    logger_init();
+
+    app_log(LOG_LEVEL_INFO, TAG, "Relays restored %lu us after start", (unsigned long)restore_us);
+
     // Initialize Zigbee platform
     esp_zb_platform_config_t config = {
         .radio_config = {.radio_mode = ZB_RADIO_MODE_NATIVE},
@@ -33,4 +56,10 @@ void app_main(void)
     
     // Start Zigbee task
     xTaskCreate(zigbee_main_task, "Zigbee_main", 4096, NULL, 5, NULL);
+
+    // Network and relay state are only forgotten on purpose
+    factory_reset_start();
+
+    // Serial `metrics`, `log` and `factory_reset` commands
+    metrics_console_start();
 }
\ No newline at end of file
@@ -0,0 +1,178 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host tests for the metrics registry
+ *
+ * Writer threads hammer counters and a histogram while a reader takes
+ * snapshots; every snapshot must be self-consistent and nothing may be lost.
+ *
+ * Compile and run from this directory:
+ *
+ *   cc -O2 -pthread -I. -I../../../components/host_test -I<stubs> host/metrics_test.c metrics.c \
+ *      -o metrics_test && ./metrics_test
+ *
+ * <stubs> needs esp_err.h and freertos/{FreeRTOS,task,semphr}.h declaring
+ * the calls implemented below.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "metrics.h"
+#include "host_test.h"
+
+/* FreeRTOS on pthreads, as much as metrics.c needs */
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return &s_mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t ticks)
+{
+    return pthread_mutex_lock(handle) == 0;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle)
+{
+    return pthread_mutex_unlock(handle) == 0;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    sched_yield();
+}
+
+static void test_basic(void)
+{
+    metrics_snapshot_t snap;
+
+    metrics_init();
+    metrics_increment(METRIC_ZIGBEE_CMD_RECEIVED);
+    metrics_add(METRIC_RELAY_CHANGES, 5);
+    metrics_set(METRIC_RELAY_STATE, 2);
+    // Wrong type or ID is ignored
+    metrics_set(METRIC_OTA_STARTED, 7);
+    metrics_increment(METRIC_RELAY_STATE);
+    metrics_increment(METRIC_COUNT);
+    metrics_observe(METRIC_HIST_COUNT, 1);
+
+    metrics_observe(METRIC_HIST_ZB_CALLBACK_US, 0);
+    metrics_observe(METRIC_HIST_ZB_CALLBACK_US, 100);
+    metrics_observe(METRIC_HIST_ZB_CALLBACK_US, 101);
+    metrics_observe(METRIC_HIST_ZB_CALLBACK_US, 5000000);
+
+    CHECK_EQ(metrics_get(METRIC_ZIGBEE_CMD_RECEIVED), 1);
+    CHECK_EQ(metrics_snapshot(&snap), ESP_OK);
+    CHECK_EQ(snap.seq, 0);
+    CHECK_EQ(snap.values[METRIC_ZIGBEE_CMD_RECEIVED], 1);
+    CHECK_EQ(snap.values[METRIC_RELAY_CHANGES], 5);
+    CHECK_EQ(snap.values[METRIC_OTA_STARTED], 0);
+    CHECK_EQ(snap.values[METRIC_RELAY_STATE], 2);
+
+    const metrics_histogram_t *hist = &snap.histograms[METRIC_HIST_ZB_CALLBACK_US];
+    CHECK_EQ(hist->count, 4);
+    CHECK_EQ(hist->sum_us, 5000201);
+    CHECK_EQ(hist->buckets[0], 2);      // <= 100 us, bounds are inclusive
+    CHECK_EQ(hist->buckets[1], 1);
+    CHECK_EQ(hist->buckets[METRICS_HISTOGRAM_BUCKETS - 1], 1);
+    CHECK_EQ(snap.histograms[METRIC_HIST_CMD_TO_RELAY_US].count, 0);
+
+    // Totals carry over, gauges keep their last value
+    metrics_increment(METRIC_ZIGBEE_CMD_RECEIVED);
+    CHECK_EQ(metrics_get(METRIC_ZIGBEE_CMD_RECEIVED), 2);
+    metrics_snapshot(&snap);
+    CHECK_EQ(snap.seq, 1);
+    CHECK_EQ(snap.values[METRIC_ZIGBEE_CMD_RECEIVED], 2);
+    CHECK_EQ(snap.values[METRIC_RELAY_STATE], 2);
+    CHECK_EQ(snap.histograms[METRIC_HIST_ZB_CALLBACK_US].count, 4);
+}
+
+static void test_encode(void)
+{
+    metrics_snapshot_t snap;
+    uint8_t buf[METRICS_ENCODED_LEN];
+
+    metrics_init();
+    metrics_add(METRIC_OTA_STARTED, 0x01020304);
+    metrics_observe(METRIC_HIST_CMD_TO_RELAY_US, 300);
+    metrics_snapshot(&snap);
+
+    CHECK_EQ(metrics_encode(&snap, buf, sizeof(buf) - 1), 0);
+    CHECK_EQ(metrics_encode(&snap, buf, sizeof(buf)), METRICS_ENCODED_LEN);
+    // The attribute is a ZCL octet string: at most 254 bytes
+    CHECK_EQ(METRICS_ENCODED_LEN <= 254, 1);
+    CHECK_EQ(buf[0], METRICS_ENCODED_VERSION);
+    CHECK_EQ(buf[1], METRIC_COUNT);
+    CHECK_EQ(buf[3], METRICS_HISTOGRAM_BUCKETS);
+    const uint8_t *value = &buf[4 + 4 * METRIC_OTA_STARTED];
+    CHECK_EQ(value[0], 0x04);
+    CHECK_EQ(value[3], 0x01);
+    // Histogram 0: sum, then bucket 2 (<= 500 us)
+    const uint8_t *hist = &buf[4 + 4 * METRIC_COUNT];
+    CHECK_EQ(hist[0] | hist[1] << 8, 300);
+    CHECK_EQ(hist[4 + 4 * 2], 1);
+}
+
+#define WRITERS         4
+#define WRITES          200000
+#define OBSERVED_US     150
+
+static volatile int s_running;
+
+static void *writer(void *arg)
+{
+    for (int i = 0; i < WRITES; i++) {
+        metrics_increment(METRIC_ZIGBEE_CMD_RECEIVED);
+        metrics_observe(METRIC_HIST_CMD_TO_RELAY_US, OBSERVED_US);
+    }
+    return NULL;
+}
+
+static void test_concurrent(void)
+{
+    pthread_t threads[WRITERS];
+    metrics_snapshot_t snap;
+    uint32_t last = 0;
+
+    metrics_init();
+    for (int i = 0; i < WRITERS; i++) {
+        pthread_create(&threads[i], NULL, writer, NULL);
+    }
+
+    do {
+        metrics_snapshot(&snap);
+        const metrics_histogram_t *hist = &snap.histograms[METRIC_HIST_CMD_TO_RELAY_US];
+        // Every observation is seen whole: its bucket and its share of the sum
+        if (hist->sum_us != hist->count * OBSERVED_US || hist->buckets[1] != hist->count) {
+            CHECK_FAIL("inconsistent snapshot: count %u sum %u", hist->count, hist->sum_us);
+            break;
+        }
+        if (snap.values[METRIC_ZIGBEE_CMD_RECEIVED] < last) {
+            CHECK_FAIL("counter went back: %u < %u", snap.values[METRIC_ZIGBEE_CMD_RECEIVED], last);
+            break;
+        }
+        last = snap.values[METRIC_ZIGBEE_CMD_RECEIVED];
+    } while (last < WRITERS * WRITES || snap.histograms[METRIC_HIST_CMD_TO_RELAY_US].count < WRITERS * WRITES);
+
+    for (int i = 0; i < WRITERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    metrics_snapshot(&snap);
+    CHECK_EQ(snap.values[METRIC_ZIGBEE_CMD_RECEIVED], WRITERS * WRITES);
+    CHECK_EQ(snap.histograms[METRIC_HIST_CMD_TO_RELAY_US].count, WRITERS * WRITES);
+}
+
+int main(void)
+{
+    test_basic();
+    test_encode();
+    test_concurrent();
+
+    return host_test_summary("metrics");
+}
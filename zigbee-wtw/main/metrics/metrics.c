@@ -1,27 +1,239 @@
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "metrics.h"
 
-// Static array to hold counter values
-static uint32_t metric_counters[METRIC_COUNT];
+// Updates go into one of two banks; the reader empties the other
+typedef struct {
+    _Atomic uint32_t counters[METRIC_COUNT];
+    _Atomic uint32_t sums[METRIC_HIST_COUNT];
+    _Atomic uint32_t buckets[METRIC_HIST_COUNT][METRICS_HISTOGRAM_BUCKETS];
+} metrics_bank_t;
 
-// Initialize all metrics counters to zero
+static metrics_bank_t s_banks[2];
+static _Atomic uint32_t s_active;            // Bank writers add into
+static _Atomic uint32_t s_writers[2];        // Writers inside each bank
+static _Atomic uint32_t s_gauges[METRIC_COUNT];
+
+// Folded totals, guarded by s_mutex
+static metrics_snapshot_t s_totals;
+static SemaphoreHandle_t s_mutex;
+
+static const struct {
+    const char *name;
+    metric_type_t type;
+} s_info[METRIC_COUNT] = {
+    [METRIC_ZIGBEE_CMD_RECEIVED] = { "zigbee_cmd_received", METRIC_TYPE_COUNTER },
+    [METRIC_OTA_STARTED] = { "ota_started", METRIC_TYPE_COUNTER },
+    [METRIC_OTA_FAILED] = { "ota_failed", METRIC_TYPE_COUNTER },
+    [METRIC_RELAY_CHANGES] = { "relay_changes", METRIC_TYPE_COUNTER },
+    [METRIC_STEERING_FAILED] = { "steering_failed", METRIC_TYPE_COUNTER },
+    [METRIC_LOG_DROPPED] = { "log_dropped", METRIC_TYPE_COUNTER },
+    [METRIC_RELAY_STATE] = { "relay_state", METRIC_TYPE_GAUGE },
+    [METRIC_HEAP_FREE_MIN] = { "heap_free_min", METRIC_TYPE_GAUGE },
+    [METRIC_RESTORE_US] = { "restore_us", METRIC_TYPE_GAUGE },
+    [METRIC_REJOIN_MS] = { "rejoin_ms", METRIC_TYPE_GAUGE },
+    [METRIC_OTA_RESUMED] = { "ota_resumed", METRIC_TYPE_COUNTER },
+    [METRIC_OTA_BYTES_PER_S] = { "ota_bytes_per_s", METRIC_TYPE_GAUGE },
+};
+
+static const char *const s_histogram_names[METRIC_HIST_COUNT] = {
+    [METRIC_HIST_CMD_TO_RELAY_US] = "cmd_to_relay_us",
+    [METRIC_HIST_ZB_CALLBACK_US] = "zb_callback_us",
+};
+
+static const uint32_t s_bounds[METRICS_HISTOGRAM_BOUNDS] = {
+    100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000,
+};
+
+// Join the active bank; retries if the reader switched banks meanwhile
+static metrics_bank_t *metrics_enter(uint32_t *bank)
+{
+    for (;;) {
+        uint32_t b = atomic_load(&s_active);
+        atomic_fetch_add(&s_writers[b], 1);
+        if (atomic_load(&s_active) == b) {
+            *bank = b;
+            return &s_banks[b];
+        }
+        atomic_fetch_sub(&s_writers[b], 1);
+    }
+}
+
+static void metrics_leave(uint32_t bank)
+{
+    atomic_fetch_sub(&s_writers[bank], 1);
+}
+
+// Initialize all metrics to zero
 void metrics_init(void) {
+    memset(s_banks, 0, sizeof(s_banks));
+    memset(&s_totals, 0, sizeof(s_totals));
     for (int i = 0; i < METRIC_COUNT; i++) {
-        metric_counters[i] = 0;
+        atomic_store(&s_gauges[i], 0);
+    }
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
     }
 }
 
-// Increment a specific metric counter
+// Increment a specific counter
 void metrics_increment(metric_id_t metric_id) {
-    if (metric_id < METRIC_COUNT) {
-        metric_counters[metric_id]++;
+    metrics_add(metric_id, 1);
+}
+
+void metrics_add(metric_id_t metric_id, uint32_t n) {
+    if (metric_id >= METRIC_COUNT || s_info[metric_id].type != METRIC_TYPE_COUNTER) {
+        return;
     }
+    uint32_t bank;
+    metrics_bank_t *b = metrics_enter(&bank);
+    atomic_fetch_add_explicit(&b->counters[metric_id], n, memory_order_relaxed);
+    metrics_leave(bank);
 }
 
-// Get the value of a specific metric counter
+void metrics_set(metric_id_t metric_id, uint32_t value) {
+    if (metric_id < METRIC_COUNT && s_info[metric_id].type == METRIC_TYPE_GAUGE) {
+        atomic_store_explicit(&s_gauges[metric_id], value, memory_order_relaxed);
+    }
+}
+
+void metrics_observe(metric_histogram_id_t histogram_id, uint32_t value_us) {
+    if (histogram_id >= METRIC_HIST_COUNT) {
+        return;
+    }
+    size_t bucket = 0;
+    while (bucket < METRICS_HISTOGRAM_BOUNDS && value_us > s_bounds[bucket]) {
+        bucket++;
+    }
+
+    uint32_t bank;
+    metrics_bank_t *b = metrics_enter(&bank);
+    atomic_fetch_add_explicit(&b->buckets[histogram_id][bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&b->sums[histogram_id], value_us, memory_order_relaxed);
+    metrics_leave(bank);
+}
+
+// Current value of one metric; not taken together with any other
 uint32_t metrics_get(metric_id_t metric_id) {
-    if (metric_id < METRIC_COUNT) {
-        return metric_counters[metric_id];
+    if (metric_id >= METRIC_COUNT) {
+        return 0;
+    }
+    if (s_info[metric_id].type == METRIC_TYPE_GAUGE) {
+        return atomic_load(&s_gauges[metric_id]);
     }
-    return 0;
-}
\ No newline at end of file
+    return s_totals.values[metric_id] +
+           atomic_load(&s_banks[0].counters[metric_id]) +
+           atomic_load(&s_banks[1].counters[metric_id]);
+}
+
+esp_err_t metrics_snapshot(metrics_snapshot_t *snapshot) {
+    if (s_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    // New writers go to the other bank; wait out the ones still in this one
+    uint32_t old = atomic_load(&s_active);
+    atomic_store(&s_active, old ^ 1);
+    while (atomic_load(&s_writers[old]) != 0) {
+        vTaskDelay(1);
+    }
+
+    metrics_bank_t *b = &s_banks[old];
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        s_totals.values[i] += atomic_exchange(&b->counters[i], 0);
+    }
+    for (int h = 0; h < METRIC_HIST_COUNT; h++) {
+        metrics_histogram_t *hist = &s_totals.histograms[h];
+        hist->sum_us += atomic_exchange(&b->sums[h], 0);
+        for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+            uint32_t n = atomic_exchange(&b->buckets[h][i], 0);
+            hist->buckets[i] += n;
+            hist->count += n;
+        }
+    }
+
+    *snapshot = s_totals;
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        if (s_info[i].type == METRIC_TYPE_GAUGE) {
+            snapshot->values[i] = atomic_load(&s_gauges[i]);
+        }
+    }
+    s_totals.seq++;
+
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+const char *metrics_name(metric_id_t metric_id) {
+    return metric_id < METRIC_COUNT ? s_info[metric_id].name : "unknown";
+}
+
+metric_type_t metrics_type(metric_id_t metric_id) {
+    return metric_id < METRIC_COUNT ? s_info[metric_id].type : METRIC_TYPE_COUNTER;
+}
+
+const char *metrics_histogram_name(metric_histogram_id_t histogram_id) {
+    return histogram_id < METRIC_HIST_COUNT ? s_histogram_names[histogram_id] : "unknown";
+}
+
+const uint32_t *metrics_histogram_bounds(void) {
+    return s_bounds;
+}
+
+static uint8_t *metrics_put_u32(uint8_t *p, uint32_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+    return p + 4;
+}
+
+size_t metrics_encode(const metrics_snapshot_t *snapshot, uint8_t *buf, size_t len) {
+    if (len < METRICS_ENCODED_LEN) {
+        return 0;
+    }
+    uint8_t *p = buf;
+    *p++ = METRICS_ENCODED_VERSION;
+    *p++ = METRIC_COUNT;
+    *p++ = METRIC_HIST_COUNT;
+    *p++ = METRICS_HISTOGRAM_BUCKETS;
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        p = metrics_put_u32(p, snapshot->values[i]);
+    }
+    for (int h = 0; h < METRIC_HIST_COUNT; h++) {
+        p = metrics_put_u32(p, snapshot->histograms[h].sum_us);
+        for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+            p = metrics_put_u32(p, snapshot->histograms[h].buckets[i]);
+        }
+    }
+    return p - buf;
+}
+
+void metrics_dump(const metrics_snapshot_t *snapshot) {
+    printf("# snapshot %lu\n", (unsigned long)snapshot->seq);
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        printf("%s %s %lu\n", s_info[i].type == METRIC_TYPE_GAUGE ? "gauge" : "counter",
+               s_info[i].name, (unsigned long)snapshot->values[i]);
+    }
+    for (int h = 0; h < METRIC_HIST_COUNT; h++) {
+        const metrics_histogram_t *hist = &snapshot->histograms[h];
+        printf("histogram %s count=%lu sum_us=%lu\n", s_histogram_names[h],
+               (unsigned long)hist->count, (unsigned long)hist->sum_us);
+        for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+            if (hist->buckets[i] == 0) {
+                continue;
+            }
+            if (i < METRICS_HISTOGRAM_BOUNDS) {
+                printf("  le %lu: %lu\n", (unsigned long)s_bounds[i], (unsigned long)hist->buckets[i]);
+            } else {
+                printf("  gt %lu: %lu\n", (unsigned long)s_bounds[i - 1], (unsigned long)hist->buckets[i]);
+            }
+        }
+    }
+}
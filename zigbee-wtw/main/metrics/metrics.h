@@ -3,17 +3,99 @@
 #define METRICS_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
 
-// Enum for metric IDs
+/*
+ * Metrics registry: counters, gauges and fixed-bucket histograms.
+ *
+ * Updates are lock-free 32-bit atomics and safe from any task or ISR.
+ * Counters and histograms are double-buffered: writers add into the active
+ * bank, and metrics_snapshot() switches banks, waits for writers still in
+ * the old one and folds it into the totals. A snapshot therefore sees each
+ * update completely or not at all - a histogram's buckets and sum always
+ * agree - without writers ever waiting on the reader.
+ */
+
+// Counter and gauge IDs
 typedef enum {
-    METRIC_ZIGBEE_CMD_RECEIVED,
-    METRIC_OTA_STARTED,
+    METRIC_ZIGBEE_CMD_RECEIVED,  // Counter: attribute writes received
+    METRIC_OTA_STARTED,          // Counter: OTA downloads started from the beginning
+    METRIC_OTA_FAILED,           // Counter: OTA updates that failed
+    METRIC_RELAY_CHANGES,        // Counter: relay state changes applied
+    METRIC_STEERING_FAILED,      // Counter: unsuccessful network steering attempts
+    METRIC_LOG_DROPPED,          // Counter: log messages dropped because the ring was full
+    METRIC_RELAY_STATE,          // Gauge: current output_state_t
+    METRIC_HEAP_FREE_MIN,        // Gauge: lowest free heap seen, bytes
+    METRIC_RESTORE_US,           // Gauge: application start to relays restored, us
+    METRIC_REJOIN_MS,            // Gauge: Zigbee stack start to network rejoined, ms
+    METRIC_OTA_RESUMED,          // Counter: OTA transfers continued from a resume point
+    METRIC_OTA_BYTES_PER_S,      // Gauge: throughput of the last completed OTA transfer
     METRIC_COUNT  // Keep this last for array sizing
 } metric_id_t;
 
+// Histogram IDs, values in microseconds
+typedef enum {
+    METRIC_HIST_CMD_TO_RELAY_US, // Attribute write received to relays switched
+    METRIC_HIST_ZB_CALLBACK_US,  // Zigbee action callback duration
+    METRIC_HIST_COUNT  // Keep this last for array sizing
+} metric_histogram_id_t;
+
+typedef enum {
+    METRIC_TYPE_COUNTER,
+    METRIC_TYPE_GAUGE,
+} metric_type_t;
+
+// Bucket upper bounds in us (1-2-5 steps, 100 us to 1 s) plus an overflow bucket
+#define METRICS_HISTOGRAM_BOUNDS    13
+#define METRICS_HISTOGRAM_BUCKETS   (METRICS_HISTOGRAM_BOUNDS + 1)
+
+typedef struct {
+    uint32_t count;                                 // Observations, the sum of the buckets
+    uint32_t sum_us;                                // Sum of observed values, wraps
+    uint32_t buckets[METRICS_HISTOGRAM_BUCKETS];    // Observations <= bound[i]; last: above all bounds
+} metrics_histogram_t;
+
+typedef struct {
+    uint32_t seq;                                   // Snapshots taken before this one
+    uint32_t values[METRIC_COUNT];                  // Counter totals and gauge values
+    metrics_histogram_t histograms[METRIC_HIST_COUNT];
+} metrics_snapshot_t;
+
+// Encoded snapshot: version, counts, values, then per histogram the sum and buckets (all uint32 LE)
+#define METRICS_ENCODED_VERSION     1
+#define METRICS_ENCODED_LEN         (4 + 4 * METRIC_COUNT + METRIC_HIST_COUNT * 4 * (1 + METRICS_HISTOGRAM_BUCKETS))
+
 // Function declarations
 void metrics_init(void);
 void metrics_increment(metric_id_t metric_id);
+void metrics_add(metric_id_t metric_id, uint32_t n);
+void metrics_set(metric_id_t metric_id, uint32_t value);
+void metrics_observe(metric_histogram_id_t histogram_id, uint32_t value_us);
 uint32_t metrics_get(metric_id_t metric_id);
 
-#endif // METRICS_H
\ No newline at end of file
+/**
+ * @brief Take a consistent snapshot of all metrics
+ *
+ * Task context only: may sleep a tick at a time while a preempted writer
+ * finishes. Snapshots are serialized by a mutex.
+ */
+esp_err_t metrics_snapshot(metrics_snapshot_t *snapshot);
+
+const char *metrics_name(metric_id_t metric_id);
+metric_type_t metrics_type(metric_id_t metric_id);
+const char *metrics_histogram_name(metric_histogram_id_t histogram_id);
+const uint32_t *metrics_histogram_bounds(void);
+
+/**
+ * @brief Encode a snapshot for the Zigbee metrics cluster
+ * @return Bytes written, 0 if len is below METRICS_ENCODED_LEN
+ */
+size_t metrics_encode(const metrics_snapshot_t *snapshot, uint8_t *buf, size_t len);
+
+/**
+ * @brief Print a snapshot, one metric per line
+ */
+void metrics_dump(const metrics_snapshot_t *snapshot);
+
+#endif // METRICS_H
@@ -0,0 +1,83 @@
+#include <stdlib.h>
+#include "esp_console.h"
+#include "esp_system.h"
+#include "flash_log.h"
+#include "factory_reset/factory_reset.h"
+#include "metrics/metrics.h"
+#include "metrics/metrics_console.h"
+#include "logger/logger.h"
+
+static const char *TAG = "METRICS";
+
+static int metrics_cmd(int argc, char **argv)
+{
+    metrics_snapshot_t snapshot;
+
+    metrics_set(METRIC_HEAP_FREE_MIN, esp_get_minimum_free_heap_size());
+    if (metrics_snapshot(&snapshot) != ESP_OK) {
+        return 1;
+    }
+    metrics_dump(&snapshot);
+    return 0;
+}
+
+static int log_cmd(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 20;
+
+    flash_log_dump(count);
+    return 0;
+}
+
+static int factory_reset_cmd(int argc, char **argv)
+{
+    factory_reset();
+    return 0;
+}
+
+esp_err_t metrics_console_start(void)
+{
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "wtw>";
+
+#if CONFIG_ESP_CONSOLE_UART_DEFAULT || CONFIG_ESP_CONSOLE_UART_CUSTOM
+    esp_console_dev_uart_config_t dev_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    esp_err_t ret = esp_console_new_repl_uart(&dev_config, &repl_config, &repl);
+#elif CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG
+    esp_console_dev_usb_serial_jtag_config_t dev_config = ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+    esp_err_t ret = esp_console_new_repl_usb_serial_jtag(&dev_config, &repl_config, &repl);
+#else
+    esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+#endif
+    if (ret != ESP_OK) {
+        app_log(LOG_LEVEL_WARN, TAG, "No metrics console: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    const esp_console_cmd_t cmds[] = {
+        {
+            .command = "metrics",
+            .help = "Print counters, gauges and latency histograms",
+            .func = metrics_cmd,
+        },
+        {
+            .command = "log",
+            .help = "Print the newest persistent log lines",
+            .hint = "[count]",
+            .func = log_cmd,
+        },
+        {
+            .command = "factory_reset",
+            .help = "Forget the Zigbee network and the saved relay state, then restart",
+            .func = factory_reset_cmd,
+        },
+    };
+    for (size_t i = 0; i < sizeof(cmds) / sizeof(cmds[0]) && ret == ESP_OK; i++) {
+        ret = esp_console_cmd_register(&cmds[i]);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_console_start_repl(repl);
+    }
+    return ret;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#ifndef METRICS_CONSOLE_H
+#define METRICS_CONSOLE_H
+
+#include "esp_err.h"
+
+/**
+ * @brief Start a console on the default serial port with `metrics`, `log` and `factory_reset` commands
+ *
+ * `metrics` prints a fresh snapshot, one metric per line. `log [count]`
+ * prints the newest lines of the persistent flash log, 20 by default.
+ * `factory_reset` forgets the network and the relay state and restarts.
+ */
+esp_err_t metrics_console_start(void);
+
+#endif // METRICS_CONSOLE_H
@@ -0,0 +1,54 @@
+#include "esp_system.h"
+#include "metrics/metrics_zcl.h"
+
+// Attribute storage: one uint32 per metric and a ZCL octet string (length byte + data)
+static uint32_t s_values[METRIC_COUNT];
+static uint8_t s_encoded[1 + METRICS_ENCODED_LEN];
+
+static void metrics_zcl_fill(void)
+{
+    metrics_snapshot_t snapshot;
+
+    metrics_set(METRIC_HEAP_FREE_MIN, esp_get_minimum_free_heap_size());
+    if (metrics_snapshot(&snapshot) != ESP_OK) {
+        return;
+    }
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        s_values[i] = snapshot.values[i];
+    }
+    s_encoded[0] = metrics_encode(&snapshot, &s_encoded[1], METRICS_ENCODED_LEN);
+}
+
+esp_zb_attribute_list_t *metrics_zcl_cluster_create(void)
+{
+    // Full-length initial value so the stack reserves room for the whole string
+    s_encoded[0] = METRICS_ENCODED_LEN;
+
+    esp_zb_attribute_list_t *cluster = esp_zb_zcl_attr_list_create(METRICS_CLUSTER_ID);
+    esp_zb_custom_cluster_add_custom_attr(cluster, METRICS_ATTR_SNAPSHOT, ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, s_encoded);
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        esp_zb_custom_cluster_add_custom_attr(cluster, METRICS_ATTR_VALUE_BASE + i, ESP_ZB_ZCL_ATTR_TYPE_U32,
+                                              ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING,
+                                              &s_values[i]);
+    }
+    return cluster;
+}
+
+// Runs in the Zigbee task, so no stack lock is needed
+static void metrics_zcl_refresh(uint8_t endpoint)
+{
+    metrics_zcl_fill();
+    esp_zb_zcl_set_attribute_val(endpoint, METRICS_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 METRICS_ATTR_SNAPSHOT, s_encoded, false);
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        esp_zb_zcl_set_attribute_val(endpoint, METRICS_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                     METRICS_ATTR_VALUE_BASE + i, &s_values[i], false);
+    }
+    esp_zb_scheduler_alarm(metrics_zcl_refresh, endpoint, METRICS_ZCL_REFRESH_MS);
+}
+
+void metrics_zcl_start(uint8_t endpoint)
+{
+    metrics_zcl_refresh(endpoint);
+}
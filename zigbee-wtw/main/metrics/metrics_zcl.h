@@ -0,0 +1,31 @@
+#pragma once
+#ifndef METRICS_ZCL_H
+#define METRICS_ZCL_H
+
+#include <stdint.h>
+#include "esp_zigbee_core.h"
+#include "metrics/metrics.h"
+
+// Manufacturer-specific metrics cluster
+#define METRICS_CLUSTER_ID          0xFC03
+#define METRICS_ATTR_SNAPSHOT       0x0000  // Octet string, metrics_encode() layout
+#define METRICS_ATTR_VALUE_BASE     0x0100  // + metric_id_t: uint32 counter total or gauge value
+
+// How often the attributes are refreshed from a snapshot
+#define METRICS_ZCL_REFRESH_MS      60000
+
+/**
+ * @brief Create the metrics cluster; add it to the endpoint as a server cluster
+ */
+esp_zb_attribute_list_t *metrics_zcl_cluster_create(void);
+
+/**
+ * @brief Refresh the attributes now and then every METRICS_ZCL_REFRESH_MS
+ *
+ * Call once, from the Zigbee task.
+ *
+ * @param endpoint Endpoint the cluster was registered on
+ */
+void metrics_zcl_start(uint8_t endpoint);
+
+#endif // METRICS_ZCL_H
@@ -0,0 +1,273 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Host tests for the OTA file parser
+ *
+ * Builds an OTA file with optional header fields, an upgrade image and a
+ * trailing sub-element, feeds it in pieces of varying size and checks the
+ * image comes out intact - also when the transfer is interrupted and resumed
+ * from a checkpoint, with the tail of the last block garbled. Offers and
+ * headers for another device, an older version or a different size are
+ * refused before anything is written.
+ *
+ * Compile and run from the ota_updater directory:
+ *
+ *   cc -O2 -I. -I../../../components/host_test host/ota_image_test.c ota_image.c \
+ *      -o ota_image_test && ./ota_image_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ota_image.h"
+#include "host_test.h"
+
+#define IMAGE_SIZE      20000
+#define HEADER_LEN      (OTA_IMAGE_HEADER_MIN + 2)      /* With the optional security credential version */
+#define TRAILER_LEN     24
+#define MANUFACTURER    0x131B
+#define IMAGE_TYPE      0x0001
+#define FILE_VERSION    0x00010002
+
+static uint8_t s_file[HEADER_LEN + OTA_IMAGE_ELEMENT_HEADER + IMAGE_SIZE + OTA_IMAGE_ELEMENT_HEADER + TRAILER_LEN];
+static uint8_t s_partition[IMAGE_SIZE + 4096];
+static int s_fail_at = -1;
+static size_t s_writes;
+
+/* The offer the server made for s_file */
+static ota_image_id_t s_offer = {
+    .manufacturer = MANUFACTURER,
+    .image_type = IMAGE_TYPE,
+    .file_version = FILE_VERSION,
+    .file_size = sizeof(s_file),
+};
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, v);
+    put_u16(p + 2, v >> 16);
+}
+
+static void build_file(void)
+{
+    uint8_t *p = s_file;
+
+    memset(s_file, 0, sizeof(s_file));
+    put_u32(p, OTA_IMAGE_MAGIC);
+    put_u16(p + 4, 0x0100);
+    put_u16(p + 6, HEADER_LEN);
+    put_u16(p + 8, 0x0001);
+    put_u16(p + 10, MANUFACTURER);
+    put_u16(p + 12, IMAGE_TYPE);
+    put_u32(p + 14, FILE_VERSION);
+    put_u16(p + 18, 0x0002);
+    memcpy(p + 20, "wtw test image", 14);
+    put_u32(p + 52, sizeof(s_file));
+    p[56] = 0x02;
+    p += HEADER_LEN;
+
+    put_u16(p, OTA_IMAGE_TAG_UPGRADE);
+    put_u32(p + 2, IMAGE_SIZE);
+    p += OTA_IMAGE_ELEMENT_HEADER;
+    for (int i = 0; i < IMAGE_SIZE; i++) {
+        p[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+    p += IMAGE_SIZE;
+
+    put_u16(p, 0x0001);
+    put_u32(p + 2, TRAILER_LEN);
+    memset(p + OTA_IMAGE_ELEMENT_HEADER, 0xAA, TRAILER_LEN);
+}
+
+static const uint8_t *image_data(void)
+{
+    return s_file + HEADER_LEN + OTA_IMAGE_ELEMENT_HEADER;
+}
+
+static bool write_partition(uint32_t offset, const uint8_t *data, size_t len, void *arg)
+{
+    if (s_fail_at >= 0 && offset + len > (uint32_t)s_fail_at) {
+        return false;
+    }
+    if (offset + len > sizeof(s_partition)) {
+        return false;
+    }
+    s_writes++;
+    memcpy(&s_partition[offset], data, len);
+    return true;
+}
+
+/* Feed s_file[from, to) in pieces of 1 to 80 bytes, as blocks would arrive */
+static ota_image_status_t feed_range(ota_image_t *image, size_t from, size_t to)
+{
+    while (from < to) {
+        size_t n = 1 + rand() % 80;
+        if (n > to - from) {
+            n = to - from;
+        }
+        ota_image_status_t status = ota_image_feed(image, &s_offer, s_file + from, n, write_partition, NULL);
+        if (status != OTA_IMAGE_OK) {
+            return status;
+        }
+        from += n;
+    }
+    return OTA_IMAGE_OK;
+}
+
+static void test_whole_file(void)
+{
+    ota_image_t image = {0};
+
+    memset(s_partition, 0xFF, sizeof(s_partition));
+    CHECK_EQ(feed_range(&image, 0, sizeof(s_file)), OTA_IMAGE_OK);
+    CHECK_EQ(ota_image_done(&image), true);
+    CHECK_EQ(image.header_len, HEADER_LEN);
+    CHECK_EQ(image.manufacturer, MANUFACTURER);
+    CHECK_EQ(image.file_version, FILE_VERSION);
+    CHECK_EQ(image.file_size, sizeof(s_file));
+    CHECK_EQ(image.written, IMAGE_SIZE);
+    CHECK_EQ(memcmp(s_partition, image_data(), IMAGE_SIZE), 0);
+    CHECK_EQ(s_partition[IMAGE_SIZE], 0xFF);
+
+    /* Extra bytes after the end are ignored */
+    CHECK_EQ(ota_image_feed(&image, &s_offer, s_file, 10, write_partition, NULL), OTA_IMAGE_OK);
+    CHECK_EQ(image.written, IMAGE_SIZE);
+}
+
+static void test_resume(void)
+{
+    static const size_t cuts[] = { 5000, 4096 + HEADER_LEN + OTA_IMAGE_ELEMENT_HEADER, 12345, 19999 };
+
+    for (size_t i = 0; i < sizeof(cuts) / sizeof(cuts[0]); i++) {
+        ota_image_t image = {0}, checkpoint;
+
+        memset(s_partition, 0xFF, sizeof(s_partition));
+        CHECK_EQ(feed_range(&image, 0, cuts[i]), OTA_IMAGE_OK);
+        CHECK_EQ(ota_image_checkpoint(&image, 4096, &checkpoint), true);
+        CHECK_EQ(checkpoint.written % 4096, 0);
+        CHECK_EQ(checkpoint.written, image.written / 4096 * 4096);
+        CHECK_EQ(checkpoint.offset, cuts[i] - (image.written - checkpoint.written));
+
+        /* Power lost: the block after the checkpoint is garbage */
+        memset(&s_partition[checkpoint.written], 0x5A, 4096);
+        image = checkpoint;
+        CHECK_EQ(feed_range(&image, image.offset, sizeof(s_file)), OTA_IMAGE_OK);
+        CHECK_EQ(ota_image_done(&image), true);
+        CHECK_EQ(memcmp(s_partition, image_data(), IMAGE_SIZE), 0);
+    }
+}
+
+static void test_no_checkpoint(void)
+{
+    ota_image_t image = {0}, checkpoint;
+
+    /* Still in the header, and right after the image ended */
+    CHECK_EQ(feed_range(&image, 0, 30), OTA_IMAGE_OK);
+    CHECK_EQ(ota_image_checkpoint(&image, 4096, &checkpoint), false);
+    CHECK_EQ(feed_range(&image, 30, HEADER_LEN + OTA_IMAGE_ELEMENT_HEADER + IMAGE_SIZE + 2), OTA_IMAGE_OK);
+    CHECK_EQ(ota_image_checkpoint(&image, 4096, &checkpoint), false);
+
+    /* Less than one block into the image */
+    memset(&image, 0, sizeof(image));
+    CHECK_EQ(feed_range(&image, 0, HEADER_LEN + OTA_IMAGE_ELEMENT_HEADER + 100), OTA_IMAGE_OK);
+    CHECK_EQ(ota_image_checkpoint(&image, 4096, &checkpoint), true);
+    CHECK_EQ(checkpoint.written, 0);
+    CHECK_EQ(checkpoint.offset, HEADER_LEN + OTA_IMAGE_ELEMENT_HEADER);
+}
+
+static void test_bad_files(void)
+{
+    ota_image_t image = {0};
+
+    s_file[0] ^= 1;
+    CHECK_EQ(feed_range(&image, 0, sizeof(s_file)), OTA_IMAGE_BAD_FILE);
+    s_file[0] ^= 1;
+
+    /* Sub-element longer than the rest of the file */
+    memset(&image, 0, sizeof(image));
+    put_u32(s_file + HEADER_LEN + 2, sizeof(s_file));
+    CHECK_EQ(feed_range(&image, 0, sizeof(s_file)), OTA_IMAGE_BAD_FILE);
+    put_u32(s_file + HEADER_LEN + 2, IMAGE_SIZE);
+
+    /* Header length below the fixed part */
+    memset(&image, 0, sizeof(image));
+    put_u16(s_file + 6, 40);
+    CHECK_EQ(feed_range(&image, 0, sizeof(s_file)), OTA_IMAGE_BAD_FILE);
+    put_u16(s_file + 6, HEADER_LEN);
+
+    /* Partition write error */
+    memset(&image, 0, sizeof(image));
+    s_fail_at = 8192;
+    CHECK_EQ(feed_range(&image, 0, sizeof(s_file)), OTA_IMAGE_WRITE_FAILED);
+    CHECK_EQ(image.written <= 8192, true);
+    s_fail_at = -1;
+}
+
+static void test_offer_check(void)
+{
+    const ota_image_id_t running = { MANUFACTURER, IMAGE_TYPE, FILE_VERSION - 1 };
+    ota_image_id_t offer = s_offer;
+
+    CHECK_EQ(ota_image_offer_check(&offer, &running) == NULL, true);
+    offer.manufacturer = 0x1234;
+    CHECK_EQ(ota_image_offer_check(&offer, &running) != NULL, true);
+    offer = s_offer;
+    offer.image_type = IMAGE_TYPE + 1;
+    CHECK_EQ(ota_image_offer_check(&offer, &running) != NULL, true);
+    offer = s_offer;
+    offer.file_version = running.file_version;
+    CHECK_EQ(ota_image_offer_check(&offer, &running) != NULL, true);
+    offer.file_version = running.file_version - 1;
+    CHECK_EQ(ota_image_offer_check(&offer, &running) != NULL, true);
+    offer = s_offer;
+    offer.file_size = 0;
+    CHECK_EQ(ota_image_offer_check(&offer, &running) != NULL, true);
+    offer.file_size = OTA_IMAGE_HEADER_MIN - 1;
+    CHECK_EQ(ota_image_offer_check(&offer, &running) != NULL, true);
+}
+
+/* A header that differs from the offer in any field stops the file before the first write */
+static void test_header_mismatch(void)
+{
+    static const size_t fields[] = { 10, 12, 14, 52 };
+    ota_image_t image;
+
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        memset(&image, 0, sizeof(image));
+        s_writes = 0;
+        s_file[fields[i]] ^= 1;
+        CHECK_EQ(ota_image_feed(&image, &s_offer, s_file, sizeof(s_file), write_partition, NULL),
+                 OTA_IMAGE_MISMATCH);
+        s_file[fields[i]] ^= 1;
+        CHECK_EQ(s_writes, 0);
+        CHECK_EQ(ota_image_done(&image), false);
+    }
+
+    /* The offer's size is what the download runs to */
+    ota_image_id_t offer = s_offer;
+    offer.file_size = sizeof(s_file) - 1;
+    memset(&image, 0, sizeof(image));
+    CHECK_EQ(ota_image_feed(&image, &offer, s_file, sizeof(s_file), write_partition, NULL), OTA_IMAGE_MISMATCH);
+    CHECK_EQ(s_writes, 0);
+}
+
+int main(void)
+{
+    srand(1);
+    build_file();
+
+    test_whole_file();
+    test_resume();
+    test_no_checkpoint();
+    test_bad_files();
+    test_offer_check();
+    test_header_mismatch();
+
+    return host_test_summary("OTA image");
+}
@@ -0,0 +1,124 @@
+#include <string.h>
+#include "ota_image.h"
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Gather up to want bytes into buf; returns bytes taken from data
+static size_t ota_image_gather(ota_image_t *image, size_t want, const uint8_t *data, size_t len)
+{
+    size_t n = want - image->fill < len ? want - image->fill : len;
+
+    memcpy(image->buf + image->fill, data, n);
+    image->fill += n;
+    return n;
+}
+
+const char *ota_image_offer_check(const ota_image_id_t *offer, const ota_image_id_t *running)
+{
+    if (offer->manufacturer != running->manufacturer || offer->image_type != running->image_type) {
+        return "image is for another device";
+    }
+    if (offer->file_version <= running->file_version) {
+        return "image is not newer than the running one";
+    }
+    if (offer->file_size < OTA_IMAGE_HEADER_MIN) {
+        return "image is smaller than an OTA header";
+    }
+    return NULL;
+}
+
+static ota_image_status_t ota_image_parse_header(ota_image_t *image, const ota_image_id_t *expect)
+{
+    const uint8_t *p = image->buf;
+
+    image->header_len = get_u16(p + 6);
+    image->manufacturer = get_u16(p + 10);
+    image->image_type = get_u16(p + 12);
+    image->file_version = get_u32(p + 14);
+    image->file_size = get_u32(p + 52);
+    if (get_u32(p) != OTA_IMAGE_MAGIC || image->header_len < OTA_IMAGE_HEADER_MIN ||
+        image->file_size < image->header_len) {
+        return OTA_IMAGE_BAD_FILE;
+    }
+    if (image->manufacturer != expect->manufacturer || image->image_type != expect->image_type ||
+        image->file_version != expect->file_version || image->file_size != expect->file_size) {
+        return OTA_IMAGE_MISMATCH;
+    }
+    return OTA_IMAGE_OK;
+}
+
+ota_image_status_t ota_image_feed(ota_image_t *image, const ota_image_id_t *expect, const uint8_t *data,
+                                  size_t len, ota_image_write_t write, void *arg)
+{
+    while (len > 0 && !ota_image_done(image)) {
+        size_t n;
+
+        if (image->header_len == 0) {
+            // File header: the fixed part is parsed, optional fields are skipped below
+            n = ota_image_gather(image, OTA_IMAGE_HEADER_MIN, data, len);
+            if (image->fill == OTA_IMAGE_HEADER_MIN) {
+                image->fill = 0;
+                ota_image_status_t status = ota_image_parse_header(image, expect);
+                if (status != OTA_IMAGE_OK) {
+                    image->header_len = 0;
+                    return status;
+                }
+            }
+        } else if (image->offset < image->header_len) {
+            n = image->header_len - image->offset < len ? image->header_len - image->offset : len;
+        } else if (image->element_left == 0) {
+            n = ota_image_gather(image, OTA_IMAGE_ELEMENT_HEADER, data, len);
+            if (image->fill == OTA_IMAGE_ELEMENT_HEADER) {
+                image->fill = 0;
+                image->element_tag = get_u16(image->buf);
+                image->element_len = get_u32(image->buf + 2);
+                image->element_left = image->element_len;
+                if (image->element_len > image->file_size - image->offset - n) {
+                    return OTA_IMAGE_BAD_FILE;
+                }
+            }
+        } else {
+            n = image->element_left < len ? image->element_left : len;
+            if (image->element_tag == OTA_IMAGE_TAG_UPGRADE) {
+                if (!write(image->written, data, n, arg)) {
+                    return OTA_IMAGE_WRITE_FAILED;
+                }
+                image->written += n;
+            }
+            image->element_left -= n;
+        }
+
+        image->offset += n;
+        data += n;
+        len -= n;
+    }
+    return OTA_IMAGE_OK;
+}
+
+bool ota_image_done(const ota_image_t *image)
+{
+    return image->header_len != 0 && image->offset >= image->file_size;
+}
+
+bool ota_image_checkpoint(const ota_image_t *image, uint32_t align, ota_image_t *checkpoint)
+{
+    uint32_t back = image->written % align;
+
+    if (image->header_len == 0 || image->element_tag != OTA_IMAGE_TAG_UPGRADE ||
+        image->element_left == 0 || image->element_len - image->element_left < back) {
+        return false;
+    }
+    *checkpoint = *image;
+    checkpoint->offset -= back;
+    checkpoint->written -= back;
+    checkpoint->element_left += back;
+    return true;
+}
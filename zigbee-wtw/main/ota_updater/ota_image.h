@@ -0,0 +1,98 @@
+#pragma once
+#ifndef OTA_IMAGE_H
+#define OTA_IMAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Streaming parser for Zigbee OTA upgrade files.
+ *
+ * An OTA file is a header (magic, versions, manufacturer, image type, file
+ * version, total size, optional fields) followed by tagged sub-elements. The
+ * parser takes the file in order, in pieces of any size as they come off
+ * the air, and passes the bytes of the upgrade image sub-elements (tag
+ * 0x0000) to a write callback at their offset in the image, so they can go
+ * straight to the partition. The header must name the image the server
+ * offered, or nothing is written. The state is plain data, so it can be stored
+ * as a resume point and restored later. No IDF dependencies, so the host
+ * test builds it unchanged.
+ */
+
+#define OTA_IMAGE_MAGIC             0x0BEEF11E
+#define OTA_IMAGE_HEADER_MIN        56      // Header up to and including the total image size
+#define OTA_IMAGE_ELEMENT_HEADER    6       // Tag (uint16) and length (uint32)
+#define OTA_IMAGE_TAG_UPGRADE       0x0000
+
+typedef enum {
+    OTA_IMAGE_OK,
+    OTA_IMAGE_BAD_FILE,             // Not an OTA file, or inconsistent sizes
+    OTA_IMAGE_MISMATCH,             // The header names another image than expected
+    OTA_IMAGE_WRITE_FAILED,         // The write callback returned false
+} ota_image_status_t;
+
+// Identity and size of an OTA file, as offered in a Query Next Image Response
+typedef struct {
+    uint16_t manufacturer;
+    uint16_t image_type;
+    uint32_t file_version;
+    uint32_t file_size;
+} ota_image_id_t;
+
+// Parser state; zero it to start a file
+typedef struct {
+    uint32_t offset;                // File bytes consumed
+    uint32_t written;               // Upgrade image bytes passed to the write callback
+    uint32_t header_len;            // From the header, 0 until it is complete
+    uint32_t file_size;             // Total file size from the header
+    uint16_t manufacturer;
+    uint16_t image_type;
+    uint32_t file_version;
+    uint32_t element_len;           // Length of the current sub-element
+    uint32_t element_left;          // Bytes of it not consumed yet
+    uint16_t element_tag;
+    uint8_t fill;                   // Bytes gathered in buf
+    uint8_t buf[OTA_IMAGE_HEADER_MIN];  // Partial file or sub-element header
+} ota_image_t;
+
+// Write len bytes of the upgrade image at offset; return false on failure
+typedef bool (*ota_image_write_t)(uint32_t offset, const uint8_t *data, size_t len, void *arg);
+
+/**
+ * @brief Whether to download an offered image
+ *
+ * It must be for this device (manufacturer and image type of running), newer
+ * than running and at least as large as a file header.
+ *
+ * @return NULL if acceptable, else why not
+ */
+const char *ota_image_offer_check(const ota_image_id_t *offer, const ota_image_id_t *running);
+
+/**
+ * @brief Consume the next len bytes of the file
+ *
+ * Bytes past the file size are ignored. The header is checked against
+ * expect as soon as it is complete, before anything is written.
+ */
+ota_image_status_t ota_image_feed(ota_image_t *image, const ota_image_id_t *expect, const uint8_t *data,
+                                  size_t len, ota_image_write_t write, void *arg);
+
+/**
+ * @brief Whether the whole file was consumed
+ */
+bool ota_image_done(const ota_image_t *image);
+
+/**
+ * @brief State as it was when the written image last crossed a multiple of align
+ *
+ * A resume point that only needs whole align-sized blocks of the image to be
+ * intact: continuing from it rewrites the rest of the last block, which may
+ * have been cut short. Only possible inside an upgrade image sub-element.
+ *
+ * @param[out] checkpoint Rewound state
+ * @return false if the boundary is not in the current sub-element
+ */
+bool ota_image_checkpoint(const ota_image_t *image, uint32_t align, ota_image_t *checkpoint);
+
+#endif // OTA_IMAGE_H
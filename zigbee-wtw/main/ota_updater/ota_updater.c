@@ -1,34 +1,676 @@
-#include "esp_http_client.h"
-#include "esp_https_ota.h"
+#include <inttypes.h>
+#include <string.h>
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_random.h"
 #include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+#include "zboss_api.h"
 #include "ota_updater.h"
+#include "ota_image.h"
 #include "logger/logger.h"
 #include "metrics/metrics.h"
+#include "relay_state/relay_state.h"
+#include "led_signal.h"
 
 static const char *TAG = "OTA_UPDATER";
 
-// OTA update task
-void ota_update_task(void *pvParameter)
+#define OTA_UPGRADE_CLUSTER_ID  ESP_ZB_ZCL_CLUSTER_ID_OTA_UPGRADE
+
+// OTA Upgrade cluster commands
+#define OTA_CMD_IMAGE_NOTIFY            0x00
+#define OTA_CMD_QUERY_NEXT_IMAGE_REQ    0x01
+#define OTA_CMD_QUERY_NEXT_IMAGE_RSP    0x02
+#define OTA_CMD_IMAGE_BLOCK_REQ         0x03
+#define OTA_CMD_IMAGE_PAGE_REQ          0x04
+#define OTA_CMD_IMAGE_BLOCK_RSP         0x05
+#define OTA_CMD_UPGRADE_END_REQ         0x06
+#define OTA_CMD_UPGRADE_END_RSP         0x07
+
+// ZCL status codes used by the cluster
+#define OTA_STATUS_SUCCESS              0x00
+#define OTA_STATUS_ABORT                0x95
+#define OTA_STATUS_INVALID_IMAGE        0x96
+#define OTA_STATUS_WAIT_FOR_DATA        0x97
+#define OTA_STATUS_NO_IMAGE_AVAILABLE   0x98
+
+// Client attributes
+#define OTA_ATTR_FILE_OFFSET            0x0001
+#define OTA_ATTR_CURRENT_FILE_VERSION   0x0002
+#define OTA_ATTR_IMAGE_UPGRADE_STATUS   0x0006
+#define OTA_ATTR_MANUFACTURER_ID        0x0007
+#define OTA_ATTR_IMAGE_TYPE_ID          0x0008
+
+// ImageUpgradeStatus values
+#define OTA_UPGRADE_STATUS_NORMAL       0
+#define OTA_UPGRADE_STATUS_DOWNLOADING  1
+#define OTA_UPGRADE_STATUS_WAITING      3
+
+#define OTA_SERVER_ENDPOINT             1       // Coordinator endpoint until an Image Notify names one
+#define OTA_TIMEOUT_MS                  5000    // No response: ask again
+#define OTA_MAX_RETRIES                 10      // Then give up until the next query
+#define OTA_RESUME_DELAY_MS             10000   // Query after joining when a transfer is pending
+#define OTA_PROGRESS_STEPS              10      // Progress log lines per image
+
+#if CONFIG_OTA_PAGE_REQUESTS
+#define OTA_PAGE_REQUESTS               1
+#else
+#define OTA_PAGE_REQUESTS               0
+#endif
+
+#define OTA_NVS_NAMESPACE               "wtw"
+#define OTA_NVS_KEY                     "ota"
+#define OTA_RESUME_VERSION              1
+
+typedef enum {
+    OTA_IDLE,
+    OTA_QUERYING,       // Query Next Image Request sent
+    OTA_DOWNLOADING,    // Block or page requested
+    OTA_ENDING,         // Upgrade End Request sent, waiting for the upgrade time
+} ota_state_t;
+
+// Image offered in the Query Next Image Response
+typedef ota_image_id_t ota_offer_t;
+
+// Resume point in NVS
+typedef struct {
+    uint32_t version;
+    ota_offer_t offer;
+    ota_image_t image;
+} ota_resume_t;
+
+static struct {
+    uint8_t endpoint;
+    uint16_t server_addr;
+    uint8_t server_endpoint;
+    ota_state_t state;
+    ota_offer_t offer;
+    ota_image_t image;
+    const esp_partition_t *partition;
+    uint32_t erased;            // Partition bytes erased for this image
+    uint32_t checkpoint;        // image.written at the last resume point
+    uint32_t page_end;          // File offset the requested page ends at
+    uint8_t retries;
+    int64_t start_us;           // Throughput: transfer (re)start time
+    uint32_t start_offset;      // and file offset
+    uint8_t progress;           // Progress steps logged
+} s_ota = {
+    .server_endpoint = OTA_SERVER_ENDPOINT,
+};
+
+// Attribute storage
+static uint32_t s_file_offset = 0xFFFFFFFF;
+static uint32_t s_current_version = CONFIG_OTA_FILE_VERSION;
+static uint8_t s_upgrade_status = OTA_UPGRADE_STATUS_NORMAL;
+static uint16_t s_manufacturer = CONFIG_OTA_MANUFACTURER_CODE;
+static uint16_t s_image_type = CONFIG_OTA_IMAGE_TYPE;
+
+static void ota_timeout(uint8_t param);
+
+/********************* Payloads (little endian) *********************/
+
+static uint8_t *put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    return put_u16(put_u16(p, v), v >> 16);
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Manufacturer, image type and file version, as in most requests
+static uint8_t *put_image_id(uint8_t *p, const ota_offer_t *offer)
 {
-    metrics_increment(METRIC_OTA_STARTED);
-    app_log(LOG_LEVEL_INFO, TAG, "Starting OTA update...");
+    return put_u32(put_u16(put_u16(p, offer->manufacturer), offer->image_type), offer->file_version);
+}
 
-    esp_http_client_config_t config = {
-        .url = OTA_URL,
-        .cert_pem = NULL,
+static bool same_image(const uint8_t *p, const ota_offer_t *offer)
+{
+    return get_u16(p) == offer->manufacturer && get_u16(p + 2) == offer->image_type &&
+           get_u32(p + 4) == offer->file_version;
+}
+
+static void ota_send(uint8_t cmd_id, const uint8_t *payload, size_t len)
+{
+    esp_zb_zcl_custom_cluster_cmd_req_t req = {
+        .zcl_basic_cmd = {
+            .dst_addr_u.addr_short = s_ota.server_addr,
+            .dst_endpoint = s_ota.server_endpoint,
+            .src_endpoint = s_ota.endpoint,
+        },
+        .address_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+        .profile_id = ESP_ZB_AF_HA_PROFILE_ID,
+        .cluster_id = OTA_UPGRADE_CLUSTER_ID,
+        .direction = ESP_ZB_ZCL_CMD_DIRECTION_TO_SRV,
+        .custom_cmd_id = cmd_id,
+        // Sent as is, without a length prefix
+        .data = {
+            .type = ESP_ZB_ZCL_ATTR_TYPE_SET,
+            .size = len,
+            .value = (void *)payload,
+        },
     };
+    esp_zb_zcl_custom_cluster_cmd_req(&req);
+}
+
+static void ota_set_attribute(uint16_t attr_id, void *value)
+{
+    esp_zb_zcl_set_attribute_val(s_ota.endpoint, OTA_UPGRADE_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_CLIENT_ROLE,
+                                 attr_id, value, false);
+}
+
+static void ota_set_status(uint8_t status)
+{
+    s_upgrade_status = status;
+    ota_set_attribute(OTA_ATTR_IMAGE_UPGRADE_STATUS, &s_upgrade_status);
+}
+
+static void ota_arm_timeout(uint32_t ms)
+{
+    esp_zb_scheduler_alarm_cancel(ota_timeout, 0);
+    esp_zb_scheduler_alarm(ota_timeout, 0, ms);
+}
+
+/********************* Resume points *********************/
+
+static bool ota_resume_load(ota_resume_t *resume)
+{
+    nvs_handle_t handle;
+    size_t len = sizeof(*resume);
+
+    if (nvs_open(OTA_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    esp_err_t ret = nvs_get_blob(handle, OTA_NVS_KEY, resume, &len);
+    nvs_close(handle);
+    return ret == ESP_OK && len == sizeof(*resume) && resume->version == OTA_RESUME_VERSION;
+}
 
-    esp_https_ota_config_t ota_config = {
-        .http_config = &config,
+static void ota_resume_save(const ota_image_t *image)
+{
+    ota_resume_t resume = {
+        .version = OTA_RESUME_VERSION,
+        .offer = s_ota.offer,
+        .image = *image,
     };
+    nvs_handle_t handle;
 
-    esp_err_t ret = esp_https_ota(&ota_config);
+    esp_err_t ret = nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &handle);
     if (ret == ESP_OK) {
-        app_log(LOG_LEVEL_INFO, TAG, "OTA update successful, rebooting...");
-        esp_restart();
+        ret = nvs_set_blob(handle, OTA_NVS_KEY, &resume, sizeof(resume));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        app_log(LOG_LEVEL_WARN, TAG, "Failed to save resume point: %s", esp_err_to_name(ret));
+    }
+}
+
+static void ota_resume_clear(void)
+{
+    nvs_handle_t handle;
+
+    if (nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK) {
+        if (nvs_erase_key(handle, OTA_NVS_KEY) == ESP_OK) {
+            nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+}
+
+/********************* Transfer *********************/
+
+static uint32_t ota_rate(void)
+{
+    int64_t elapsed_us = esp_timer_get_time() - s_ota.start_us;
+    uint64_t bytes = s_ota.image.offset - s_ota.start_offset;
+
+    return elapsed_us > 0 ? (uint32_t)(bytes * 1000000 / elapsed_us) : 0;
+}
+
+// Back to idle; a stored resume point is kept for the next offer of the same image
+static void ota_stop(void)
+{
+    esp_zb_scheduler_alarm_cancel(ota_timeout, 0);
+    s_ota.state = OTA_IDLE;
+    ota_set_status(OTA_UPGRADE_STATUS_NORMAL);
+    led_signal_set_state(LED_STATE_CONNECTED);
+}
+
+static void ota_fail(const char *reason, bool keep_resume)
+{
+    metrics_increment(METRIC_OTA_FAILED);
+    app_log(LOG_LEVEL_ERROR, TAG, "OTA update failed at %" PRIu32 " of %" PRIu32 " bytes: %s%s",
+            s_ota.image.offset, s_ota.offer.file_size, reason, keep_resume ? ", will resume" : "");
+    if (!keep_resume) {
+        ota_resume_clear();
+    }
+    ota_stop();
+}
+
+static void ota_query(void)
+{
+    const ota_offer_t current = {
+        .manufacturer = CONFIG_OTA_MANUFACTURER_CODE,
+        .image_type = CONFIG_OTA_IMAGE_TYPE,
+        .file_version = CONFIG_OTA_FILE_VERSION,
+    };
+    uint8_t payload[9];
+
+    payload[0] = 0;  // No hardware version
+    put_image_id(&payload[1], &current);
+    s_ota.state = OTA_QUERYING;
+    s_ota.retries = OTA_MAX_RETRIES;  // One try; the next query comes with the interval
+    ota_send(OTA_CMD_QUERY_NEXT_IMAGE_REQ, payload, sizeof(payload));
+    ota_arm_timeout(OTA_TIMEOUT_MS);
+}
+
+static void ota_request(void)
+{
+    uint8_t payload[18];
+    uint8_t *p = payload;
+
+    *p++ = 0;  // No IEEE address, no minimum block period
+    p = put_image_id(p, &s_ota.offer);
+    p = put_u32(p, s_ota.image.offset);
+    *p++ = CONFIG_OTA_BLOCK_SIZE;
+#if OTA_PAGE_REQUESTS
+    p = put_u16(p, CONFIG_OTA_PAGE_SIZE);
+    p = put_u16(p, CONFIG_OTA_RESPONSE_SPACING_MS);
+    s_ota.page_end = s_ota.image.offset + CONFIG_OTA_PAGE_SIZE;
+    ota_send(OTA_CMD_IMAGE_PAGE_REQ, payload, p - payload);
+#else
+    ota_send(OTA_CMD_IMAGE_BLOCK_REQ, payload, p - payload);
+#endif
+    ota_arm_timeout(OTA_TIMEOUT_MS);
+}
+
+// Blocks go straight to the partition, each sector erased when it is first reached
+static bool ota_write(uint32_t offset, const uint8_t *data, size_t len, void *arg)
+{
+    const esp_partition_t *partition = s_ota.partition;
+
+    if (offset + len > partition->size) {
+        return false;
+    }
+    while (s_ota.erased < offset + len) {
+        if (esp_partition_erase_range(partition, s_ota.erased, partition->erase_size) != ESP_OK) {
+            return false;
+        }
+        s_ota.erased += partition->erase_size;
+    }
+    return esp_partition_write(partition, offset, data, len) == ESP_OK;
+}
+
+static void ota_begin(void)
+{
+    ota_resume_t resume;
+
+    s_ota.partition = esp_ota_get_next_update_partition(NULL);
+    if (!s_ota.partition) {
+        app_log(LOG_LEVEL_ERROR, TAG, "No OTA partition to write to");
+        s_ota.state = OTA_IDLE;
+        return;
+    }
+
+    if (ota_resume_load(&resume) && memcmp(&resume.offer, &s_ota.offer, sizeof(s_ota.offer)) == 0) {
+        // Everything below the resume point is intact; its sector is erased again
+        s_ota.image = resume.image;
+        metrics_increment(METRIC_OTA_RESUMED);
+        app_log(LOG_LEVEL_INFO, TAG, "Resuming OTA of version 0x%08" PRIx32 " at %" PRIu32 " of %" PRIu32 " bytes",
+                s_ota.offer.file_version, s_ota.image.offset, s_ota.offer.file_size);
     } else {
-        app_log(LOG_LEVEL_ERROR, TAG, "OTA update failed: %s", esp_err_to_name(ret));
+        memset(&s_ota.image, 0, sizeof(s_ota.image));
+        ota_resume_clear();
+        metrics_increment(METRIC_OTA_STARTED);
+        app_log(LOG_LEVEL_INFO, TAG, "Downloading version 0x%08" PRIx32 ", %" PRIu32 " bytes, to %s",
+                s_ota.offer.file_version, s_ota.offer.file_size, s_ota.partition->label);
     }
+    s_ota.erased = s_ota.image.written;
+    s_ota.checkpoint = s_ota.image.written;
+    s_ota.start_us = esp_timer_get_time();
+    s_ota.start_offset = s_ota.image.offset;
+    s_ota.progress = (uint64_t)s_ota.image.offset * OTA_PROGRESS_STEPS / s_ota.offer.file_size;
+    s_ota.retries = 0;
+    s_ota.state = OTA_DOWNLOADING;
+    ota_set_status(OTA_UPGRADE_STATUS_DOWNLOADING);
+    led_signal_set_state(LED_STATE_OTA_UPDATE);
+    ota_request();
+}
+
+static void ota_end_request(uint8_t status)
+{
+    uint8_t payload[9];
 
-    vTaskDelete(NULL);
-}
\ No newline at end of file
+    payload[0] = status;
+    put_image_id(&payload[1], &s_ota.offer);
+    ota_send(OTA_CMD_UPGRADE_END_REQ, payload, sizeof(payload));
+}
+
+static void ota_finish(void)
+{
+    uint32_t rate = ota_rate();
+    int64_t elapsed_ms = (esp_timer_get_time() - s_ota.start_us) / 1000;
+
+    esp_zb_scheduler_alarm_cancel(ota_timeout, 0);
+    metrics_set(METRIC_OTA_BYTES_PER_S, rate);
+    app_log(LOG_LEVEL_INFO, TAG, "Received %" PRIu32 " bytes in %" PRId64 " ms, %" PRIu32 " B/s",
+            s_ota.image.offset - s_ota.start_offset, elapsed_ms, rate);
+    ota_resume_clear();
+
+    // Checks the image (hash, chip, segments) before making it the boot partition
+    esp_err_t ret = esp_ota_set_boot_partition(s_ota.partition);
+    if (ret != ESP_OK) {
+        ota_end_request(OTA_STATUS_INVALID_IMAGE);
+        ota_fail(esp_err_to_name(ret), false);
+        return;
+    }
+    app_log(LOG_LEVEL_INFO, TAG, "Image verified, waiting for the upgrade time");
+    s_ota.state = OTA_ENDING;
+    s_ota.retries = 0;
+    ota_set_status(OTA_UPGRADE_STATUS_WAITING);
+    ota_end_request(OTA_STATUS_SUCCESS);
+    ota_arm_timeout(OTA_TIMEOUT_MS);
+}
+
+static void ota_restart(uint8_t param)
+{
+    app_log(LOG_LEVEL_INFO, TAG, "Restarting into the new image");
+    relay_state_flush();
+    logger_flush(500);
+    esp_restart();
+}
+
+static void ota_receive(const uint8_t *data, size_t len)
+{
+    ota_image_t checkpoint;
+
+    switch (ota_image_feed(&s_ota.image, &s_ota.offer, data, len, ota_write, NULL)) {
+        case OTA_IMAGE_OK:
+            break;
+        case OTA_IMAGE_BAD_FILE:
+            ota_end_request(OTA_STATUS_INVALID_IMAGE);
+            ota_fail("not a valid OTA file", false);
+            return;
+        case OTA_IMAGE_MISMATCH:
+            ota_end_request(OTA_STATUS_INVALID_IMAGE);
+            ota_fail("file header does not match the offer", false);
+            return;
+        case OTA_IMAGE_WRITE_FAILED:
+            ota_end_request(OTA_STATUS_ABORT);
+            ota_fail("image does not fit the partition or flash write failed", false);
+            return;
+    }
+    s_ota.retries = 0;
+
+    if (s_ota.image.written - s_ota.checkpoint >= OTA_CHECKPOINT_BYTES &&
+        ota_image_checkpoint(&s_ota.image, OTA_CHECKPOINT_BYTES, &checkpoint)) {
+        ota_resume_save(&checkpoint);
+        s_ota.checkpoint = checkpoint.written;
+        s_file_offset = checkpoint.offset;
+        ota_set_attribute(OTA_ATTR_FILE_OFFSET, &s_file_offset);
+    }
+
+    uint8_t progress = (uint64_t)s_ota.image.offset * OTA_PROGRESS_STEPS / s_ota.offer.file_size;
+    if (progress > s_ota.progress && progress < OTA_PROGRESS_STEPS) {
+        s_ota.progress = progress;
+        app_log(LOG_LEVEL_INFO, TAG, "OTA %d%%: %" PRIu32 " of %" PRIu32 " bytes, %" PRIu32 " B/s",
+                progress * 100 / OTA_PROGRESS_STEPS, s_ota.image.offset, s_ota.offer.file_size, ota_rate());
+    }
+
+    if (ota_image_done(&s_ota.image)) {
+        ota_finish();
+    } else if (!OTA_PAGE_REQUESTS || s_ota.image.offset >= s_ota.page_end) {
+        ota_request();
+    } else {
+        ota_arm_timeout(OTA_TIMEOUT_MS);
+    }
+}
+
+static void ota_timeout(uint8_t param)
+{
+    if (++s_ota.retries > OTA_MAX_RETRIES) {
+        switch (s_ota.state) {
+            case OTA_QUERYING:
+                app_log(LOG_LEVEL_WARN, TAG, "No answer from the upgrade server");
+                s_ota.state = OTA_IDLE;
+                break;
+            case OTA_DOWNLOADING:
+                ota_fail("no response from the upgrade server", true);
+                break;
+            case OTA_ENDING:
+                // The new image is set to boot; do not wait for a server that went away
+                ota_restart(0);
+                break;
+            default:
+                break;
+        }
+        return;
+    }
+    if (s_ota.state == OTA_DOWNLOADING) {
+        ota_request();
+    } else if (s_ota.state == OTA_ENDING) {
+        ota_end_request(OTA_STATUS_SUCCESS);
+        ota_arm_timeout(OTA_TIMEOUT_MS);
+    }
+}
+
+/********************* Server commands *********************/
+
+static void ota_handle_image_notify(const uint8_t *p, size_t len, uint16_t addr, uint8_t endpoint)
+{
+    // Query jitter: only that percentage of the clients that see the notify should query
+    if (s_ota.state != OTA_IDLE || len < 2 || esp_random() % 100 >= p[1]) {
+        return;
+    }
+    s_ota.server_addr = addr;
+    s_ota.server_endpoint = endpoint;
+    ota_query();
+}
+
+static void ota_handle_query_response(const uint8_t *p, size_t len)
+{
+    if (s_ota.state != OTA_QUERYING || len < 1) {
+        return;
+    }
+    esp_zb_scheduler_alarm_cancel(ota_timeout, 0);
+    if (p[0] != OTA_STATUS_SUCCESS || len < 13) {
+        if (p[0] != OTA_STATUS_NO_IMAGE_AVAILABLE) {
+            app_log(LOG_LEVEL_WARN, TAG, "Query Next Image failed: status 0x%02x", p[0]);
+        }
+        s_ota.state = OTA_IDLE;
+        return;
+    }
+    s_ota.offer.manufacturer = get_u16(p + 1);
+    s_ota.offer.image_type = get_u16(p + 3);
+    s_ota.offer.file_version = get_u32(p + 5);
+    s_ota.offer.file_size = get_u32(p + 9);
+
+    const ota_offer_t running = {
+        .manufacturer = CONFIG_OTA_MANUFACTURER_CODE,
+        .image_type = CONFIG_OTA_IMAGE_TYPE,
+        .file_version = CONFIG_OTA_FILE_VERSION,
+    };
+    const char *reason = ota_image_offer_check(&s_ota.offer, &running);
+    if (reason) {
+        // Declined before the partition is touched
+        app_log(LOG_LEVEL_WARN, TAG, "Declining version 0x%08" PRIx32 " (manufacturer 0x%04x, type 0x%04x, %" PRIu32
+                " bytes): %s", s_ota.offer.file_version, s_ota.offer.manufacturer, s_ota.offer.image_type,
+                s_ota.offer.file_size, reason);
+        ota_end_request(OTA_STATUS_INVALID_IMAGE);
+        s_ota.state = OTA_IDLE;
+        return;
+    }
+    ota_begin();
+}
+
+static void ota_handle_block_response(const uint8_t *p, size_t len)
+{
+    if (s_ota.state != OTA_DOWNLOADING || len < 1) {
+        return;
+    }
+    switch (p[0]) {
+        case OTA_STATUS_SUCCESS: {
+            if (len < 14 || !same_image(p + 1, &s_ota.offer) || len < 14u + p[13]) {
+                return;
+            }
+            uint32_t offset = get_u32(p + 9);
+            uint8_t size = p[13];
+            if (offset == s_ota.image.offset) {
+                ota_receive(p + 14, size);
+            } else if (OTA_PAGE_REQUESTS && offset > s_ota.image.offset && offset + size >= s_ota.page_end) {
+                // A block of the page went missing: ask again from the gap
+                ota_request();
+            }
+            break;
+        }
+        case OTA_STATUS_WAIT_FOR_DATA: {
+            // Current time, request time (UTC s) and minimum block period (ms)
+            uint32_t delay_ms = len >= 11 && get_u32(p + 5) > get_u32(p + 1) ?
+                                (get_u32(p + 5) - get_u32(p + 1)) * 1000 : OTA_TIMEOUT_MS;
+            s_ota.retries = 0;
+            ota_arm_timeout(delay_ms);
+            break;
+        }
+        case OTA_STATUS_ABORT:
+            ota_fail("aborted by the server", true);
+            break;
+        default:
+            break;
+    }
+}
+
+static void ota_handle_end_response(const uint8_t *p, size_t len)
+{
+    if (s_ota.state != OTA_ENDING || len < 16 || !same_image(p, &s_ota.offer)) {
+        return;
+    }
+    uint32_t current_time = get_u32(p + 8);
+    uint32_t upgrade_time = get_u32(p + 12);
+
+    esp_zb_scheduler_alarm_cancel(ota_timeout, 0);
+    if (upgrade_time == 0xFFFFFFFF) {
+        // Wait for another Upgrade End Response with a time
+        return;
+    }
+    uint32_t delay_s = upgrade_time > current_time ? upgrade_time - current_time : 0;
+    app_log(LOG_LEVEL_INFO, TAG, "Upgrading in %" PRIu32 " s", delay_s);
+    esp_zb_scheduler_alarm(ota_restart, 0, delay_s * 1000 + 100);
+}
+
+bool ota_updater_raw_command(uint8_t bufid)
+{
+    zb_zcl_parsed_hdr_t *cmd_info = ZB_BUF_GET_PARAM(bufid, zb_zcl_parsed_hdr_t);
+
+    if (cmd_info->cluster_id != OTA_UPGRADE_CLUSTER_ID || cmd_info->is_common_command ||
+        cmd_info->cmd_direction != ZB_ZCL_FRAME_DIRECTION_TO_CLI) {
+        return false;
+    }
+
+    const uint8_t *payload = zb_buf_begin(bufid);
+    size_t len = zb_buf_len(bufid);
+    uint16_t addr = ZB_ZCL_PARSED_HDR_SHORT_DATA(cmd_info).source.u.short_addr;
+    uint8_t endpoint = ZB_ZCL_PARSED_HDR_SHORT_DATA(cmd_info).src_endpoint;
+
+    // Transfers stick to the server that answered the query
+    if (cmd_info->cmd_id == OTA_CMD_IMAGE_NOTIFY) {
+        ota_handle_image_notify(payload, len, addr, endpoint);
+    } else if (addr == s_ota.server_addr) {
+        switch (cmd_info->cmd_id) {
+            case OTA_CMD_QUERY_NEXT_IMAGE_RSP:
+                ota_handle_query_response(payload, len);
+                break;
+            case OTA_CMD_IMAGE_BLOCK_RSP:
+                ota_handle_block_response(payload, len);
+                break;
+            case OTA_CMD_UPGRADE_END_RSP:
+                ota_handle_end_response(payload, len);
+                break;
+            default:
+                break;
+        }
+    }
+    zb_buf_free(bufid);
+    return true;
+}
+
+/********************* Setup *********************/
+
+esp_zb_attribute_list_t *ota_updater_cluster_create(void)
+{
+    esp_zb_attribute_list_t *cluster = esp_zb_zcl_attr_list_create(OTA_UPGRADE_CLUSTER_ID);
+
+    esp_zb_custom_cluster_add_custom_attr(cluster, OTA_ATTR_FILE_OFFSET, ESP_ZB_ZCL_ATTR_TYPE_U32,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_file_offset);
+    esp_zb_custom_cluster_add_custom_attr(cluster, OTA_ATTR_CURRENT_FILE_VERSION, ESP_ZB_ZCL_ATTR_TYPE_U32,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_current_version);
+    esp_zb_custom_cluster_add_custom_attr(cluster, OTA_ATTR_IMAGE_UPGRADE_STATUS, ESP_ZB_ZCL_ATTR_TYPE_8BIT_ENUM,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_upgrade_status);
+    esp_zb_custom_cluster_add_custom_attr(cluster, OTA_ATTR_MANUFACTURER_ID, ESP_ZB_ZCL_ATTR_TYPE_U16,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_manufacturer);
+    esp_zb_custom_cluster_add_custom_attr(cluster, OTA_ATTR_IMAGE_TYPE_ID, ESP_ZB_ZCL_ATTR_TYPE_U16,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, &s_image_type);
+    return cluster;
+}
+
+static void ota_periodic(uint8_t param)
+{
+    if (s_ota.state == OTA_IDLE) {
+        ota_query();
+    }
+    esp_zb_scheduler_alarm(ota_periodic, 0, CONFIG_OTA_QUERY_INTERVAL_MIN * 60000UL);
+}
+
+static void ota_resume_query(uint8_t param)
+{
+    ota_updater_query();
+}
+
+void ota_updater_start(uint8_t endpoint)
+{
+    ota_resume_t resume;
+
+    s_ota.endpoint = endpoint;
+
+    if (ota_resume_load(&resume)) {
+        esp_zb_scheduler_alarm(ota_resume_query, 0, OTA_RESUME_DELAY_MS);
+    }
+    if (CONFIG_OTA_QUERY_INTERVAL_MIN > 0) {
+        esp_zb_scheduler_alarm(ota_periodic, 0, CONFIG_OTA_QUERY_INTERVAL_MIN * 60000UL);
+    }
+}
+
+void ota_updater_confirm_image(void)
+{
+    esp_ota_img_states_t state;
+
+    if (esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) == ESP_OK &&
+        state == ESP_OTA_IMG_PENDING_VERIFY) {
+        app_log(LOG_LEVEL_INFO, TAG, "New image is on the network, cancelling the rollback");
+        esp_ota_mark_app_valid_cancel_rollback();
+    }
+}
+
+void ota_updater_query(void)
+{
+    if (s_ota.state == OTA_IDLE) {
+        ota_query();
+    }
+}
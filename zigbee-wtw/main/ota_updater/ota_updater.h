@@ -2,14 +2,74 @@
 #ifndef OTA_UPDATER_H
 #define OTA_UPDATER_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "esp_err.h"
+#include "esp_zigbee_core.h"
 
-// OTA update settings
-#define OTA_URL "http://192.168.1.100:8070/zigbee_wtw.bin"
+/*
+ * Zigbee OTA Upgrade cluster (0x0019) client.
+ *
+ * The client asks the upgrade server (Zigbee2MQTT) for a new image when the
+ * server sends an Image Notify, when the trigger attribute below is written
+ * and every CONFIG_OTA_QUERY_INTERVAL_MIN. The image is fetched with Image
+ * Page Requests (a page of blocks per request, the server sends them
+ * CONFIG_OTA_RESPONSE_SPACING_MS apart) or one Image Block Request per block,
+ * and each block is written straight to the next OTA partition as it
+ * arrives. Every OTA_CHECKPOINT_BYTES of image a resume point is stored in
+ * NVS, so a transfer cut short by a restart or a lost link continues where
+ * it stopped the next time the same image is offered.
+ *
+ * Everything runs in the Zigbee task: the raw command hook, the scheduler
+ * alarms and the functions below.
+ */
+
+// Custom trigger: writing OTA_ATTR_ID queries the upgrade server right away
 #define OTA_CLUSTER_ID 0xFC01
 #define OTA_ATTR_ID 0x0001
 
-// Function declaration
-void ota_update_task(void *pvParameter);
+// Image bytes between resume points stored in NVS; a multiple of the flash sector size
+#define OTA_CHECKPOINT_BYTES    16384
+
+/**
+ * @brief Create the OTA Upgrade client cluster
+ *
+ * Add the result to the endpoint's cluster list as a client cluster.
+ */
+esp_zb_attribute_list_t *ota_updater_cluster_create(void);
+
+/**
+ * @brief Start periodic queries once the device is on the network
+ *
+ * Also continues an interrupted transfer soon. Call once.
+ *
+ * @param endpoint Endpoint the client cluster was registered on
+ */
+void ota_updater_start(uint8_t endpoint);
+
+/**
+ * @brief Confirm the running image once the device has joined or rejoined
+ *
+ * Cancels a pending rollback of a freshly installed image. Call on network
+ * steering or rejoin success only: an image that cannot get onto the network
+ * must stay unconfirmed so the bootloader rolls it back on the next reset.
+ */
+void ota_updater_confirm_image(void);
+
+/**
+ * @brief Ask the upgrade server for a new image now
+ *
+ * Does nothing while a transfer is running.
+ */
+void ota_updater_query(void);
+
+/**
+ * @brief Handle OTA Upgrade commands from the server
+ *
+ * Hook for esp_zb_raw_command_handler_register().
+ *
+ * @return true if the command was handled and the buffer freed
+ */
+bool ota_updater_raw_command(uint8_t bufid);
 
-#endif // OTA_UPDATER_H
\ No newline at end of file
+#endif // OTA_UPDATER_H
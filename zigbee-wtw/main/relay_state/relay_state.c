@@ -0,0 +1,116 @@
+#include <stddef.h>
+#include <stdatomic.h>
+#include "esp_timer.h"
+#include "nvs.h"
+#include "relay_state.h"
+#include "logger/logger.h"
+
+static const char *TAG = "RELAY_STATE";
+
+#define RELAY_STATE_NAMESPACE   "wtw"
+#define RELAY_STATE_KEY         "relay"
+
+static esp_timer_handle_t s_timer;
+static _Atomic int s_pending = -1;  // State to write, -1 if none
+static int s_saved = -1;            // State in NVS, -1 if unknown
+
+static void relay_state_write(int state)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(RELAY_STATE_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_u8(handle, RELAY_STATE_KEY, state);
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        app_log(LOG_LEVEL_ERROR, TAG, "Failed to save relay state: %s", esp_err_to_name(ret));
+        return;
+    }
+    s_saved = state;
+}
+
+static void relay_state_timer_cb(void *arg)
+{
+    int state = atomic_exchange(&s_pending, -1);
+    if (state >= 0 && state != s_saved) {
+        relay_state_write(state);
+    }
+}
+
+output_state_t relay_state_load(void)
+{
+    nvs_handle_t handle;
+    uint8_t state = STATE_DAY;
+
+    esp_err_t ret = nvs_open(RELAY_STATE_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_get_u8(handle, RELAY_STATE_KEY, &state);
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK || state > STATE_SHOWER) {
+        // The namespace only exists once something was saved
+        if (ret != ESP_ERR_NVS_NOT_FOUND) {
+            app_log(LOG_LEVEL_WARN, TAG, "Stored relay state unusable (%s), using day mode",
+                    ret == ESP_OK ? "out of range" : esp_err_to_name(ret));
+        }
+        return STATE_DAY;
+    }
+    s_saved = state;
+    return (output_state_t)state;
+}
+
+void relay_state_save(output_state_t state)
+{
+    if (!s_timer) {
+        const esp_timer_create_args_t args = {
+            .callback = relay_state_timer_cb,
+            .name = "relay_state",
+        };
+        if (esp_timer_create(&args, &s_timer) != ESP_OK) {
+            relay_state_write(state);
+            return;
+        }
+    }
+
+    atomic_store(&s_pending, state);
+    // Every change restarts the delay; the callback skips a state that is already stored
+    esp_timer_stop(s_timer);
+    esp_timer_start_once(s_timer, RELAY_STATE_SAVE_DELAY_MS * 1000ULL);
+}
+
+void relay_state_flush(void)
+{
+    if (s_timer) {
+        esp_timer_stop(s_timer);
+    }
+    relay_state_timer_cb(NULL);
+}
+
+esp_err_t relay_state_erase(void)
+{
+    nvs_handle_t handle;
+
+    if (s_timer) {
+        esp_timer_stop(s_timer);
+    }
+    atomic_store(&s_pending, -1);
+
+    esp_err_t ret = nvs_open(RELAY_STATE_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_OK;
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_erase_key(handle, RELAY_STATE_KEY);
+        if (ret == ESP_OK || ret == ESP_ERR_NVS_NOT_FOUND) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret == ESP_OK) {
+        s_saved = -1;
+    }
+    return ret;
+}
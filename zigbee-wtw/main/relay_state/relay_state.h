@@ -0,0 +1,40 @@
+#pragma once
+#ifndef RELAY_STATE_H
+#define RELAY_STATE_H
+
+#include "esp_err.h"
+#include "gpio_control/gpio_control.h"
+
+/*
+ * Last relay state, kept in NVS so a power cycle restores it.
+ *
+ * Saves are coalesced: the state is written RELAY_STATE_SAVE_DELAY_MS after
+ * the last change, and only if it differs from what is stored, so a burst
+ * of commands costs one NVS write and switching back and forth costs none.
+ */
+
+#define RELAY_STATE_SAVE_DELAY_MS   5000
+
+/**
+ * @brief Read the stored state
+ *
+ * Needs NVS initialized. Returns STATE_DAY if nothing valid was stored.
+ */
+output_state_t relay_state_load(void);
+
+/**
+ * @brief Store state after RELAY_STATE_SAVE_DELAY_MS, unless it changes again
+ */
+void relay_state_save(output_state_t state);
+
+/**
+ * @brief Write a pending save now, e.g. before a restart
+ */
+void relay_state_flush(void);
+
+/**
+ * @brief Forget the stored state, so the next boot starts in STATE_DAY
+ */
+esp_err_t relay_state_erase(void);
+
+#endif // RELAY_STATE_H
@@ -1,14 +1,17 @@
 
+#include "esp_timer.h"
 #include "zigbee_handler.h"
 
 static const char *TAG = "ZIGBEE_HANDLER";
 
+#define WTW_ENDPOINT 1
+
 // Basic device info
 const uint8_t manufacturer[] = {6, 'E', 'S', 'P', '-', '3', '2'};
 const uint8_t model[] = {3, 'W', 'T', 'W'};
 
-// Current output state (0=night, 1=day, 2=shower)
-static uint16_t current_output_state = 1; // Default to day mode
+// esp_timer time when the stack was started, for the rejoin time
+static int64_t stack_start_us;
 
 static const char *get_cluster_name(uint16_t cluster_id) {
     switch (cluster_id) {
@@ -16,6 +19,9 @@ static const char *get_cluster_name(uint16_t cluster_id) {
         case ESP_ZB_ZCL_CLUSTER_ID_IDENTIFY: return "Identify";
         case ESP_ZB_ZCL_CLUSTER_ID_MULTI_VALUE: return "Multistate Value";
         case OTA_CLUSTER_ID: return "OTA";
+        case ESP_ZB_ZCL_CLUSTER_ID_OTA_UPGRADE: return "OTA Upgrade";
+        case METRICS_CLUSTER_ID: return "Metrics";
+        case FLASH_LOG_CLUSTER_ID: return "Flash Log";
         default: return "Unknown";
     }
 }
@@ -29,12 +35,29 @@ static const char *get_multistate_attr_name(uint16_t attr_id) {
     }
 }
 
+// Record how long it took from stack start to network membership, once per boot
+static void log_join_time(const char *what)
+{
+    static bool logged = false;
+    int64_t now_us = esp_timer_get_time();
+    uint32_t join_ms = (uint32_t)((now_us - stack_start_us) / 1000);
+
+    if (logged) {
+        return;
+    }
+    logged = true;
+    metrics_set(METRIC_REJOIN_MS, join_ms);
+    app_log(LOG_LEVEL_INFO, TAG, "%s %lu ms after stack start, %lu ms after boot", what,
+            (unsigned long)join_ms, (unsigned long)(now_us / 1000));
+}
+
 // Zigbee signal handler
 void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
 {
     uint32_t *p_sg_p = signal_struct->p_app_signal;
     esp_zb_app_signal_type_t sig_type = *p_sg_p;
     esp_err_t err_status = signal_struct->esp_err_status;
+    static bool services_started = false;
 
     switch (sig_type) {
         case ESP_ZB_ZDO_SIGNAL_SKIP_STARTUP:
@@ -55,6 +78,14 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
                 } else {
                     app_log(LOG_LEVEL_INFO, TAG, "Device rebooted");
                     led_signal_set_state(LED_STATE_CONNECTED);
+                    log_join_time("Rejoined network");
+                    ota_updater_confirm_image();
+                }
+                if (!services_started) {
+                    metrics_zcl_start(WTW_ENDPOINT);
+                    flash_log_zcl_start(WTW_ENDPOINT);
+                    ota_updater_start(WTW_ENDPOINT);
+                    services_started = true;
                 }
             } else {
                 app_log(LOG_LEVEL_WARN, TAG, "Failed to initialize Zigbee stack (status: %s)",
@@ -72,7 +103,10 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
                         extended_pan_id[3], extended_pan_id[2], extended_pan_id[1], extended_pan_id[0],
                         esp_zb_get_pan_id(), esp_zb_get_current_channel(), esp_zb_get_short_address());
                 led_signal_set_state(LED_STATE_CONNECTED);
+                log_join_time("Joined network");
+                ota_updater_confirm_image();
             } else {
+                metrics_increment(METRIC_STEERING_FAILED);
                 app_log(LOG_LEVEL_INFO, TAG, "Network steering was not successful (status: %s)",
                         esp_err_to_name(err_status));
                 led_signal_set_state(LED_STATE_ERROR);
@@ -91,6 +125,8 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
 // Attribute handler for receiving commands
 static esp_err_t zb_attribute_handler(const esp_zb_zcl_set_attr_value_message_t *message)
 {
+    int64_t received_us = esp_timer_get_time();
+
     metrics_increment(METRIC_ZIGBEE_CMD_RECEIVED);
     led_signal_blink_once(800);
     app_log(LOG_LEVEL_INFO, TAG, "Attribute handler called");
@@ -115,6 +151,8 @@ static esp_err_t zb_attribute_handler(const esp_zb_zcl_set_attr_value_message_t
             
             if (new_value >= 0 && new_value <= 2) {
                 set_relay_outputs((output_state_t)new_value);
+                metrics_observe(METRIC_HIST_CMD_TO_RELAY_US, (uint32_t)(esp_timer_get_time() - received_us));
+                relay_state_save((output_state_t)new_value);
             } else {
                 app_log(LOG_LEVEL_WARN, TAG, "Invalid Present Value received: %d (valid range: 0-2)", new_value);
             }
@@ -129,8 +167,7 @@ static esp_err_t zb_attribute_handler(const esp_zb_zcl_set_attr_value_message_t
         }
     } else if (cluster == OTA_CLUSTER_ID) {
         if (attr_id == OTA_ATTR_ID) {
-            led_signal_set_state(LED_STATE_OTA_UPDATE);
-            xTaskCreate(&ota_update_task, "ota_update_task", 8192, NULL, 5, NULL);
+            ota_updater_query();
         }
     } else {
         app_log(LOG_LEVEL_WARN, TAG, "Unhandled cluster ID: 0x%04x", cluster);
@@ -142,10 +179,20 @@ static esp_err_t zb_attribute_handler(const esp_zb_zcl_set_attr_value_message_t
 // Action handler
 static esp_err_t zb_action_handler(esp_zb_core_action_callback_id_t callback_id, const void *message)
 {
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = ESP_OK;
+
     if (callback_id == ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID) {
-        return zb_attribute_handler((esp_zb_zcl_set_attr_value_message_t *)message);
+        ret = zb_attribute_handler((esp_zb_zcl_set_attr_value_message_t *)message);
     }
-    return ESP_OK;
+    metrics_observe(METRIC_HIST_ZB_CALLBACK_US, (uint32_t)(esp_timer_get_time() - start_us));
+    return ret;
+}
+
+// Raw ZCL commands, for the clusters the stack does not handle itself
+static bool zb_raw_command_handler(uint8_t bufid)
+{
+    return ota_updater_raw_command(bufid);
 }
 
 // Create Zigbee device
@@ -171,26 +218,38 @@ static void create_zigbee_device(void)
     esp_zb_multistate_value_cluster_cfg_t multistate_cfg = {
         .number_of_states = 3,
         .out_of_service = false,
-        .present_value = 1, // Default to day mode
+        .present_value = get_relay_outputs(), // Restored before the stack started
         .status_flags = 0,
     };
     esp_zb_attribute_list_t *multistate_cluster = esp_zb_multistate_value_cluster_create(&multistate_cfg);
 
-    // OTA cluster
+    // OTA trigger cluster
     esp_zb_attribute_list_t *ota_cluster = esp_zb_zcl_attr_list_create(OTA_CLUSTER_ID);
     uint8_t ota_attr_value = 0;
     esp_zb_cluster_add_attr(ota_cluster, OTA_CLUSTER_ID, OTA_ATTR_ID, ESP_ZB_ZCL_ATTR_TYPE_U8, ESP_ZB_ZCL_ATTR_ACCESS_READ_WRITE, &ota_attr_value);
 
+    // Metrics cluster, read-only
+    esp_zb_attribute_list_t *metrics_cluster = metrics_zcl_cluster_create();
+
+    // OTA Upgrade client
+    esp_zb_attribute_list_t *ota_upgrade_cluster = ota_updater_cluster_create();
+
+    // Newest persistent log lines, read-only
+    esp_zb_attribute_list_t *flash_log_cluster = flash_log_zcl_cluster_create();
+
     // Create cluster list
     esp_zb_cluster_list_t *cluster_list = esp_zb_zcl_cluster_list_create();
     esp_zb_cluster_list_add_basic_cluster(cluster_list, basic_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
     esp_zb_cluster_list_add_identify_cluster(cluster_list, identify_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
     esp_zb_cluster_list_add_multistate_value_cluster(cluster_list, multistate_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
     esp_zb_cluster_list_add_custom_cluster(cluster_list, ota_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+    esp_zb_cluster_list_add_custom_cluster(cluster_list, metrics_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+    esp_zb_cluster_list_add_custom_cluster(cluster_list, flash_log_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+    esp_zb_cluster_list_add_custom_cluster(cluster_list, ota_upgrade_cluster, ESP_ZB_ZCL_CLUSTER_CLIENT_ROLE);
     
     // Create endpoint
     esp_zb_endpoint_config_t endpoint_config = {
-        .endpoint = 1,
+        .endpoint = WTW_ENDPOINT,
         .app_profile_id = ESP_ZB_AF_HA_PROFILE_ID,
         .app_device_id = ESP_ZB_HA_SIMPLE_SENSOR_DEVICE_ID,
         .app_device_version = 1
@@ -199,6 +258,7 @@ static void create_zigbee_device(void)
     esp_zb_ep_list_add_ep(ep_list, cluster_list, endpoint_config);
     esp_zb_device_register(ep_list);
     esp_zb_core_action_handler_register(zb_action_handler);
+    esp_zb_raw_command_handler_register(zb_raw_command_handler);
     
     app_log(LOG_LEVEL_INFO, TAG, "WTW 2-relay controller device created");
 }
@@ -220,13 +280,11 @@ void zigbee_main_task(void *pvParameters)
     };
     esp_zb_init(&zb_nwk_cfg);
     
-    // Initialize relay outputs
-    init_relay_outputs();
-    
     // Create device
     create_zigbee_device();
     
-    // Start Zigbee stack
+    // Start Zigbee stack, keeping the network from the last boot
+    stack_start_us = esp_timer_get_time();
     ESP_ERROR_CHECK(esp_zb_start(false));
     
     // Main task loop
@@ -9,11 +9,14 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "gpio_control/gpio_control.h"
+#include "relay_state/relay_state.h"
 #include "ota_updater/ota_updater.h"
 #include "led_signal.h"
 
 #include "logger/logger.h"
 #include "metrics/metrics.h"
+#include "metrics/metrics_zcl.h"
+#include "flash_log_zcl.h"
 
 // External declarations for device info constants
 extern const uint8_t manufacturer[];